@@ -0,0 +1,58 @@
+#ifndef __AVS_PROXY_CLIENT_COM__
+#define __AVS_PROXY_CLIENT_COM__
+
+/**
+ * ѹõCom.h: ֻƴͼںõĲ, MFC, libeventSDL;
+ * ֻнѹ(BENCH_WITH_AVCODEC)ffmpeg.
+ * Monitor/Com.hеͬ屣һ.
+ */
+#include <memory>
+#include <functional>
+#include <vector>
+#include <mutex>
+
+#include <pjlib.h>
+#include <pjmedia.h>
+
+#ifdef BENCH_WITH_AVCODEC
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+#endif
+
+using std::vector;
+
+#define INVALID_SCREEN_INDEX      -1
+#define MAXIMAL_SCREEN_NUM         15
+#define MIN(m1, m2) ((m1) < (m2) ? (m1) : (m2))
+#define MAX(m1, m2) ((m1) > (m2) ? (m1) : (m2))
+enum { AUDIO_INDEX, VIDEO_INDEX };
+
+#define RETURN_VAL_IF_FAIL(_macro_exp_, _macro_ret_) do { \
+	if ( !(_macro_exp_) ) return (_macro_ret_); \
+} while(0)
+
+#define RETURN_IF_FAIL(_macro_exp_) do { \
+	if ( !(_macro_exp_) ) return; \
+} while(0)
+
+#define RETURN_VAL_WITH_STATEMENT_IF_FAIL(_macro_exp_, _statement_, _macro_ret_) do { \
+	if ( !(_macro_exp_) ) { (_statement_); return (_macro_ret_); }\
+} while(0)
+
+#define RETURN_WITH_STATEMENT_IF_FAIL(_macro_exp_, _statement_) do { \
+	if ( !(_macro_exp_) ) { (_statement_); return; }\
+} while(0)
+
+class Noncopyable
+{
+public:
+	Noncopyable() {}
+
+private:
+	Noncopyable(const Noncopyable &);
+	Noncopyable &operator=(const Noncopyable &);
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef __AVS_PROXY_CLIENT_RTP_SESSION__
+#define __AVS_PROXY_CLIENT_RTP_SESSION__
+
+#include "Config.h"
+#include "Com.h"
+
+/**
+ * ԳõRTPSession: ֻRTCPFeedbackõĽӿ, local_ipϿһUDP socketշ,
+ * libevent. Monitor/RTPSession.hеͬһ.
+ */
+class RTPSession
+{
+public:
+	RTPSession()
+		: rtp_sock_(-1)
+		, ssrc_(0)
+	{
+	}
+
+	pj_status_t Open()
+	{
+		pj_status_t status;
+		status = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &rtp_sock_);
+		RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+		pj_sockaddr_in addr;
+		status = pj_sockaddr_in_init(&addr, &g_client_config.local_ip, g_client_config.local_media_port);
+		RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+		ssrc_ = pj_rand();
+		return pj_sock_bind(rtp_sock_, &addr, sizeof(addr));
+	}
+
+	void Close()
+	{
+		pj_sock_close(rtp_sock_);
+	}
+
+	pj_status_t SendRTCPPacket(const pj_sockaddr_in &addr, const void *packet, pj_ssize_t packet_len)
+	{
+		pj_ssize_t size = packet_len;
+		return pj_sock_sendto(rtp_sock_, packet, &size, 0, &addr, sizeof(addr));
+	}
+
+	inline pj_uint32_t GetSSRC() const { return ssrc_; }
+
+private:
+	pj_sock_t   rtp_sock_;
+	pj_uint32_t ssrc_;
+};
+
+extern RTPSession g_rtp_session;
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef __AVS_PROXY_CLIENT_VIDEO_STREAM__
+#define __AVS_PROXY_CLIENT_VIDEO_STREAM__
+
+/**
+ * ѹõVideoStream.h: PjmediaDecoderֻõ뻺ĳߴ, jitter buffer̳߳.
+ * Monitor/VideoStream.hеͬ屣һ.
+ */
+#include "Com.h"
+
+#define VIDEO_WIDTH  320
+#define VIDEO_HEIGHT 240
+#define VIDEO_CLOCK_RATE 90000
+
+#endif
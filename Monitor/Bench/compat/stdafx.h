@@ -0,0 +1,2 @@
+// ѹLinuxϱ, MFC
+#pragma once
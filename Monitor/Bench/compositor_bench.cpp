@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <thread>
+#include <atomic>
+
+#include "Compositor.h"
+#include "ImageKernels.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "compositor_bench.cpp"
+
+#define BENCH_CANVAS_WIDTH    1920
+#define BENCH_CANVAS_HEIGHT   1080
+#define BENCH_FRAME_WIDTH     640
+#define BENCH_FRAME_HEIGHT    360
+
+/**
+ * headlessƴ: 3x5ַtiles, ÿӰfpsϳɵI420֡,
+ * ʱӡÿӷ, ֺͱǵ֡; ƴԼÿCOMPOSITOR_STATS_INTERVALγִӡһƽʱ.
+ * ÷: compositor_bench [=10] [=15] [fps=25] [ں=Զ]
+ */
+static video_frame_ptr_t make_frame(pj_uint32_t seq)
+{
+	const pj_uint32_t width = BENCH_FRAME_WIDTH, height = BENCH_FRAME_HEIGHT;
+	shared_ptr<vector<pj_uint8_t> > buffer(new vector<pj_uint8_t>(width * height * 3 / 2));
+	pj_uint8_t *y = &(*buffer)[0];
+	pj_uint8_t *u = y + width * height;
+	pj_uint8_t *v = u + width * height / 4;
+
+	// б֡ƽ, ÿ֡ݶͬ
+	for(pj_uint32_t row = 0; row < height; ++ row)
+	{
+		for(pj_uint32_t col = 0; col < width; ++ col)
+		{
+			y[row * width + col] = (pj_uint8_t)(16 + ((row + col + seq * 4) & 0x7f));
+		}
+	}
+	pj_memset(u, (pj_uint8_t)(seq & 0xff), width * height / 4);
+	pj_memset(v, 128, width * height / 4);
+
+	video_frame_t *frame = new video_frame_t;
+	frame->width_ = width;
+	frame->height_ = height;
+	frame->planes_[0] = y;
+	frame->planes_[1] = u;
+	frame->planes_[2] = v;
+	frame->pitches_[0] = width;
+	frame->pitches_[1] = width / 2;
+	frame->pitches_[2] = width / 2;
+	frame->buffer_ = buffer;
+
+	return video_frame_ptr_t(frame);
+}
+
+static void feed(pj_uint32_t tiles, pj_uint32_t fps, const std::atomic<bool> &active)
+{
+	pj_thread_desc desc;
+	pj_thread_t *pj_thread = nullptr;
+	pj_thread_register(NULL, desc, &pj_thread);
+
+	// Ԥһ֡, ֻƴ, ֡
+	vector<video_frame_ptr_t> frames;
+	for(pj_uint32_t i = 0; i < 16; ++ i)
+	{
+		frames.push_back(make_frame(i));
+	}
+
+	pj_timestamp start, now;
+	pj_get_timestamp(&start);
+	for(pj_uint32_t seq = 0; active; ++ seq)
+	{
+		for(pj_uint32_t idx = 0; idx < tiles; ++ idx)
+		{
+			g_compositor.Publish(idx, frames[(seq + idx) % frames.size()]);
+		}
+
+		pj_get_timestamp(&now);
+		pj_uint32_t elapsed = pj_elapsed_msec(&start, &now);
+		pj_uint32_t deadline = (seq + 1) * 1000 / fps;
+		if(deadline > elapsed)
+		{
+			pj_thread_sleep(deadline - elapsed);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	pj_uint32_t seconds = argc > 1 ? atoi(argv[1]) : 10;
+	pj_uint32_t tiles = argc > 2 ? MIN((pj_uint32_t)atoi(argv[2]), MAXIMAL_SCREEN_NUM) : MAXIMAL_SCREEN_NUM;
+	pj_uint32_t fps = argc > 3 ? MAX(atoi(argv[3]), 1) : 25;
+	pj_str_t isa = pj_str(argc > 4 ? argv[4] : (char *)"");
+
+	pj_status_t status = pj_init();
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+
+	g_client_config.letterbox = PJ_FALSE;
+	ImageKernels::Init(isa);
+
+	pj_str_t backend = pj_str((char *)"headless");
+	status = g_compositor.Prepare(nullptr, backend);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+
+	// 3x5
+	const pj_uint32_t cols = 5, rows = 3;
+	g_compositor.Resize(BENCH_CANVAS_WIDTH, BENCH_CANVAS_HEIGHT);
+	for(pj_uint32_t idx = 0; idx < tiles; ++ idx)
+	{
+		tile_rect_t rect = {(idx % cols) * BENCH_CANVAS_WIDTH / cols, (idx / cols) * BENCH_CANVAS_HEIGHT / rows,
+			BENCH_CANVAS_WIDTH / cols, BENCH_CANVAS_HEIGHT / rows};
+		g_compositor.SetTile(idx, rect);
+	}
+
+	status = g_compositor.Launch();
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+
+	std::atomic<bool> active(true);
+	std::thread feeder(std::bind(feed, tiles, fps, std::cref(active)));
+	pj_thread_sleep(seconds * 1000);
+	active = false;
+	feeder.join();
+	g_compositor.Destory();
+
+	printf("kernels[%s] %u tiles %ux%u -> %ux%u at %ufps for %us\n", ImageKernels::Get().name_, tiles,
+		BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, BENCH_CANVAS_WIDTH / cols, BENCH_CANVAS_HEIGHT / rows, fps, seconds);
+
+	pj_uint64_t decoded = 0, presented = 0, dropped = 0;
+	for(pj_uint32_t idx = 0; idx < tiles; ++ idx)
+	{
+		tile_counters_t counters;
+		RETURN_VAL_IF_FAIL(g_compositor.GetCounters(idx, counters) == PJ_SUCCESS, 1);
+		printf("tile %2u: decoded %u presented %u dropped %u\n", idx, counters.decoded_, counters.presented_, counters.dropped_);
+		decoded += counters.decoded_;
+		presented += counters.presented_;
+		dropped += counters.dropped_;
+	}
+	printf("total: decoded %llu presented %llu dropped %llu (%.1f%%)\n", (unsigned long long)decoded,
+		(unsigned long long)presented, (unsigned long long)dropped, decoded > 0 ? dropped * 100.0 / decoded : 0.0);
+
+	pj_shutdown();
+
+	return 0;
+}
@@ -0,0 +1,291 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <algorithm>
+#include <pjmedia-codec.h>
+
+#include "VideoDecoder.h"
+#include "VideoStream.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "decode_bench.cpp"
+
+#define BENCH_MTU           1400
+#define BENCH_TS_STEP       (VIDEO_CLOCK_RATE / 25)
+
+/**
+ * ͬһH264ƬԴֱ𽻸AvcodecDecoderPjmediaDecoder, ӡºÿ֡ʱ.
+ * ƬԴΪAnnex-B, Ȱaccess unitпpjmedia_h264_packetizeRTP, jitter bufferһ.
+ * PjmediaDecoderĽ뻺尴VIDEO_WIDTH x VIDEO_HEIGHT x 4, ƬԴܳ.
+ * ÷: decode_bench <ƬԴ.h264> [ѭ=10] [libavcodec߳=1] [߳=slice]
+ */
+typedef struct
+{
+	vector<vector<pj_uint8_t> > payloads_;
+	vector<pjmedia_frame>       packets_;
+} access_unit_t;
+
+typedef struct
+{
+	pj_uint32_t         decoded_;       // ͼ
+	pj_uint32_t         failed_;        // ʧܵaccess unit, ֡߳δ³ͼ
+	pj_uint32_t         first_picture_; // һͼǰaccess unit
+	pj_uint64_t         pixels_;
+	pj_uint32_t         elapsed_usec_;
+	vector<pj_uint32_t> call_usec_;     // ÿDecodeõĺʱ
+} decode_result_t;
+
+static pj_bool_t read_clip(const char *path, vector<pj_uint8_t> &clip)
+{
+	FILE *fp = fopen(path, "rb");
+	RETURN_VAL_IF_FAIL(fp != nullptr, PJ_FALSE);
+
+	pj_uint8_t chunk[64 * 1024];
+	size_t len;
+	while((len = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+	{
+		clip.insert(clip.end(), chunk, chunk + len);
+	}
+	fclose(fp);
+
+	return clip.empty() ? PJ_FALSE : PJ_TRUE;
+}
+
+// [from, size)һʼ(00 00 0100 00 00 01)λ, ûʱsize
+static size_t next_start_code(const vector<pj_uint8_t> &clip, size_t from)
+{
+	for(size_t pos = from; pos + 3 <= clip.size(); ++ pos)
+	{
+		if(clip[pos] == 0 && clip[pos + 1] == 0)
+		{
+			if(clip[pos + 2] == 1)
+			{
+				return pos;
+			}
+			else if(clip[pos + 2] == 0 && pos + 4 <= clip.size() && clip[pos + 3] == 1)
+			{
+				return pos;
+			}
+		}
+	}
+	return clip.size();
+}
+
+/**
+ * NALп, ͼĵһslice(first_mb_in_sliceΪ0)sliceAUD/SPS/PPS/SEIʱʼµaccess unit.
+ */
+static void split_access_units(const vector<pj_uint8_t> &clip, vector<std::pair<size_t, size_t> > &units)
+{
+	size_t au_start = next_start_code(clip, 0);
+	pj_bool_t has_slice = PJ_FALSE;
+	for(size_t nal = au_start; nal < clip.size(); )
+	{
+		size_t header = nal + (clip[nal + 2] == 1 ? 3 : 4);
+		size_t next = next_start_code(clip, header);
+		if(header < next)
+		{
+			pj_uint8_t type = clip[header] & 0x1f;
+			pj_bool_t is_slice = (type == 1 || type == 5) ? PJ_TRUE : PJ_FALSE;
+			pj_bool_t first_slice = is_slice && header + 1 < next && (clip[header + 1] & 0x80) ? PJ_TRUE : PJ_FALSE;
+			pj_bool_t is_prefix = (type == 6 || type == 7 || type == 8 || type == 9) ? PJ_TRUE : PJ_FALSE;
+			if(has_slice && (first_slice || is_prefix))
+			{
+				units.push_back(std::make_pair(au_start, nal));
+				au_start = nal;
+				has_slice = PJ_FALSE;
+			}
+			has_slice = has_slice || is_slice ? PJ_TRUE : PJ_FALSE;
+		}
+		nal = next;
+	}
+	if(has_slice)
+	{
+		units.push_back(std::make_pair(au_start, clip.size()));
+	}
+}
+
+static pj_status_t packetize(pj_pool_t *pool, const vector<pj_uint8_t> &clip, vector<access_unit_t> &units)
+{
+	pjmedia_h264_packetizer_cfg cfg;
+	pj_bzero(&cfg, sizeof(cfg));
+	cfg.mtu = BENCH_MTU;
+	cfg.mode = PJMEDIA_H264_PACKETIZER_MODE_NON_INTERLEAVED;
+
+	pjmedia_h264_packetizer *packetizer = nullptr;
+	pj_status_t status = pjmedia_h264_packetizer_create(pool, &cfg, &packetizer);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	vector<std::pair<size_t, size_t> > ranges;
+	split_access_units(clip, ranges);
+	RETURN_VAL_IF_FAIL(!ranges.empty(), PJ_ENOTFOUND);
+
+	units.resize(ranges.size());
+	for(size_t i = 0; i < ranges.size(); ++ i)
+	{
+		// ƴFU-Aʱpacketizeд, ÿaccess unitһ
+		vector<pj_uint8_t> bits(clip.begin() + ranges[i].first, clip.begin() + ranges[i].second);
+		unsigned pos = 0;
+		while(pos < bits.size())
+		{
+			const pj_uint8_t *payload = nullptr;
+			pj_size_t payload_len = 0;
+			status = pjmedia_h264_packetize(packetizer, &bits[0], bits.size(), &pos, &payload, &payload_len);
+			RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+			units[i].payloads_.push_back(vector<pj_uint8_t>(payload, payload + payload_len));
+		}
+
+		for(size_t j = 0; j < units[i].payloads_.size(); ++ j)
+		{
+			pjmedia_frame packet;
+			pj_bzero(&packet, sizeof(packet));
+			packet.type = PJMEDIA_FRAME_TYPE_VIDEO;
+			packet.buf = &units[i].payloads_[j][0];
+			packet.size = units[i].payloads_[j].size();
+			packet.timestamp.u64 = i * BENCH_TS_STEP;
+			units[i].packets_.push_back(packet);
+		}
+	}
+
+	return PJ_SUCCESS;
+}
+
+static pj_status_t run(VideoDecoder *decoder, pj_pool_t *pool, const vector<access_unit_t> &units, pj_uint32_t loops,
+	decode_result_t &result)
+{
+	pj_status_t status = decoder->Open(pool);
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(status == PJ_SUCCESS, decoder->Close(), status);
+
+	result.decoded_ = 0;
+	result.failed_ = 0;
+	result.first_picture_ = 0;
+	result.pixels_ = 0;
+	result.call_usec_.reserve(units.size() * loops);
+
+	pj_timestamp start, before, after;
+	pj_get_timestamp(&start);
+	for(pj_uint32_t loop = 0; loop < loops; ++ loop)
+	{
+		for(size_t i = 0; i < units.size(); ++ i)
+		{
+			pj_uint32_t ts = (pj_uint32_t)((loop * units.size() + i) * BENCH_TS_STEP);
+			video_frame_ptr_t frame;
+			pj_get_timestamp(&before);
+			status = decoder->Decode(&units[i].packets_[0], units[i].packets_.size(), ts, frame);
+			pj_get_timestamp(&after);
+			result.call_usec_.push_back(pj_elapsed_usec(&before, &after));
+
+			if(status != PJ_SUCCESS || frame == nullptr)
+			{
+				++ result.failed_;
+				continue;
+			}
+			if(result.decoded_ == 0)
+			{
+				result.first_picture_ = result.call_usec_.size();
+			}
+			++ result.decoded_;
+			result.pixels_ += (pj_uint64_t)frame->width_ * frame->height_;
+		}
+	}
+	pj_get_timestamp(&after);
+	result.elapsed_usec_ = pj_elapsed_usec(&start, &after);
+
+	decoder->Close();
+
+	return PJ_SUCCESS;
+}
+
+static void report(const char *name, decode_result_t &result)
+{
+	vector<pj_uint32_t> &usec = result.call_usec_;
+	RETURN_IF_FAIL(!usec.empty());
+
+	std::sort(usec.begin(), usec.end());
+	pj_uint64_t total = 0;
+	for(size_t i = 0; i < usec.size(); ++ i)
+	{
+		total += usec[i];
+	}
+
+	double seconds = result.elapsed_usec_ / 1000000.0;
+	printf("%-8s decoded %u failed %u in %.2fs: %.1f fps %.1f MPix/s, first picture after %u frames\n",
+		name, result.decoded_, result.failed_, seconds,
+		seconds > 0 ? result.decoded_ / seconds : 0.0, seconds > 0 ? result.pixels_ / seconds / 1000000.0 : 0.0,
+		result.first_picture_);
+	printf("%-8s decode call avg %.2fms p50 %.2fms p95 %.2fms max %.2fms\n", name,
+		total / 1000.0 / usec.size(), usec[usec.size() / 2] / 1000.0, usec[usec.size() * 95 / 100] / 1000.0,
+		usec.back() / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 2)
+	{
+		printf("usage: %s <clip.h264> [loops=10] [threads=1] [thread_type=slice]\n", argv[0]);
+		return 1;
+	}
+	pj_uint32_t loops = argc > 2 ? MAX(atoi(argv[2]), 1) : 10;
+
+	pj_status_t status = pj_init();
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+
+	g_client_config.decoder_threads = argc > 3 ? atoi(argv[3]) : 1;
+	g_client_config.decoder_thread_type = pj_str(argc > 4 ? argv[4] : (char *)"slice");
+	g_client_config.decoder_skip_frame = pj_str((char *)"");
+	g_client_config.decoder_fast = PJ_FALSE;
+
+	pj_caching_pool caching_pool;
+	pj_caching_pool_init(&caching_pool, &pj_pool_factory_default_policy, 0);
+	pj_pool_t *pool = pj_pool_create(&caching_pool.factory, "DecodeBenchPool", 1000, 1000, NULL);
+
+	// ScreenMgr::Prepareһ, PjmediaDecoderҪpjmediaı
+	status = pjmedia_video_format_mgr_create(pool, 64, 0, NULL);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+	status = pjmedia_converter_mgr_create(pool, NULL);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+	status = pjmedia_event_mgr_create(pool, 0, NULL);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+	status = pjmedia_vid_codec_mgr_create(pool, NULL);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+	status = pjmedia_codec_ffmpeg_vid_init(NULL, &caching_pool.factory);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+
+	vector<pj_uint8_t> clip;
+	vector<access_unit_t> units;
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(read_clip(argv[1], clip), printf("can not read %s\n", argv[1]), 1);
+	status = packetize(pool, clip, units);
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(status == PJ_SUCCESS, printf("can not packetize %s, status %d\n", argv[1], status), 1);
+
+	printf("clip %s: %u bytes, %u access units, %u loops, libavcodec threads[%u] thread_type[%s]\n", argv[1],
+		(pj_uint32_t)clip.size(), (pj_uint32_t)units.size(), loops, g_client_config.decoder_threads,
+		g_client_config.decoder_thread_type.ptr);
+
+	int failed = 0;
+	const char *names[] = {"ffmpeg", "pjmedia"};
+	for(pj_uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); ++ i)
+	{
+		VideoDecoder *decoder = VideoDecoder::Create(pj_str((char *)names[i]));
+		decode_result_t result;
+		status = run(decoder, pool, units, loops, result);
+		if(status != PJ_SUCCESS)
+		{
+			printf("%-8s open failed, status %d\n", decoder->Name(), status);
+			++ failed;
+		}
+		else
+		{
+			report(decoder->Name(), result);
+		}
+		delete decoder;
+	}
+
+	pjmedia_codec_ffmpeg_vid_deinit();
+	pj_pool_release(pool);
+	pj_caching_pool_destroy(&caching_pool);
+	pj_shutdown();
+
+	return failed;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+
+#include "ImageKernels.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "kernel_bench.cpp"
+
+#define KERNEL_BENCH_WIDTH      1920
+#define KERNEL_BENCH_HEIGHT     1080
+#define KERNEL_BENCH_MSEC       200     // ÿںô
+
+/**
+ * һ֡1080pĺϳͼϲָں, ԴؼMPix/s, ȷϷɵЧͱȽϲͬ.
+ */
+static void bench(const image_kernels_t &kernels, pj_bool_t reference)
+{
+	ImageKernels::Init(pj_str((char *)kernels.name_));
+
+	const pj_uint32_t width = KERNEL_BENCH_WIDTH, height = KERNEL_BENCH_HEIGHT;
+	vector<pj_uint8_t> frame(width * height * 3 / 2);
+	for(pj_uint32_t i = 0; i < frame.size(); ++ i)
+	{
+		frame[i] = (pj_uint8_t)((i * 7) ^ (i >> 11));
+	}
+	const pj_uint8_t *plane = &frame[0];
+
+	const pj_uint8_t *planes[3] = {plane, plane + width * height, plane + width * height * 5 / 4};
+	const pj_int32_t pitches[3] = {(pj_int32_t)width, (pj_int32_t)width / 2, (pj_int32_t)width / 2};
+
+	vector<pj_uint8_t> out(width * height * 4);
+	PlaneScaler scaler;
+	pj_uint32_t sums[3];
+
+	// ƴĵ͸: 640x360֡Ž1920x10803x5е384x360, ֻˮƽ
+	const pj_uint32_t tile_w = 640, tile_h = 360, cell_w = 384;
+	vector<pj_uint32_t> xmap(cell_w);
+	for(pj_uint32_t i = 0; i < cell_w; ++ i)
+	{
+		xmap[i] = PlaneScaler::MapCoord(i, tile_w, cell_w);
+	}
+
+	const char *names[] = {"bilinear 1080p->720p", "area 1080p->360p", "scale row 640->384", "i420 to bgra", "luma stats",
+		"copy plane", "fill plane"};
+	const pj_uint64_t pixels[] = {width * height, width * height, tile_w * height, width * height, width * height,
+		width * height, width * height};
+	pj_uint32_t count = reference ? 7 : 5;   // 䲻, ֻһ
+	for(pj_uint32_t k = 0; k < count; ++ k)
+	{
+		pj_timestamp begin, now;
+		pj_get_timestamp(&begin);
+		now = begin;
+
+		pj_uint32_t runs = 0;
+		while(pj_elapsed_msec(&begin, &now) < KERNEL_BENCH_MSEC)
+		{
+			switch(k)
+			{
+			case 0:
+				scaler.Scale(plane, width, width, height, &out[0], 1280, 1280, 720);
+				break;
+			case 1:
+				scaler.Scale(plane, width, width, height, &out[0], 640, 640, 360);
+				break;
+			case 2:
+				for(pj_uint32_t y = 0; y < height; ++ y)
+				{
+					kernels.scale_row_(&out[0] + (y % tile_h) * cell_w, plane + y * width, &xmap[0], cell_w);
+				}
+				break;
+			case 3:
+				ImageKernels::I420ToBgra(planes, pitches, width, height, &out[0], width * 4);
+				break;
+			case 4:
+				for(pj_uint32_t y = 0; y + 1 < height; ++ y)
+				{
+					kernels.luma_stats_row_(plane + y * width, plane + (y + 1) * width, width, sums);
+				}
+				break;
+			case 5:
+				ImageKernels::CopyPlane(plane, width, &out[0], width + 64, width, height);
+				break;
+			default:
+				ImageKernels::FillPlane(&out[0], width + 64, width, height, (pj_uint8_t)runs);
+				break;
+			}
+			++ runs;
+			pj_get_timestamp(&now);
+		}
+
+		pj_uint32_t usec = MAX(pj_elapsed_usec(&begin, &now), 1);
+		printf("[%s] %s: %u runs, %u MPix/s\n", kernels.name_, names[k], runs, (pj_uint32_t)(runs * pixels[k] / usec));
+	}
+}
+
+int main()
+{
+	pj_status_t status = pj_init();
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+
+	for(pj_uint32_t isa = KERNEL_ISA_C; isa < KERNEL_ISA_COUNT; ++ isa)
+	{
+		const image_kernels_t *kernels = ImageKernels::Table((kernel_isa_t)isa);
+		if(kernels != nullptr)
+		{
+			bench(*kernels, isa == KERNEL_ISA_C ? PJ_TRUE : PJ_FALSE);
+		}
+	}
+
+	pj_shutdown();
+
+	return 0;
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <algorithm>
+
+#include "ImageKernels.h"
+#include "AudioKernels.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "kernel_test.cpp"
+
+#define CHECK(_name_, _exp_) do { \
+	if ( !(_exp_) ) { printf("%s: %s differs from c at round %u\n", kernels.name_, (_name_), round); return PJ_FALSE; } \
+} while(0)
+
+#define MAX_WIDTH 1283
+
+/**
+ * ָںC汾ֽڱȶ. ù̶ӵα, SIMDѭ, β͸.
+ * CPUֵָ֧. ȫһʱ0.
+ */
+static pj_uint32_t round_width(pj_uint32_t round)
+{
+	return round < 80 ? round + 1 : MAX_WIDTH - (round - 80) * 7;
+}
+
+static pj_bool_t verify_image(const image_kernels_t &kernels, const image_kernels_t &reference)
+{
+	vector<pj_uint8_t> a(MAX_WIDTH), b(MAX_WIDTH), u(MAX_WIDTH), v(MAX_WIDTH);
+	vector<pj_uint8_t> expected(4 * MAX_WIDTH), actual(4 * MAX_WIDTH);
+	vector<pj_uint16_t> acc_expected(MAX_WIDTH), acc_actual(MAX_WIDTH);
+	vector<pj_uint32_t> xmap(MAX_WIDTH);
+	pj_uint32_t sums_expected[3], sums_actual[3];
+
+	pj_uint32_t seed = 0x2545f491;
+	for(pj_uint32_t round = 0; round < 96; ++ round)
+	{
+		pj_uint32_t width = round_width(round);
+		for(pj_uint32_t i = 0; i < MAX_WIDTH; ++ i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			a[i] = (pj_uint8_t)(seed >> 24);
+			b[i] = (pj_uint8_t)(seed >> 16);
+			u[i] = (pj_uint8_t)(seed >> 8);
+			v[i] = (pj_uint8_t)((seed >> 24) ^ (seed >> 4));
+			acc_expected[i] = acc_actual[i] = (pj_uint16_t)(seed % 60000);
+		}
+
+		// ֵҲҪǵ
+		if(round % 4 == 0)
+		{
+			std::fill(a.begin(), a.end(), (pj_uint8_t)(round % 8 == 0 ? 0 : 255));
+			std::fill(u.begin(), u.end(), (pj_uint8_t)(round % 8 == 0 ? 255 : 0));
+		}
+
+		pj_uint32_t f = round % 3 == 0 ? (round * 37) & 0xff : (round % 2 == 0 ? 0 : 255);
+		reference.blend_rows_(&expected[0], &a[0], &b[0], width, f);
+		kernels.blend_rows_(&actual[0], &a[0], &b[0], width, f);
+		CHECK("blend_rows", pj_memcmp(&expected[0], &actual[0], width) == 0);
+
+		// ŴСǵ, ԴȲMAX_WIDTH
+		pj_uint32_t src_width = 2 + seed % (MAX_WIDTH - 1);
+		for(pj_uint32_t i = 0; i < width; ++ i)
+		{
+			xmap[i] = PlaneScaler::MapCoord(i, src_width, width);
+		}
+		reference.scale_row_(&expected[0], &b[0], &xmap[0], width);
+		kernels.scale_row_(&actual[0], &b[0], &xmap[0], width);
+		CHECK("scale_row", pj_memcmp(&expected[0], &actual[0], width) == 0);
+
+		reference.accumulate_row_(&acc_expected[0], &a[0], width);
+		kernels.accumulate_row_(&acc_actual[0], &a[0], width);
+		CHECK("accumulate_row", pj_memcmp(&acc_expected[0], &acc_actual[0], width * sizeof(pj_uint16_t)) == 0);
+
+		reference.i420_to_bgra_row_(&expected[0], &a[0], &u[0], &v[0], width);
+		kernels.i420_to_bgra_row_(&actual[0], &a[0], &u[0], &v[0], width);
+		CHECK("i420_to_bgra_row", pj_memcmp(&expected[0], &actual[0], 4 * width) == 0);
+
+		reference.luma_stats_row_(&a[0], &b[0], width, sums_expected);
+		kernels.luma_stats_row_(&a[0], &b[0], width, sums_actual);
+		CHECK("luma_stats_row", pj_memcmp(sums_expected, sums_actual, sizeof(sums_expected)) == 0);
+	}
+
+	return PJ_TRUE;
+}
+
+static pj_bool_t verify_audio(const audio_kernels_t &kernels, const audio_kernels_t &reference)
+{
+	vector<pj_uint8_t> b(MAX_WIDTH), u(MAX_WIDTH);
+	vector<pj_int16_t> pcm(MAX_WIDTH / 2), pcm_expected(MAX_WIDTH / 2), pcm_actual(MAX_WIDTH / 2);
+
+	pj_uint32_t seed = 0x2545f491;
+	for(pj_uint32_t round = 0; round < 96; ++ round)
+	{
+		for(pj_uint32_t i = 0; i < MAX_WIDTH; ++ i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			b[i] = (pj_uint8_t)(seed >> 16);
+			u[i] = (pj_uint8_t)(seed >> 8);
+		}
+
+		if(round % 4 == 0)
+		{
+			std::fill(u.begin(), u.end(), (pj_uint8_t)(round % 8 == 0 ? 255 : 0));
+		}
+
+		// , ֽһ
+		pj_uint32_t samples = round_width(round) / 2;
+		reference.l16_to_pcm_(&pcm_expected[0], &b[0], samples);
+		kernels.l16_to_pcm_(&pcm_actual[0], &b[0], samples);
+		CHECK("l16_to_pcm", pj_memcmp(&pcm_expected[0], &pcm_actual[0], samples * sizeof(pj_int16_t)) == 0);
+
+		reference.l16_to_pcm_(&pcm[0], &u[0], samples);
+		if(round % 4 == 1)
+		{
+			for(pj_uint32_t i = 0; i < samples; ++ i)
+			{
+				pcm[i] = (pj_int16_t)(i % 2 == 0 ? -32768 : 32767);
+				pcm_expected[i] = pcm_actual[i] = pcm[i];
+			}
+		}
+
+		pj_uint64_t energy_expected, energy_actual;
+		pj_uint32_t peak_expected, peak_actual;
+		reference.pcm_energy_(&pcm[0], samples, &energy_expected, &peak_expected);
+		kernels.pcm_energy_(&pcm[0], samples, &energy_actual, &peak_actual);
+		CHECK("pcm_energy", energy_expected == energy_actual && peak_expected == peak_actual);
+
+		reference.mix_pcm_(&pcm_expected[0], &pcm[0], samples);
+		kernels.mix_pcm_(&pcm_actual[0], &pcm[0], samples);
+		CHECK("mix_pcm", pj_memcmp(&pcm_expected[0], &pcm_actual[0], samples * sizeof(pj_int16_t)) == 0);
+	}
+
+	return PJ_TRUE;
+}
+
+int main()
+{
+	const image_kernels_t *reference = ImageKernels::Table(KERNEL_ISA_C);
+	const audio_kernels_t *audio_reference = AudioKernels::Table(KERNEL_ISA_C);
+
+	int failed = 0;
+	for(pj_uint32_t isa = KERNEL_ISA_C + 1; isa < KERNEL_ISA_COUNT; ++ isa)
+	{
+		const image_kernels_t *kernels = ImageKernels::Table((kernel_isa_t)isa);
+		if(kernels == nullptr)
+		{
+			printf("isa %u: not supported by this cpu, skipped\n", isa);
+			continue;
+		}
+
+		pj_bool_t ok = verify_image(*kernels, *reference);
+		printf("image %s: %s\n", kernels->name_, ok ? "ok" : "FAILED");
+		failed += ok ? 0 : 1;
+
+		const audio_kernels_t *audio = AudioKernels::Table((kernel_isa_t)isa);
+		ok = verify_audio(*audio, *audio_reference);
+		printf("audio %s for %s: %s\n", audio->name_, kernels->name_, ok ? "ok" : "FAILED");
+		failed += ok ? 0 : 1;
+	}
+
+	return failed;
+}
@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <set>
+
+#include "RTCPFeedback.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "rtcp_test.cpp"
+
+#define CHECK(_name_, _exp_) do { \
+	if ( !(_exp_) ) { printf("%s: %s failed at line %d\n", __FUNCTION__, (_name_), __LINE__); return PJ_FALSE; } \
+} while(0)
+
+#define TEST_NACK_INTERVAL  50      // ms
+#define TEST_VIDEO_SSRC     0x11223344
+#define TEST_KEYFRAME_SSRC  0x55667788
+#define TEST_WAIT_SSRC      0x99aabbcc
+
+RTPSession g_rtp_session;
+
+/**
+ * ػػϵģproxy. RTCPFeedbackѷյRTPԴַ, ԴַΪproxysocket,
+ * ٴյĸϰвRR, NACK, PLIFIR.
+ * ssrcRTPͷһ°ԭȽ, ֽת.
+ */
+class MockProxy
+{
+public:
+	MockProxy()
+		: sock_(-1)
+		, reports_(0)
+	{
+		pj_bzero(&addr_, sizeof(addr_));
+	}
+
+	pj_status_t Open()
+	{
+		pj_status_t status;
+		status = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &sock_);
+		RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+		pj_str_t ip = pj_str((char *)"127.0.0.1");
+		status = pj_sockaddr_in_init(&addr_, &ip, 0);
+		RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+		status = pj_sock_bind(sock_, &addr_, sizeof(addr_));
+		RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+		int len = sizeof(addr_);
+		return pj_sock_getsockname(sock_, &addr_, &len);
+	}
+
+	void Close()
+	{
+		pj_sock_close(sock_);
+	}
+
+	inline const pj_sockaddr_in &Addr() const { return addr_; }
+
+	// ѵİ, wait_msecȵһ
+	void Drain(pj_uint32_t wait_msec)
+	{
+		pj_time_val timeout = {0, (long)wait_msec};
+		while(PJ_TRUE)
+		{
+			pj_fd_set_t readable;
+			PJ_FD_ZERO(&readable);
+			PJ_FD_SET(sock_, &readable);
+			RETURN_IF_FAIL(pj_sock_select(sock_ + 1, &readable, NULL, NULL, &timeout) > 0);
+
+			pj_uint8_t packet[RTCP_MAX_PACKET_SIZE];
+			pj_ssize_t len = sizeof(packet);
+			RETURN_IF_FAIL(pj_sock_recv(sock_, packet, &len, 0) == PJ_SUCCESS);
+			Parse(packet, (pj_uint32_t)len);
+
+			timeout.msec = 0;
+		}
+	}
+
+	std::multiset<pj_uint16_t> nacked_;     // ÿNACK, ظNACKƶ
+	pj_uint32_t                reports_;
+	std::multiset<pj_uint32_t> plis_;       // ÿPLImedia ssrc
+	std::multiset<pj_uint32_t> firs_;       // ÿFIRĿssrc
+	vector<pj_uint8_t>         fir_seqs_;
+
+private:
+	static pj_bool_t SameSsrc(const pj_uint8_t *p, pj_uint32_t ssrc)
+	{
+		return pj_memcmp(p, &ssrc, sizeof(ssrc)) == 0 ? PJ_TRUE : PJ_FALSE;
+	}
+
+	static pj_uint32_t Ssrc(const pj_uint8_t *p)
+	{
+		pj_uint32_t ssrc;
+		pj_memcpy(&ssrc, p, sizeof(ssrc));
+		return ssrc;
+	}
+
+	void Parse(const pj_uint8_t *packet, pj_uint32_t packetlen)
+	{
+		pj_uint32_t offset = 0;
+		while(offset + 8 <= packetlen)
+		{
+			const pj_uint8_t *p = packet + offset;
+			pj_uint32_t size = ((((pj_uint32_t)p[2] << 8) | p[3]) + 1) * 4;
+			RETURN_IF_FAIL(offset + size <= packetlen);
+
+			pj_uint8_t fmt = p[0] & 0x1f;
+			if(p[1] == RTCP_PT_RR)
+			{
+				++ reports_;
+			}
+			else if(p[1] == RTCP_PT_RTPFB && fmt == RTCP_FMT_NACK && SameSsrc(p + 8, TEST_VIDEO_SSRC))
+			{
+				for(pj_uint32_t fci = 12; fci + 4 <= size; fci += 4)
+				{
+					pj_uint16_t pid = (pj_uint16_t)((p[fci] << 8) | p[fci + 1]);
+					pj_uint16_t blp = (pj_uint16_t)((p[fci + 2] << 8) | p[fci + 3]);
+					nacked_.insert(pid);
+					for(pj_uint32_t bit = 0; bit < 16; ++ bit)
+					{
+						if(blp & (1 << bit))
+						{
+							nacked_.insert((pj_uint16_t)(pid + bit + 1));
+						}
+					}
+				}
+			}
+			else if(p[1] == RTCP_PT_PSFB && fmt == RTCP_FMT_PLI)
+			{
+				plis_.insert(Ssrc(p + 8));
+			}
+			else if(p[1] == RTCP_PT_PSFB && fmt == RTCP_FMT_FIR && size >= 20)
+			{
+				firs_.insert(Ssrc(p + 12));
+				fir_seqs_.push_back(p[16]);
+			}
+
+			offset += size;
+		}
+	}
+
+	pj_sock_t      sock_;
+	pj_sockaddr_in addr_;
+};
+
+static void feed(const MockProxy &proxy, pj_uint32_t ssrc, pj_uint16_t seq)
+{
+	pjmedia_rtp_hdr hdr;
+	pj_bzero(&hdr, sizeof(hdr));
+	hdr.v = 2;
+	hdr.seq = pj_htons(seq);
+	hdr.ts = pj_htonl((pj_uint32_t)seq * 3000);
+	hdr.ssrc = ssrc;
+	g_rtcp_feedback.OnRxRtp(&hdr, 1000, proxy.Addr());
+}
+
+static pj_uint32_t elapsed_msec(const pj_timestamp &since)
+{
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	return pj_elapsed_msec(&since, &now);
+}
+
+/**
+ * : ÿȱڶNACK, ڲظNACK, ٵİNACK,
+ * ÿNACK NACK_MAX_RETRIES, NACK_MAX_AGENACK, 䲻NACK.
+ */
+static pj_bool_t test_nack(MockProxy &proxy)
+{
+	static const pj_uint16_t lost[] = {1010, 1011, 1050, 1070, 1071, 1072, 1073, 1090};
+	std::set<pj_uint16_t> expected(lost, lost + sizeof(lost) / sizeof(lost[0]));
+
+	g_rtcp_feedback.Track(TEST_VIDEO_SSRC);
+	for(pj_uint16_t seq = 1000; seq < 1100; ++ seq)
+	{
+		if(expected.count(seq) == 0)
+		{
+			feed(proxy, TEST_VIDEO_SSRC, seq);
+		}
+	}
+
+	pj_timestamp sent;
+	pj_get_timestamp(&sent);
+	g_rtcp_feedback.OnTimer();
+	proxy.Drain(100);
+	CHECK("report sent", proxy.reports_ > 0);
+	CHECK("every gap nacked once", std::set<pj_uint16_t>(proxy.nacked_.begin(), proxy.nacked_.end()) == expected
+		&& proxy.nacked_.size() == expected.size());
+
+	// ٴʱظNACK
+	g_rtcp_feedback.OnTimer();
+	proxy.Drain(10);
+	if(elapsed_msec(sent) < TEST_NACK_INTERVAL)
+	{
+		CHECK("nack rate limited", proxy.nacked_.size() == expected.size());
+	}
+
+	// 1050ٵ, ֮NACK
+	feed(proxy, TEST_VIDEO_SSRC, 1050);
+	pj_thread_sleep(TEST_NACK_INTERVAL + 10);
+	g_rtcp_feedback.OnTimer();
+	proxy.Drain(100);
+	CHECK("late packet not nacked again", proxy.nacked_.count(1050) == 1);
+	CHECK("missing packet nacked again", proxy.nacked_.count(1010) >= 2);
+
+	// ԴʱЧNACK
+	while(elapsed_msec(sent) <= NACK_MAX_AGE + TEST_NACK_INTERVAL)
+	{
+		pj_thread_sleep(TEST_NACK_INTERVAL / 5);
+		g_rtcp_feedback.OnTimer();
+		proxy.Drain(0);
+	}
+	for(std::set<pj_uint16_t>::const_iterator pseq = expected.begin(); pseq != expected.end(); ++ pseq)
+	{
+		CHECK("nack retries capped", proxy.nacked_.count(*pseq) <= NACK_MAX_RETRIES);
+	}
+	pj_uint32_t total = proxy.nacked_.size();
+	pj_thread_sleep(TEST_NACK_INTERVAL + 10);
+	g_rtcp_feedback.OnTimer();
+	proxy.Drain(50);
+	CHECK("exhausted entries retired", proxy.nacked_.size() == total);
+
+	// İNACK_MAX_GAPΪ
+	feed(proxy, TEST_VIDEO_SSRC, 1099 + NACK_MAX_GAP + 10);
+	pj_thread_sleep(TEST_NACK_INTERVAL + 10);
+	g_rtcp_feedback.OnTimer();
+	proxy.Drain(50);
+	CHECK("seq jump not nacked", proxy.nacked_.size() == total);
+
+	g_rtcp_feedback.Untrack(TEST_VIDEO_SSRC);
+
+	return PJ_TRUE;
+}
+
+/**
+ * ÿ10msһιؼ֡, PLI֮ٸRTCP_KEYFRAME_REQ_INTERVAL;
+ * FIRFIRPLI, ŵ; ֪proxyַʱһ.
+ */
+static pj_bool_t test_keyframe(MockProxy &proxy)
+{
+	g_rtcp_feedback.Track(TEST_KEYFRAME_SSRC);
+	feed(proxy, TEST_KEYFRAME_SSRC, 1);
+
+	pj_timestamp start;
+	pj_get_timestamp(&start);
+	while(elapsed_msec(start) < RTCP_KEYFRAME_REQ_INTERVAL * 2 + 200)
+	{
+		g_rtcp_feedback.RequestKeyframe(TEST_KEYFRAME_SSRC, PJ_FALSE);
+		g_rtcp_feedback.OnTimer();
+		proxy.Drain(0);
+		pj_thread_sleep(RTCP_TIMER_INTERVAL);
+	}
+	proxy.Drain(50);
+	pj_uint32_t elapsed = elapsed_msec(start);
+	pj_uint32_t plis = proxy.plis_.count(TEST_KEYFRAME_SSRC);
+	CHECK("pli sent", plis >= 2);
+	CHECK("pli rate limited", plis <= 1 + elapsed / RTCP_KEYFRAME_REQ_INTERVAL);
+	CHECK("no fir before asked", proxy.firs_.empty());
+
+	// FIRPLIͬʱʱFIR
+	for(pj_uint32_t i = 0; i < 2; ++ i)
+	{
+		pj_thread_sleep(RTCP_KEYFRAME_REQ_INTERVAL + 10);
+		g_rtcp_feedback.RequestKeyframe(TEST_KEYFRAME_SSRC, PJ_TRUE);
+		g_rtcp_feedback.RequestKeyframe(TEST_KEYFRAME_SSRC, PJ_FALSE);
+		g_rtcp_feedback.OnTimer();
+		proxy.Drain(100);
+	}
+	CHECK("fir sent", proxy.firs_.count(TEST_KEYFRAME_SSRC) == 2 && proxy.plis_.count(TEST_KEYFRAME_SSRC) == plis);
+	CHECK("fir seq increments", proxy.fir_seqs_.size() == 2 && (pj_uint8_t)(proxy.fir_seqs_[1] - proxy.fir_seqs_[0]) == 1);
+	g_rtcp_feedback.Untrack(TEST_KEYFRAME_SSRC);
+
+	// ûյǰ֪
+	g_rtcp_feedback.Track(TEST_WAIT_SSRC);
+	g_rtcp_feedback.RequestKeyframe(TEST_WAIT_SSRC, PJ_FALSE);
+	g_rtcp_feedback.OnTimer();
+	pj_uint32_t reports = proxy.reports_;
+	proxy.Drain(50);
+	CHECK("nothing sent without peer", proxy.reports_ == reports && proxy.plis_.count(TEST_WAIT_SSRC) == 0);
+	feed(proxy, TEST_WAIT_SSRC, 1);
+	g_rtcp_feedback.OnTimer();
+	proxy.Drain(100);
+	CHECK("request kept until first packet", proxy.plis_.count(TEST_WAIT_SSRC) == 1);
+	g_rtcp_feedback.Untrack(TEST_WAIT_SSRC);
+
+	return PJ_TRUE;
+}
+
+/**
+ * ػػRTCPFeedbackģproxy֮շ, NACKɺPLI/FIR. ȫͨʱ0.
+ */
+int main()
+{
+	pj_status_t status = pj_init();
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, 1);
+
+	g_client_config.rtcp_enable = PJ_TRUE;
+	g_client_config.rtcp_interval = 1000;
+	g_client_config.nack_interval = TEST_NACK_INTERVAL;
+	g_client_config.local_ip = pj_str((char *)"127.0.0.1");
+	g_client_config.local_media_port = 0;
+
+	MockProxy proxy;
+	RETURN_VAL_IF_FAIL(g_rtp_session.Open() == PJ_SUCCESS && proxy.Open() == PJ_SUCCESS, 1);
+
+	int failed = 0;
+	pj_bool_t ok = test_nack(proxy);
+	printf("nack: %s\n", ok ? "ok" : "FAILED");
+	failed += ok ? 0 : 1;
+
+	ok = test_keyframe(proxy);
+	printf("keyframe: %s\n", ok ? "ok" : "FAILED");
+	failed += ok ? 0 : 1;
+
+	proxy.Close();
+	g_rtp_session.Close();
+	pj_shutdown();
+
+	return failed;
+}
@@ -0,0 +1,174 @@
+#include "stdafx.h"
+
+#include "ActivityMeter.h"
+#include "GopCache.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "ActivityMeter.cpp"
+
+#define H264_NAL_SLICE      1
+
+// ָײ, posΪλ
+static pj_bool_t read_ue(const pj_uint8_t *data, pj_uint32_t bits, pj_uint32_t &pos, pj_uint32_t &value)
+{
+	pj_uint32_t zeros = 0;
+	while(pos < bits && !(data[pos >> 3] & (0x80 >> (pos & 7))))
+	{
+		++ zeros;
+		++ pos;
+	}
+	RETURN_VAL_IF_FAIL(pos < bits && zeros < 32, PJ_FALSE);
+
+	++ pos;
+	RETURN_VAL_IF_FAIL(pos + zeros <= bits, PJ_FALSE);
+
+	value = 0;
+	for(pj_uint32_t i = 0; i < zeros; ++ i, ++ pos)
+	{
+		value = (value << 1) | ((data[pos >> 3] >> (7 - (pos & 7))) & 1);
+	}
+	value += (1u << zeros) - 1;
+
+	return PJ_TRUE;
+}
+
+ActivityMeter::ActivityMeter()
+{
+	Reset();
+}
+
+void ActivityMeter::Reset()
+{
+	intra_ = inter_ = bidir_ = PJ_FALSE;
+	intra_bytes_ = 0;
+	level_ = 0;
+	started_ = PJ_FALSE;
+	last_ts_ = 0;
+	interval_ = 0;
+	nominal_ = 0;
+	score_ = 0;
+}
+
+/**
+ * ֻҪsliceͷͷfirst_mb_in_sliceslice_type, ȡǰֽȥֽڼ.
+ */
+pj_int32_t ActivityMeter::SliceType(const pj_uint8_t *nal, pj_uint32_t nal_len)
+{
+	RETURN_VAL_IF_FAIL(nal_len > 1, -1);
+
+	pj_uint8_t type = H264_NAL_TYPE(nal[0]);
+	RETURN_VAL_IF_FAIL(type == H264_NAL_SLICE || type == H264_NAL_IDR, -1);
+
+	pj_uint8_t rbsp[16];
+	pj_uint32_t size = 0, zeros = 0;
+	for(pj_uint32_t i = 1; i < nal_len && size < sizeof(rbsp); ++ i)
+	{
+		if(zeros >= 2 && nal[i] == 0x03)
+		{
+			zeros = 0;
+			continue;
+		}
+		zeros = nal[i] == 0 ? zeros + 1 : 0;
+		rbsp[size ++] = nal[i];
+	}
+
+	pj_uint32_t pos = 0, first_mb, slice_type;
+	RETURN_VAL_IF_FAIL(read_ue(rbsp, size * 8, pos, first_mb), -1);
+	RETURN_VAL_IF_FAIL(read_ue(rbsp, size * 8, pos, slice_type), -1);
+	RETURN_VAL_IF_FAIL(slice_type <= 9, -1);
+
+	return (pj_int32_t)(slice_type % 5);
+}
+
+void ActivityMeter::OnNal(const pj_uint8_t *nal, pj_uint32_t nal_len)
+{
+	switch(SliceType(nal, nal_len))
+	{
+	case H264_SLICE_I:
+	case H264_SLICE_SI:
+		intra_ = PJ_TRUE;
+		break;
+	case H264_SLICE_P:
+	case H264_SLICE_SP:
+		inter_ = PJ_TRUE;
+		break;
+	case H264_SLICE_B:
+		bidir_ = PJ_TRUE;
+		break;
+	default:
+		break;
+	}
+}
+
+// RFC 6184: NAL, STAP-AеÿNAL, FU-Aֻ׸Ƭ
+void ActivityMeter::OnPayload(const pj_uint8_t *payload, pj_uint32_t payloadlen)
+{
+	RETURN_IF_FAIL(payloadlen > 1);
+
+	pj_uint8_t type = H264_NAL_TYPE(payload[0]);
+	if(type == H264_NAL_STAP_A)
+	{
+		pj_uint32_t offset = 1;
+		while(offset + 2 < payloadlen)
+		{
+			pj_uint16_t nal_size = (payload[offset] << 8) | payload[offset + 1];
+			RETURN_IF_FAIL(nal_size > 0 && offset + 2 + nal_size <= payloadlen);
+
+			OnNal(payload + offset + 2, nal_size);
+			offset += 2 + nal_size;
+		}
+	}
+	else if(type == H264_NAL_FU_A)
+	{
+		RETURN_IF_FAIL(payloadlen > 2 && (payload[1] & 0x80));
+
+		// FU indicatorNRIFU headerƴԭNALͷ
+		pj_uint8_t header[16];
+		pj_uint32_t len = MIN(payloadlen - 1, (pj_uint32_t)sizeof(header));
+		header[0] = (payload[0] & 0xE0) | H264_NAL_TYPE(payload[1]);
+		pj_memcpy(header + 1, payload + 2, len - 1);
+		OnNal(header, len);
+	}
+	else
+	{
+		OnNal(payload, payloadlen);
+	}
+}
+
+pj_uint32_t ActivityMeter::EndFrame(pj_uint32_t ts, pj_uint32_t bytes, pj_bool_t keyframe)
+{
+	if(started_)
+	{
+		pj_uint32_t delta = ts - last_ts_;
+		if(delta > 0 && delta < ACTIVITY_MAX_INTERVAL)
+		{
+			interval_ = interval_ == 0 ? delta << 8 : interval_ - interval_ / ACTIVITY_SMOOTH + (delta << 8) / ACTIVITY_SMOOTH;
+			nominal_ = nominal_ == 0 || interval_ < nominal_ ? interval_ : nominal_ + (interval_ - nominal_) / ACTIVITY_NOMINAL_RELAX;
+		}
+	}
+	started_ = PJ_TRUE;
+	last_ts_ = ts;
+
+	if(keyframe || (intra_ && !inter_ && !bidir_))
+	{
+		intra_bytes_ = bytes;
+	}
+	else if(intra_bytes_ > 0 && (inter_ || bidir_))
+	{
+		// Bֻ֡ͨP֡һ, 
+		pj_uint32_t scale = bidir_ && !inter_ && !intra_ ? 2 : 1;
+		pj_uint64_t ratio = (pj_uint64_t)bytes * scale * 100 * 100 / ((pj_uint64_t)intra_bytes_ * ACTIVITY_FULL_RATIO);
+		pj_uint32_t level = (pj_uint32_t)MIN(ratio, 100);
+		level_ = level_ - level_ / ACTIVITY_SMOOTH + (level << 8) / ACTIVITY_SMOOTH;
+	}
+
+	intra_ = inter_ = bidir_ = PJ_FALSE;
+
+	pj_uint64_t cadence = nominal_ > 0 && interval_ > 0 ? MIN((pj_uint64_t)nominal_ * 100 / interval_, 100) : 100;
+	score_ = (pj_uint32_t)((level_ >> 8) * cadence / 100);
+
+	return score_;
+}
@@ -0,0 +1,55 @@
+#ifndef __AVS_PROXY_CLIENT_ACTIVITY_METER__
+#define __AVS_PROXY_CLIENT_ACTIVITY_METER__
+
+#include "Com.h"
+
+#define ACTIVITY_FULL_RATIO     30      // IDR֡ﵽIDRС30%ΪԾ
+#define ACTIVITY_SMOOTH         16      // ԾȰָ֡ƽ, ÿֻ֡1/16
+#define ACTIVITY_NOMINAL_RELAX  256     // ֡ÿ֡ǰ1/256, ֡øıԼʮ
+#define ACTIVITY_MAX_INTERVAL   90000   // RTP̶, 1֡Ϊж, ֡
+
+typedef enum
+{
+	H264_SLICE_P = 0,
+	H264_SLICE_B,
+	H264_SLICE_I,
+	H264_SLICE_SP,
+	H264_SLICE_SI,
+} h264_slice_type_t;
+
+/**
+ * ѹԾȹ, ֻհ߳ʹ.
+ * ÿsliceͷslice_type֡: ȫI slice֡(IDR)ΪοС; P֡ԲοԽ,
+ * 仯Խ; ֻB slice֡. ٳ֡Ա֡ʵı,
+ * 澲ֹʱ֡ıҲõϵ͵ķ. Ϊ0~100.
+ */
+class ActivityMeter
+{
+public:
+	ActivityMeter();
+
+	void        Reset();
+	void        OnPayload(const pj_uint8_t *payload, pj_uint32_t payloadlen);
+	// һ֡аѽOnPayload, ظºķ
+	pj_uint32_t EndFrame(pj_uint32_t ts, pj_uint32_t bytes, pj_bool_t keyframe);
+	inline pj_uint32_t Score() const { return score_; }
+
+	// h264_slice_type_t, sliceʧʱ-1; nalNALͷʼ
+	static pj_int32_t SliceType(const pj_uint8_t *nal, pj_uint32_t nal_len);
+
+private:
+	void OnNal(const pj_uint8_t *nal, pj_uint32_t nal_len);
+
+	pj_bool_t   intra_;              // ǰ֡гֹslice
+	pj_bool_t   inter_;
+	pj_bool_t   bidir_;
+	pj_uint32_t intra_bytes_;        // һI֡ĴС, Ϊ0ʱܹ
+	pj_uint32_t level_;              // ƽĴС, 0~100 << 8
+	pj_bool_t   started_;
+	pj_uint32_t last_ts_;
+	pj_uint32_t interval_;           // ƽ֡, RTP̶ << 8
+	pj_uint32_t nominal_;            // ֡, ȡƽСֵ
+	pj_uint32_t score_;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "stdafx.h"
+
+#include "AudioKernels.h"
+#include "ImageKernels.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define KERNELS_X86
+#include <emmintrin.h>
+#endif
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "AudioKernels.cpp"
+
+static void l16_to_pcm_c(pj_int16_t *dst, const pj_uint8_t *src, pj_uint32_t count)
+{
+	for(pj_uint32_t i = 0; i < count; ++ i)
+	{
+		dst[i] = (pj_int16_t)((src[2 * i] << 8) | src[2 * i + 1]);
+	}
+}
+
+static void mix_pcm_c(pj_int16_t *dst, const pj_int16_t *src, pj_uint32_t count)
+{
+	for(pj_uint32_t i = 0; i < count; ++ i)
+	{
+		pj_int32_t value = dst[i] + src[i];
+		dst[i] = (pj_int16_t)(value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+	}
+}
+
+static void pcm_energy_c(const pj_int16_t *src, pj_uint32_t count, pj_uint64_t *energy, pj_uint32_t *peak)
+{
+	pj_uint64_t sum = 0;
+	pj_uint32_t max = 0;
+	for(pj_uint32_t i = 0; i < count; ++ i)
+	{
+		pj_int32_t value = src[i];
+		sum += (pj_uint32_t)(value * value);
+		max = MAX(max, (pj_uint32_t)(value < 0 ? -value : value));
+	}
+
+	*energy = sum;
+	*peak = max;
+}
+
+#ifdef KERNELS_X86
+static void l16_to_pcm_sse2(pj_int16_t *dst, const pj_uint8_t *src, pj_uint32_t count)
+{
+	pj_uint32_t i = 0;
+	for(; i + 8 <= count; i += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+	}
+
+	l16_to_pcm_c(dst + i, src + 2 * i, count - i);
+}
+
+static void mix_pcm_sse2(pj_int16_t *dst, const pj_int16_t *src, pj_uint32_t count)
+{
+	pj_uint32_t i = 0;
+	for(; i + 8 <= count; i += 8)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi16(a, b));
+	}
+
+	mix_pcm_c(dst + i, src + i, count - i);
+}
+
+// pmaddwdÿ32λΪ2 * 32768 * 32768, ޷չ64λۼ
+static void pcm_energy_sse2(const pj_int16_t *src, pj_uint32_t count, pj_uint64_t *energy, pj_uint32_t *peak)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = zero;
+	__m128i max = _mm_set1_epi16(0);
+	__m128i min = _mm_set1_epi16(0);
+
+	pj_uint32_t i = 0;
+	for(; i + 8 <= count; i += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i sq = _mm_madd_epi16(v, v);
+
+		sum = _mm_add_epi64(sum, _mm_add_epi64(_mm_unpacklo_epi32(sq, zero), _mm_unpackhi_epi32(sq, zero)));
+		max = _mm_max_epi16(max, v);
+		min = _mm_min_epi16(min, v);
+	}
+
+	pcm_energy_c(src + i, count - i, energy, peak);
+
+	pj_uint64_t lanes[2];
+	_mm_storeu_si128((__m128i *)lanes, sum);
+	*energy += lanes[0] + lanes[1];
+
+	pj_int16_t maxs[8], mins[8];
+	_mm_storeu_si128((__m128i *)maxs, max);
+	_mm_storeu_si128((__m128i *)mins, min);
+	for(pj_uint32_t k = 0; k < 8; ++ k)
+	{
+		*peak = MAX(*peak, (pj_uint32_t)maxs[k]);
+		*peak = MAX(*peak, (pj_uint32_t)(-(pj_int32_t)mins[k]));
+	}
+}
+#endif
+
+static const audio_kernels_t kernels_c = {"c", l16_to_pcm_c, mix_pcm_c, pcm_energy_c};
+#ifdef KERNELS_X86
+static const audio_kernels_t kernels_sse2 = {"sse2", l16_to_pcm_sse2, mix_pcm_sse2, pcm_energy_sse2};
+#endif
+
+const audio_kernels_t *AudioKernels::active_ = &kernels_c;
+
+// Ƶÿֻмٸ, AVX2SSE2汾; CPUǷ֧ImageKernelsж
+const audio_kernels_t *AudioKernels::Table(kernel_isa_t isa)
+{
+	switch(isa)
+	{
+	case KERNEL_ISA_C:
+		return &kernels_c;
+#ifdef KERNELS_X86
+	case KERNEL_ISA_SSE2:
+	case KERNEL_ISA_AVX2:
+		return ImageKernels::Table(isa) != nullptr ? &kernels_sse2 : nullptr;
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+void AudioKernels::Init(const pj_str_t &isa)
+{
+	static const char *names[KERNEL_ISA_COUNT] = {"c", "sse2", "avx2"};
+
+	kernel_isa_t wanted = KERNEL_ISA_COUNT;
+	for(pj_uint32_t i = 0; i < KERNEL_ISA_COUNT; ++ i)
+	{
+		pj_str_t name = pj_str((char *)names[i]);
+		if(pj_stricmp(&isa, &name) == 0)
+		{
+			wanted = (kernel_isa_t)i;
+		}
+	}
+
+	const audio_kernels_t *best = &kernels_c;
+	for(pj_uint32_t i = 0; i < KERNEL_ISA_COUNT; ++ i)
+	{
+		const audio_kernels_t *kernels = Table((kernel_isa_t)i);
+		if(kernels != nullptr && i <= (pj_uint32_t)wanted)
+		{
+			best = kernels;
+		}
+	}
+
+	active_ = best;
+
+	PJ_LOG(4, (__ABS_FILE__, "Init() => audio kernels[%s] requested[%.*s]", active_->name_, (int)isa.slen, isa.ptr));
+}
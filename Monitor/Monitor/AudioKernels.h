@@ -0,0 +1,35 @@
+#ifndef __AVS_PROXY_CLIENT_AUDIO_KERNELS__
+#define __AVS_PROXY_CLIENT_AUDIO_KERNELS__
+
+#include "ImageKernels.h"
+#include "Com.h"
+
+// ҪָɵƵں, ָĽC汾ֽͬ
+typedef struct
+{
+	const char *name_;
+	// ֽL16תΪ16λPCM
+	void (*l16_to_pcm_)(pj_int16_t *dst, const pj_uint8_t *src, pj_uint32_t count);
+	// dst = dst + src, ͵16λ
+	void (*mix_pcm_)(pj_int16_t *dst, const pj_int16_t *src, pj_uint32_t count);
+	// energyΪƽ, peakΪֵֵ(-32768Ϊ32768)
+	void (*pcm_energy_)(const pj_int16_t *src, pj_uint32_t count, pj_uint64_t *energy, pj_uint32_t *peak);
+} audio_kernels_t;
+
+/**
+ * Ƶں˿, ImageKernelsͬһimage_kernelsѡָ. Init()֮ǰʹC汾.
+ * C汾ֽڱȶMonitor/Benchkernel_test.
+ */
+class AudioKernels
+{
+public:
+	static void Init(const pj_str_t &isa);
+	static const audio_kernels_t &Get() { return *active_; }
+	// CPUֵָ֧nullptr
+	static const audio_kernels_t *Table(kernel_isa_t isa);
+
+private:
+	static const audio_kernels_t *active_;
+};
+
+#endif
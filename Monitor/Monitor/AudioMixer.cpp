@@ -0,0 +1,200 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "AudioMixer.h"
+#include "AudioKernels.h"
+#include "AvSync.h"
+#include "Playout.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "AudioMixer.cpp"
+
+AudioMixer g_audio_mixer;
+
+AudioMixer::AudioMixer()
+	: active_(PJ_FALSE)
+	, device_(0)
+	, mix_(1)
+	, focus_lock_()
+	, focused_()
+	, monitored_(0)
+	, period_usec_(0)
+	, scratch_()
+	, last_callback_usec_(0)
+	, next_play_usec_(0)
+{
+	pj_bzero(streams_, sizeof(streams_));
+	pj_bzero(desc_, sizeof(desc_));
+}
+
+pj_status_t AudioMixer::Prepare(pj_uint32_t mix)
+{
+	mix_ = MIN(MAX(mix, 1), (pj_uint32_t)MAXIMAL_SCREEN_NUM);
+
+	int ret = SDL_InitSubSystem(SDL_INIT_AUDIO);
+	if(ret != 0)
+	{
+		PJ_LOG(2, (__ABS_FILE__, "Prepare() => init audio failed: %s", SDL_GetError()));
+		return PJ_EINVAL;
+	}
+
+	// ʽʱSDLת, ʼ44.1kHz16λ
+	SDL_AudioSpec want, have;
+	SDL_zero(want);
+	want.freq = AUDIO_CLOCK_RATE;
+	want.format = AUDIO_S16SYS;
+	want.channels = 1;
+	want.samples = AUDIO_DEVICE_SAMPLES;
+	want.callback = AudioCallback;
+	want.userdata = this;
+	int allowed = 0;
+#ifdef SDL_AUDIO_ALLOW_SAMPLES_CHANGE
+	// 豸ʵʵڻص, have.samples豸ĴС; ϰ汾SDLûдѡ, ǰĴС
+	allowed = SDL_AUDIO_ALLOW_SAMPLES_CHANGE;
+#endif
+	device_ = SDL_OpenAudioDevice(NULL, 0, &want, &have, allowed);
+	if(device_ == 0)
+	{
+		PJ_LOG(2, (__ABS_FILE__, "Prepare() => open audio device failed: %s", SDL_GetError()));
+		return PJ_EINVAL;
+	}
+
+	period_usec_ = (pj_uint64_t)have.samples * 1000000 / have.freq;
+	scratch_.resize(have.samples);
+	focused_.push_front(0);
+	monitored_ = 1;
+
+	PJ_LOG(5, (__ABS_FILE__, "Prepare() => audio device[%u] %uHz %u samples, mix[%u]", device_, have.freq, have.samples, mix_));
+
+	return PJ_SUCCESS;
+}
+
+pj_status_t AudioMixer::Launch()
+{
+	RETURN_VAL_IF_FAIL(device_ != 0, PJ_EINVAL);
+
+	active_ = PJ_TRUE;
+	SDL_PauseAudioDevice(device_, 0);
+
+	return PJ_SUCCESS;
+}
+
+// ر豸ʱSDLȻص, ֮AudioStreamſԹر
+void AudioMixer::Destory()
+{
+	active_ = PJ_FALSE;
+	monitored_ = 0;
+	if(device_ != 0)
+	{
+		SDL_CloseAudioDevice(device_);
+		device_ = 0;
+	}
+}
+
+void AudioMixer::Attach(pj_uint32_t idx, AudioStream *stream)
+{
+	RETURN_IF_FAIL(idx < MAXIMAL_SCREEN_NUM);
+	streams_[idx] = stream;
+}
+
+void AudioMixer::Focus(pj_uint32_t idx)
+{
+	RETURN_IF_FAIL(idx < MAXIMAL_SCREEN_NUM);
+
+	pj_uint32_t dropped = 0;
+	{
+		lock_guard<mutex> lock(focus_lock_);
+		std::deque<pj_uint32_t>::iterator pos = std::find(focused_.begin(), focused_.end(), idx);
+		if(pos != focused_.end())
+		{
+			focused_.erase(pos);
+		}
+		focused_.push_front(idx);
+
+		pj_uint32_t monitored = 0;
+		for(pj_uint32_t i = 0; i < focused_.size(); ++ i)
+		{
+			if(i < mix_)
+			{
+				monitored |= 1u << focused_[i];
+			}
+			else
+			{
+				dropped |= 1u << focused_[i];
+			}
+		}
+		focused_.resize(MIN((pj_uint32_t)focused_.size(), mix_));
+		monitored_ = monitored;
+	}
+
+	// ټĸӶƵ, ¼ʱµİʼ
+	for(pj_uint32_t i = 0; i < MAXIMAL_SCREEN_NUM; ++ i)
+	{
+		if((dropped & (1u << i)) && streams_[i] != nullptr)
+		{
+			streams_[i]->Reset();
+		}
+	}
+
+	PJ_LOG(5, (__ABS_FILE__, "Focus() => screen[%u] monitored mask[0x%x]", idx, (pj_uint32_t)monitored_));
+}
+
+void SDLCALL AudioMixer::AudioCallback(void *userdata, Uint8 *stream, int len)
+{
+	AudioMixer *mixer = reinterpret_cast<AudioMixer *>(userdata);
+	if(!pj_thread_is_registered())
+	{
+		pj_thread_t *pj_thread = nullptr;
+		pj_thread_register(NULL, mixer->desc_, &pj_thread);
+	}
+
+	mixer->Mix(reinterpret_cast<pj_int16_t *>(stream), (pj_uint32_t)len / sizeof(pj_int16_t));
+}
+
+void AudioMixer::Mix(pj_int16_t *out, pj_uint32_t count)
+{
+	pj_bzero(out, count * sizeof(pj_int16_t));
+	if(scratch_.size() < count)
+	{
+		scratch_.resize(count);
+	}
+
+	/**
+	 * Ĳ豸ڷŵһ֮ų. ˻˶ʱص,
+	 * ϴλصڵ, һĲ֮.
+	 */
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	pj_uint64_t now_usec = PlayoutClock::Usec(now);
+	pj_uint64_t play_usec = now_usec + period_usec_;
+	if(now_usec < last_callback_usec_ + period_usec_ / 2 && next_play_usec_ > play_usec)
+	{
+		play_usec = next_play_usec_;
+	}
+	last_callback_usec_ = now_usec;
+	next_play_usec_ = play_usec + (pj_uint64_t)count * 1000000 / AUDIO_CLOCK_RATE;
+
+	const audio_kernels_t &kernels = AudioKernels::Get();
+	pj_uint32_t monitored = monitored_;
+	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+	{
+		if(!(monitored & (1u << idx)) || streams_[idx] == nullptr)
+		{
+			continue;
+		}
+
+		pj_uint32_t ssrc, ts;
+		if(streams_[idx]->Read(&scratch_[0], count, ssrc, ts))
+		{
+			kernels.mix_pcm_(out, &scratch_[0], count);
+			if(g_client_config.av_sync)
+			{
+				g_av_sync.OnAudioPlayed(idx, ssrc, ts, play_usec);
+			}
+		}
+	}
+}
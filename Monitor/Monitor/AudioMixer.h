@@ -0,0 +1,61 @@
+#ifndef __AVS_PROXY_CLIENT_AUDIO_MIXER__
+#define __AVS_PROXY_CLIENT_AUDIO_MIXER__
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+#include "AudioStream.h"
+#include "Com.h"
+
+using std::vector;
+using std::mutex;
+using std::lock_guard;
+
+#define AUDIO_DEVICE_SAMPLES    512     // ÿλصĲ, Լ11.6ms
+
+/**
+ * Ψһķ豸. Ĭֻѡеһ, audio_mixΪNʱѡеN.
+ * ֻбĸӲŽƵ: հ߳Monitored(), ӵİڷֱַӶ.
+ * صSDLƵ߳, ӸAudioStreamȡݺSIMDں˱.
+ */
+class AudioMixer
+	: public Noncopyable
+{
+public:
+	AudioMixer();
+
+	pj_status_t Prepare(pj_uint32_t mix);
+	pj_status_t Launch();
+	void        Destory();
+	// Launch֮ǰϸĻƵ
+	void        Attach(pj_uint32_t idx, AudioStream *stream);
+	// ߳е, ѡеĸӳΪµļ, ȥĸ
+	void        Focus(pj_uint32_t idx);
+	inline pj_bool_t Monitored(pj_uint32_t idx) const
+	{
+		return (active_ && idx < MAXIMAL_SCREEN_NUM && (monitored_ & (1u << idx))) ? PJ_TRUE : PJ_FALSE;
+	}
+
+private:
+	static void SDLCALL AudioCallback(void *userdata, Uint8 *stream, int len);
+	void        Mix(pj_int16_t *out, pj_uint32_t count);
+
+	pj_bool_t                active_;
+	SDL_AudioDeviceID        device_;
+	pj_uint32_t              mix_;
+	AudioStream             *streams_[MAXIMAL_SCREEN_NUM];
+	mutex                    focus_lock_;
+	std::deque<pj_uint32_t>  focused_;       // ѡеǰ
+	std::atomic<pj_uint32_t> monitored_;     // λ, հ̺߳صȡ
+	pj_uint64_t              period_usec_;   // 豸ʵʵĻص, 豸һ
+	vector<pj_int16_t>       scratch_;       // ֻصʹ
+	pj_uint64_t              last_callback_usec_;
+	pj_uint64_t              next_play_usec_; // һĲʱ
+	pj_thread_desc           desc_;
+};
+
+extern AudioMixer g_audio_mixer;
+
+#endif
@@ -0,0 +1,205 @@
+#include "stdafx.h"
+#include <math.h>
+
+#include "AudioStream.h"
+#include "AudioKernels.h"
+#include "AvSync.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "AudioStream.cpp"
+
+AudioStream::AudioStream()
+	: jb_(nullptr)
+	, ssrc_(0)
+	, frame_(AUDIO_MAX_FRAME)
+	, pending_()
+	, pending_pos_(0)
+	, pending_ts_(0)
+	, last_()
+	, concealed_(0)
+	, level_(AUDIO_LEVEL_SILENT)
+	, peak_(0)
+{
+}
+
+// jitter bufferpoolз, poolĻͬ
+pj_status_t AudioStream::Open(pj_pool_t *pool)
+{
+	pj_str_t name = pj_str("audio");
+	pj_status_t status;
+	status = pjmedia_jbuf_create(pool, &name, AUDIO_MAX_FRAME, AUDIO_PTIME, AUDIO_JB_MAX, &jb_);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	pjmedia_jbuf_set_adaptive(jb_, AUDIO_JB_PREFETCH, 1, AUDIO_JB_MAX * 4 / 5);
+
+	return PJ_SUCCESS;
+}
+
+void AudioStream::Close()
+{
+	lock_guard<mutex> lock(lock_);
+	if(jb_ != nullptr)
+	{
+		pjmedia_jbuf_destroy(jb_);
+		jb_ = nullptr;
+	}
+}
+
+void AudioStream::Reset()
+{
+	lock_guard<mutex> lock(lock_);
+	Clear();
+	ssrc_ = 0;
+}
+
+// ÷lock_
+void AudioStream::Clear()
+{
+	if(jb_ != nullptr)
+	{
+		pjmedia_jbuf_reset(jb_);
+	}
+	pending_.clear();
+	pending_pos_ = 0;
+	pending_ts_ = 0;
+	last_.clear();
+	concealed_ = 0;
+	level_ = AUDIO_LEVEL_SILENT;
+	peak_ = 0;
+}
+
+/**
+ * հ߳е, ֱӷŽjitter buffer, ȥ, ʱ.
+ * L16ÿֽ, سȱΪż.
+ */
+void AudioStream::Put(const pj_uint8_t *rtp_frame, pj_uint16_t framelen)
+{
+	const pjmedia_rtp_hdr *hdr;
+	const void *payload;
+	unsigned payloadlen;
+	pj_status_t status;
+	status = pjmedia_rtp_decode_rtp(NULL, rtp_frame, framelen, &hdr, &payload, &payloadlen);
+	RETURN_IF_FAIL(status == PJ_SUCCESS && hdr->pt == RTP_MEDIA_AUDIO_TYPE);
+	RETURN_IF_FAIL(payloadlen > 0 && payloadlen <= AUDIO_MAX_FRAME && payloadlen % 2 == 0);
+
+	if(g_client_config.av_sync)
+	{
+		pj_timestamp arrival;
+		pj_get_timestamp(&arrival);
+		g_av_sync.OnRtp(hdr->ssrc, pj_ntohl(hdr->ts), arrival, AUDIO_CLOCK_RATE);
+	}
+
+	lock_guard<mutex> lock(lock_);
+	RETURN_IF_FAIL(jb_ != nullptr);
+
+	if(hdr->ssrc != ssrc_)
+	{
+		PJ_LOG(5, (__ABS_FILE__, "Put() => audio ssrc[%u] replaced by ssrc[%u]", ssrc_, hdr->ssrc));
+		Clear();
+		ssrc_ = hdr->ssrc;
+	}
+
+	pj_bool_t discarded;
+	pjmedia_jbuf_put_frame3(jb_, payload, payloadlen, 0, pj_ntohs(hdr->seq), pj_ntohl(hdr->ts), &discarded);
+}
+
+/**
+ * ص߳е. һʣµĲ, ٴjitter bufferȡ;
+ * ʱظһһ, . ճcount˳.
+ * صʱAvSyncΪƵʱ.
+ */
+pj_bool_t AudioStream::Read(pj_int16_t *pcm, pj_uint32_t count, pj_uint32_t &ssrc, pj_uint32_t &ts)
+{
+	lock_guard<mutex> lock(lock_);
+	RETURN_VAL_IF_FAIL(jb_ != nullptr, PJ_FALSE);
+
+	ssrc = ssrc_;
+
+	pj_uint32_t filled = 0;
+	while(filled < count)
+	{
+		if(pending_pos_ < pending_.size())
+		{
+			if(filled == 0)
+			{
+				ts = pending_ts_ + pending_pos_;
+			}
+			pj_uint32_t n = MIN(count - filled, (pj_uint32_t)pending_.size() - pending_pos_);
+			pj_memcpy(pcm + filled, &pending_[pending_pos_], n * sizeof(pj_int16_t));
+			filled += n;
+			pending_pos_ += n;
+			continue;
+		}
+
+		pending_pos_ = 0;
+
+		char type;
+		pj_size_t size = frame_.size();
+		pj_uint32_t bit_info;
+		pj_uint32_t frame_ts;
+		int seq;
+		pjmedia_jbuf_get_frame3(jb_, &frame_[0], &size, &type, &bit_info, &frame_ts, &seq);
+		if(type == PJMEDIA_JB_NORMAL_FRAME)
+		{
+			Decode(&frame_[0], (pj_uint32_t)size);
+			pending_ts_ = frame_ts;
+			concealed_ = 0;
+		}
+		else if(type == PJMEDIA_JB_MISSING_FRAME)
+		{
+			pending_ts_ += pending_.size();
+			pending_.assign(last_.empty() ? AUDIO_CLOCK_RATE * AUDIO_PTIME / 1000 : last_.size(), 0);
+			if(concealed_ ++ == 0)
+			{
+				for(pj_uint32_t i = 0; i < last_.size(); ++ i)
+				{
+					pending_[i] = last_[i] / 2;
+				}
+			}
+		}
+		else
+		{
+			// Ԥȡлѿ, һûʱ
+			pending_.clear();
+			if(filled == 0)
+			{
+				level_ = AUDIO_LEVEL_SILENT;
+				peak_ = 0;
+				return PJ_FALSE;
+			}
+
+			pj_bzero(pcm + filled, (count - filled) * sizeof(pj_int16_t));
+			filled = count;
+		}
+	}
+
+	pj_uint64_t energy;
+	pj_uint32_t peak;
+	AudioKernels::Get().pcm_energy_(pcm, count, &energy, &peak);
+	level_ = Dbov(energy, count);
+	peak_ = peak;
+
+	return PJ_TRUE;
+}
+
+void AudioStream::Decode(const pj_uint8_t *payload, pj_uint32_t payloadlen)
+{
+	pj_uint32_t samples = payloadlen / 2;
+	pending_.resize(samples);
+	AudioKernels::Get().l16_to_pcm_(&pending_[0], payload, samples);
+	last_ = pending_;
+}
+
+// ķֱȡ, 0Ϊ, AUDIO_LEVEL_SILENTΪ
+pj_uint32_t AudioStream::Dbov(pj_uint64_t energy, pj_uint32_t count)
+{
+	RETURN_VAL_IF_FAIL(energy > 0 && count > 0, AUDIO_LEVEL_SILENT);
+
+	double power = (double)energy / count / (32768.0 * 32768.0);
+	double dbov = -10.0 * log10(power);
+	return dbov <= 0.0 ? 0 : (dbov >= AUDIO_LEVEL_SILENT ? AUDIO_LEVEL_SILENT : (pj_uint32_t)(dbov + 0.5));
+}
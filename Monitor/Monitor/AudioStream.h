@@ -0,0 +1,63 @@
+#ifndef __AVS_PROXY_CLIENT_AUDIO_STREAM__
+#define __AVS_PROXY_CLIENT_AUDIO_STREAM__
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <pjmedia.h>
+
+#include "Com.h"
+
+using std::vector;
+using std::mutex;
+using std::lock_guard;
+
+#define AUDIO_CLOCK_RATE        44100   // PT 11ΪL1644.1kHz(RFC 3551)
+#define AUDIO_PTIME             10      // ms, հֻMAX_STORAGE_SIZE, 44.1kHzL16һԼ10ms
+#define AUDIO_MAX_FRAME         MAX_STORAGE_SIZE
+#define AUDIO_JB_MAX            100     // , Լ1
+#define AUDIO_JB_PREFETCH       3
+#define AUDIO_LEVEL_SILENT      127     // dBov, ޼
+
+/**
+ * һĻƵ: jitter bufferL16, ssrc仯ʱ¿ʼ.
+ * Put()հֱ߳ӰRTPطŽjitter buffer, ;
+ * Read()ص߳аȡ, ʱظһһ, ֮󲹾.
+ * SIMDں˼, dBov, ߳̿ɶ.
+ */
+class AudioStream
+	: public Noncopyable
+{
+public:
+	AudioStream();
+
+	pj_status_t Open(pj_pool_t *pool);
+	void        Close();
+	void        Reset();
+	void        Put(const pj_uint8_t *rtp_frame, pj_uint16_t framelen);
+	// չcountPJ_TRUE, ssrctsΪpcm[0]RTPʱ;
+	// jitter bufferԤȡѿʱPJ_FALSE, pcm
+	pj_bool_t   Read(pj_int16_t *pcm, pj_uint32_t count, pj_uint32_t &ssrc, pj_uint32_t &ts);
+	inline pj_uint32_t Level() const { return level_; }
+	inline pj_uint32_t Peak() const { return peak_; }
+
+	static pj_uint32_t Dbov(pj_uint64_t energy, pj_uint32_t count);
+
+private:
+	void Clear();
+	void Decode(const pj_uint8_t *payload, pj_uint32_t payloadlen);
+
+	mutex                 lock_;           // , հ, صͻû֮߳
+	pjmedia_jbuf         *jb_;
+	pj_uint32_t           ssrc_;
+	vector<pj_uint8_t>    frame_;          // jitter bufferȡһ
+	vector<pj_int16_t>    pending_;        // ѽ뻹ûĲ
+	pj_uint32_t           pending_pos_;
+	pj_uint32_t           pending_ts_;     // pending_[0]RTPʱ, Ĳһ
+	vector<pj_int16_t>    last_;           // һĲ, ʱظ
+	pj_uint32_t           concealed_;      // 
+	std::atomic<pj_uint32_t> level_;
+	std::atomic<pj_uint32_t> peak_;
+};
+
+#endif
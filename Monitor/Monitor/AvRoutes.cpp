@@ -0,0 +1,157 @@
+#include "stdafx.h"
+#include <chrono>
+
+#include "AvRoutes.h"
+#include "StreamMgr.h"
+#include "Recorder.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "AvRoutes.cpp"
+
+AvRoutes g_av_routes;
+
+AvRoutes::AvRoutes()
+	: routes_(new av_routes_t())
+	, owner_(std::thread::id())
+	, depth_(0)
+	, dirty_(PJ_FALSE)
+	, deferred_()
+	, reclaim_lock_()
+	, retired_()
+{
+}
+
+av_route_t &AvRoutes::Entry(av_route_map_t &routes, pj_uint32_t ssrc)
+{
+	av_route_map_t::iterator proute = routes.find(ssrc);
+	if(proute == routes.end())
+	{
+		av_route_t route = {(pj_uint8_t)INVALID_SCREEN_INDEX, nullptr, stream_health_ptr_t(), nullptr};
+		proute = routes.insert(std::make_pair(ssrc, route)).first;
+	}
+
+	return proute->second;
+}
+
+// ·ɵĻ, ûʱΪINVALID_SCREEN_INDEX. ֻںڳ
+pj_uint8_t AvRoutes::ScreenIndex(pj_uint8_t media, pj_uint32_t ssrc) const
+{
+	av_routes_ptr_t routes = Load();
+	av_route_map_t::const_iterator proute = routes->routes[media].find(ssrc);
+
+	return proute != routes->routes[media].end() ? proute->second.screen_idx : (pj_uint8_t)INVALID_SCREEN_INDEX;
+}
+
+// ֻг̻߳owner_Լ, ̶߳ĲԼid
+void AvRoutes::Enter()
+{
+	if(owner_.load() == std::this_thread::get_id())
+	{
+		++ depth_;
+		return;
+	}
+
+	g_av_index_lock.lock();
+	owner_.store(std::this_thread::get_id());
+	depth_ = 1;
+}
+
+void AvRoutes::Leave()
+{
+	RETURN_IF_FAIL(-- depth_ == 0);
+
+	if(dirty_ || !deferred_.empty())
+	{
+		Publish();
+	}
+	owner_.store(std::thread::id());
+	g_av_index_lock.unlock();
+
+	// ɿնѾûж, ܻյĵ, ɶʱ
+	Reclaim();
+}
+
+/**
+ * иĶʱؽ: ޸ֻڻҳ, ɾûͿʼֹͣ¼ʱ, հԶƵ.
+ * µĿղڵȴ, ͵ǼǵĶһҵն.
+ */
+void AvRoutes::Publish()
+{
+	g_recorder.StopUnrouted();
+
+	av_routes_t *routes = new av_routes_t();
+
+	for(pj_uint8_t media = AUDIO_INDEX; media <= VIDEO_INDEX; ++ media)
+	{
+		for(index_map_t::const_iterator pindex = g_av_index_map[media].begin(); pindex != g_av_index_map[media].end(); ++ pindex)
+		{
+			Entry(routes->routes[media], pindex->first).screen_idx = pindex->second;
+		}
+	}
+
+	const stream_map_t &streams = g_stream_mgr.Streams();
+	for(stream_map_t::const_iterator pstream = streams.begin(); pstream != streams.end(); ++ pstream)
+	{
+		Entry(routes->routes[VIDEO_INDEX], pstream->first).stream = pstream->second;
+	}
+
+	const health_map_t &healths = g_health_monitor.Streams();
+	for(health_map_t::const_iterator phealth = healths.begin(); phealth != healths.end(); ++ phealth)
+	{
+		Entry(routes->routes[VIDEO_INDEX], phealth->first).health = phealth->second;
+	}
+
+	const recording_map_t &recordings = g_recorder.Recordings();
+	for(recording_map_t::const_iterator precording = recordings.begin(); precording != recordings.end(); ++ precording)
+	{
+		Recording *recording = precording->second;
+		pj_uint8_t media = precording->first == recording->video_ssrc_ ? VIDEO_INDEX : AUDIO_INDEX;
+		Entry(routes->routes[media], precording->first).recording = recording;
+	}
+
+	dirty_ = PJ_FALSE;
+
+	lock_guard<mutex> lock(reclaim_lock_);
+	retired_.push_back(av_retired_t());
+	retired_.back().routes = std::atomic_exchange(&routes_, av_routes_ptr_t(routes));
+	retired_.back().actions.swap(deferred_);
+}
+
+/**
+ * : ֻܾroutes_ȡ, ºֻ, ֻʣһʱհ߳.
+ * ĿҲкƳĽ¼, ԰˳, õľͣ.
+ */
+pj_bool_t AvRoutes::Reclaim()
+{
+	lock_guard<mutex> lock(reclaim_lock_);
+	while(!retired_.empty())
+	{
+		av_retired_t &retired = retired_.front();
+		RETURN_VAL_IF_FAIL(retired.routes.use_count() == 1, PJ_FALSE);
+
+		for(pj_uint32_t i = 0; i < retired.actions.size(); ++ i)
+		{
+			retired.actions[i]();
+		}
+		retired_.pop_front();
+	}
+
+	return PJ_TRUE;
+}
+
+// ɿֻհ̴߳һʱڱ, ͨһξܻ
+void AvRoutes::Synchronize()
+{
+	while(!Reclaim())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+void AvRoutes::Defer(const std::function<void ()> &action)
+{
+	deferred_.push_back(action);
+}
@@ -0,0 +1,117 @@
+#ifndef __AVS_PROXY_CLIENT_AV_ROUTES__
+#define __AVS_PROXY_CLIENT_AV_ROUTES__
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <unordered_map>
+
+#include "HealthMonitor.h"
+#include "Com.h"
+
+using std::shared_ptr;
+using std::vector;
+using std::mutex;
+using std::lock_guard;
+
+class VideoStream;
+class Recording;
+
+// һssrcյҪ˭, հ߳һβõȫ
+typedef struct
+{
+	pj_uint8_t          screen_idx;     // g_av_index_mapеֵ, ʱΪINVALID_SCREEN_INDEX
+	VideoStream        *stream;         // еĽ, ֻƵ
+	stream_health_ptr_t health;         // , ֻƵ
+	Recording          *recording;
+} av_route_t;
+
+typedef std::unordered_map<pj_uint32_t, av_route_t> av_route_map_t;   // ssrc -> ·
+
+typedef struct
+{
+	av_route_map_t routes[2];           // AUDIO_INDEX/VIDEO_INDEX
+} av_routes_t;
+
+typedef shared_ptr<const av_routes_t> av_routes_ptr_t;
+
+#define AV_ROUTES_RECLAIM_INTERVAL 20   // ms, ɿջжʱlibevent̶߳ʱ
+
+// µĿպҪĶ߶ִֺеĶ
+typedef struct
+{
+	av_routes_ptr_t                routes;
+	vector<std::function<void ()>> actions;
+} av_retired_t;
+
+/**
+ * հ·ɵֻ(RCU). g_av_index_map, StreamMgr, HealthMonitorRecorderıg_av_index_lock޸,
+ * ĶʱTouch(), AvRouteUpdateǰиĶؽ滻; հֻ߳ԭӵȡһο, .
+ * µľɿղڵȴ, ͬDefer()ǼǵĶ(Flush, ¼β)ҵն,
+ * ߶ֺReclaim()ִ, ֮հ̲߳ƳĽ¼.
+ */
+class AvRoutes
+	: public Noncopyable
+{
+public:
+	AvRoutes();
+
+	inline av_routes_ptr_t Load() const { return std::atomic_load(&routes_); }
+	pj_uint8_t ScreenIndex(pj_uint8_t media, pj_uint32_t ssrc) const;
+
+	// AvRouteUpdate. ͬһ߳Ƕʱֻͷ
+	void Enter();
+	void Leave();
+
+	// µ÷g_av_index_lock
+	inline void Touch() { dirty_ = PJ_TRUE; }
+	void Defer(const std::function<void ()> &action);
+
+	/**
+	 * ˳ִж߶ѷֵĿյĶ, g_av_index_lock, ȫִʱPJ_TRUE.
+	 * reclaim_lock_ִ, ٿAvRouteUpdate.
+	 */
+	pj_bool_t Reclaim();
+	// ȵǼǵĶִ, ˳ʱڹرս¼֮ǰ
+	void      Synchronize();
+
+	static av_route_t &Entry(av_route_map_t &routes, pj_uint32_t ssrc);
+
+private:
+	void Publish();
+
+	av_routes_ptr_t                routes_;
+	std::atomic<std::thread::id>   owner_;      // ǰg_av_index_lockAvRouteUpdateڵ߳
+	pj_uint32_t                    depth_;      // AvRouteUpdateǶײ, g_av_index_lock
+	pj_bool_t                      dirty_;
+	vector<std::function<void ()>> deferred_;
+	mutex                          reclaim_lock_;
+	std::deque<av_retired_t>       retired_;
+};
+
+extern AvRoutes g_av_routes;
+
+/**
+ * lock_guard<mutex>(g_av_index_lock)޸·ɵĵط. ͬһ߳пǶ,
+ * һReconcileҳ˶ûֻǰһ, ûиĶʱ.
+ */
+class AvRouteUpdate
+	: public Noncopyable
+{
+public:
+	AvRouteUpdate()
+	{
+		g_av_routes.Enter();
+	}
+
+	~AvRouteUpdate()
+	{
+		g_av_routes.Leave();
+	}
+};
+
+#endif
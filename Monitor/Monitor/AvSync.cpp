@@ -0,0 +1,242 @@
+#include "stdafx.h"
+
+#include "AvSync.h"
+#include "Playout.h"
+#include "RTCPFeedback.h"
+#include "AvRoutes.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "AvSync.cpp"
+
+AvSync g_av_sync;
+
+AvSync::AvSync()
+	: sources_lock_()
+	, sources_()
+	, expired_usec_(0)
+{
+}
+
+// ScreenMgr::Destory()йر֮, ʱûд
+void AvSync::Clear()
+{
+	lock_guard<mutex> lock(sources_lock_);
+	sources_.clear();
+
+	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+	{
+		pj_bzero(&clocks_[idx].BeginWrite(), sizeof(audio_clock_t));
+		clocks_[idx].EndWrite();
+	}
+}
+
+/**
+ * SR: ̶ͷΪssrc, NTPʱС, ֮ӦRTPʱ.
+ * ֻ¼ѾյRTPssrc, ûSRռڴ.
+ */
+void AvSync::OnRxRtcp(const pj_uint8_t *packet, pj_uint32_t packetlen)
+{
+	lock_guard<mutex> lock(sources_lock_);
+
+	pj_uint32_t offset = 0;
+	while(offset + 8 <= packetlen)
+	{
+		const pj_uint8_t *p = packet + offset;
+		pj_uint32_t size = ((((pj_uint32_t)p[2] << 8) | p[3]) + 1) * 4;
+		RETURN_IF_FAIL(offset + size <= packetlen);
+
+		if(p[1] == RTCP_PT_SR && size >= 28)
+		{
+			pj_uint32_t ssrc, ntp_sec, ntp_frac, rtp_ts;
+			pj_memcpy(&ssrc, p + 4, sizeof(ssrc));
+			pj_memcpy(&ntp_sec, p + 8, sizeof(ntp_sec));
+			pj_memcpy(&ntp_frac, p + 12, sizeof(ntp_frac));
+			pj_memcpy(&rtp_ts, p + 16, sizeof(rtp_ts));
+
+			sync_source_map_t::iterator psource = sources_.find(ssrc);
+			if(psource != sources_.end())
+			{
+				ts_anchor_t &report = psource->second.report_;
+				if(!report.valid_)
+				{
+					PJ_LOG(5, (__ABS_FILE__, "OnRxRtcp() => ssrc[%u] first sender report", ssrc));
+				}
+				report.valid_ = PJ_TRUE;
+				report.ts_ = pj_ntohl(rtp_ts);
+				report.usec_ = (pj_int64_t)pj_ntohl(ntp_sec) * 1000000 + (((pj_uint64_t)pj_ntohl(ntp_frac) * 1000000) >> 32);
+			}
+		}
+
+		offset += size;
+	}
+}
+
+void AvSync::OnRtp(pj_uint32_t ssrc, pj_uint32_t ts, const pj_timestamp &arrival, pj_uint32_t rate)
+{
+	pj_uint64_t arrival_usec = PlayoutClock::Usec(arrival);
+
+	lock_guard<mutex> lock(sources_lock_);
+
+	// µssrcʼΪȫ0
+	sync_source_t &source = sources_[ssrc];
+	source.rate_ = rate;
+	source.updated_usec_ = arrival_usec;
+	UpdateArrival(source.arrival_, ts, arrival_usec, rate);
+
+	if(arrival_usec > expired_usec_ + AVSYNC_EXPIRE * 1000)
+	{
+		Expire(arrival_usec);
+		expired_usec_ = arrival_usec;
+	}
+}
+
+/**
+ * êӳСİ: êʱ̵˵֮ǰİŶ, ;
+ * ֻһ, ·ɱ仯ӳٱʱêҲ.
+ * êʼƵµʱ, 㲻Խʱ.
+ */
+void AvSync::UpdateArrival(ts_anchor_t &anchor, pj_uint32_t ts, pj_uint64_t arrival_usec, pj_uint32_t rate)
+{
+	pj_int64_t usec = (pj_int64_t)arrival_usec;
+	if(anchor.valid_)
+	{
+		pj_int64_t expected = Wall(anchor, ts, rate);
+		pj_int64_t late = usec - expected;
+		if(late > -AVSYNC_ANCHOR_RESET * 1000 && late < AVSYNC_ANCHOR_RESET * 1000)
+		{
+			anchor.usec_ = late < 0 ? usec : expected + late / AVSYNC_ANCHOR_RELAX;
+			anchor.ts_ = ts;
+			return;
+		}
+	}
+
+	anchor.valid_ = PJ_TRUE;
+	anchor.ts_ = ts;
+	anchor.usec_ = usec;
+}
+
+// ֻصд, ÿĻһSeqLock, Ƶ߳ȡ
+void AvSync::OnAudioPlayed(pj_uint32_t idx, pj_uint32_t ssrc, pj_uint32_t ts, pj_uint64_t play_usec)
+{
+	RETURN_IF_FAIL(idx < MAXIMAL_SCREEN_NUM);
+
+	audio_clock_t &clock = clocks_[idx].BeginWrite();
+	clock.ssrc_ = ssrc;
+	clock.ts_ = ts;
+	clock.usec_ = play_usec;
+	clocks_[idx].EndWrite();
+}
+
+/**
+ * Ƶ֡Ļϵĸڷ, ҷŵͬһûƵʱ, ƵʱӶ.
+ * ƽ, ʱƽص0; ڲ, ͬһ·֡԰˳.
+ */
+pj_uint64_t AvSync::Align(pj_uint32_t video_ssrc, pj_uint32_t ts, const pj_timestamp &arrival, pj_uint64_t due,
+	av_sync_state_t &state)
+{
+	OnRtp(video_ssrc, ts, arrival, PLAYOUT_CLOCK_RATE * 1000);
+
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	pj_uint64_t now_usec = PlayoutClock::Usec(now);
+
+	pj_uint32_t idx = g_av_routes.ScreenIndex(VIDEO_INDEX, video_ssrc);
+
+	pj_bool_t synced = PJ_FALSE;
+	pj_int64_t diff = 0;
+	audio_clock_t clock;
+	if(idx < MAXIMAL_SCREEN_NUM)
+	{
+		clocks_[idx].Read(clock);
+		pj_bool_t same_user = PJ_FALSE;
+		if(clock.usec_ + AVSYNC_CLOCK_STALE * 1000 >= now_usec)
+		{
+			// ûܻڷһû󼸺
+			same_user = g_av_routes.ScreenIndex(AUDIO_INDEX, clock.ssrc_) == idx ? PJ_TRUE : PJ_FALSE;
+		}
+
+		pj_int64_t target;
+		if(same_user && Target(video_ssrc, ts, clock, target, state.by_report_))
+		{
+			diff = target - (pj_int64_t)due;
+			synced = diff > -AVSYNC_MAX_OFFSET * 1000 && diff < AVSYNC_MAX_OFFSET * 1000 ? PJ_TRUE : PJ_FALSE;
+
+			// ƵΪƵô, ֡ڶѹ
+			pj_int64_t limit = (pj_int64_t)MIN(g_client_config.playout_max_delay, (pj_uint32_t)AVSYNC_MAX_OFFSET) * 1000;
+			diff = MAX(MIN(diff, limit), -limit);
+		}
+	}
+
+	if(!synced)
+	{
+		diff = 0;
+	}
+	else
+	{
+		++ state.frames_;
+	}
+
+	if(synced != state.synced_)
+	{
+		PJ_LOG(5, (__ABS_FILE__, "Align() => video ssrc[%u] screen[%u] %s, offset[%lld]ms",
+			video_ssrc, idx, synced ? (state.by_report_ ? "synced by sender reports" : "synced by arrival") : "unsynced",
+			state.offset_usec_ / 1000));
+	}
+	state.synced_ = synced;
+	state.offset_usec_ += (diff - state.offset_usec_) / AVSYNC_SMOOTH;
+
+	pj_int64_t aligned = (pj_int64_t)due + state.offset_usec_;
+	state.last_due_ = MAX(state.last_due_, aligned > 0 ? (pj_uint64_t)aligned : 0);
+
+	return state.last_due_;
+}
+
+/**
+ * ·SRʱӳ䵽Ͷ˵NTPʱ, ӳ䵽Եĵê.
+ * Ƶ֡Ƶʱڲʱ, ӵòųʱ, Ƶ֡Ӧʾʱ.
+ */
+pj_bool_t AvSync::Target(pj_uint32_t video_ssrc, pj_uint32_t ts, const audio_clock_t &clock, pj_int64_t &target, pj_bool_t &by_report)
+{
+	lock_guard<mutex> lock(sources_lock_);
+
+	sync_source_map_t::const_iterator pvideo = sources_.find(video_ssrc);
+	sync_source_map_t::const_iterator paudio = sources_.find(clock.ssrc_);
+	RETURN_VAL_IF_FAIL(pvideo != sources_.end() && paudio != sources_.end(), PJ_FALSE);
+
+	const sync_source_t &video = pvideo->second;
+	const sync_source_t &audio = paudio->second;
+	RETURN_VAL_IF_FAIL(video.rate_ > 0 && audio.rate_ > 0, PJ_FALSE);
+
+	by_report = video.report_.valid_ && audio.report_.valid_ ? PJ_TRUE : PJ_FALSE;
+	const ts_anchor_t &video_anchor = by_report ? video.report_ : video.arrival_;
+	const ts_anchor_t &audio_anchor = by_report ? audio.report_ : audio.arrival_;
+	RETURN_VAL_IF_FAIL(video_anchor.valid_ && audio_anchor.valid_, PJ_FALSE);
+
+	target = (pj_int64_t)clock.usec_ + Wall(video_anchor, ts, video.rate_) - Wall(audio_anchor, clock.ts_, audio.rate_);
+
+	return PJ_TRUE;
+}
+
+// ÷sources_lock_
+void AvSync::Expire(pj_uint64_t now_usec)
+{
+	for(sync_source_map_t::iterator psource = sources_.begin(); psource != sources_.end(); )
+	{
+		if(now_usec > psource->second.updated_usec_ + AVSYNC_EXPIRE * 1000)
+		{
+			psource = sources_.erase(psource);
+			continue;
+		}
+		++ psource;
+	}
+}
+
+// ʱз, êǰڶȷ
+pj_int64_t AvSync::Wall(const ts_anchor_t &anchor, pj_uint32_t ts, pj_uint32_t rate)
+{
+	return anchor.usec_ + (pj_int64_t)(pj_int32_t)(ts - anchor.ts_) * 1000000 / rate;
+}
@@ -0,0 +1,96 @@
+#ifndef __AVS_PROXY_CLIENT_AV_SYNC__
+#define __AVS_PROXY_CLIENT_AV_SYNC__
+
+#include <mutex>
+#include <unordered_map>
+
+#include "SeqLock.hpp"
+#include "Com.h"
+
+using std::mutex;
+using std::lock_guard;
+
+#define AVSYNC_CLOCK_STALE      200     // ms, ƵʱӳʱûиΪûڷ
+#define AVSYNC_MAX_OFFSET       2000    // ms, ҪĵֵΪӳ, ͬ; ͬʱĵplayout_max_delay
+#define AVSYNC_SMOOTH           16      // Ƶĵÿֵֻ֡1/16, ಻ͻ
+#define AVSYNC_ANCHOR_RELAX     256     // êÿʵʵʱ1/256, ӳٵı仯
+#define AVSYNC_ANCHOR_RESET     3000    // ms, ʱêֵΪ, ê
+#define AVSYNC_EXPIRE           60000   // ms, ʱûиµssrc
+
+// RTPʱts_Ӧʱusec_, ʱƵͬһ·ʱʱ
+typedef struct
+{
+	pj_bool_t   valid_;
+	pj_uint32_t ts_;
+	pj_int64_t  usec_;
+} ts_anchor_t;
+
+typedef struct
+{
+	pj_uint32_t  rate_;              // ʱƵ, յһRTPǰΪ0
+	ts_anchor_t  report_;            // һSR: Ͷ˵NTPʱ
+	ts_anchor_t  arrival_;           // 絽İ: ʱ; ·SR֮ǰ˶
+	pj_uint64_t  updated_usec_;
+} sync_source_t;
+
+typedef std::unordered_map<pj_uint32_t, sync_source_t> sync_source_map_t;   // ssrc -> ʱӳ
+
+// صд: ssrc_ʱts_ڱʱusec_ʼų
+typedef struct
+{
+	pj_uint32_t ssrc_;
+	pj_uint32_t ts_;
+	pj_uint64_t usec_;
+} audio_clock_t;
+
+// һ·Ƶͬ״̬, ֻVideoStream߳з
+typedef struct
+{
+	pj_int64_t  offset_usec_;        // ǰʩϵĵ, ΪƳ
+	pj_uint64_t last_due_;           // ͬһ·ĲʱҲ
+	pj_bool_t   synced_;             // һ֡ǷƵ
+	pj_bool_t   by_report_;          // SR, 򰴵ʱ
+	pj_uint32_t frames_;             // ͳڶ֡
+} av_sync_state_t;
+
+/**
+ * ӵƵͬ, ƵΪʱ.
+ * صÿڷŵƵʱͷųʱ; Ƶں,
+ * ֡ʱ·ԵSRӳ䵽Ͷ˵NTPʱ, ͬһʱ̵Ƶʱ,
+ * ٰƵʱӦųıʱ, 𲽵Ƶȥ.
+ * ûSRʱ˶·Сӳͬ, ø絽İΪͬʱԭ.
+ * ֻʾĻڱûͬ, ƵԼ.
+ */
+class AvSync
+	: public Noncopyable
+{
+public:
+	AvSync();
+
+	void Clear();
+	// հ߳е, ϰеSR
+	void OnRxRtcp(const pj_uint8_t *packet, pj_uint32_t packetlen);
+	// ƵAudioStream::Put()е, ƵAlign()˳, rateΪʱƵ(Hz)
+	void OnRtp(pj_uint32_t ssrc, pj_uint32_t ts, const pj_timestamp &arrival, pj_uint32_t rate);
+	// صе
+	void OnAudioPlayed(pj_uint32_t idx, pj_uint32_t ssrc, pj_uint32_t ts, pj_uint64_t play_usec);
+	// Ƶ߳е, ض뵽ƵĲʱ; ޷ʱ𲽻ص0
+	pj_uint64_t Align(pj_uint32_t video_ssrc, pj_uint32_t ts, const pj_timestamp &arrival, pj_uint64_t due,
+		av_sync_state_t &state);
+
+	static pj_int64_t Wall(const ts_anchor_t &anchor, pj_uint32_t ts, pj_uint32_t rate);
+
+private:
+	void UpdateArrival(ts_anchor_t &anchor, pj_uint32_t ts, pj_uint64_t arrival_usec, pj_uint32_t rate);
+	pj_bool_t Target(pj_uint32_t video_ssrc, pj_uint32_t ts, const audio_clock_t &clock, pj_int64_t &target, pj_bool_t &by_report);
+	void Expire(pj_uint64_t now_usec);
+
+	mutex                  sources_lock_;
+	sync_source_map_t      sources_;
+	pj_uint64_t            expired_usec_;
+	SeqLock<audio_clock_t> clocks_[MAXIMAL_SCREEN_NUM];   // Ļ, ֻصд
+};
+
+extern AvSync g_av_sync;
+
+#endif
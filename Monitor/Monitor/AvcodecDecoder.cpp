@@ -0,0 +1,154 @@
+#include "stdafx.h"
+#include "AvcodecDecoder.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "AvcodecDecoder.cpp"
+
+static void release_av_frame(AVFrame *frame)
+{
+	av_frame_free(&frame);
+}
+
+// ֡߳ÿ̶߳໺һ֡, ӳ߳, ֻȷʱ
+static int thread_type_of(const pj_str_t &name)
+{
+	pj_str_t frame = pj_str("frame");
+	if(pj_stricmp(&name, &frame) == 0)
+	{
+		return FF_THREAD_FRAME;
+	}
+	return FF_THREAD_SLICE;
+}
+
+static enum AVDiscard skip_frame_of(const pj_str_t &name)
+{
+	pj_str_t nonref = pj_str("nonref");
+	pj_str_t bidir = pj_str("bidir");
+	pj_str_t nonkey = pj_str("nonkey");
+	if(pj_stricmp(&name, &nonref) == 0)
+	{
+		return AVDISCARD_NONREF;
+	}
+	else if(pj_stricmp(&name, &bidir) == 0)
+	{
+		return AVDISCARD_BIDIR;
+	}
+	else if(pj_stricmp(&name, &nonkey) == 0)
+	{
+		return AVDISCARD_NONKEY;
+	}
+	return AVDISCARD_DEFAULT;
+}
+
+AvcodecDecoder::AvcodecDecoder()
+	: context_(nullptr)
+	, packetizer_(nullptr)
+	, au_buf_(nullptr)
+	, au_size_(PJMEDIA_MAX_VIDEO_ENC_FRAME_SIZE)
+{
+}
+
+pj_status_t AvcodecDecoder::Open(pj_pool_t *pool)
+{
+	au_buf_ = (pj_uint8_t *)pj_pool_alloc(pool, au_size_ + FF_INPUT_BUFFER_PADDING_SIZE);
+	RETURN_VAL_IF_FAIL(au_buf_ != nullptr, PJ_ENOMEM);
+
+	pjmedia_h264_packetizer_cfg cfg;
+	pj_bzero(&cfg, sizeof(cfg));
+	cfg.mtu = PJMEDIA_MAX_MRU;
+	cfg.mode = PJMEDIA_H264_PACKETIZER_MODE_NON_INTERLEAVED;
+
+	pj_status_t status;
+	status = pjmedia_h264_packetizer_create(pool, &cfg, &packetizer_);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	avcodec_register_all();
+	AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+	RETURN_VAL_IF_FAIL(codec != nullptr, PJ_ENOTFOUND);
+
+	context_ = avcodec_alloc_context3(codec);
+	RETURN_VAL_IF_FAIL(context_ != nullptr, PJ_ENOMEM);
+
+	context_->refcounted_frames = 1;    // ֡÷, ɿ߳̽Ļ
+	context_->thread_count = g_client_config.decoder_threads;
+	context_->thread_type = thread_type_of(g_client_config.decoder_thread_type);
+	context_->skip_frame = skip_frame_of(g_client_config.decoder_skip_frame);
+	if(g_client_config.decoder_fast)
+	{
+		context_->flags2 |= CODEC_FLAG2_FAST;
+	}
+
+	int ret = avcodec_open2(context_, codec, NULL);
+	RETURN_VAL_IF_FAIL(ret >= 0, PJ_EINVAL);
+
+	PJ_LOG(5, (__ABS_FILE__, "Open libavcodec h264 decoder threads[%d] thread_type[%d] skip_frame[%d] fast[%d]",
+		context_->thread_count, context_->thread_type, context_->skip_frame, g_client_config.decoder_fast));
+
+	return PJ_SUCCESS;
+}
+
+void AvcodecDecoder::Close()
+{
+	RETURN_IF_FAIL(context_ != nullptr);
+
+	avcodec_free_context(&context_);
+}
+
+void AvcodecDecoder::Flush()
+{
+	RETURN_IF_FAIL(context_ != nullptr);
+
+	avcodec_flush_buffers(context_);
+
+	// ƴδɵFU-A
+	unsigned pos = 0;
+	pjmedia_h264_unpacketize(packetizer_, NULL, 0, au_buf_, au_size_, &pos);
+}
+
+pj_status_t AvcodecDecoder::Decode(const pjmedia_frame *packets, pj_uint32_t count, pj_uint32_t ts, video_frame_ptr_t &frame)
+{
+	RETURN_VAL_IF_FAIL(context_ != nullptr, PJ_EINVALIDOP);
+
+	unsigned pos = 0;
+	for(pj_uint32_t i = 0; i < count; ++ i)
+	{
+		// ʧİNULL֪ƴ, ȱNAL
+		pjmedia_h264_unpacketize(packetizer_,
+			(const pj_uint8_t *)packets[i].buf, packets[i].buf != nullptr ? packets[i].size : 0,
+			au_buf_, au_size_, &pos);
+	}
+	RETURN_VAL_IF_FAIL(pos > 0, PJ_ENOTFOUND);
+	pj_bzero(au_buf_ + pos, FF_INPUT_BUFFER_PADDING_SIZE);
+
+	AVPacket packet;
+	av_init_packet(&packet);
+	packet.data = au_buf_;
+	packet.size = pos;
+	packet.pts = ts;
+
+	AVFrame *picture = av_frame_alloc();
+	RETURN_VAL_IF_FAIL(picture != nullptr, PJ_ENOMEM);
+
+	int got_picture = 0;
+	int ret = avcodec_decode_video2(context_, picture, &got_picture, &packet);
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(ret >= 0 && got_picture, release_av_frame(picture), PJ_ENOTFOUND);
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(picture->format == AV_PIX_FMT_YUV420P || picture->format == AV_PIX_FMT_YUVJ420P,
+		release_av_frame(picture), PJ_ENOTSUP);
+
+	video_frame_t *decoded = new video_frame_t;
+	decoded->width_ = picture->width;
+	decoded->height_ = picture->height;
+	for(pj_uint32_t i = 0; i < 3; ++ i)
+	{
+		decoded->planes_[i] = picture->data[i];
+		decoded->pitches_[i] = picture->linesize[i];
+	}
+	decoded->buffer_ = shared_ptr<AVFrame>(picture, release_av_frame);
+	frame.reset(decoded);
+
+	return PJ_SUCCESS;
+}
@@ -0,0 +1,32 @@
+#ifndef __AVS_PROXY_CLIENT_AVCODEC_DECODER__
+#define __AVS_PROXY_CLIENT_AVCODEC_DECODER__
+
+#include <pjmedia-codec.h>
+
+#include "VideoDecoder.h"
+
+/**
+ * ֱӵlibavcodec. RTPؾpjmedia_h264_unpacketizeƴAnnex-Baccess unit,
+ * AVFrameüķʽĻ, ٿ.
+ * ߳ģ, skip_frameflags2=fastclient.xml.
+ */
+class AvcodecDecoder
+	: public VideoDecoder
+{
+public:
+	AvcodecDecoder();
+
+	virtual pj_status_t Open(pj_pool_t *pool);
+	virtual void        Close();
+	virtual void        Flush();
+	virtual pj_status_t Decode(const pjmedia_frame *packets, pj_uint32_t count, pj_uint32_t ts, video_frame_ptr_t &frame);
+	virtual const char *Name() const { return "ffmpeg"; }
+
+private:
+	AVCodecContext          *context_;
+	pjmedia_h264_packetizer *packetizer_;
+	pj_uint8_t              *au_buf_;
+	pj_uint32_t              au_size_;
+};
+
+#endif
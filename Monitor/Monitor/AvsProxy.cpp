@@ -7,6 +7,12 @@
 
 #define __ABS_FILE__ "AvsProxy.cpp"
 
+// ˵ʱҪproxyתƵ
+static pj_uint8_t media_mask()
+{
+	return (pj_uint8_t)(MEDIA_MASK_VIDEO | (g_client_config.audio_enable || g_client_config.speaker_enable ? MEDIA_MASK_AUDIO : 0));
+}
+
 AvsProxy::AvsProxy(pj_uint16_t id, const pj_str_t &ip, pj_uint16_t tcp_port, pj_uint16_t udp_port, pj_sock_t sock)
 	: pfunction_(nullptr)
 	, tcp_ev_(nullptr)
@@ -18,6 +24,9 @@ AvsProxy::AvsProxy(pj_uint16_t id, const pj_str_t &ip, pj_uint16_t tcp_port, pj_
 	, udp_port_(udp_port)
 	, active_(PJ_FALSE)
 	, tcp_storage_offset_(0)
+	, resuming_(PJ_FALSE)
+	, snapshot_lock_()
+	, snapshot_()
 {
 }
 
@@ -76,6 +85,8 @@ pj_status_t AvsProxy::OnRxNAT()
 
 	PJ_LOG(5, (__ABS_FILE__, "OnRxNAT() => Receive NAT response from proxy id[%u]. Proxy is online now.", id_));
 
+	ReplaySnapshot();
+
 	lock_guard<mutex> lock(waits_rooms_lock_);
 	for(pj_uint32_t i = 0; i < waits_rooms_.size(); ++ i)
 	{
@@ -139,20 +150,202 @@ void AvsProxy::Destory()
 	}
 }
 
+void AvsProxy::Suspend()
+{
+	status_ = AVS_PROXY_STATUS_RESUMING;
+	tcp_storage_offset_ = 0;
+
+	lock_guard<mutex> snapshot_lock(snapshot_lock_);
+	snapshot_.rooms.clear();
+	snapshot_.bindings.clear();
+
+	lock_guard<mutex> rooms_lock(rooms_lock_);
+	for(room_map_t::iterator proom = rooms_.begin(); proom != rooms_.end(); ++ proom)
+	{
+		room_map_t::mapped_type title_room = proom->second;
+		if(title_room == nullptr)
+		{
+			continue;
+		}
+
+		snapshot_.rooms.insert(proom->first);
+
+		lock_guard<mutex> room_lock(title_room->room_lock_);
+		for(users_map_t::iterator puser = title_room->users_.begin();
+			puser != title_room->users_.end(); ++ puser)
+		{
+			users_map_t::mapped_type user = puser->second;
+			if(user != nullptr && user->IsForwarded())
+			{
+				user_binding_t binding = {title_room->id_, user->user_id_};
+				snapshot_.bindings.push_back(binding);
+			}
+		}
+	}
+
+	snapshot_.replayed = PJ_FALSE;
+	resuming_ = PJ_TRUE;
+
+	PJ_LOG(5, (__ABS_FILE__, "Suspend() => Proxy id[%u] suspended with %u rooms and %u screen bindings",
+		id_, snapshot_.rooms.size(), snapshot_.bindings.size()));
+}
+
+pj_status_t AvsProxy::Resume(pj_sock_t sock)
+{
+	RETURN_VAL_IF_FAIL(status_ == AVS_PROXY_STATUS_RESUMING, PJ_EINVALIDOP);
+
+	{
+		lock_guard<mutex> tcp_lock(tcp_lock_);
+		sock_ = sock;
+	}
+	tcp_storage_offset_ = 0;
+	status_ = AVS_PROXY_STATUS_UNINIT;
+
+	PJ_LOG(5, (__ABS_FILE__, "Resume() => Proxy id[%u] reconnected, replay login", id_));
+
+	return PJ_SUCCESS;
+}
+
+void AvsProxy::ReplaySnapshot()
+{
+	vector<pj_int32_t>     rooms_id;
+	vector<user_binding_t> users;
+
+	{
+		lock_guard<mutex> snapshot_lock(snapshot_lock_);
+		RETURN_IF_FAIL(resuming_ && !snapshot_.replayed);
+
+		set<pj_int32_t>::iterator proom_id = snapshot_.rooms.begin();
+		for(; proom_id != snapshot_.rooms.end();)
+		{
+			TitleRoom *title_room = nullptr;
+			if(GetRoom(*proom_id, title_room) == PJ_SUCCESS)
+			{
+				rooms_id.push_back(*proom_id);
+				++ proom_id;
+			}
+			else
+			{
+				proom_id = snapshot_.rooms.erase(proom_id);  // ڼ䷿ѱȡע
+			}
+		}
+
+		for(pj_uint32_t i = 0; i < snapshot_.bindings.size(); ++ i)
+		{
+			const user_binding_t &binding = snapshot_.bindings[i];
+			TitleRoom *title_room = nullptr;
+			if(GetRoom(binding.room_id, title_room) != PJ_SUCCESS)
+			{
+				continue;
+			}
+
+			lock_guard<mutex> room_lock(title_room->room_lock_);
+			users_map_t::iterator puser = title_room->users_.find(binding.user_id);
+			if(puser != title_room->users_.end()
+				&& puser->second != nullptr
+				&& puser->second->IsForwarded())
+			{
+				users.push_back(binding);
+			}
+		}
+		snapshot_.bindings.clear();
+		snapshot_.replayed = PJ_TRUE;
+
+		if(snapshot_.rooms.empty())
+		{
+			resuming_ = PJ_FALSE;
+		}
+	}
+
+	PJ_LOG(5, (__ABS_FILE__, "ReplaySnapshot() => Proxy id[%u] replay %u rooms and %u users",
+		id_, rooms_id.size(), users.size()));
+
+	LinkRooms(rooms_id);
+	LinkRoomUsers(users);
+}
+
+/**
+ * ط֮ǰµlink/unlinkֻbindings, ReplaySnapshot()ͳһ,
+ * ͬһûطźֱӷиlinkһ. PJ_TRUEʾӺ.
+ */
+pj_bool_t AvsProxy::DeferLink(const user_binding_t &binding, pj_bool_t link)
+{
+	lock_guard<mutex> snapshot_lock(snapshot_lock_);
+	RETURN_VAL_IF_FAIL(resuming_ && !snapshot_.replayed, PJ_FALSE);
+
+	vector<user_binding_t>::iterator pbinding = snapshot_.bindings.begin();
+	for(; pbinding != snapshot_.bindings.end(); ++ pbinding)
+	{
+		if(pbinding->room_id == binding.room_id && pbinding->user_id == binding.user_id)
+		{
+			break;
+		}
+	}
+
+	if(link && pbinding == snapshot_.bindings.end())
+	{
+		snapshot_.bindings.push_back(binding);
+	}
+	else if(!link && pbinding != snapshot_.bindings.end())
+	{
+		snapshot_.bindings.erase(pbinding);
+	}
+
+	return PJ_TRUE;
+}
+
+pj_bool_t AvsProxy::IsResumingRoom(pj_int32_t room_id)
+{
+	lock_guard<mutex> snapshot_lock(snapshot_lock_);
+	RETURN_VAL_IF_FAIL(resuming_, PJ_FALSE);
+
+	return snapshot_.rooms.find(room_id) != snapshot_.rooms.end() ? PJ_TRUE : PJ_FALSE;
+}
+
+void AvsProxy::OnReconciled(pj_int32_t room_id)
+{
+	lock_guard<mutex> snapshot_lock(snapshot_lock_);
+	snapshot_.rooms.erase(room_id);
+
+	if(snapshot_.rooms.empty())
+	{
+		resuming_ = PJ_FALSE;
+
+		PJ_LOG(5, (__ABS_FILE__, "OnReconciled() => Proxy id[%u] session was resumed", id_));
+	}
+}
+
 pj_status_t AvsProxy::LinkRoomUser(User *user)
 {
 	RETURN_VAL_IF_FAIL(user, PJ_EINVAL);
 
+	user_binding_t binding = {user->title_room_->id_, user->user_id_};
+	return LinkRoomUser(binding);
+}
+
+pj_status_t AvsProxy::UnlinkRoomUser(User *user)
+{
+	RETURN_VAL_IF_FAIL(user, PJ_EINVAL);
+
+	user_binding_t binding = {user->title_room_->id_, user->user_id_};
+	return UnlinkRoomUser(binding);
+}
+
+// ֻid, ÷Ҫڷڼ䱣֤User
+pj_status_t AvsProxy::LinkRoomUser(const user_binding_t &binding)
+{
+	RETURN_VAL_IF_FAIL(!DeferLink(binding, PJ_TRUE), PJ_SUCCESS);
+
 	request_to_avs_proxy_link_room_user_t link_room_user;
 	link_room_user.client_request_type = REQUEST_FROM_CLIENT_TO_AVSPROXY_LINK_ROOM_USER;
 	link_room_user.proxy_id = id_;
 	link_room_user.client_id = g_client_config.client_id;
-	link_room_user.room_id = user->title_room_->id_;
-	link_room_user.user_id = user->user_id_;
-	link_room_user.link_media_mask = MEDIA_MASK_VIDEO;
+	link_room_user.room_id = binding.room_id;
+	link_room_user.user_id = binding.user_id;
+	link_room_user.link_media_mask = media_mask();
 
 	PJ_LOG(5, (__ABS_FILE__, "LinkRoomUser() => Send REQUEST_FROM_CLIENT_TO_AVSPROXY_LINK_ROOM_USER to Proxy id[%u] roomid[%d] userid[%ld]",
-		id_, user->title_room_->id_, user->user_id_));
+		id_, binding.room_id, binding.user_id));
 
 	link_room_user.Serialize();
 
@@ -160,20 +353,20 @@ pj_status_t AvsProxy::LinkRoomUser(User *user)
 	return SendTCPPacket(&link_room_user, &sndlen);
 }
 
-pj_status_t AvsProxy::UnlinkRoomUser(User *user)
+pj_status_t AvsProxy::UnlinkRoomUser(const user_binding_t &binding)
 {
-	RETURN_VAL_IF_FAIL(user, PJ_EINVAL);
+	RETURN_VAL_IF_FAIL(!DeferLink(binding, PJ_FALSE), PJ_SUCCESS);
 
 	request_to_avs_proxy_unlink_room_user_t unlink_room_user;
 	unlink_room_user.client_request_type = REQUEST_FROM_CLIENT_TO_AVSPROXY_UNLINK_ROOM_USER;
 	unlink_room_user.proxy_id = id_;
 	unlink_room_user.client_id = g_client_config.client_id;
-	unlink_room_user.room_id = user->title_room_->id_;
-	unlink_room_user.user_id = user->user_id_;
-	unlink_room_user.unlink_media_mask = MEDIA_MASK_VIDEO;
+	unlink_room_user.room_id = binding.room_id;
+	unlink_room_user.user_id = binding.user_id;
+	unlink_room_user.unlink_media_mask = media_mask();
 	
 	PJ_LOG(5, (__ABS_FILE__, "UnlinkRoomUser() => Send REQUEST_FROM_CLIENT_TO_AVSPROXY_UNLINK_ROOM_USER to Proxy id[%u] roomid[%d] userid[%ld]",
-		id_, user->title_room_->id_, user->user_id_));
+		id_, binding.room_id, binding.user_id));
 
 	unlink_room_user.Serialize();
 
@@ -230,6 +423,62 @@ pj_status_t AvsProxy::UnlinkRoom(TitleRoom *title_room)
 	return SendTCPPacket(&unlink_room, &sndlen);
 }
 
+// ϲΪһTCP
+pj_status_t AvsProxy::LinkRooms(const vector<pj_int32_t> &rooms_id)
+{
+	RETURN_VAL_IF_FAIL(!rooms_id.empty(), PJ_SUCCESS);
+
+	vector<request_to_avs_proxy_link_room_t> link_rooms(rooms_id.size());
+	for(pj_uint32_t i = 0; i < rooms_id.size(); ++ i)
+	{
+		link_rooms[i].client_request_type = REQUEST_FROM_CLIENT_TO_AVSPROXY_LINK_ROOM;
+		link_rooms[i].proxy_id = id_;
+		link_rooms[i].client_id = g_client_config.client_id;
+		link_rooms[i].room_id = rooms_id[i];
+		link_rooms[i].Serialize();
+	}
+
+	PJ_LOG(5, (__ABS_FILE__, "LinkRooms() => Send %u REQUEST_FROM_CLIENT_TO_AVSPROXY_LINK_ROOM to Proxy id[%u]",
+		rooms_id.size(), id_));
+
+	pj_ssize_t sndlen = link_rooms.size() * sizeof(link_rooms[0]);
+	return SendTCPPacket(&link_rooms[0], &sndlen);
+}
+
+// ֻ, ÷سз
+pj_status_t AvsProxy::LinkRoomUsers(const vector<user_binding_t> &users)
+{
+	RETURN_VAL_IF_FAIL(!users.empty(), PJ_SUCCESS);
+
+	vector<request_to_avs_proxy_link_room_user_t> link_room_users;
+	link_room_users.reserve(users.size());
+	for(pj_uint32_t i = 0; i < users.size(); ++ i)
+	{
+		const user_binding_t &binding = users[i];
+		if(DeferLink(binding, PJ_TRUE))
+		{
+			continue;
+		}
+
+		request_to_avs_proxy_link_room_user_t link_room_user;
+		link_room_user.client_request_type = REQUEST_FROM_CLIENT_TO_AVSPROXY_LINK_ROOM_USER;
+		link_room_user.proxy_id = id_;
+		link_room_user.client_id = g_client_config.client_id;
+		link_room_user.room_id = binding.room_id;
+		link_room_user.user_id = binding.user_id;
+		link_room_user.link_media_mask = media_mask();
+		link_room_user.Serialize();
+		link_room_users.push_back(link_room_user);
+	}
+	RETURN_VAL_IF_FAIL(!link_room_users.empty(), PJ_SUCCESS);
+
+	PJ_LOG(5, (__ABS_FILE__, "LinkRoomUsers() => Send %u REQUEST_FROM_CLIENT_TO_AVSPROXY_LINK_ROOM_USER to Proxy id[%u]",
+		link_room_users.size(), id_));
+
+	pj_ssize_t sndlen = link_room_users.size() * sizeof(link_room_users[0]);
+	return SendTCPPacket(&link_room_users[0], &sndlen);
+}
+
 pj_status_t AvsProxy::AddRoom(pj_int32_t room_id, TitleRoom *title_room)
 {
 	lock_guard<mutex> lock(rooms_lock_);
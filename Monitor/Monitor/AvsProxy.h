@@ -13,9 +13,28 @@ enum _enum_avs_proxy_status_
 	AVS_PROXY_STATUS_UNINIT = 0,    /**< Wait for login response. */
 	AVS_PROXY_STATUS_LOGINING,
 	AVS_PROXY_STATUS_NATING,        /**< Wait for NAT response. */
-	AVS_PROXY_STATUS_ONLINE
+	AVS_PROXY_STATUS_ONLINE,
+	AVS_PROXY_STATUS_RESUMING       /**< TCP lost, wait for background reconnect. */
 };
 
+typedef struct
+{
+	pj_int32_t  room_id;
+	pj_int64_t  user_id;
+} user_binding_t;
+
+/**
+ * Compact state kept while a proxy is being resumed. It only records
+ * what must be replayed to the proxy, rooms and users stay alive so that
+ * the screens keep their decoders and jitter buffers.
+ */
+typedef struct
+{
+	set<pj_int32_t>        rooms;        // δյRoomsInfoķ
+	vector<user_binding_t> bindings;     // ʱScreenʾ, Ԥȡ򽡿еû
+	pj_bool_t              replayed;     // bindingsط, ֮LinkRoomUserֱӷ
+} proxy_snapshot_t;
+
 class User;
 class TitleRoom;
 typedef map<pj_int32_t, TitleRoom *> room_map_t;
@@ -29,12 +48,20 @@ public:
 	pj_status_t OnRxNAT();
 	pj_status_t Logout();
 	void        Destory();
+	void        Suspend();
+	pj_status_t Resume(pj_sock_t sock);
+	pj_bool_t   IsResumingRoom(pj_int32_t room_id);
+	void        OnReconciled(pj_int32_t room_id);
 
 	/**< ûקScreen */
 	pj_status_t LinkRoomUser(User *user);
 	pj_status_t UnlinkRoomUser(User *user);
+	pj_status_t LinkRoomUser(const user_binding_t &binding);
+	pj_status_t UnlinkRoomUser(const user_binding_t &binding);
 	pj_status_t LinkRoom(TitleRoom *title_room);
 	pj_status_t UnlinkRoom(TitleRoom *title_room);
+	pj_status_t LinkRooms(const vector<pj_int32_t> &rooms_id);
+	pj_status_t LinkRoomUsers(const vector<user_binding_t> &users);
 	pj_status_t AddRoom(pj_int32_t room_id, TitleRoom *title_room);
 	pj_status_t DelRoom(pj_int32_t room_id, TitleRoom *title_room, room_map_t::iterator &proom);
 	pj_status_t GetRoom(pj_int32_t room_id, TitleRoom *&title_room);
@@ -57,6 +84,13 @@ public:
 	room_vec_t   waits_rooms_;                    // ȴLinkRoomķ
 	pj_uint8_t   tcp_storage_[MAX_STORAGE_SIZE];  // TCP
 	pj_uint16_t  tcp_storage_offset_;             // TCPƫƵַ
+	pj_bool_t    resuming_;                       // طŶǰ״̬
+	mutex        snapshot_lock_;
+	proxy_snapshot_t snapshot_;
+
+private:
+	void        ReplaySnapshot();
+	pj_bool_t   DeferLink(const user_binding_t &binding, pj_bool_t link);
 };
 
 #endif
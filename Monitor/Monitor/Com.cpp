@@ -3,6 +3,7 @@
 
 evutil_socket_t g_mainframe_pipe[2];
 index_map_t g_av_index_map[2];
+std::mutex  g_av_index_lock;
 
 namespace sinashow
 {
@@ -185,6 +186,27 @@ void http_tls_get(const pj_str_t &host, pj_uint16_t port, const pj_str_t &url,
 		conn.pump();
 }
 
+static void OnStreamData( const happyhttp::Response* r, void* userdata, const unsigned char* data, int n )
+{
+	const http_data_cb_t &on_data = *(reinterpret_cast<const http_data_cb_t *>(userdata));
+	on_data(data, n);
+}
+
+// http_tls_getͬ, ÿյһݼص, Ӧ
+void http_tls_stream(const pj_str_t &host, pj_uint16_t port, const pj_str_t &url,
+					 pj_uint32_t node_id, const http_data_cb_t &on_data)
+{
+	std::stringstream ss_uri;
+	ss_uri << url.ptr << ATTR_NODE_ID << node_id;
+
+	happyhttp::Connection conn(host.ptr, port);
+	conn.setcallbacks(0, OnStreamData, 0, const_cast<http_data_cb_t *>(&on_data));
+	conn.request("GET", ss_uri.str().c_str(), 0, 0, 0);
+
+	while( conn.outstanding() )
+		conn.pump();
+}
+
 void http_proxy_get(const pj_str_t &host, pj_uint16_t port, const pj_str_t &url,
 					pj_uint32_t room_id, std::vector<pj_uint8_t> &response)
 {
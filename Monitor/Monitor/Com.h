@@ -9,6 +9,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <mutex>
 
 #include <pjlib.h>
 #include <pjmedia.h>
@@ -37,6 +38,7 @@ typedef vector<index_map_t> av_index_map_t;
 typedef pj_uint32_t order_t;
 
 #define INVALID_SCREEN_INDEX      -1
+#define PREFETCH_SCREEN_INDEX      0xFE    // ·ɱԤȡûֵ, ƵֻGopCache; User::screen_idx_ȡֵ
 #define MAXIMAL_SCREEN_NUM         15
 #define MAXIMAL_THREAD_NUM         1
 #define MAX_STORAGE_SIZE           1024
@@ -50,6 +52,7 @@ enum { AUDIO_INDEX, VIDEO_INDEX };
 
 extern evutil_socket_t g_mainframe_pipe[2];
 extern index_map_t g_av_index_map[2];
+extern std::mutex  g_av_index_lock;       // g_av_index_map, հ·뻻ҳлͬһ
 
 typedef enum __enum_screen_mgr_resolution_type__
 {
@@ -185,14 +188,17 @@ struct order_cmp
 {
 	bool operator() (const T *t1, const T *t2)
 	{
-		return t1->order_ < t2->order_;
+		return t1->order_ < t2->order_
+			|| (t1->order_ == t2->order_ && t1->id_ < t2->id_);
 	}
 };
 
 pj_status_t log_open(pj_pool_t *pool, const pj_str_t &file_name);
 void        log_writer(int level, const char *log, int loglen);
 
+typedef std::function<void (const pj_uint8_t *, pj_uint32_t)> http_data_cb_t;
 void        http_tls_get(const pj_str_t &host, pj_uint16_t port, const pj_str_t &url, pj_uint32_t node_id, std::vector<pj_uint8_t> &response);
+void        http_tls_stream(const pj_str_t &host, pj_uint16_t port, const pj_str_t &url, pj_uint32_t node_id, const http_data_cb_t &on_data);
 void        http_proxy_get(const pj_str_t &host, pj_uint16_t port, const pj_str_t &url, pj_uint32_t room_id, std::vector<pj_uint8_t> &response);
 
 pj_status_t UTF8_to_GB2312(wchar_t *gb_dst, int gb_len, const pj_str_t &utf_src);
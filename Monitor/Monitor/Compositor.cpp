@@ -0,0 +1,604 @@
+#include "stdafx.h"
+
+#include "Compositor.h"
+#include "Config.h"
+#ifndef COMPOSITOR_HEADLESS_ONLY
+#include "SdlBackend.h"
+#endif
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "Compositor.cpp"
+
+Compositor g_compositor;
+
+static void copy_rect(canvas_t &dst, const canvas_t &src, const tile_rect_t &rect)
+{
+	for(pj_uint32_t plane = 0; plane < 3; ++ plane)
+	{
+		pj_uint32_t shift = plane == 0 ? 0 : 1;
+		pj_uint32_t x = rect.x_ >> shift, y = rect.y_ >> shift;
+		ImageKernels::CopyPlane(src.planes_[plane] + y * src.pitches_[plane] + x, src.pitches_[plane],
+			dst.planes_[plane] + y * dst.pitches_[plane] + x, dst.pitches_[plane],
+			rect.width_ >> shift, rect.height_ >> shift);
+	}
+}
+
+void alloc_canvas(vector<pj_uint8_t> &buffer, canvas_t &canvas, pj_uint32_t width, pj_uint32_t height)
+{
+	pj_uint32_t luma = width * height;
+	buffer.resize(luma + luma / 2);
+
+	canvas.width_ = width;
+	canvas.height_ = height;
+	canvas.planes_[0] = buffer.empty() ? nullptr : &buffer[0];
+	canvas.planes_[1] = canvas.planes_[0] + luma;
+	canvas.planes_[2] = canvas.planes_[1] + luma / 4;
+	canvas.pitches_[0] = width;
+	canvas.pitches_[1] = width / 2;
+	canvas.pitches_[2] = width / 2;
+}
+
+CompositorBackend *CompositorBackend::Create(const pj_str_t &name)
+{
+	pj_str_t headless = pj_str("headless");
+	if(pj_stricmp(&name, &headless) == 0)
+	{
+		return new HeadlessBackend();
+	}
+
+#ifdef COMPOSITOR_HEADLESS_ONLY
+	PJ_LOG(3, (__ABS_FILE__, "Create() => compositor[%.*s] not built in, use headless", (int)name.slen, name.ptr));
+	return new HeadlessBackend();
+#else
+	return new SdlBackend();
+#endif
+}
+
+HeadlessBackend::HeadlessBackend()
+	: buffer_()
+{
+	pj_bzero(&shadow_, sizeof(shadow_));
+}
+
+pj_status_t HeadlessBackend::Open(void * /* native_window */)
+{
+	return PJ_SUCCESS;
+}
+
+void HeadlessBackend::Close()
+{
+	vector<pj_uint8_t>().swap(buffer_);
+	pj_bzero(&shadow_, sizeof(shadow_));
+}
+
+pj_status_t HeadlessBackend::Resize(pj_uint32_t width, pj_uint32_t height)
+{
+	alloc_canvas(buffer_, shadow_, width, height);
+	return PJ_SUCCESS;
+}
+
+// ϴĿͬ, ѹʱܷӳʵĴ
+void HeadlessBackend::Upload(const canvas_t &canvas, const tile_rect_t &rect)
+{
+	copy_rect(shadow_, canvas, rect);
+}
+
+void HeadlessBackend::Present()
+{
+}
+
+pj_uint32_t HeadlessBackend::RefreshRate()
+{
+	return COMPOSITOR_DEFAULT_REFRESH;
+}
+
+Compositor::Compositor()
+	: native_window_(nullptr)
+	, backend_(nullptr)
+	, active_(PJ_FALSE)
+	, present_thread_()
+	, buffer_()
+	, backend_width_(0)
+	, backend_height_(0)
+	, full_(PJ_FALSE)
+{
+	pj_bzero(&canvas_, sizeof(canvas_));
+	pj_bzero(&stats_, sizeof(stats_));
+	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+	{
+		pj_bzero(&tiles_[idx].rect_, sizeof(tile_rect_t));
+		pj_bzero(&tiles_[idx].inner_, sizeof(tile_rect_t));
+		tiles_[idx].dirty_ = PJ_FALSE;
+		tiles_[idx].reblit_ = PJ_FALSE;
+		tiles_[idx].alarm_ = PJ_FALSE;
+		pj_bzero(&tiles_[idx].video_, sizeof(tile_rect_t));
+		tiles_[idx].decoded_ = 0;
+		tiles_[idx].presented_ = 0;
+		tiles_[idx].dropped_ = 0;
+	}
+}
+
+Compositor::~Compositor()
+{
+	delete backend_;
+}
+
+pj_status_t Compositor::Prepare(void *native_window, const pj_str_t &backend)
+{
+	native_window_ = native_window;
+	backend_ = CompositorBackend::Create(backend);
+	RETURN_VAL_IF_FAIL(backend_ != nullptr, PJ_ENOMEM);
+
+	PJ_LOG(5, (__ABS_FILE__, "Prepare compositor ok! backend[%s] kernels[%s]", backend_->Name(), ImageKernels::Get().name_));
+
+	return PJ_SUCCESS;
+}
+
+pj_status_t Compositor::Launch()
+{
+	RETURN_VAL_IF_FAIL(backend_ != nullptr, PJ_EINVALIDOP);
+
+	active_ = PJ_TRUE;
+	present_thread_ = thread(std::bind(&Compositor::PresentThread, this));
+
+	return PJ_SUCCESS;
+}
+
+void Compositor::Destory()
+{
+	active_ = PJ_FALSE;
+	if(present_thread_.joinable())
+	{
+		present_thread_.join();
+	}
+}
+
+void Compositor::LockTiles()
+{
+	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+	{
+		tiles_[idx].lock_.lock();
+	}
+}
+
+void Compositor::UnlockTiles()
+{
+	for(pj_uint32_t idx = MAXIMAL_SCREEN_NUM; idx > 0; -- idx)
+	{
+		tiles_[idx - 1].lock_.unlock();
+	}
+}
+
+// ÷иrect
+void Compositor::Fill(const tile_rect_t &rect, pj_uint8_t y, pj_uint8_t u, pj_uint8_t v)
+{
+	const pj_uint8_t values[3] = {y, u, v};
+	for(pj_uint32_t plane = 0; plane < 3; ++ plane)
+	{
+		pj_uint32_t shift = plane == 0 ? 0 : 1;
+		ImageKernels::FillPlane(canvas_.planes_[plane] + (rect.y_ >> shift) * canvas_.pitches_[plane] + (rect.x_ >> shift),
+			canvas_.pitches_[plane], rect.width_ >> shift, rect.height_ >> shift, values[plane]);
+	}
+}
+
+// ÷tile.lock_, ֻȦ, Ƶ
+void Compositor::DrawBorder(const tile_t &tile)
+{
+	const tile_rect_t &rect = tile.rect_;
+	const tile_rect_t edges[4] =
+	{
+		{rect.x_, rect.y_, rect.width_, 2},
+		{rect.x_, rect.y_ + rect.height_ - 2, rect.width_, 2},
+		{rect.x_, rect.y_ + 2, 2, rect.height_ - 4},
+		{rect.x_ + rect.width_ - 2, rect.y_ + 2, 2, rect.height_ - 4},
+	};
+
+	for(pj_uint32_t i = 0; i < 4; ++ i)
+	{
+		if(tile.alarm_)
+		{
+			Fill(edges[i], CANVAS_ALARM_Y, CANVAS_ALARM_U, CANVAS_ALARM_V);
+		}
+		else
+		{
+			Fill(edges[i], CANVAS_BORDER_Y, CANVAS_BLACK_UV, CANVAS_BLACK_UV);
+		}
+	}
+}
+
+/**
+ * ֱ仯ʱɽ̵߳: ³ߴؽ, ɺɫи,
+ * SetTileֻ·²еĻ.
+ */
+void Compositor::Resize(pj_uint32_t width, pj_uint32_t height)
+{
+	lock_guard<mutex> surface_lock(surface_lock_);
+	LockTiles();
+
+	width &= ~1;
+	height &= ~1;
+	if(width != canvas_.width_ || height != canvas_.height_)
+	{
+		alloc_canvas(buffer_, canvas_, width, height);
+	}
+
+	tile_rect_t whole = {0, 0, canvas_.width_, canvas_.height_};
+	Fill(whole, CANVAS_BLACK_Y, CANVAS_BLACK_UV, CANVAS_BLACK_UV);
+
+	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+	{
+		pj_bzero(&tiles_[idx].rect_, sizeof(tile_rect_t));
+		pj_bzero(&tiles_[idx].inner_, sizeof(tile_rect_t));
+		pj_bzero(&tiles_[idx].video_, sizeof(tile_rect_t));
+		tiles_[idx].dirty_ = PJ_FALSE;
+	}
+	full_ = PJ_TRUE;
+
+	UnlockTiles();
+}
+
+// 갴ɫȡżü, Ȧػ߿
+void Compositor::SetTile(pj_uint32_t idx, const tile_rect_t &rect)
+{
+	RETURN_IF_FAIL(idx < MAXIMAL_SCREEN_NUM);
+
+	tile_t &tile = tiles_[idx];
+	lock_guard<mutex> lock(tile.lock_);
+
+	tile_rect_t aligned = {rect.x_ & ~1, rect.y_ & ~1, rect.width_ & ~1, rect.height_ & ~1};
+	if(aligned.x_ >= canvas_.width_ || aligned.y_ >= canvas_.height_)
+	{
+		aligned.width_ = aligned.height_ = 0;
+	}
+	else
+	{
+		aligned.width_ = MIN(aligned.width_, canvas_.width_ - aligned.x_);
+		aligned.height_ = MIN(aligned.height_, canvas_.height_ - aligned.y_);
+	}
+
+	tile.rect_ = aligned;
+	pj_bzero(&tile.video_, sizeof(tile_rect_t));
+	if(aligned.width_ <= 4 || aligned.height_ <= 4)
+	{
+		pj_bzero(&tile.inner_, sizeof(tile_rect_t));
+		return;
+	}
+
+	tile_rect_t inner = {aligned.x_ + 2, aligned.y_ + 2, aligned.width_ - 4, aligned.height_ - 4};
+	tile.inner_ = inner;
+	DrawBorder(tile);
+	Fill(inner, CANVAS_BLACK_Y, CANVAS_BLACK_UV, CANVAS_BLACK_UV);
+
+	tile.dirty_ = PJ_TRUE;
+	tile.reblit_ = PJ_TRUE;
+}
+
+// ɼƵ澯Ķʱ, ֻ״̬仯ʱػ߿
+void Compositor::SetAlarm(pj_uint32_t idx, pj_bool_t alarm)
+{
+	RETURN_IF_FAIL(idx < MAXIMAL_SCREEN_NUM);
+
+	tile_t &tile = tiles_[idx];
+	lock_guard<mutex> lock(tile.lock_);
+	RETURN_IF_FAIL(tile.alarm_ != alarm);
+
+	tile.alarm_ = alarm;
+	RETURN_IF_FAIL(tile.inner_.width_ > 0);
+
+	DrawBorder(tile);
+	tile.dirty_ = PJ_TRUE;
+}
+
+/**
+ * ڽ߳е, ͬһӵĵ÷֮軥(Screen֤). ȴ߳,
+ * һ֡ûʱֱӸ. ֡ʾѸɺɫ.
+ */
+void Compositor::Publish(pj_uint32_t idx, const video_frame_ptr_t &frame)
+{
+	RETURN_IF_FAIL(idx < MAXIMAL_SCREEN_NUM);
+
+	tile_t &tile = tiles_[idx];
+	if(frame)
+	{
+		++ tile.decoded_;
+	}
+
+	if(tile.frames_.Write(frame))
+	{
+		++ tile.dropped_;
+	}
+}
+
+pj_status_t Compositor::GetCounters(pj_uint32_t idx, tile_counters_t &counters)
+{
+	RETURN_VAL_IF_FAIL(idx < MAXIMAL_SCREEN_NUM, PJ_EINVAL);
+
+	counters.decoded_ = tiles_[idx].decoded_;
+	counters.presented_ = tiles_[idx].presented_;
+	counters.dropped_ = tiles_[idx].dropped_;
+
+	return PJ_SUCCESS;
+}
+
+/**
+ * ̵߳, ȡµһ֡; ûֱ֡ʱ³ߴػǰ֡.
+ * Ƿ·֡.
+ */
+pj_bool_t Compositor::Update(tile_t &tile)
+{
+	video_frame_ptr_t frame;
+	pj_bool_t fresh = tile.frames_.Read(frame);
+	if(fresh)
+	{
+		tile.shown_ = frame;
+	}
+
+	lock_guard<mutex> lock(tile.lock_);
+	RETURN_VAL_IF_FAIL(fresh || tile.reblit_, PJ_FALSE);
+
+	tile.reblit_ = PJ_FALSE;
+	RETURN_VAL_IF_FAIL(tile.inner_.width_ > 0, PJ_FALSE);
+
+	if(tile.shown_)
+	{
+		Blit(tile, *tile.shown_);
+	}
+	else
+	{
+		Fill(tile.inner_, CANVAS_BLACK_Y, CANVAS_BLACK_UV, CANVAS_BLACK_UV);
+		tile.dirty_ = PJ_TRUE;
+	}
+
+	return fresh && tile.shown_ ? PJ_TRUE : PJ_FALSE;
+}
+
+/**
+ * letterboxʱ֡Ŀ߱ڸھ, ڱ; .
+ * ͳߴ簴ɫȡż.
+ */
+static tile_rect_t fit_rect(const tile_rect_t &inner, pj_uint32_t width, pj_uint32_t height)
+{
+	RETURN_VAL_IF_FAIL(g_client_config.letterbox, inner);
+
+	pj_uint32_t fit_width = inner.width_, fit_height = inner.height_;
+	if((pj_uint64_t)width * inner.height_ > (pj_uint64_t)inner.width_ * height)
+	{
+		fit_height = (pj_uint32_t)((pj_uint64_t)inner.width_ * height / width);
+	}
+	else
+	{
+		fit_width = (pj_uint32_t)((pj_uint64_t)inner.height_ * width / height);
+	}
+	fit_width = MAX(fit_width & ~1, 2);
+	fit_height = MAX(fit_height & ~1, 2);
+
+	tile_rect_t fit = {inner.x_ + ((inner.width_ - fit_width) / 2 & ~1), inner.y_ + ((inner.height_ - fit_height) / 2 & ~1),
+		fit_width, fit_height};
+	return fit;
+}
+
+// ÷tile.lock_. λñ(ֻ߱)ʱȰ, Žλ
+void Compositor::Blit(tile_t &tile, const video_frame_t &frame)
+{
+	RETURN_IF_FAIL(frame.width_ >= 4 && frame.height_ >= 4);
+
+	pj_timestamp begin, end;
+	pj_get_timestamp(&begin);
+
+	tile_rect_t video = fit_rect(tile.inner_, frame.width_, frame.height_);
+	if(pj_memcmp(&video, &tile.video_, sizeof(tile_rect_t)) != 0)
+	{
+		Fill(tile.inner_, CANVAS_BLACK_Y, CANVAS_BLACK_UV, CANVAS_BLACK_UV);
+		tile.video_ = video;
+	}
+
+	pj_uint32_t src_width[3] = {frame.width_, (frame.width_ + 1) / 2, (frame.width_ + 1) / 2};
+	pj_uint32_t src_height[3] = {frame.height_, (frame.height_ + 1) / 2, (frame.height_ + 1) / 2};
+	for(pj_uint32_t plane = 0; plane < 3; ++ plane)
+	{
+		pj_uint32_t shift = plane == 0 ? 0 : 1;
+		tile.scalers_[plane].Scale(frame.planes_[plane], frame.pitches_[plane], src_width[plane], src_height[plane],
+			canvas_.planes_[plane] + (video.y_ >> shift) * canvas_.pitches_[plane] + (video.x_ >> shift), canvas_.pitches_[plane],
+			video.width_ >> shift, video.height_ >> shift);
+	}
+	tile.dirty_ = PJ_TRUE;
+
+	pj_get_timestamp(&end);
+
+	++ stats_.blits_;
+	stats_.blit_usec_ += pj_elapsed_usec(&begin, &end);
+}
+
+/**
+ * ȰѸӵ֡, ֻϴб仯ĸ, ûκα仯ʱ. Ƿ.
+ */
+pj_bool_t Compositor::PresentOnce(pj_bool_t force)
+{
+	pj_timestamp begin, end;
+	pj_get_timestamp(&begin);
+
+	lock_guard<mutex> surface_lock(surface_lock_);
+	RETURN_VAL_IF_FAIL(canvas_.width_ > 0 && canvas_.height_ > 0, PJ_FALSE);
+
+	pj_bool_t full = full_.exchange(PJ_FALSE);
+	if(canvas_.width_ != backend_width_ || canvas_.height_ != backend_height_)
+	{
+		pj_status_t status = backend_->Resize(canvas_.width_, canvas_.height_);
+		RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, PJ_FALSE);
+
+		backend_width_ = canvas_.width_;
+		backend_height_ = canvas_.height_;
+		full = PJ_TRUE;
+	}
+
+	pj_bool_t fresh[MAXIMAL_SCREEN_NUM];
+	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+	{
+		fresh[idx] = Update(tiles_[idx]);
+	}
+
+	pj_uint32_t uploads = 0;
+	if(full)
+	{
+		LockTiles();
+		tile_rect_t whole = {0, 0, canvas_.width_, canvas_.height_};
+		backend_->Upload(canvas_, whole);
+		for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+		{
+			tiles_[idx].dirty_ = PJ_FALSE;
+		}
+		UnlockTiles();
+		uploads = 1;
+	}
+	else
+	{
+		for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+		{
+			lock_guard<mutex> lock(tiles_[idx].lock_);
+			if(tiles_[idx].dirty_)
+			{
+				backend_->Upload(canvas_, tiles_[idx].rect_);
+				tiles_[idx].dirty_ = PJ_FALSE;
+				++ uploads;
+			}
+		}
+	}
+
+	RETURN_VAL_IF_FAIL(uploads > 0 || force, PJ_FALSE);
+
+	backend_->Present();
+
+	pj_get_timestamp(&end);
+
+	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+	{
+		if(fresh[idx])
+		{
+			++ tiles_[idx].presented_;
+		}
+	}
+
+	++ stats_.presents_;
+	stats_.uploads_ += uploads;
+	stats_.present_usec_ += pj_elapsed_usec(&begin, &end);
+	if(stats_.presents_ >= COMPOSITOR_STATS_INTERVAL)
+	{
+		tile_counters_t total = {0, 0, 0};
+		for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+		{
+			total.decoded_ += tiles_[idx].decoded_;
+			total.presented_ += tiles_[idx].presented_;
+			total.dropped_ += tiles_[idx].dropped_;
+		}
+
+		PJ_LOG(4, (__ABS_FILE__, "PresentOnce() => backend[%s] %ux%u presents[%u] avg[%u]us uploads[%u] blits[%u] avg[%u]us, frames decoded[%u] presented[%u] dropped[%u]",
+			backend_->Name(), canvas_.width_, canvas_.height_,
+			stats_.presents_, (pj_uint32_t)(stats_.present_usec_ / stats_.presents_), stats_.uploads_,
+			stats_.blits_, stats_.blits_ > 0 ? (pj_uint32_t)(stats_.blit_usec_ / stats_.blits_) : 0,
+			total.decoded_, total.presented_, total.dropped_));
+
+		pj_bzero(&stats_, sizeof(stats_));
+	}
+
+	return PJ_TRUE;
+}
+
+/**
+ * ʾˢʽĳ. SDLĶڱ߳дʹ.
+ * ˿˴ֱͬʱPresent()һvblank, ֮˯, ֻûгʱĵȴ.
+ */
+/**
+ * ȵdeadline: pj_thread_sleepֻк뾫, WindowsĬϻ˯һ,
+ * ֻ˯deadlineһ, ʣµóʱƬ, ּĶڼʮ΢.
+ */
+static void wait_until(const pj_timestamp &deadline, const pj_timestamp &freq)
+{
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	RETURN_IF_FAIL(deadline.u64 > now.u64);
+
+	pj_uint64_t remain_usec = (deadline.u64 - now.u64) * 1000000 / freq.u64;
+	if(remain_usec > 2000)
+	{
+		pj_thread_sleep((unsigned)(remain_usec / 1000 - 1));
+	}
+
+	for(pj_get_timestamp(&now); now.u64 < deadline.u64; pj_get_timestamp(&now))
+	{
+		std::this_thread::yield();
+	}
+}
+
+void Compositor::PresentThread()
+{
+	pj_thread_desc desc;
+	pj_thread_t *pj_thread = nullptr;
+	if(!pj_thread_is_registered())
+	{
+		pj_thread_register(NULL, desc, &pj_thread);
+	}
+
+	pj_status_t status = backend_->Open(native_window_);
+	if(status != PJ_SUCCESS)
+	{
+		PJ_LOG(2, (__ABS_FILE__, "PresentThread() => open backend[%s] failed", backend_->Name()));
+		return;
+	}
+
+	pj_uint32_t refresh = MAX(backend_->RefreshRate(), 1);
+	pj_bool_t vsync = backend_->Vsync();
+	PJ_LOG(5, (__ABS_FILE__, "PresentThread() => backend[%s] present at %uHz vsync[%d]", backend_->Name(), refresh, vsync));
+
+	pj_timestamp freq, start, now, last_present, last_vsync;
+	pj_get_timestamp_freq(&freq);
+	pj_get_timestamp(&start);
+	last_present = last_vsync = start;
+
+	pj_uint64_t tick = 0;
+	while(active_)
+	{
+		pj_get_timestamp(&now);
+		pj_bool_t force = pj_elapsed_msec(&last_present, &now) >= COMPOSITOR_IDLE_PRESENT ? PJ_TRUE : PJ_FALSE;
+		pj_bool_t presented = PresentOnce(force);
+		if(presented)
+		{
+			last_present = now;
+		}
+
+		// Լʱ̶ȼһεʱ, ۻ; 󳬹100msʱ¶
+		++ tick;
+		pj_get_timestamp(&now);
+		pj_uint64_t elapsed = now.u64 - start.u64;
+		if(presented && vsync)
+		{
+			// Present()Ӧֱͬ; ϴβˢ˵û(ǿƹ˴ֱͬ,
+			// ڱСڵ), ˢʲһ, ת
+			pj_timestamp next;
+			next.u64 = last_vsync.u64 + freq.u64 / refresh;
+			if(now.u64 - last_vsync.u64 < freq.u64 / refresh / 2)
+			{
+				wait_until(next, freq);
+				pj_get_timestamp(&now);
+			}
+			last_vsync = now;
+			tick = (now.u64 - start.u64) * refresh / freq.u64;
+			continue;
+		}
+
+		pj_timestamp deadline;
+		deadline.u64 = start.u64 + tick * freq.u64 / refresh;
+		if(deadline.u64 > now.u64)
+		{
+			wait_until(deadline, freq);
+		}
+		else if(now.u64 - deadline.u64 > freq.u64 / 10)
+		{
+			tick = elapsed * refresh / freq.u64;
+		}
+	}
+
+	backend_->Close();
+}
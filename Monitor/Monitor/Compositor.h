@@ -0,0 +1,180 @@
+#ifndef __AVS_PROXY_CLIENT_COMPOSITOR__
+#define __AVS_PROXY_CLIENT_COMPOSITOR__
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#include "VideoDecoder.h"
+#include "TripleBuffer.hpp"
+#include "ImageKernels.h"
+#include "Com.h"
+
+using std::vector;
+using std::mutex;
+using std::lock_guard;
+using std::thread;
+
+#define COMPOSITOR_DEFAULT_REFRESH  60      // Hz, ȡʾˢʱʹ
+#define COMPOSITOR_IDLE_PRESENT     1000    // ms, û֡ʱҲ˼³, ڱڵɻָ
+#define COMPOSITOR_STATS_INTERVAL   1500    // ÿôδӡһͳ
+#define CANVAS_BLACK_Y              16
+#define CANVAS_BLACK_UV             128
+#define CANVAS_BORDER_Y             96      // ֮ı߿
+#define CANVAS_ALARM_Y              81      // Ƶ澯ĸӱ߿򻭳ɺɫ
+#define CANVAS_ALARM_U              90
+#define CANVAS_ALARM_V              240
+
+// , Ϊ0ʾ
+typedef struct
+{
+	pj_uint32_t x_;
+	pj_uint32_t y_;
+	pj_uint32_t width_;
+	pj_uint32_t height_;
+} tile_rect_t;
+
+// ǽI420
+typedef struct
+{
+	pj_uint32_t  width_;
+	pj_uint32_t  height_;
+	pj_uint8_t  *planes_[3];
+	pj_uint32_t  pitches_[3];
+} canvas_t;
+
+typedef struct
+{
+	pj_uint32_t presents_;
+	pj_uint32_t uploads_;            // ϴ˵ĸ
+	pj_uint32_t blits_;
+	pj_uint64_t blit_usec_;
+	pj_uint64_t present_usec_;       // ϴӳֵĺʱ֮
+} compositor_stats_t;
+
+// һӴӴ֡
+typedef struct
+{
+	pj_uint32_t decoded_;            // ̷߳֡
+	pj_uint32_t presented_;          // ֳ֡
+	pj_uint32_t dropped_;            // û־ͱµ֡
+} tile_counters_t;
+
+/**
+ * ֺ. еöCompositorĳ߳н.
+ */
+class CompositorBackend
+	: public Noncopyable
+{
+public:
+	virtual ~CompositorBackend() {}
+
+	virtual pj_status_t Open(void *native_window) = 0;
+	virtual void        Close() = 0;
+	virtual pj_status_t Resize(pj_uint32_t width, pj_uint32_t height) = 0;
+	virtual void        Upload(const canvas_t &canvas, const tile_rect_t &rect) = 0;
+	virtual void        Present() = 0;
+	virtual pj_uint32_t RefreshRate() = 0;
+	virtual pj_bool_t   Vsync() const = 0;          // Present()Ƿֱͬ
+	virtual const char *Name() const = 0;
+
+	/**
+	 * client.xmlеcompositor: "headless", ֻѻ, ѹ;
+	 * ΪһSDLһ(SdlBackend). COMPOSITOR_HEADLESS_ONLYʱSDL, headless.
+	 */
+	static CompositorBackend *Create(const pj_str_t &name);
+};
+
+// ߷I420, ƽbuffer
+void alloc_canvas(vector<pj_uint8_t> &buffer, canvas_t &canvas, pj_uint32_t width, pj_uint32_t height);
+
+class HeadlessBackend
+	: public CompositorBackend
+{
+public:
+	HeadlessBackend();
+
+	virtual pj_status_t Open(void *native_window);
+	virtual void        Close();
+	virtual pj_status_t Resize(pj_uint32_t width, pj_uint32_t height);
+	virtual void        Upload(const canvas_t &canvas, const tile_rect_t &rect);
+	virtual void        Present();
+	virtual pj_uint32_t RefreshRate();
+	virtual pj_bool_t   Vsync() const { return PJ_FALSE; }
+	virtual const char *Name() const { return "headless"; }
+
+private:
+	vector<pj_uint8_t> buffer_;
+	canvas_t           shadow_;
+};
+
+typedef struct
+{
+	mutex               lock_;
+	tile_rect_t         rect_;           // 2ر߿
+	tile_rect_t         inner_;          // Ƶ
+	pj_bool_t           dirty_;
+	pj_bool_t           reblit_;         // λñ, ´γʱ³ߴػshown_
+	pj_bool_t           alarm_;          // ߿򻭳ɸ澯ɫ
+	tile_rect_t         video_;          // inner_ʵʻƵ, Ϊڱ; Ϊ0ʾû
+	PlaneScaler         scalers_[3];     // Y/U/Vһ, ֻɳ߳ʹ
+	TripleBuffer<video_frame_ptr_t> frames_;   // ߳д, ̶߳, ֡ʾɺɫ
+	video_frame_ptr_t   shown_;          // ʾ֡, ֻɳ̷߳
+	std::atomic<pj_uint32_t> decoded_;
+	std::atomic<pj_uint32_t> presented_;
+	std::atomic<pj_uint32_t> dropped_;
+} tile_t;
+
+/**
+ * һƴ: Ļ֡źдһǽСI420,
+ * ɳ̰߳ʾˢֻϴб仯ĸӲһ, ÿĻԵSDLȾ.
+ * ScreenֻϷ, ٻ.
+ * ֻ߳֡Publishӵ, ȳҲκ; ߳ÿˢ
+ * ȡµһ֡Ž, ֵ֡ǲdropped_.
+ * ӵֻڽ̸߳Ĳ, ˳Ϊsurface_lock_ -> ӵlock_(±).
+ */
+class Compositor
+	: public Noncopyable
+{
+public:
+	Compositor();
+	~Compositor();
+
+	pj_status_t Prepare(void *native_window, const pj_str_t &backend);
+	pj_status_t Launch();
+	void        Destory();
+	void        Resize(pj_uint32_t width, pj_uint32_t height);
+	void        SetTile(pj_uint32_t idx, const tile_rect_t &rect);
+	void        SetAlarm(pj_uint32_t idx, pj_bool_t alarm);
+	void        Publish(pj_uint32_t idx, const video_frame_ptr_t &frame);
+	pj_status_t GetCounters(pj_uint32_t idx, tile_counters_t &counters);
+
+private:
+	void PresentThread();
+	pj_bool_t PresentOnce(pj_bool_t force);
+	pj_bool_t Update(tile_t &tile);
+	void Blit(tile_t &tile, const video_frame_t &frame);
+	void Fill(const tile_rect_t &rect, pj_uint8_t y, pj_uint8_t u, pj_uint8_t v);
+	void DrawBorder(const tile_t &tile);
+	void LockTiles();
+	void UnlockTiles();
+
+private:
+	void               *native_window_;
+	CompositorBackend  *backend_;
+	pj_bool_t           active_;
+	thread              present_thread_;
+	mutex               surface_lock_;
+	vector<pj_uint8_t>  buffer_;
+	canvas_t            canvas_;          // ߴֻڳиӵʱ޸
+	pj_uint32_t         backend_width_;   // ֻɳ̷߳
+	pj_uint32_t         backend_height_;
+	std::atomic<pj_bool_t> full_;         // ´γϴ黭
+	tile_t              tiles_[MAXIMAL_SCREEN_NUM];
+	compositor_stats_t  stats_;           // ֻɳ̷߳, ÿCOMPOSITOR_STATS_INTERVALγ
+};
+
+extern Compositor g_compositor;
+
+#endif
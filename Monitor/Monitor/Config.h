@@ -20,6 +20,39 @@ public:
 	pj_str_t    rrtvms_fcgi_host;
 	pj_uint16_t rrtvms_fcgi_port;
 	pj_str_t    rrtvms_fcgi_uri;
+	pj_bool_t   resume_enable;           // proxyϿǷԻָỰ
+	pj_uint32_t resume_max_retries;
+	pj_uint32_t resume_retry_interval;   // ms
+	pj_str_t    snapshot_file_name;      // Ŀ¼ļ, Ϊʹ
+	pj_uint32_t prefetch_pages;          // 0Ԥȡ, 1Ԥȡһҳ, 2ͬʱԤȡһҳ
+	pj_uint32_t gop_cache_size;          // KB, ƵGOP
+	pj_uint32_t max_decoders;            // ʵ, дõ
+	pj_str_t    video_decoder;           // "ffmpeg"ֱӵlibavcodec, "pjmedia"pjmediaķװ
+	pj_uint32_t decoder_threads;         // libavcodec߳, 0ΪԶ
+	pj_str_t    decoder_thread_type;     // "frame", "slice", Ϊʱslice
+	pj_str_t    decoder_skip_frame;      // "nonref", "bidir", "nonkey", Ϊ֡
+	pj_bool_t   decoder_fast;            // flags2=fast
+	pj_bool_t   rtcp_enable;             // proxyRR/NACK/PLI/FIR
+	pj_uint32_t rtcp_interval;           // ms, RRķͼ
+	pj_uint32_t nack_interval;           // ms, ͬһ·NACKС, ҲͬһظNACKļ
+	pj_bool_t   health_enable;           // 鿴еķûֻ, 
+	pj_uint32_t health_timeout;          // ms, ʱûаʱǰ澯
+	pj_str_t    compositor;              // "sdl"һڳǽ, "headless", ѹ
+	pj_bool_t   low_latency;             // ʾ, RTPʱ, ֱӱΪ
+	pj_uint32_t playout_max_delay;       // ms, ʱӦĿӳٵ
+	pj_str_t    image_kernels;           // ͼƵں˵ָ, "c", "sse2", "avx2", ΪCPUԶѡ
+	pj_bool_t   letterbox;               // ֿ߱ڱ, 0
+	pj_bool_t   analytics_enable;        // ֡, //˶ʱ澯Ѹӱ߿򻭳ɺɫ
+	pj_uint32_t freeze_timeout;          // ms, 治ʱǰʱ䱨, 0
+	pj_uint32_t black_timeout;           // ms, ʱ澯, 0
+	pj_uint32_t low_motion_timeout;      // ms, ˶ʱ澯, 0
+	pj_bool_t   audio_enable;            // űӵƵ(PT 11, L16)
+	pj_uint32_t audio_mix;               // ͬʱѡеļӲ, Ĭ1ֻѡеĸ
+	pj_bool_t   speaker_enable;          // ͳתû˵, ڰ˵
+	pj_uint32_t audio_level_ext_id;      // RFC 6464ͷչid, 0ǴӸع
+	pj_bool_t   av_sync;                 // еĸƵΪʱӵƵ, low_latencyʱЧ
+	pj_str_t    record_path;             // ¼ļĿ¼, ΪΪǰĿ¼
+	pj_str_t    record_format;           // ¼ļչ, װʽ; "mp4", "ts"ֻ¼Ƶ, "mov", "mkv"ͬʱ¼L16Ƶ
 };
 
 extern Config g_client_config;
@@ -0,0 +1,293 @@
+#include "stdafx.h"
+#include <string.h>
+
+#include "DirectoryParser.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "DirectoryParser.cpp"
+
+#define XML_SERVICE_NAME "service"
+#define XML_NODE_NAME    "node"
+#define XML_ROOM_NAME    "room_node"
+
+#define IS_XML_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
+static pj_bool_t token_equal(const char *begin, const char *end, const char *token)
+{
+	pj_size_t len = strlen(token);
+	return ((pj_size_t)(end - begin) == len && memcmp(begin, token, len) == 0) ? PJ_TRUE : PJ_FALSE;
+}
+
+// atoiһ: ѡ, ֹּͣ, ڴ. pj_int32_tķΧʱPJ_FALSE
+static pj_bool_t token_to_int(const char *begin, const char *end, pj_int32_t &value)
+{
+	pj_bool_t negative = PJ_FALSE;
+	if(begin < end && (*begin == '-' || *begin == '+'))
+	{
+		negative = *begin == '-' ? PJ_TRUE : PJ_FALSE;
+		++ begin;
+	}
+
+	pj_int64_t limit = (pj_int64_t)PJ_MAXINT32 + (negative ? 1 : 0);
+	pj_int64_t result = 0;
+	for(; begin < end && *begin >= '0' && *begin <= '9'; ++ begin)
+	{
+		result = result * 10 + (*begin - '0');
+		RETURN_VAL_IF_FAIL(result <= limit, PJ_FALSE);
+	}
+
+	value = (pj_int32_t)(negative ? -result : result);
+
+	return PJ_TRUE;
+}
+
+DirectoryParser::DirectoryParser(const dir_record_cb_t &on_record)
+	: on_record_(on_record)
+	, tail_()
+	, in_tag_(PJ_FALSE)
+	, quote_(0)
+	, depth_(0)
+	, root_closed_(PJ_FALSE)
+	, error_(PJ_FALSE)
+	, value_buf_()
+{
+}
+
+void DirectoryParser::Feed(const pj_uint8_t *data, pj_uint32_t len)
+{
+	const char *p   = reinterpret_cast<const char *>(data);
+	const char *end = p + len;
+	const char *tag = p;           // һİǩӱ鿪ͷ
+
+	while(p < end)
+	{
+		if(!in_tag_)
+		{
+			p = reinterpret_cast<const char *>(memchr(p, '<', end - p));
+			RETURN_IF_FAIL(p != nullptr);
+
+			in_tag_ = PJ_TRUE;
+			quote_  = 0;
+			tag     = ++ p;
+			continue;
+		}
+
+		for(; p < end; ++ p)
+		{
+			if(quote_ != 0)
+			{
+				quote_ = *p == quote_ ? 0 : quote_;
+			}
+			else if(*p == '"' || *p == '\'')
+			{
+				quote_ = *p;
+			}
+			else if(*p == '>')
+			{
+				break;
+			}
+		}
+
+		if(p == end)
+		{
+			tail_.insert(tail_.end(), tag, end);
+			return;
+		}
+
+		if(tail_.empty())
+		{
+			OnTag(tag, p);
+		}
+		else
+		{
+			tail_.insert(tail_.end(), tag, p);
+			OnTag(&tail_[0], &tail_[0] + tail_.size());
+			tail_.clear();
+		}
+
+		in_tag_ = PJ_FALSE;
+		++ p;
+	}
+}
+
+pj_bool_t DirectoryParser::Complete() const
+{
+	return (root_closed_ && !error_ && !in_tag_) ? PJ_TRUE : PJ_FALSE;
+}
+
+// [begin, end)Ϊ'<''>'֮
+void DirectoryParser::OnTag(const char *begin, const char *end)
+{
+	RETURN_IF_FAIL(begin < end);
+	RETURN_IF_FAIL(*begin != '?' && *begin != '!');  // , ע, DOCTYPE
+
+	if(*begin == '/')
+	{
+		RETURN_WITH_STATEMENT_IF_FAIL(depth_ > 0, error_ = PJ_TRUE);
+		if(-- depth_ == 0)
+		{
+			root_closed_ = PJ_TRUE;
+		}
+		return;
+	}
+
+	pj_bool_t self_closing = end[-1] == '/' ? PJ_TRUE : PJ_FALSE;
+	if(self_closing)
+	{
+		-- end;
+	}
+
+	const char *name_end = begin;
+	while(name_end < end && !IS_XML_SPACE(*name_end))
+	{
+		++ name_end;
+	}
+
+	if(token_equal(begin, name_end, XML_SERVICE_NAME))
+	{
+		OnRecord(DIR_RECORD_SERVICE, name_end, end);
+	}
+	else if(token_equal(begin, name_end, XML_NODE_NAME))
+	{
+		OnRecord(DIR_RECORD_NODE, name_end, end);
+	}
+	else if(token_equal(begin, name_end, XML_ROOM_NAME))
+	{
+		OnRecord(DIR_RECORD_ROOM, name_end, end);
+	}
+
+	if(!self_closing)
+	{
+		++ depth_;
+	}
+	else if(depth_ == 0)
+	{
+		root_closed_ = PJ_TRUE;
+	}
+}
+
+// [begin, end)Ϊб: id="1" name="..." order="2" usercount="3"
+void DirectoryParser::OnRecord(pj_uint8_t type, const char *begin, const char *end)
+{
+	dir_record_t record;
+	record.type_      = type;
+	record.id_        = 0;
+	record.name_      = pj_str("");
+	record.order_     = 0;
+	record.usercount_ = 0;
+
+	const char *p = begin;
+	while(p < end)
+	{
+		while(p < end && IS_XML_SPACE(*p)) ++ p;
+		if(p == end)
+		{
+			break;
+		}
+
+		const char *attr = p;
+		while(p < end && *p != '=' && !IS_XML_SPACE(*p)) ++ p;
+		const char *attr_end = p;
+
+		while(p < end && IS_XML_SPACE(*p)) ++ p;
+		RETURN_WITH_STATEMENT_IF_FAIL(p < end && *p == '=', error_ = PJ_TRUE);
+		++ p;
+		while(p < end && IS_XML_SPACE(*p)) ++ p;
+		RETURN_WITH_STATEMENT_IF_FAIL(p < end && (*p == '"' || *p == '\''), error_ = PJ_TRUE);
+
+		char quote = *p ++;
+		const char *value = p;
+		while(p < end && *p != quote) ++ p;
+		RETURN_WITH_STATEMENT_IF_FAIL(p < end, error_ = PJ_TRUE);
+		const char *value_end = p ++;
+
+		pj_int32_t number = 0;
+		if(token_equal(attr, attr_end, "id"))
+		{
+			RETURN_IF_FAIL(ParseInt(attr, attr_end, value, value_end, number));
+			record.id_ = number;
+		}
+		else if(token_equal(attr, attr_end, "name"))
+		{
+			DecodeValue(value, value_end, record.name_);
+		}
+		else if(token_equal(attr, attr_end, "order"))
+		{
+			RETURN_IF_FAIL(ParseInt(attr, attr_end, value, value_end, number));
+			record.order_ = (order_t)number;
+		}
+		else if(token_equal(attr, attr_end, "usercount"))
+		{
+			RETURN_IF_FAIL(ParseInt(attr, attr_end, value, value_end, number));
+			record.usercount_ = (pj_uint32_t)number;
+		}
+	}
+
+	on_record_(record);
+}
+
+// ֵ˵ĵ, ĵΪ, ܾݴ߳ڵ
+pj_bool_t DirectoryParser::ParseInt(const char *attr, const char *attr_end, const char *begin, const char *end, pj_int32_t &value)
+{
+	pj_bool_t parsed = token_to_int(begin, end, value);
+	if(!parsed)
+	{
+		PJ_LOG(3, (__ABS_FILE__, "ParseInt() => Attribute %.*s overflows: %.*s",
+			(int)(attr_end - attr), attr, (int)(end - begin), begin));
+		error_ = PJ_TRUE;
+	}
+
+	return parsed;
+}
+
+// ûʵʱֱָԭ, 뵽value_buf_. 󲻻ԭĳ, ֲض
+void DirectoryParser::DecodeValue(const char *begin, const char *end, pj_str_t &value)
+{
+	if(memchr(begin, '&', end - begin) == nullptr)
+	{
+		value.ptr  = const_cast<char *>(begin);
+		value.slen = end - begin;
+		return;
+	}
+
+	static const struct { const char *entity; char ch; } entities[] =
+	{
+		{ "&amp;",  '&'  },
+		{ "&lt;",   '<'  },
+		{ "&gt;",   '>'  },
+		{ "&quot;", '"'  },
+		{ "&apos;", '\'' },
+	};
+
+	value_buf_.resize(end - begin + 1);
+
+	pj_size_t len = 0;
+	while(begin < end)
+	{
+		char ch = *begin;
+		pj_size_t step = 1;
+		if(ch == '&')
+		{
+			for(pj_size_t i = 0; i < PJ_ARRAY_SIZE(entities); ++ i)
+			{
+				pj_size_t entity_len = strlen(entities[i].entity);
+				if((pj_size_t)(end - begin) >= entity_len && memcmp(begin, entities[i].entity, entity_len) == 0)
+				{
+					ch   = entities[i].ch;
+					step = entity_len;
+					break;
+				}
+			}
+		}
+
+		value_buf_[len ++] = ch;
+		begin += step;
+	}
+
+	value_buf_[len] = '\0';
+	value.ptr  = &value_buf_[0];
+	value.slen = len;
+}
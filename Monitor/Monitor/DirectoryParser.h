@@ -0,0 +1,60 @@
+#ifndef __AVS_PROXY_CLIENT_DIRECTORY_PARSER__
+#define __AVS_PROXY_CLIENT_DIRECTORY_PARSER__
+
+#include <functional>
+#include <vector>
+
+#include "Com.h"
+
+using std::vector;
+
+enum __enum_dir_record_type__
+{
+	DIR_RECORD_SERVICE,
+	DIR_RECORD_NODE,
+	DIR_RECORD_ROOM
+};
+
+typedef struct
+{
+	pj_uint8_t  type_;
+	pj_int32_t  id_;
+	pj_str_t    name_;        // ָջ, ֻڻصڼЧ
+	order_t     order_;
+	pj_uint32_t usercount_;
+} dir_record_t;
+
+typedef std::function<void (const dir_record_t &)> dir_record_cb_t;
+
+/**
+ * Ŀ¼XMLʽ.
+ * ݰHTTPֿι, ıǩֱڽջϽ, ֻпİǩŻ´tail_.
+ * <service>/<node>/<room_node>صһ¼, DOM.
+ * עͺǩ, עڲܳ'>'.
+ */
+class DirectoryParser
+	: public Noncopyable
+{
+public:
+	DirectoryParser(const dir_record_cb_t &on_record);
+
+	void      Feed(const pj_uint8_t *data, pj_uint32_t len);
+	pj_bool_t Complete() const;   // ڵѱպûг
+
+private:
+	void OnTag(const char *begin, const char *end);
+	void OnRecord(pj_uint8_t type, const char *begin, const char *end);
+	pj_bool_t ParseInt(const char *attr, const char *attr_end, const char *begin, const char *end, pj_int32_t &value);
+	void DecodeValue(const char *begin, const char *end, pj_str_t &value);
+
+	dir_record_cb_t on_record_;
+	vector<char>    tail_;
+	pj_bool_t       in_tag_;
+	char            quote_;
+	pj_int32_t      depth_;
+	pj_bool_t       root_closed_;
+	pj_bool_t       error_;
+	vector<char>    value_buf_;
+};
+
+#endif
@@ -0,0 +1,564 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "DirectorySnapshot.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "DirectorySnapshot.cpp"
+
+DirectorySnapshot g_directory_snapshot;
+
+static bool snapshot_entry_cmp(const snapshot_entry_t *e1, const snapshot_entry_t *e2)
+{
+	return e1->order_ < e2->order_
+		|| (e1->order_ == e2->order_ && e1->id_ < e2->id_);
+}
+
+static bool snapshot_proxy_cmp(const dir_snapshot_proxy_t &proxy, pj_int32_t room_id)
+{
+	return proxy.room_id < room_id;
+}
+
+static bool snapshot_entry_id_cmp(const snapshot_entry_t &e1, const snapshot_entry_t &e2)
+{
+	return e1.id_ < e2.id_;
+}
+
+static pj_bool_t snapshot_entry_equal(const snapshot_entry_t &e1, const snapshot_entry_t &e2)
+{
+	return (e1.type_ == e2.type_ && e1.id_ == e2.id_ && e1.name_ == e2.name_
+		&& e1.order_ == e2.order_ && e1.usercount_ == e2.usercount_) ? PJ_TRUE : PJ_FALSE;
+}
+
+static pj_bool_t snapshot_proxy_equal(const snapshot_proxy_t &p1, const snapshot_proxy_t &p2)
+{
+	return (p1.proxy_id_ == p2.proxy_id_ && p1.proxy_ip_ == p2.proxy_ip_
+		&& p1.tcp_port_ == p2.tcp_port_ && p1.udp_port_ == p2.udp_port_) ? PJ_TRUE : PJ_FALSE;
+}
+
+static pj_bool_t write_file(HANDLE file, const void *buf, pj_uint32_t len)
+{
+	DWORD written = 0;
+	return (len == 0 || (WriteFile(file, buf, len, &written, NULL) && written == len)) ? PJ_TRUE : PJ_FALSE;
+}
+
+DirectorySnapshot::DirectorySnapshot()
+	: snapshot_lock_()
+	, file_name_()
+	, file_(INVALID_HANDLE_VALUE)
+	, mapping_(nullptr)
+	, view_(nullptr)
+	, header_(nullptr)
+	, records_(nullptr)
+	, proxies_(nullptr)
+	, strings_(nullptr)
+	, children_()
+	, proxies_map_()
+	, dirty_(PJ_FALSE)
+	, refresh_thread_pool_(1)
+{
+}
+
+pj_status_t DirectorySnapshot::Prepare(const pj_str_t &file_name)
+{
+	lock_guard<mutex> lock(snapshot_lock_);
+
+	RETURN_VAL_IF_FAIL(file_name.ptr != nullptr && file_name.slen > 0, PJ_SUCCESS);  // δʹÿ
+	file_name_.assign(file_name.ptr, file_name.slen);
+
+	pj_status_t status = Map();
+	if(status != PJ_SUCCESS)
+	{
+		PJ_LOG(5, (__ABS_FILE__, "Prepare() => No usable snapshot in %s", file_name_.c_str()));
+		return PJ_SUCCESS;
+	}
+
+	PJ_LOG(5, (__ABS_FILE__, "Prepare() => Mapped snapshot %s records[%u] proxies[%u]",
+		file_name_.c_str(), header_->record_count, header_->proxy_count));
+
+	return PJ_SUCCESS;
+}
+
+pj_status_t DirectorySnapshot::Launch()
+{
+	refresh_thread_pool_.Start();
+
+	return PJ_SUCCESS;
+}
+
+void DirectorySnapshot::Destory()
+{
+	refresh_thread_pool_.Stop();
+
+	Save();
+
+	lock_guard<mutex> lock(snapshot_lock_);
+	Unmap();
+}
+
+pj_status_t DirectorySnapshot::Map()
+{
+	file_ = CreateFileA(file_name_.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	RETURN_VAL_IF_FAIL(file_ != INVALID_HANDLE_VALUE, PJ_ENOTFOUND);
+
+	LARGE_INTEGER file_size;
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(GetFileSizeEx(file_, &file_size)
+		&& file_size.QuadPart >= sizeof(dir_snapshot_header_t), Unmap(), PJ_ETOOSMALL);
+
+	mapping_ = CreateFileMapping(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(mapping_ != nullptr, Unmap(), PJ_EINVAL);
+
+	view_ = reinterpret_cast<const pj_uint8_t *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(view_ != nullptr, Unmap(), PJ_EINVAL);
+
+	header_ = reinterpret_cast<const dir_snapshot_header_t *>(view_);
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(header_->magic == DIR_SNAPSHOT_MAGIC
+		&& header_->version == DIR_SNAPSHOT_VERSION
+		&& header_->header_size == sizeof(dir_snapshot_header_t), Unmap(), PJ_EINVALIDOP);
+
+	pj_uint64_t expected = (pj_uint64_t)header_->header_size
+		+ (pj_uint64_t)header_->record_count * sizeof(dir_snapshot_record_t)
+		+ (pj_uint64_t)header_->proxy_count * sizeof(dir_snapshot_proxy_t)
+		+ header_->string_size;
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(expected == (pj_uint64_t)file_size.QuadPart, Unmap(), PJ_EINVALIDOP);
+
+	records_ = reinterpret_cast<const dir_snapshot_record_t *>(view_ + header_->header_size);
+	proxies_ = reinterpret_cast<const dir_snapshot_proxy_t *>(records_ + header_->record_count);
+	strings_ = reinterpret_cast<const char *>(proxies_ + header_->proxy_count);
+
+	return PJ_SUCCESS;
+}
+
+void DirectorySnapshot::Unmap()
+{
+	if(view_ != nullptr)
+	{
+		UnmapViewOfFile(view_);
+		view_ = nullptr;
+	}
+
+	if(mapping_ != nullptr)
+	{
+		CloseHandle(mapping_);
+		mapping_ = nullptr;
+	}
+
+	if(file_ != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file_);
+		file_ = INVALID_HANDLE_VALUE;
+	}
+
+	header_  = nullptr;
+	records_ = nullptr;
+	proxies_ = nullptr;
+	strings_ = nullptr;
+}
+
+pj_str_t DirectorySnapshot::MappedString(pj_uint32_t offset, pj_uint32_t len)
+{
+	pj_str_t str = pj_str("");
+	RETURN_VAL_IF_FAIL(offset <= header_->string_size && len <= header_->string_size - offset, str);
+
+	str.ptr  = const_cast<char *>(strings_ + offset);
+	str.slen = len;
+
+	return str;
+}
+
+pj_bool_t DirectorySnapshot::FindMappedChildren(dir_parent_key_t key, pj_uint32_t &first, pj_uint32_t &last)
+{
+	RETURN_VAL_IF_FAIL(view_ != nullptr, PJ_FALSE);
+
+	pj_uint32_t lo = 0, hi = header_->record_count;
+	while(lo < hi)
+	{
+		pj_uint32_t mid = lo + (hi - lo) / 2;
+		if(ParentKey(records_[mid].parent_type, records_[mid].parent_id) < key)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	first = last = lo;
+	while(last < header_->record_count && ParentKey(records_[last].parent_type, records_[last].parent_id) == key)
+	{
+		++ last;
+	}
+
+	return first < last ? PJ_TRUE : PJ_FALSE;
+}
+
+// ڴе, ӳ. PJ_FALSEʾûڵ
+pj_bool_t DirectorySnapshot::VisitChildren(pj_uint8_t parent_type, pj_int32_t parent_id, const dir_record_cb_t &on_record)
+{
+	lock_guard<mutex> lock(snapshot_lock_);
+
+	dir_parent_key_t key = ParentKey(parent_type, parent_id);
+	dir_record_t record;
+
+	snapshot_children_t::iterator pchildren = children_.find(key);
+	if(pchildren != children_.end())
+	{
+		vector<snapshot_entry_t> &entries = pchildren->second;
+		for(pj_uint32_t i = 0; i < entries.size(); ++ i)
+		{
+			record.type_      = entries[i].type_;
+			record.id_        = entries[i].id_;
+			record.name_.ptr  = const_cast<char *>(entries[i].name_.c_str());
+			record.name_.slen = entries[i].name_.size();
+			record.order_     = entries[i].order_;
+			record.usercount_ = entries[i].usercount_;
+			on_record(record);
+		}
+		return PJ_TRUE;
+	}
+
+	pj_uint32_t first, last;
+	RETURN_VAL_IF_FAIL(FindMappedChildren(key, first, last), PJ_FALSE);
+
+	for(pj_uint32_t i = first; i < last; ++ i)
+	{
+		record.type_      = records_[i].type;
+		record.id_        = records_[i].id;
+		record.name_      = MappedString(records_[i].name_offset, records_[i].name_len);
+		record.order_     = records_[i].order;
+		record.usercount_ = records_[i].usercount;
+		on_record(record);
+	}
+
+	return PJ_TRUE;
+}
+
+/**
+ * Ŀ¼ȡnode_idµӽڵ(node_idΪ0ʱȡservicesµnode),
+ * ߽ձ߽, ĵʱд, changedʾеݲͬ. ֻrefresh_thread_pool_е.
+ */
+pj_bool_t DirectorySnapshot::Fetch(pj_int32_t node_id, pj_bool_t &changed)
+{
+	snapshot_children_t children;
+	vector<snapshot_entry_t> *parent = node_id == 0
+		? &children[ParentKey(DIR_PARENT_ROOT, 0)]
+		: &children[ParentKey(DIR_RECORD_NODE, node_id)];
+	vector<snapshot_entry_t> *service = nullptr;
+
+	DirectoryParser parser([&](const dir_record_t &record) {
+		snapshot_entry_t entry;
+		entry.type_      = record.type_;
+		entry.id_        = record.id_;
+		entry.name_.assign(record.name_.ptr, record.name_.slen);
+		entry.order_     = record.order_;
+		entry.usercount_ = record.usercount_;
+
+		if(node_id == 0 && record.type_ == DIR_RECORD_SERVICE)
+		{
+			parent->push_back(entry);
+			service = &children[ParentKey(DIR_RECORD_SERVICE, record.id_)];
+		}
+		else if(node_id != 0)
+		{
+			parent->push_back(entry);
+		}
+		else if(service != nullptr)
+		{
+			service->push_back(entry);
+		}
+	});
+
+	http_tls_stream(g_client_config.tls_host, g_client_config.tls_port, g_client_config.tls_uri, node_id,
+		[&](const pj_uint8_t *data, pj_uint32_t len) {
+		parser.Feed(data, len);
+	});
+
+	RETURN_VAL_IF_FAIL(parser.Complete(), PJ_FALSE);
+
+	lock_guard<mutex> lock(snapshot_lock_);
+	changed = PJ_FALSE;
+	for(snapshot_children_t::iterator pchildren = children.begin();
+		pchildren != children.end();
+		++ pchildren)
+	{
+		if(!SameChildren(pchildren->first, pchildren->second))
+		{
+			children_[pchildren->first].swap(pchildren->second);
+			changed = PJ_TRUE;
+		}
+	}
+	dirty_ |= changed;
+
+	return PJ_TRUE;
+}
+
+// ÷snapshot_lock_. еӽڵбidȽ, ûڵʱΪͬ
+pj_bool_t DirectorySnapshot::SameChildren(dir_parent_key_t key, vector<snapshot_entry_t> entries)
+{
+	vector<snapshot_entry_t> current;
+	snapshot_children_t::iterator pchildren = children_.find(key);
+	if(pchildren != children_.end())
+	{
+		current = pchildren->second;
+	}
+	else
+	{
+		pj_uint32_t first, last;
+		RETURN_VAL_IF_FAIL(FindMappedChildren(key, first, last), PJ_FALSE);
+
+		for(pj_uint32_t i = first; i < last; ++ i)
+		{
+			pj_str_t name = MappedString(records_[i].name_offset, records_[i].name_len);
+			snapshot_entry_t entry;
+			entry.type_      = records_[i].type;
+			entry.id_        = records_[i].id;
+			entry.name_.assign(name.ptr, name.slen);
+			entry.order_     = records_[i].order;
+			entry.usercount_ = records_[i].usercount;
+			current.push_back(entry);
+		}
+	}
+	RETURN_VAL_IF_FAIL(current.size() == entries.size(), PJ_FALSE);
+
+	std::sort(current.begin(), current.end(), snapshot_entry_id_cmp);
+	std::sort(entries.begin(), entries.end(), snapshot_entry_id_cmp);
+	for(pj_uint32_t i = 0; i < entries.size(); ++ i)
+	{
+		RETURN_VAL_IF_FAIL(snapshot_entry_equal(current[i], entries[i]), PJ_FALSE);
+	}
+
+	return PJ_TRUE;
+}
+
+// ̨У, õղͬݺű沢صon_refreshed(ں̨߳)
+void DirectorySnapshot::Revalidate(pj_int32_t node_id, const snapshot_cb_t &on_refreshed)
+{
+	refresh_thread_pool_.Schedule([=]
+	{
+		pj_bool_t changed = PJ_FALSE;
+		if(!Fetch(node_id, changed))
+		{
+			PJ_LOG(5, (__ABS_FILE__, "Revalidate() => Node[%d] fetch failed, keep snapshot", node_id));
+			return;
+		}
+		RETURN_IF_FAIL(changed);
+
+		Save();
+		on_refreshed();
+	});
+}
+
+// лûʱں̨ȡ, ۳ɰܶصon_loaded, ݴ˽ȴ
+void DirectorySnapshot::Load(pj_int32_t node_id, const snapshot_cb_t &on_loaded)
+{
+	refresh_thread_pool_.Schedule([=]
+	{
+		pj_bool_t changed = PJ_FALSE;
+		if(!Fetch(node_id, changed))
+		{
+			PJ_LOG(5, (__ABS_FILE__, "Load() => Node[%d] fetch failed", node_id));
+		}
+		else if(changed)
+		{
+			Save();
+		}
+		on_loaded();
+	});
+}
+
+/**
+ * ÿеproxy֮. proxyϲ仹,
+ * ̨queryrrtvms˶, һʱ¿ղصon_stale(ں̨߳), ɵ÷µproxy.
+ */
+void DirectorySnapshot::RevalidateProxy(pj_int32_t room_id, const snapshot_proxy_t &cached, const proxy_query_t &query,
+	const snapshot_cb_t &on_stale)
+{
+	refresh_thread_pool_.Schedule([=]
+	{
+		snapshot_proxy_t latest;
+		if(!query(latest))
+		{
+			PJ_LOG(5, (__ABS_FILE__, "RevalidateProxy() => Room[%d] query failed, keep proxy[%u]", room_id, cached.proxy_id_));
+			return;
+		}
+		RETURN_IF_FAIL(!snapshot_proxy_equal(latest, cached));
+
+		PJ_LOG(5, (__ABS_FILE__, "RevalidateProxy() => Room[%d] moved from proxy[%u] to proxy[%u]",
+			room_id, cached.proxy_id_, latest.proxy_id_));
+
+		SetProxy(room_id, latest);
+		Save();
+		on_stale();
+	});
+}
+
+pj_bool_t DirectorySnapshot::GetProxy(pj_int32_t room_id, snapshot_proxy_t &proxy)
+{
+	lock_guard<mutex> lock(snapshot_lock_);
+
+	snapshot_proxies_t::iterator pproxy = proxies_map_.find(room_id);
+	if(pproxy != proxies_map_.end())
+	{
+		proxy = pproxy->second;
+		return PJ_TRUE;
+	}
+
+	RETURN_VAL_IF_FAIL(view_ != nullptr, PJ_FALSE);
+
+	const dir_snapshot_proxy_t *end = proxies_ + header_->proxy_count;
+	const dir_snapshot_proxy_t *pmapped = std::lower_bound(proxies_, end, room_id, snapshot_proxy_cmp);
+	RETURN_VAL_IF_FAIL(pmapped != end && pmapped->room_id == room_id, PJ_FALSE);
+
+	pj_str_t ip = MappedString(pmapped->ip_offset, pmapped->ip_len);
+	proxy.proxy_id_ = pmapped->proxy_id;
+	proxy.proxy_ip_.assign(ip.ptr, ip.slen);
+	proxy.tcp_port_ = pmapped->tcp_port;
+	proxy.udp_port_ = pmapped->udp_port;
+
+	return PJ_TRUE;
+}
+
+void DirectorySnapshot::SetProxy(pj_int32_t room_id, const snapshot_proxy_t &proxy)
+{
+	snapshot_proxy_t current;
+	RETURN_IF_FAIL(!GetProxy(room_id, current) || !snapshot_proxy_equal(current, proxy));  // ûб仯ʱдļ
+
+	lock_guard<mutex> lock(snapshot_lock_);
+
+	proxies_map_[room_id] = proxy;
+	dirty_ = PJ_TRUE;
+}
+
+// ӳڴûеĲֿ, ֮ܽӳ䲢ļ
+void DirectorySnapshot::Absorb()
+{
+	RETURN_IF_FAIL(view_ != nullptr);
+
+	for(pj_uint32_t i = 0; i < header_->record_count;)
+	{
+		dir_parent_key_t key = ParentKey(records_[i].parent_type, records_[i].parent_id);
+		pj_bool_t absorb = children_.find(key) == children_.end() ? PJ_TRUE : PJ_FALSE;
+		vector<snapshot_entry_t> &entries = children_[key];
+		for(; i < header_->record_count && ParentKey(records_[i].parent_type, records_[i].parent_id) == key; ++ i)
+		{
+			if(absorb)
+			{
+				pj_str_t name = MappedString(records_[i].name_offset, records_[i].name_len);
+				snapshot_entry_t entry;
+				entry.type_      = records_[i].type;
+				entry.id_        = records_[i].id;
+				entry.name_.assign(name.ptr, name.slen);
+				entry.order_     = records_[i].order;
+				entry.usercount_ = records_[i].usercount;
+				entries.push_back(entry);
+			}
+		}
+	}
+
+	for(pj_uint32_t i = 0; i < header_->proxy_count; ++ i)
+	{
+		if(proxies_map_.find(proxies_[i].room_id) == proxies_map_.end())
+		{
+			pj_str_t ip = MappedString(proxies_[i].ip_offset, proxies_[i].ip_len);
+			snapshot_proxy_t proxy;
+			proxy.proxy_id_ = proxies_[i].proxy_id;
+			proxy.proxy_ip_.assign(ip.ptr, ip.slen);
+			proxy.tcp_port_ = proxies_[i].tcp_port;
+			proxy.udp_port_ = proxies_[i].udp_port;
+			proxies_map_[proxies_[i].room_id] = proxy;
+		}
+	}
+}
+
+pj_status_t DirectorySnapshot::Save()
+{
+	lock_guard<mutex> lock(snapshot_lock_);
+
+	RETURN_VAL_IF_FAIL(!file_name_.empty() && dirty_, PJ_SUCCESS);
+
+	Absorb();
+	Unmap();
+
+	vector<dir_snapshot_record_t> records;
+	vector<dir_snapshot_proxy_t>  proxies;
+	string                        strings;
+
+	for(snapshot_children_t::iterator pchildren = children_.begin();
+		pchildren != children_.end();
+		++ pchildren)
+	{
+		vector<const snapshot_entry_t *> entries;
+		for(pj_uint32_t i = 0; i < pchildren->second.size(); ++ i)
+		{
+			entries.push_back(&pchildren->second[i]);
+		}
+		std::sort(entries.begin(), entries.end(), snapshot_entry_cmp);
+
+		for(pj_uint32_t i = 0; i < entries.size(); ++ i)
+		{
+			dir_snapshot_record_t record;
+			record.type        = entries[i]->type_;
+			record.parent_type = (pj_uint8_t)(pchildren->first >> 32);
+			record.reserved    = 0;
+			record.parent_id   = (pj_int32_t)(pj_uint32_t)pchildren->first;
+			record.id          = entries[i]->id_;
+			record.order       = entries[i]->order_;
+			record.usercount   = entries[i]->usercount_;
+			record.name_offset = strings.size();
+			record.name_len    = entries[i]->name_.size();
+			strings.append(entries[i]->name_);
+			records.push_back(record);
+		}
+	}
+
+	for(snapshot_proxies_t::iterator pproxy = proxies_map_.begin();
+		pproxy != proxies_map_.end();
+		++ pproxy)
+	{
+		dir_snapshot_proxy_t proxy;
+		proxy.room_id   = pproxy->first;
+		proxy.proxy_id  = pproxy->second.proxy_id_;
+		proxy.tcp_port  = pproxy->second.tcp_port_;
+		proxy.udp_port  = pproxy->second.udp_port_;
+		proxy.reserved  = 0;
+		proxy.ip_offset = strings.size();
+		proxy.ip_len    = pproxy->second.proxy_ip_.size();
+		strings.append(pproxy->second.proxy_ip_);
+		proxies.push_back(proxy);
+	}
+
+	dir_snapshot_header_t header;
+	header.magic        = DIR_SNAPSHOT_MAGIC;
+	header.version      = DIR_SNAPSHOT_VERSION;
+	header.header_size  = sizeof(dir_snapshot_header_t);
+	header.record_count = records.size();
+	header.proxy_count  = proxies.size();
+	header.string_size  = strings.size();
+	header.reserved     = 0;
+
+	// дʱļ滻, ;˳Ҳ°
+	string tmp_name = file_name_ + ".tmp";
+	HANDLE file = CreateFileA(tmp_name.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	RETURN_VAL_IF_FAIL(file != INVALID_HANDLE_VALUE, PJ_EINVAL);
+
+	pj_bool_t written = write_file(file, &header, sizeof(header))
+		&& write_file(file, records.empty() ? nullptr : &records[0], records.size() * sizeof(dir_snapshot_record_t))
+		&& write_file(file, proxies.empty() ? nullptr : &proxies[0], proxies.size() * sizeof(dir_snapshot_proxy_t))
+		&& write_file(file, strings.data(), strings.size());
+	CloseHandle(file);
+
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(written, DeleteFileA(tmp_name.c_str()), PJ_EINVAL);
+	RETURN_VAL_IF_FAIL(MoveFileExA(tmp_name.c_str(), file_name_.c_str(),
+		MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH), PJ_EINVAL);
+
+	dirty_ = PJ_FALSE;
+
+	PJ_LOG(5, (__ABS_FILE__, "Save() => Snapshot saved records[%u] proxies[%u]", records.size(), proxies.size()));
+
+	return PJ_SUCCESS;
+}
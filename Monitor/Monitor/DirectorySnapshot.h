@@ -0,0 +1,144 @@
+#ifndef __AVS_PROXY_CLIENT_DIRECTORY_SNAPSHOT__
+#define __AVS_PROXY_CLIENT_DIRECTORY_SNAPSHOT__
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <mutex>
+
+#include "DirectoryParser.h"
+#include "Config.h"
+#include "PoolThread.hpp"
+#include "Com.h"
+
+using std::string;
+
+#define DIR_SNAPSHOT_MAGIC   0x44535641    // "AVSD"
+#define DIR_SNAPSHOT_VERSION 1
+#define DIR_PARENT_ROOT      0xFF          // servicesĸڵ
+
+/**
+ * ļʽ(С):
+ * header | records[record_count] | proxies[proxy_count] | strings[string_size]
+ * records(parent_type, parent_id, order, id), ͬһڵӽڵ;
+ * proxiesroom_id. ֺipoffset/lenstrings, '\0'.
+ */
+#pragma pack(1)
+typedef struct
+{
+	pj_uint32_t magic;
+	pj_uint16_t version;
+	pj_uint16_t header_size;
+	pj_uint32_t record_count;
+	pj_uint32_t proxy_count;
+	pj_uint32_t string_size;
+	pj_uint32_t reserved;
+} dir_snapshot_header_t;
+
+typedef struct
+{
+	pj_uint8_t  type;
+	pj_uint8_t  parent_type;
+	pj_uint16_t reserved;
+	pj_int32_t  parent_id;
+	pj_int32_t  id;
+	pj_uint32_t order;
+	pj_uint32_t usercount;
+	pj_uint32_t name_offset;
+	pj_uint32_t name_len;
+} dir_snapshot_record_t;
+
+typedef struct
+{
+	pj_int32_t  room_id;
+	pj_uint16_t proxy_id;
+	pj_uint16_t tcp_port;
+	pj_uint16_t udp_port;
+	pj_uint16_t reserved;
+	pj_uint32_t ip_offset;
+	pj_uint32_t ip_len;
+} dir_snapshot_proxy_t;
+#pragma pack()
+
+typedef struct
+{
+	pj_uint8_t  type_;
+	pj_int32_t  id_;
+	string      name_;
+	order_t     order_;
+	pj_uint32_t usercount_;
+} snapshot_entry_t;
+
+typedef struct
+{
+	pj_uint16_t proxy_id_;
+	string      proxy_ip_;
+	pj_uint16_t tcp_port_;
+	pj_uint16_t udp_port_;
+} snapshot_proxy_t;
+
+typedef pj_uint64_t dir_parent_key_t;      // parent_type << 32 | parent_id
+typedef map<dir_parent_key_t, vector<snapshot_entry_t>> snapshot_children_t;
+typedef map<pj_int32_t, snapshot_proxy_t> snapshot_proxies_t;
+typedef std::function<void ()> snapshot_cb_t;
+typedef std::function<pj_bool_t (snapshot_proxy_t &)> proxy_query_t;
+
+/**
+ * Ŀ¼room->proxyӳıؿ.
+ * ʱϴαļӳڴ, ֱӴӳ;
+ * ں̨߳Ŀ¼У, ݼ¼ڴ, ɵ÷Ӧõ.
+ * ûеĽڵҲں̨߳ȡ, ֻ߳ȡõĽ.
+ * ʱȰӳݲڴٽӳ, дʱļ滻ԭļ.
+ */
+class DirectorySnapshot
+	: public Noncopyable
+{
+public:
+	DirectorySnapshot();
+
+	pj_status_t Prepare(const pj_str_t &file_name);
+	pj_status_t Launch();
+	void        Destory();
+
+	pj_bool_t   VisitChildren(pj_uint8_t parent_type, pj_int32_t parent_id, const dir_record_cb_t &on_record);
+	// ں̨߳ȡͽ, صҲں̨߳
+	void        Revalidate(pj_int32_t node_id, const snapshot_cb_t &on_refreshed);
+	void        Load(pj_int32_t node_id, const snapshot_cb_t &on_loaded);
+	void        RevalidateProxy(pj_int32_t room_id, const snapshot_proxy_t &cached, const proxy_query_t &query,
+		const snapshot_cb_t &on_stale);
+	pj_bool_t   GetProxy(pj_int32_t room_id, snapshot_proxy_t &proxy);
+	void        SetProxy(pj_int32_t room_id, const snapshot_proxy_t &proxy);
+	pj_status_t Save();
+
+private:
+	pj_bool_t   Fetch(pj_int32_t node_id, pj_bool_t &changed);
+	pj_bool_t   SameChildren(dir_parent_key_t key, vector<snapshot_entry_t> entries);
+	pj_status_t Map();
+	void        Unmap();
+	void        Absorb();
+	pj_bool_t   FindMappedChildren(dir_parent_key_t key, pj_uint32_t &first, pj_uint32_t &last);
+	pj_str_t    MappedString(pj_uint32_t offset, pj_uint32_t len);
+
+	static inline dir_parent_key_t ParentKey(pj_uint8_t parent_type, pj_int32_t parent_id)
+	{
+		return ((dir_parent_key_t)parent_type << 32) | (pj_uint32_t)parent_id;
+	}
+
+	mutex                         snapshot_lock_;
+	string                        file_name_;
+	HANDLE                        file_;
+	HANDLE                        mapping_;
+	const pj_uint8_t             *view_;
+	const dir_snapshot_header_t  *header_;
+	const dir_snapshot_record_t  *records_;
+	const dir_snapshot_proxy_t   *proxies_;
+	const char                   *strings_;
+	snapshot_children_t           children_;    // ӳµӽڵб
+	snapshot_proxies_t            proxies_map_;
+	pj_bool_t                     dirty_;
+	PoolThread<std::function<void ()>> refresh_thread_pool_;
+};
+
+extern DirectorySnapshot g_directory_snapshot;
+
+#endif
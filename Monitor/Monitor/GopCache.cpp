@@ -0,0 +1,314 @@
+#include "stdafx.h"
+#include "GopCache.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "GopCache.cpp"
+
+GopCache g_gop_cache;
+
+GopCache::GopCache()
+	: gop_lock_()
+	, pool_(nullptr)
+	, gops_()
+	, lru_()
+	, free_chunks_()
+	, chunk_count_(0)
+	, max_chunks_(GOP_CACHE_MIN_CHUNKS)
+{
+}
+
+// limitΪռڴ(ֽ)
+pj_status_t GopCache::Prepare(pj_pool_factory *factory, pj_uint32_t limit)
+{
+	lock_guard<mutex> lock(gop_lock_);
+
+	max_chunks_ = MAX(limit / GOP_CHUNK_SIZE, GOP_CACHE_MIN_CHUNKS);
+	pool_ = pj_pool_create(factory, "GopCache", GOP_CHUNK_SIZE, GOP_CHUNK_SIZE, NULL);
+	RETURN_VAL_IF_FAIL(pool_ != nullptr, PJ_ENOMEM);
+
+	PJ_LOG(5, (__ABS_FILE__, "Prepare gop cache with %u chunks of %u bytes", max_chunks_, GOP_CHUNK_SIZE));
+
+	return PJ_SUCCESS;
+}
+
+void GopCache::Destory()
+{
+	lock_guard<mutex> lock(gop_lock_);
+
+	gops_.clear();
+	lru_.clear();
+	free_chunks_.clear();
+	chunk_count_ = 0;
+
+	if(pool_ != nullptr)
+	{
+		pj_pool_release(pool_);
+		pool_ = nullptr;
+	}
+}
+
+// RFC 6184: NAL, STAP-AеһNAL, FU-A׸ƬΪIDR/SPS
+pj_bool_t GopCache::IsKeyframe(const pj_uint8_t *payload, pj_uint32_t payloadlen)
+{
+	RETURN_VAL_IF_FAIL(payload != nullptr && payloadlen > 0, PJ_FALSE);
+
+	pj_uint8_t type = H264_NAL_TYPE(payload[0]);
+	if(type == H264_NAL_STAP_A)
+	{
+		pj_uint32_t offset = 1;
+		while(offset + 2 < payloadlen)
+		{
+			pj_uint16_t nal_size = (payload[offset] << 8) | payload[offset + 1];
+			type = H264_NAL_TYPE(payload[offset + 2]);
+			if(type == H264_NAL_IDR || type == H264_NAL_SPS)
+			{
+				return PJ_TRUE;
+			}
+			offset += 2 + nal_size;
+		}
+		return PJ_FALSE;
+	}
+	else if(type == H264_NAL_FU_A)
+	{
+		RETURN_VAL_IF_FAIL(payloadlen > 1 && (payload[1] & 0x80), PJ_FALSE);
+		type = H264_NAL_TYPE(payload[1]);
+	}
+
+	return (type == H264_NAL_IDR || type == H264_NAL_SPS) ? PJ_TRUE : PJ_FALSE;
+}
+
+// STAP-ANRIȡNALеֵ, FU-ANRIԭNALͬ, ֻһֽ
+pj_bool_t GopCache::IsReference(const pj_uint8_t *payload, pj_uint32_t payloadlen)
+{
+	RETURN_VAL_IF_FAIL(payload != nullptr && payloadlen > 0, PJ_FALSE);
+
+	return H264_NAL_REF_IDC(payload[0]) != 0 ? PJ_TRUE : PJ_FALSE;
+}
+
+// SEIеĵһϢǷΪrecovery point. sei_lenNALͷ
+static pj_bool_t is_recovery_point_sei(const pj_uint8_t *sei, pj_uint32_t sei_len)
+{
+	pj_uint32_t payload_type = 0;
+	pj_uint32_t offset = 0;
+	while(offset < sei_len && sei[offset] == 0xFF)
+	{
+		payload_type += 0xFF;
+		++ offset;
+	}
+	RETURN_VAL_IF_FAIL(offset < sei_len, PJ_FALSE);
+
+	payload_type += sei[offset];
+	return payload_type == H264_SEI_RECOVERY_POINT ? PJ_TRUE : PJ_FALSE;
+}
+
+// NALSTAP-Aдrecovery point SEI, ֮֡ԲǰĲοָ֡
+pj_bool_t GopCache::IsRecoveryPoint(const pj_uint8_t *payload, pj_uint32_t payloadlen)
+{
+	RETURN_VAL_IF_FAIL(payload != nullptr && payloadlen > 1, PJ_FALSE);
+
+	pj_uint8_t type = H264_NAL_TYPE(payload[0]);
+	if(type == H264_NAL_SEI)
+	{
+		return is_recovery_point_sei(payload + 1, payloadlen - 1);
+	}
+	else if(type == H264_NAL_STAP_A)
+	{
+		pj_uint32_t offset = 1;
+		while(offset + 2 < payloadlen)
+		{
+			pj_uint16_t nal_size = (payload[offset] << 8) | payload[offset + 1];
+			RETURN_VAL_IF_FAIL(nal_size > 0 && offset + 2 + nal_size <= payloadlen, PJ_FALSE);
+
+			const pj_uint8_t *nal = payload + offset + 2;
+			if(H264_NAL_TYPE(nal[0]) == H264_NAL_SEI && is_recovery_point_sei(nal + 1, nal_size - 1))
+			{
+				return PJ_TRUE;
+			}
+			offset += 2 + nal_size;
+		}
+	}
+
+	return PJ_FALSE;
+}
+
+void GopCache::Push(pj_uint32_t ssrc, const pj_uint8_t *rtp_frame, pj_uint16_t framelen)
+{
+	RETURN_IF_FAIL(rtp_frame != nullptr && framelen > 0);
+
+	const pjmedia_rtp_hdr *hdr;
+	const void *payload;
+	unsigned payloadlen;
+	pj_status_t status;
+	status = pjmedia_rtp_decode_rtp(NULL, rtp_frame, framelen, &hdr, &payload, &payloadlen);
+	RETURN_IF_FAIL(status == PJ_SUCCESS && payloadlen > 0);
+
+	pj_uint32_t ts = pj_ntohl(hdr->ts);
+	pj_bool_t   keyframe = IsKeyframe((const pj_uint8_t *)payload, payloadlen);
+
+	lock_guard<mutex> lock(gop_lock_);
+
+	gop_map_t::iterator pgop = gops_.find(ssrc);
+	if(pgop == gops_.end())
+	{
+		RETURN_IF_FAIL(keyframe);   // ûȵؼ֡
+
+		gop_entry_t entry;
+		entry.ts_ = ts;
+		entry.tail_ = 0;
+		entry.packet_count_ = 0;
+		entry.lru_ = lru_.insert(lru_.end(), ssrc);
+		pgop = gops_.insert(gop_map_t::value_type(ssrc, entry)).first;
+	}
+	else
+	{
+		lru_.splice(lru_.end(), lru_, pgop->second.lru_);
+	}
+
+	gop_entry_t &gop = pgop->second;
+
+	// SPS/PPS/IDRͬһʱ, ֻʱϵĹؼ֡ſʼµGOP
+	if(keyframe && (gop.packet_count_ == 0 || gop.ts_ != ts))
+	{
+		Reset(gop);
+		gop.ts_ = ts;
+	}
+	else if(gop.packet_count_ == 0)
+	{
+		return;
+	}
+
+	// һŲһʱGOP, ȱGOPҲỨ
+	pj_uint32_t need = sizeof(pj_uint16_t) + framelen;
+	if(need > GOP_CHUNK_SIZE)
+	{
+		PJ_LOG(5, (__ABS_FILE__, "Push() => ssrc[%u] packet of %u bytes exceeds the chunk size, wait for next keyframe", ssrc, framelen));
+		Reset(gop);
+		return;
+	}
+
+	if(gop.chunks_.empty() || gop.tail_ + need > GOP_CHUNK_SIZE)
+	{
+		if(!gop.chunks_.empty() && gop.tail_ + sizeof(pj_uint16_t) <= GOP_CHUNK_SIZE)
+		{
+			pj_bzero(gop.chunks_.back() + gop.tail_, sizeof(pj_uint16_t));  // ڽ
+		}
+
+		pj_uint8_t *chunk = AllocChunk(ssrc);
+		if(chunk == nullptr)
+		{
+			PJ_LOG(5, (__ABS_FILE__, "Push() => ssrc[%u] gop exceeds the cache limit, wait for next keyframe", ssrc));
+			Reset(gop);
+			return;
+		}
+
+		gop.chunks_.push_back(chunk);
+		gop.tail_ = 0;
+	}
+
+	pj_uint8_t *dst = gop.chunks_.back() + gop.tail_;
+	pj_memcpy(dst, &framelen, sizeof(framelen));
+	pj_memcpy(dst + sizeof(framelen), rtp_frame, framelen);
+	gop.tail_ += need;
+	++ gop.packet_count_;
+}
+
+// ƳssrcǰGOP, 汣ֲ
+pj_bool_t GopCache::Snapshot(pj_uint32_t ssrc, gop_packets_t &packets)
+{
+	lock_guard<mutex> lock(gop_lock_);
+	gop_map_t::iterator pgop = gops_.find(ssrc);
+	RETURN_VAL_IF_FAIL(pgop != gops_.end(), PJ_FALSE);
+
+	const gop_entry_t &gop = pgop->second;
+	packets.clear();
+	packets.reserve(gop.packet_count_);
+	for(pj_uint32_t i = 0; i < gop.chunks_.size(); ++ i)
+	{
+		const pj_uint8_t *chunk = gop.chunks_[i];
+		pj_uint32_t used = (i + 1 == gop.chunks_.size()) ? gop.tail_ : GOP_CHUNK_SIZE;
+		pj_uint32_t offset = 0;
+		while(offset + sizeof(pj_uint16_t) <= used)
+		{
+			pj_uint16_t len;
+			pj_memcpy(&len, chunk + offset, sizeof(len));
+			if(len == 0)
+			{
+				break;
+			}
+
+			offset += sizeof(len);
+			packets.push_back(rtp_packet_t(chunk + offset, chunk + offset + len));
+			offset += len;
+		}
+	}
+
+	return packets.empty() ? PJ_FALSE : PJ_TRUE;
+}
+
+void GopCache::Drop(pj_uint32_t ssrc)
+{
+	lock_guard<mutex> lock(gop_lock_);
+	gop_map_t::iterator pgop = gops_.find(ssrc);
+	RETURN_IF_FAIL(pgop != gops_.end());
+
+	Erase(pgop);
+}
+
+void GopCache::Clear()
+{
+	lock_guard<mutex> lock(gop_lock_);
+	while(!gops_.empty())
+	{
+		Erase(gops_.begin());
+	}
+}
+
+// ÷gop_lock_. ûппѵʱ, ̭ûյssrc
+pj_uint8_t *GopCache::AllocChunk(pj_uint32_t ssrc)
+{
+	RETURN_VAL_IF_FAIL(pool_ != nullptr, nullptr);
+
+	while(free_chunks_.empty() && chunk_count_ >= max_chunks_)
+	{
+		gop_lru_t::iterator pvictim = lru_.begin();
+		while(pvictim != lru_.end() && *pvictim == ssrc)
+		{
+			++ pvictim;
+		}
+		RETURN_VAL_IF_FAIL(pvictim != lru_.end(), nullptr);
+
+		PJ_LOG(5, (__ABS_FILE__, "AllocChunk() => Evict gop of ssrc[%u]", *pvictim));
+		Erase(gops_.find(*pvictim));
+	}
+
+	if(!free_chunks_.empty())
+	{
+		pj_uint8_t *chunk = free_chunks_.back();
+		free_chunks_.pop_back();
+		return chunk;
+	}
+
+	pj_uint8_t *chunk = reinterpret_cast<pj_uint8_t *>(pj_pool_alloc(pool_, GOP_CHUNK_SIZE));
+	RETURN_VAL_IF_FAIL(chunk != nullptr, nullptr);
+	++ chunk_count_;
+
+	return chunk;
+}
+
+void GopCache::Reset(gop_entry_t &gop)
+{
+	free_chunks_.insert(free_chunks_.end(), gop.chunks_.begin(), gop.chunks_.end());
+	gop.chunks_.clear();
+	gop.tail_ = 0;
+	gop.packet_count_ = 0;
+}
+
+void GopCache::Erase(gop_map_t::iterator pgop)
+{
+	Reset(pgop->second);
+	lru_.erase(pgop->second.lru_);
+	gops_.erase(pgop);
+}
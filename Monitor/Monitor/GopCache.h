@@ -0,0 +1,83 @@
+#ifndef __AVS_PROXY_CLIENT_GOP_CACHE__
+#define __AVS_PROXY_CLIENT_GOP_CACHE__
+
+#include <vector>
+#include <list>
+#include <mutex>
+#include <map>
+
+#include "Com.h"
+
+using std::vector;
+using std::list;
+using std::mutex;
+using std::lock_guard;
+using std::map;
+
+#define GOP_CHUNK_SIZE        (64 * 1024)   // ÿɷ40ϵMTU
+#define GOP_CACHE_MIN_CHUNKS  4
+
+#define H264_NAL_TYPE(b)      ((b) & 0x1F)
+#define H264_NAL_REF_IDC(b)   (((b) >> 5) & 0x03)
+#define H264_NAL_IDR          5
+#define H264_NAL_SEI          6
+#define H264_NAL_SPS          7
+#define H264_NAL_STAP_A       24
+#define H264_NAL_FU_A         28
+#define H264_SEI_RECOVERY_POINT 6
+
+typedef vector<pj_uint8_t>    rtp_packet_t;
+typedef vector<rtp_packet_t>  gop_packets_t;
+typedef list<pj_uint32_t>     gop_lru_t;     // δյ
+
+typedef struct
+{
+	pj_uint32_t          ts_;           // ؼ֡RTPʱ
+	vector<pj_uint8_t *> chunks_;       // δ: | len(2ֽ) | RTP |
+	pj_uint32_t          tail_;         // һֽ
+	pj_uint32_t          packet_count_;
+	gop_lru_t::iterator  lru_;
+} gop_entry_t;
+
+typedef map<pj_uint32_t, gop_entry_t> gop_map_t;  // video ssrc -> gop
+
+/**
+ * ѹGOP: ÿ·תƵssrcһؼ֡ȫRTP, .
+ * ڹ̶СĿ, ȡpj_poolͨ, ܿlimit;
+ * 鲻ʱ̭ûյһ·.
+ * ûӵĻʱȡGOPٽ, ֻʾһ֡, õһIDR.
+ */
+class GopCache
+	: public Noncopyable
+{
+public:
+	GopCache();
+
+	pj_status_t Prepare(pj_pool_factory *factory, pj_uint32_t limit);
+	void        Destory();
+	void        Push(pj_uint32_t ssrc, const pj_uint8_t *rtp_frame, pj_uint16_t framelen);
+	pj_bool_t   Snapshot(pj_uint32_t ssrc, gop_packets_t &packets);
+	void        Drop(pj_uint32_t ssrc);
+	void        Clear();
+
+	static pj_bool_t IsKeyframe(const pj_uint8_t *payload, pj_uint32_t payloadlen);
+	static pj_bool_t IsReference(const pj_uint8_t *payload, pj_uint32_t payloadlen);
+	static pj_bool_t IsRecoveryPoint(const pj_uint8_t *payload, pj_uint32_t payloadlen);
+
+private:
+	pj_uint8_t *AllocChunk(pj_uint32_t ssrc);
+	void        Reset(gop_entry_t &gop);
+	void        Erase(gop_map_t::iterator pgop);
+
+	mutex                gop_lock_;
+	pj_pool_t           *pool_;
+	gop_map_t            gops_;
+	gop_lru_t            lru_;
+	vector<pj_uint8_t *> free_chunks_;
+	pj_uint32_t          chunk_count_;
+	pj_uint32_t          max_chunks_;
+};
+
+extern GopCache g_gop_cache;
+
+#endif
@@ -0,0 +1,423 @@
+#include "stdafx.h"
+#include "HealthMonitor.h"
+#include "AvRoutes.h"
+#include "TitleRoom.h"
+#include "AvsProxy.h"
+#include "VideoStream.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "HealthMonitor.cpp"
+
+HealthMonitor g_health_monitor;
+
+StreamHealth::StreamHealth(pj_uint32_t ssrc, pj_int32_t room_id, pj_int64_t user_id)
+	: ssrc_(ssrc)
+	, room_id_(room_id)
+	, user_id_(user_id)
+	, state_(HEALTH_STATE_WAITING)
+	, stats_(VIDEO_CLOCK_RATE, ssrc)
+	, nal_()
+	, started_(PJ_FALSE)
+	, frame_ts_(0)
+	, frame_bytes_(0)
+	, frame_key_(PJ_FALSE)
+	, activity_()
+{
+	pj_get_timestamp(&attached_);
+}
+
+// հ̵߳. ٵľ֡İֻհͳ
+void StreamHealth::OnRtp(const pj_uint8_t *rtp_frame, pj_uint16_t framelen, const pj_timestamp &arrival)
+{
+	const pjmedia_rtp_hdr *hdr;
+	const void *payload;
+	unsigned payloadlen;
+	pj_status_t status;
+	status = pjmedia_rtp_decode_rtp(NULL, rtp_frame, framelen, &hdr, &payload, &payloadlen);
+	RETURN_IF_FAIL(status == PJ_SUCCESS);
+
+	stats_.OnRtp(hdr, payloadlen, arrival);
+
+	pj_uint32_t ts = pj_ntohl(hdr->ts);
+	RETURN_IF_FAIL(!started_ || (pj_int32_t)(ts - frame_ts_) >= 0);
+
+	pj_bool_t keyframe = GopCache::IsKeyframe((const pj_uint8_t *)payload, payloadlen);
+
+	nal_stats_t &nal = nal_.BeginWrite();
+	if(!started_ || ts != frame_ts_)
+	{
+		if(started_)
+		{
+			EndFrame(nal);
+		}
+		started_ = PJ_TRUE;
+		frame_ts_ = ts;
+		frame_bytes_ = 0;
+		frame_key_ = PJ_FALSE;
+		nal.last_advance_ = arrival;
+	}
+
+	activity_.OnPayload((const pj_uint8_t *)payload, payloadlen);
+	frame_bytes_ += payloadlen;
+	if(keyframe && !frame_key_)
+	{
+		frame_key_ = PJ_TRUE;
+		if(nal.idr_count_ > 0)
+		{
+			nal.idr_interval_msec_ = pj_elapsed_msec(&nal.last_idr_, &arrival);
+		}
+		++ nal.idr_count_;
+		nal.last_idr_ = arrival;
+	}
+	nal_.EndWrite();
+}
+
+// ÷BeginWrite/EndWrite֮
+void StreamHealth::EndFrame(nal_stats_t &nal)
+{
+	++ nal.frames_;
+	nal.frame_bytes_avg_ = nal.frames_ == 1 ? frame_bytes_ : nal.frame_bytes_avg_ - nal.frame_bytes_avg_ / 8 + frame_bytes_ / 8;
+	nal.frame_bytes_max_ = MAX(nal.frame_bytes_max_, frame_bytes_);
+	if(frame_key_)
+	{
+		nal.idr_bytes_ = frame_bytes_;
+	}
+	nal.activity_ = activity_.EndFrame(frame_ts_, frame_bytes_, frame_key_);
+}
+
+// ̵߳
+void StreamHealth::Snapshot(health_snapshot_t &snapshot) const
+{
+	stats_.Snapshot(snapshot.stats_);
+	nal_.Read(snapshot.nal_);
+
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+
+	pj_uint32_t timeout = g_client_config.health_timeout;
+	if(snapshot.stats_.rx_.packets_ == 0)
+	{
+		snapshot.state_ = pj_elapsed_msec(&attached_, &now) > timeout ? HEALTH_STATE_STALLED : HEALTH_STATE_WAITING;
+	}
+	else if(pj_elapsed_msec(&snapshot.stats_.rx_.last_arrival_, &now) > timeout)
+	{
+		snapshot.state_ = HEALTH_STATE_STALLED;
+	}
+	else if(pj_elapsed_msec(&snapshot.nal_.last_advance_, &now) > timeout)
+	{
+		snapshot.state_ = HEALTH_STATE_FROZEN;
+	}
+	else
+	{
+		snapshot.state_ = HEALTH_STATE_ALIVE;
+	}
+}
+
+// ͣͻ򶳽ûлԾ. ̵߳
+pj_uint32_t StreamHealth::Activity() const
+{
+	nal_stats_t nal;
+	nal_.Read(nal);
+	RETURN_VAL_IF_FAIL(nal.frames_ > 0, 0);
+
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	RETURN_VAL_IF_FAIL(pj_elapsed_msec(&nal.last_advance_, &now) <= g_client_config.health_timeout, 0);
+
+	return nal.activity_;
+}
+
+HealthMonitor::HealthMonitor()
+	: streams_()
+	, links_lock_()
+	, links_()
+{
+	pj_bzero(counts_, sizeof(counts_));
+}
+
+const char *HealthMonitor::StateName(health_state_t state)
+{
+	static const char *names[] = {"waiting", "alive", "frozen", "stalled"};
+	return state <= HEALTH_STATE_STALLED ? names[state] : "unknown";
+}
+
+/**
+ * 鿴бʱ. δתûϲΪһLinkRoomUsers, ͷroom_lock_֮.
+ */
+void HealthMonitor::AddRoom(TitleRoom *room)
+{
+	RETURN_IF_FAIL(room != nullptr && g_client_config.health_enable);
+
+	AvsProxy *proxy;
+	pj_uint32_t users;
+	vector<user_binding_t> link;
+	{
+		lock_guard<mutex> room_lock(room->room_lock_);
+		RETURN_IF_FAIL(!room->health_);
+		room->health_ = PJ_TRUE;
+
+		AvRouteUpdate update;
+		for(pj_uint32_t i = 0; i < room->users_order_.size(); ++ i)
+		{
+			User *user = room->users_order_[i];
+			if(user->health_)
+			{
+				continue;
+			}
+
+			if(!user->IsForwarded())
+			{
+				user_binding_t binding = {room->id_, user->user_id_};
+				link.push_back(binding);
+			}
+			user->health_ = PJ_TRUE;
+			Attach(user);
+		}
+		proxy = room->proxy_;
+		users = room->users_order_.size();
+	}
+
+	if(proxy != nullptr)
+	{
+		proxy->LinkRoomUsers(link);
+	}
+
+	PJ_LOG(5, (__ABS_FILE__, "AddRoom() => Room[%d] health monitoring %u users, %u newly linked",
+		room->id_, users, link.size()));
+}
+
+// ĻϻԤȡûת
+void HealthMonitor::DelRoom(TitleRoom *room)
+{
+	RETURN_IF_FAIL(room != nullptr);
+
+	AvsProxy *proxy;
+	vector<user_binding_t> unlink;
+	{
+		lock_guard<mutex> room_lock(room->room_lock_);
+		RETURN_IF_FAIL(room->health_);
+		room->health_ = PJ_FALSE;
+
+		AvRouteUpdate update;
+		for(pj_uint32_t i = 0; i < room->users_order_.size(); ++ i)
+		{
+			User *user = room->users_order_[i];
+			if(!user->health_)
+			{
+				continue;
+			}
+
+			user->health_ = PJ_FALSE;
+			Detach(user->video_ssrc_);
+			if(!user->IsForwarded())
+			{
+				user_binding_t binding = {room->id_, user->user_id_};
+				unlink.push_back(binding);
+			}
+		}
+		proxy = room->proxy_;
+	}
+
+	for(pj_uint32_t i = 0; i < unlink.size() && proxy != nullptr; ++ i)
+	{
+		proxy->UnlinkRoomUser(unlink[i]);
+	}
+
+	PJ_LOG(5, (__ABS_FILE__, "DelRoom() => Room[%d] stop health monitoring, %u users unlinked",
+		room->id_, unlink.size()));
+}
+
+// еķûʱ, TitleRoomڳroom_lock_ʱ. linkڷ, ǼǺCheck()
+void HealthMonitor::AddUser(User *user)
+{
+	RETURN_IF_FAIL(user != nullptr && user->title_room_ != nullptr);
+
+	pj_bool_t forwarded;
+	{
+		AvRouteUpdate update;
+		RETURN_IF_FAIL(!user->health_);
+
+		forwarded = user->IsForwarded();
+		user->health_ = PJ_TRUE;
+		Attach(user);
+	}
+
+	RETURN_IF_FAIL(!forwarded && user->title_room_->proxy_ != nullptr);
+
+	health_link_t link = {user->title_room_->proxy_, user->title_room_->id_, user->user_id_};
+	lock_guard<std::mutex> lock(links_lock_);
+	links_.push_back(link);
+}
+
+// û뿪, Ҫ֪ͨproxy, δlinkҲһȡ
+void HealthMonitor::DelUser(User *user)
+{
+	RETURN_IF_FAIL(user != nullptr);
+
+	{
+		lock_guard<std::mutex> lock(links_lock_);
+		for(vector<health_link_t>::iterator plink = links_.begin(); plink != links_.end(); )
+		{
+			if(plink->user_id == user->user_id_ && user->title_room_ != nullptr && plink->room_id == user->title_room_->id_)
+			{
+				plink = links_.erase(plink);
+			}
+			else
+			{
+				++ plink;
+			}
+		}
+	}
+
+	AvRouteUpdate update;
+	RETURN_IF_FAIL(user->health_);
+
+	user->health_ = PJ_FALSE;
+	Detach(user->video_ssrc_);
+}
+
+// proxyϲΪLinkRoomUsers, κη
+void HealthMonitor::SendLinks()
+{
+	vector<health_link_t> links;
+	{
+		lock_guard<std::mutex> lock(links_lock_);
+		RETURN_IF_FAIL(!links_.empty());
+		links.swap(links_);
+	}
+
+	while(!links.empty())
+	{
+		AvsProxy *proxy = links.front().proxy;
+		vector<user_binding_t> bindings;
+		for(vector<health_link_t>::iterator plink = links.begin(); plink != links.end(); )
+		{
+			if(plink->proxy == proxy)
+			{
+				user_binding_t binding = {plink->room_id, plink->user_id};
+				bindings.push_back(binding);
+				plink = links.erase(plink);
+			}
+			else
+			{
+				++ plink;
+			}
+		}
+		proxy->LinkRoomUsers(bindings);
+	}
+}
+
+void HealthMonitor::Clear()
+{
+	{
+		lock_guard<std::mutex> lock(links_lock_);
+		links_.clear();
+	}
+
+	AvRouteUpdate update;
+	RETURN_IF_FAIL(!streams_.empty());
+
+	streams_.clear();
+	g_av_routes.Touch();
+}
+
+void HealthMonitor::Attach(User *user)
+{
+	RETURN_IF_FAIL(user->video_ssrc_ > 0);
+	RETURN_IF_FAIL(streams_.find(user->video_ssrc_) == streams_.end());
+
+	pj_int32_t room_id = user->title_room_ != nullptr ? user->title_room_->id_ : 0;
+	streams_[user->video_ssrc_] = stream_health_ptr_t(new StreamHealth(user->video_ssrc_, room_id, user->user_id_));
+	g_av_routes.Touch();
+}
+
+void HealthMonitor::Detach(pj_uint32_t ssrc)
+{
+	RETURN_IF_FAIL(streams_.erase(ssrc) > 0);
+	g_av_routes.Touch();
+}
+
+pj_bool_t HealthMonitor::GetHealth(pj_uint32_t ssrc, health_snapshot_t &snapshot)
+{
+	stream_health_ptr_t stream;
+	{
+		lock_guard<mutex> lock(g_av_index_lock);
+		health_map_t::iterator pstream = streams_.find(ssrc);
+		RETURN_VAL_IF_FAIL(pstream != streams_.end(), PJ_FALSE);
+
+		stream = pstream->second;
+	}
+
+	stream->Snapshot(snapshot);
+
+	return PJ_TRUE;
+}
+
+// scoresƵssrcsһһӦ, ûڼΪ0. ֻssrc, ѱɾUser
+void HealthMonitor::GetActivity(const vector<pj_uint32_t> &ssrcs, vector<pj_uint32_t> &scores)
+{
+	scores.assign(ssrcs.size(), 0);
+
+	lock_guard<mutex> lock(g_av_index_lock);
+	for(pj_uint32_t i = 0; i < ssrcs.size(); ++ i)
+	{
+		health_map_t::iterator pstream = streams_.find(ssrcs[i]);
+		if(pstream != streams_.end())
+		{
+			scores[i] = pstream->second->Activity();
+		}
+	}
+}
+
+/**
+ * libevent߳ÿHEALTH_CHECK_INTERVALһ. ֻ·ɱ, ·,
+ * ǧ·Ҳհ. ֻӡ״̬仯ͻܵı仯.
+ */
+void HealthMonitor::Check()
+{
+	SendLinks();
+
+	vector<stream_health_ptr_t> streams;
+	{
+		lock_guard<mutex> lock(g_av_index_lock);
+		streams.reserve(streams_.size());
+		for(health_map_t::iterator pstream = streams_.begin(); pstream != streams_.end(); ++ pstream)
+		{
+			streams.push_back(pstream->second);
+		}
+	}
+
+	pj_uint32_t counts[HEALTH_STATE_STALLED + 1] = {0};
+	for(pj_uint32_t i = 0; i < streams.size(); ++ i)
+	{
+		StreamHealth &stream = *streams[i];
+
+		health_snapshot_t snapshot;
+		stream.Snapshot(snapshot);
+		++ counts[snapshot.state_];
+
+		if(snapshot.state_ != stream.state_)
+		{
+			PJ_LOG(snapshot.state_ == HEALTH_STATE_ALIVE && stream.state_ == HEALTH_STATE_WAITING ? 5 : 4,
+				(__ABS_FILE__, "Check() => room[%d] user[%lld] ssrc[%u] %s -> %s, bitrate[%u]kbps fps[%u] idr interval[%u]ms activity[%u]",
+				stream.room_id_, stream.user_id_, stream.ssrc_,
+				StateName(stream.state_), StateName(snapshot.state_),
+				snapshot.stats_.rx_.bitrate_ / 1000, snapshot.stats_.rx_.fps_, snapshot.nal_.idr_interval_msec_,
+				snapshot.nal_.activity_));
+
+			stream.state_ = snapshot.state_;
+		}
+	}
+
+	if(pj_memcmp(counts, counts_, sizeof(counts)) != 0)
+	{
+		pj_memcpy(counts_, counts, sizeof(counts));
+
+		PJ_LOG(4, (__ABS_FILE__, "Check() => %u streams monitored, alive[%u] frozen[%u] stalled[%u] waiting[%u]",
+			streams.size(), counts[HEALTH_STATE_ALIVE], counts[HEALTH_STATE_FROZEN],
+			counts[HEALTH_STATE_STALLED], counts[HEALTH_STATE_WAITING]));
+	}
+}
@@ -0,0 +1,136 @@
+#ifndef __AVS_PROXY_CLIENT_HEALTH_MONITOR__
+#define __AVS_PROXY_CLIENT_HEALTH_MONITOR__
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+#include "StreamStats.h"
+#include "SeqLock.hpp"
+#include "GopCache.h"
+#include "ActivityMeter.h"
+#include "Com.h"
+
+using std::shared_ptr;
+using std::vector;
+
+#define HEALTH_CHECK_INTERVAL  1000    // ms
+
+typedef enum
+{
+	HEALTH_STATE_WAITING = 0,   // ûյ
+	HEALTH_STATE_ALIVE,
+	HEALTH_STATE_FROZEN,        // аʱǰ
+	HEALTH_STATE_STALLED,       // ʱûյ
+} health_state_t;
+
+// ֻRTPͷNAL͵õָ, ֻհ߳д
+typedef struct
+{
+	pj_uint32_t  frames_;
+	pj_uint32_t  frame_bytes_avg_;     // ֡ƽС, 1/8˥
+	pj_uint32_t  frame_bytes_max_;
+	pj_uint32_t  idr_count_;
+	pj_uint32_t  idr_bytes_;           // һIDR֡ĴС
+	pj_uint32_t  idr_interval_msec_;   // IDRļ
+	pj_timestamp last_idr_;
+	pj_timestamp last_advance_;        // һʱǰ(µһ֡ʼ)
+	pj_uint32_t  activity_;            // ѹԾ0~100, ActivityMeter
+} nal_stats_t;
+
+typedef struct
+{
+	health_state_t state_;
+	stream_stats_t stats_;
+	nal_stats_t    nal_;
+} health_snapshot_t;
+
+/**
+ * һ·ֻƵssrc: , GopCache.
+ */
+class StreamHealth
+	: public Noncopyable
+{
+public:
+	StreamHealth(pj_uint32_t ssrc, pj_int32_t room_id, pj_int64_t user_id);
+
+	void OnRtp(const pj_uint8_t *rtp_frame, pj_uint16_t framelen, const pj_timestamp &arrival);
+	void Snapshot(health_snapshot_t &snapshot) const;
+	pj_uint32_t Activity() const;
+
+	const pj_uint32_t ssrc_;
+	const pj_int32_t  room_id_;
+	const pj_int64_t  user_id_;
+	health_state_t    state_;        // ֻCheck()д
+
+private:
+	void EndFrame(nal_stats_t &nal);
+
+	StreamStats          stats_;
+	SeqLock<nal_stats_t> nal_;
+	pj_timestamp         attached_;     // ʼʱ, һֱûаʱݴжͣ
+	pj_bool_t            started_;
+	pj_uint32_t          frame_ts_;
+	pj_uint32_t          frame_bytes_;
+	pj_bool_t            frame_key_;
+	ActivityMeter        activity_;
+};
+
+typedef shared_ptr<StreamHealth> stream_health_ptr_t;
+typedef std::unordered_map<pj_uint32_t, stream_health_ptr_t> health_map_t;   // video ssrc -> ״̬
+
+class User;
+class TitleRoom;
+class AvsProxy;
+
+// еķû, ´Check()ʱlink
+typedef struct
+{
+	AvsProxy  *proxy;
+	pj_int32_t room_id;
+	pj_int64_t user_id;
+} health_link_t;
+
+/**
+ * health-only: health_enableʱ, 鿴еķûproxyתƵ,
+ * ֻRTPͷ, NALͺsliceͷ, ͳƴ, , ֡, IDR, ֡СͻԾ, ⶳ, Ӳ.
+ * ĻʾӰ, ûʱ˱ȡת.
+ * streams_g_av_index_mapһg_av_index_lock޸, հ߳̾AvRoutesĿֱõStreamHealth.
+ * proxylink/unlinkһroom_lock_֮: AvsProxyطſʱsnapshot_lock_ȡroom_lock_, .
+ * healthֻǱصĶķʽ, proxymedia maskֻƵ, proxy˵һͨƵlink.
+ */
+class HealthMonitor
+	: public Noncopyable
+{
+public:
+	HealthMonitor();
+
+	void AddRoom(TitleRoom *room);
+	void DelRoom(TitleRoom *room);
+	void AddUser(User *user);
+	void DelUser(User *user);
+	void Clear();
+	void Check();
+	pj_bool_t GetHealth(pj_uint32_t ssrc, health_snapshot_t &snapshot);
+	void      GetActivity(const vector<pj_uint32_t> &ssrcs, vector<pj_uint32_t> &scores);
+
+	// µ÷g_av_index_lock
+	void Attach(User *user);
+	void Detach(pj_uint32_t ssrc);
+	inline const health_map_t &Streams() const { return streams_; }
+
+	static const char *StateName(health_state_t state);
+
+private:
+	void SendLinks();
+
+	health_map_t streams_;
+	pj_uint32_t  counts_[HEALTH_STATE_STALLED + 1];   // һCheck()ʱ״̬·
+	std::mutex   links_lock_;
+	vector<health_link_t> links_;                      // AddUserʱroom_lock_µǼ, Check()
+};
+
+extern HealthMonitor g_health_monitor;
+
+#endif
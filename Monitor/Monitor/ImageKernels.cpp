@@ -0,0 +1,643 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "ImageKernels.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define KERNELS_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "ImageKernels.cpp"
+
+
+// BT.601޷ΧתRGBϵ, 6λ: 1.596, 0.391, 0.813, 2.018;
+// 1.16416λ߰˷, (y * 0x0101 * YUV_Y_MUL) >> 16, ټȥ16Ӧƫ(Ѻ0.5)
+#define YUV_Y_MUL   18997
+#define YUV_Y_BIAS  1160
+#define YUV_RV_MUL  102
+#define YUV_GU_MUL  25
+#define YUV_GV_MUL  52
+#define YUV_BU_MUL  129
+
+static void blend_rows_c(pj_uint8_t *dst, const pj_uint8_t *a, const pj_uint8_t *b, pj_uint32_t width, pj_uint32_t f)
+{
+	for(pj_uint32_t i = 0; i < width; ++ i)
+	{
+		dst[i] = (pj_uint8_t)((a[i] * (256 - f) + b[i] * f + 128) >> 8);
+	}
+}
+
+static void accumulate_row_c(pj_uint16_t *acc, const pj_uint8_t *src, pj_uint32_t width)
+{
+	for(pj_uint32_t i = 0; i < width; ++ i)
+	{
+		acc[i] = (pj_uint16_t)(acc[i] + src[i]);
+	}
+}
+
+static void scale_row_c(pj_uint8_t *dst, const pj_uint8_t *src, const pj_uint32_t *xmap, pj_uint32_t width)
+{
+	for(pj_uint32_t i = 0; i < width; ++ i)
+	{
+		const pj_uint8_t *p = src + (xmap[i] >> 8);
+		pj_uint32_t f = xmap[i] & 0xff;
+		dst[i] = (pj_uint8_t)((p[0] * (256 - f) + p[1] * f + 128) >> 8);
+	}
+}
+
+static inline pj_uint8_t clamp_rgb(pj_int32_t value)
+{
+	value = value < 0 ? 0 : value >> 6;
+	return (pj_uint8_t)(value > 255 ? 255 : value);
+}
+
+/**
+ * SIMD汾16λͼӷ, ֻBᳬ16λ, ҳʱȻǯ255, 32λһ.
+ */
+static void i420_to_bgra_row_c(pj_uint8_t *dst, const pj_uint8_t *y, const pj_uint8_t *u, const pj_uint8_t *v, pj_uint32_t width)
+{
+	for(pj_uint32_t i = 0; i < width; ++ i)
+	{
+		pj_int32_t luma = (pj_int32_t)((y[i] * 0x0101u * YUV_Y_MUL) >> 16) - YUV_Y_BIAS;
+		pj_int32_t cb = u[i / 2] - 128;
+		pj_int32_t cr = v[i / 2] - 128;
+
+		dst[4 * i + 0] = clamp_rgb(luma + YUV_BU_MUL * cb);
+		dst[4 * i + 1] = clamp_rgb(luma - YUV_GU_MUL * cb - YUV_GV_MUL * cr);
+		dst[4 * i + 2] = clamp_rgb(luma + YUV_RV_MUL * cr);
+		dst[4 * i + 3] = 0xff;
+	}
+}
+
+static void luma_stats_row_c(const pj_uint8_t *cur, const pj_uint8_t *prev, pj_uint32_t width, pj_uint32_t sums[3])
+{
+	pj_uint32_t sum = 0, sum_sq = 0, sad = 0;
+	for(pj_uint32_t i = 0; i < width; ++ i)
+	{
+		sum += cur[i];
+		sum_sq += cur[i] * cur[i];
+		sad += cur[i] > prev[i] ? cur[i] - prev[i] : prev[i] - cur[i];
+	}
+
+	sums[0] = sum;
+	sums[1] = sum_sq;
+	sums[2] = sad;
+}
+
+#ifdef KERNELS_X86
+// ÿ16, չ16λ, ֵ255 * 256 + 128
+static void blend_rows_sse2(pj_uint8_t *dst, const pj_uint8_t *a, const pj_uint8_t *b, pj_uint32_t width, pj_uint32_t f)
+{
+	const __m128i wa = _mm_set1_epi16((short)(256 - f));
+	const __m128i wb = _mm_set1_epi16((short)f);
+	const __m128i round = _mm_set1_epi16(128);
+	const __m128i zero = _mm_setzero_si128();
+
+	pj_uint32_t i = 0;
+	for(; i + 16 <= width; i += 16)
+	{
+		__m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+
+		__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa), _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+		__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa), _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+
+	blend_rows_c(dst + i, a + i, b + i, width - i, f);
+}
+
+/**
+ * ÿ8. SSE2ûgather, ÿԴp[0], p[1]ֽpinsrwһȡһ16λͨ,
+ * 0չÿ32λͨp[0] | p[1] << 16, (256 - f) | f << 16maddõֵ.
+ * ڱĴλƴ, ֮ǰC汾.
+ */
+#define PAIR(_i_) (*(const pj_uint16_t *)(src + (m[_i_] >> 8)))
+static void scale_row_sse2(pj_uint8_t *dst, const pj_uint8_t *src, const pj_uint32_t *xmap, pj_uint32_t width)
+{
+	const __m128i low8 = _mm_set1_epi32(0xff);
+	const __m128i full = _mm_set1_epi32(256);
+	const __m128i round = _mm_set1_epi32(128);
+	const __m128i zero = _mm_setzero_si128();
+
+	pj_uint32_t i = 0;
+	for(; i + 8 <= width; i += 8)
+	{
+		const pj_uint32_t *m = xmap + i;
+		__m128i pairs = _mm_cvtsi32_si128(PAIR(0));
+		pairs = _mm_insert_epi16(pairs, PAIR(1), 1);
+		pairs = _mm_insert_epi16(pairs, PAIR(2), 2);
+		pairs = _mm_insert_epi16(pairs, PAIR(3), 3);
+		pairs = _mm_insert_epi16(pairs, PAIR(4), 4);
+		pairs = _mm_insert_epi16(pairs, PAIR(5), 5);
+		pairs = _mm_insert_epi16(pairs, PAIR(6), 6);
+		pairs = _mm_insert_epi16(pairs, PAIR(7), 7);
+
+		__m128i f0 = _mm_and_si128(_mm_loadu_si128((const __m128i *)m), low8);
+		__m128i f1 = _mm_and_si128(_mm_loadu_si128((const __m128i *)(m + 4)), low8);
+		__m128i w0 = _mm_or_si128(_mm_sub_epi32(full, f0), _mm_slli_epi32(f0, 16));
+		__m128i w1 = _mm_or_si128(_mm_sub_epi32(full, f1), _mm_slli_epi32(f1, 16));
+
+		__m128i lo = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(pairs, zero), w0), round), 8);
+		__m128i hi = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi8(pairs, zero), w1), round), 8);
+
+		__m128i words = _mm_packs_epi32(lo, hi);
+		_mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(words, words));
+	}
+#undef PAIR
+
+	scale_row_c(dst + i, src, xmap + i, width - i);
+}
+
+static void accumulate_row_sse2(pj_uint16_t *acc, const pj_uint8_t *src, pj_uint32_t width)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	pj_uint32_t i = 0;
+	for(; i + 16 <= width; i += 16)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i lo = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(acc + i)), _mm_unpacklo_epi8(s, zero));
+		__m128i hi = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(acc + i + 8)), _mm_unpackhi_epi8(s, zero));
+
+		_mm_storeu_si128((__m128i *)(acc + i), lo);
+		_mm_storeu_si128((__m128i *)(acc + i + 8), hi);
+	}
+
+	accumulate_row_c(acc + i, src + i, width - i);
+}
+
+// 8صY(y * 0x0101)ѰչU/V(ȥ128), õB/G/R16λֵ
+static inline void yuv_to_rgb_sse2(__m128i y, __m128i u, __m128i v, __m128i &b, __m128i &g, __m128i &r)
+{
+	__m128i luma = _mm_sub_epi16(_mm_mulhi_epu16(y, _mm_set1_epi16((short)YUV_Y_MUL)), _mm_set1_epi16(YUV_Y_BIAS));
+
+	b = _mm_srai_epi16(_mm_adds_epi16(luma, _mm_mullo_epi16(u, _mm_set1_epi16(YUV_BU_MUL))), 6);
+	g = _mm_srai_epi16(_mm_sub_epi16(_mm_sub_epi16(luma, _mm_mullo_epi16(u, _mm_set1_epi16(YUV_GU_MUL))),
+		_mm_mullo_epi16(v, _mm_set1_epi16(YUV_GV_MUL))), 6);
+	r = _mm_srai_epi16(_mm_adds_epi16(luma, _mm_mullo_epi16(v, _mm_set1_epi16(YUV_RV_MUL))), 6);
+}
+
+// 16صB/G/Rֽڽ֯BGRAд
+static inline void store_bgra_sse2(pj_uint8_t *dst, __m128i b, __m128i g, __m128i r)
+{
+	const __m128i alpha = _mm_set1_epi8((char)0xff);
+
+	__m128i bg_lo = _mm_unpacklo_epi8(b, g);
+	__m128i bg_hi = _mm_unpackhi_epi8(b, g);
+	__m128i ra_lo = _mm_unpacklo_epi8(r, alpha);
+	__m128i ra_hi = _mm_unpackhi_epi8(r, alpha);
+
+	_mm_storeu_si128((__m128i *)(dst + 0), _mm_unpacklo_epi16(bg_lo, ra_lo));
+	_mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(bg_lo, ra_lo));
+	_mm_storeu_si128((__m128i *)(dst + 32), _mm_unpacklo_epi16(bg_hi, ra_hi));
+	_mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi16(bg_hi, ra_hi));
+}
+
+static void i420_to_bgra_row_sse2(pj_uint8_t *dst, const pj_uint8_t *y, const pj_uint8_t *u, const pj_uint8_t *v, pj_uint32_t width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+
+	pj_uint32_t i = 0;
+	for(; i + 16 <= width; i += 16)
+	{
+		__m128i vy = _mm_loadu_si128((const __m128i *)(y + i));
+		__m128i vu = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(u + i / 2)), zero), bias);
+		__m128i vv = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(v + i / 2)), zero), bias);
+
+		__m128i b_lo, g_lo, r_lo, b_hi, g_hi, r_hi;
+		yuv_to_rgb_sse2(_mm_unpacklo_epi8(vy, vy), _mm_unpacklo_epi16(vu, vu), _mm_unpacklo_epi16(vv, vv), b_lo, g_lo, r_lo);
+		yuv_to_rgb_sse2(_mm_unpackhi_epi8(vy, vy), _mm_unpackhi_epi16(vu, vu), _mm_unpackhi_epi16(vv, vv), b_hi, g_hi, r_hi);
+
+		store_bgra_sse2(dst + 4 * i, _mm_packus_epi16(b_lo, b_hi), _mm_packus_epi16(g_lo, g_hi), _mm_packus_epi16(r_lo, r_hi));
+	}
+
+	i420_to_bgra_row_c(dst + 4 * i, y + i, u + i / 2, v + i / 2, width - i);
+}
+
+static inline pj_uint32_t hsum_epi64_sse2(__m128i v)
+{
+	return (pj_uint32_t)_mm_cvtsi128_si32(_mm_add_epi32(v, _mm_srli_si128(v, 8)));
+}
+
+static inline pj_uint32_t hsum_epi32_sse2(__m128i v)
+{
+	v = _mm_add_epi32(v, _mm_srli_si128(v, 8));
+	return (pj_uint32_t)_mm_cvtsi128_si32(_mm_add_epi32(v, _mm_srli_si128(v, 4)));
+}
+
+// Բpsadbw, ƽpmaddwd; 32λͨ޷Żۼ, C汾Ľͬ
+static void luma_stats_row_sse2(const pj_uint8_t *cur, const pj_uint8_t *prev, pj_uint32_t width, pj_uint32_t sums[3])
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = zero, sum_sq = zero, sad = zero;
+
+	pj_uint32_t i = 0;
+	for(; i + 16 <= width; i += 16)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i *)(cur + i));
+		__m128i p = _mm_loadu_si128((const __m128i *)(prev + i));
+		__m128i lo = _mm_unpacklo_epi8(c, zero);
+		__m128i hi = _mm_unpackhi_epi8(c, zero);
+
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(c, zero));
+		sad = _mm_add_epi64(sad, _mm_sad_epu8(c, p));
+		sum_sq = _mm_add_epi32(sum_sq, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+	}
+
+	luma_stats_row_c(cur + i, prev + i, width - i, sums);
+	sums[0] += hsum_epi64_sse2(sum);
+	sums[1] += hsum_epi32_sse2(sum_sq);
+	sums[2] += hsum_epi64_sse2(sad);
+}
+
+// SSE2ͬ, ʹ128λͨڽ, ˳򲻱
+TARGET_AVX2 static void blend_rows_avx2(pj_uint8_t *dst, const pj_uint8_t *a, const pj_uint8_t *b, pj_uint32_t width, pj_uint32_t f)
+{
+	const __m256i wa = _mm256_set1_epi16((short)(256 - f));
+	const __m256i wb = _mm256_set1_epi16((short)f);
+	const __m256i round = _mm256_set1_epi16(128);
+	const __m256i zero = _mm256_setzero_si256();
+
+	pj_uint32_t i = 0;
+	for(; i + 32 <= width; i += 32)
+	{
+		__m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+
+		__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), wa), _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), wb));
+		__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), wa), _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), wb));
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+	}
+
+	blend_rows_sse2(dst + i, a + i, b + i, width - i, f);
+}
+
+TARGET_AVX2 static void accumulate_row_avx2(pj_uint16_t *acc, const pj_uint8_t *src, pj_uint32_t width)
+{
+	pj_uint32_t i = 0;
+	for(; i + 32 <= width; i += 32)
+	{
+		__m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + i)));
+		__m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + i + 16)));
+
+		_mm256_storeu_si256((__m256i *)(acc + i), _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(acc + i)), lo));
+		_mm256_storeu_si256((__m256i *)(acc + i + 16), _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(acc + i + 16)), hi));
+	}
+
+	accumulate_row_sse2(acc + i, src + i, width - i);
+}
+
+// 16һ, 128λ, ܿͨ
+TARGET_AVX2 static void i420_to_bgra_row_avx2(pj_uint8_t *dst, const pj_uint8_t *y, const pj_uint8_t *u, const pj_uint8_t *v, pj_uint32_t width)
+{
+	const __m128i bias = _mm_set1_epi16(128);
+
+	pj_uint32_t i = 0;
+	for(; i + 16 <= width; i += 16)
+	{
+		__m128i y8 = _mm_loadu_si128((const __m128i *)(y + i));
+		__m256i vy = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(y8, y8)), _mm_unpackhi_epi8(y8, y8), 1);
+		__m128i vu = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(u + i / 2))), bias);
+		__m128i vv = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(v + i / 2))), bias);
+		__m256i cb = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(vu, vu)), _mm_unpackhi_epi16(vu, vu), 1);
+		__m256i cr = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(vv, vv)), _mm_unpackhi_epi16(vv, vv), 1);
+
+		__m256i luma = _mm256_sub_epi16(_mm256_mulhi_epu16(vy, _mm256_set1_epi16((short)YUV_Y_MUL)), _mm256_set1_epi16(YUV_Y_BIAS));
+		__m256i b = _mm256_srai_epi16(_mm256_adds_epi16(luma, _mm256_mullo_epi16(cb, _mm256_set1_epi16(YUV_BU_MUL))), 6);
+		__m256i g = _mm256_srai_epi16(_mm256_sub_epi16(_mm256_sub_epi16(luma, _mm256_mullo_epi16(cb, _mm256_set1_epi16(YUV_GU_MUL))),
+			_mm256_mullo_epi16(cr, _mm256_set1_epi16(YUV_GV_MUL))), 6);
+		__m256i r = _mm256_srai_epi16(_mm256_adds_epi16(luma, _mm256_mullo_epi16(cr, _mm256_set1_epi16(YUV_RV_MUL))), 6);
+
+		store_bgra_sse2(dst + 4 * i,
+			_mm_packus_epi16(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1)),
+			_mm_packus_epi16(_mm256_castsi256_si128(g), _mm256_extracti128_si256(g, 1)),
+			_mm_packus_epi16(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1)));
+	}
+
+	i420_to_bgra_row_sse2(dst + 4 * i, y + i, u + i / 2, v + i / 2, width - i);
+}
+
+TARGET_AVX2 static void luma_stats_row_avx2(const pj_uint8_t *cur, const pj_uint8_t *prev, pj_uint32_t width, pj_uint32_t sums[3])
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i sum = zero, sum_sq = zero, sad = zero;
+
+	pj_uint32_t i = 0;
+	for(; i + 32 <= width; i += 32)
+	{
+		__m256i c = _mm256_loadu_si256((const __m256i *)(cur + i));
+		__m256i p = _mm256_loadu_si256((const __m256i *)(prev + i));
+		__m256i lo = _mm256_unpacklo_epi8(c, zero);
+		__m256i hi = _mm256_unpackhi_epi8(c, zero);
+
+		sum = _mm256_add_epi64(sum, _mm256_sad_epu8(c, zero));
+		sad = _mm256_add_epi64(sad, _mm256_sad_epu8(c, p));
+		sum_sq = _mm256_add_epi32(sum_sq, _mm256_add_epi32(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+	}
+
+	luma_stats_row_sse2(cur + i, prev + i, width - i, sums);
+	sums[0] += hsum_epi64_sse2(_mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)));
+	sums[1] += hsum_epi32_sse2(_mm_add_epi32(_mm256_castsi256_si128(sum_sq), _mm256_extracti128_si256(sum_sq, 1)));
+	sums[2] += hsum_epi64_sse2(_mm_add_epi64(_mm256_castsi256_si128(sad), _mm256_extracti128_si256(sad, 1)));
+}
+
+static pj_bool_t cpu_has_sse2()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return PJ_TRUE;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) ? PJ_TRUE : PJ_FALSE;
+#else
+	return __builtin_cpu_supports("sse2") ? PJ_TRUE : PJ_FALSE;
+#endif
+}
+
+static pj_bool_t cpu_has_avx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	RETURN_VAL_IF_FAIL(info[0] >= 7, PJ_FALSE);
+
+	// ҪϵͳYMMĴ
+	__cpuid(info, 1);
+	RETURN_VAL_IF_FAIL((info[2] & (1 << 27)) && (info[2] & (1 << 28)), PJ_FALSE);
+	RETURN_VAL_IF_FAIL((_xgetbv(0) & 6) == 6, PJ_FALSE);
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) ? PJ_TRUE : PJ_FALSE;
+#else
+	return __builtin_cpu_supports("avx2") ? PJ_TRUE : PJ_FALSE;
+#endif
+}
+#endif
+
+static const image_kernels_t kernels_c = {"c", blend_rows_c, accumulate_row_c, scale_row_c, i420_to_bgra_row_c, luma_stats_row_c};
+#ifdef KERNELS_X86
+static const image_kernels_t kernels_sse2 = {"sse2", blend_rows_sse2, accumulate_row_sse2, scale_row_sse2, i420_to_bgra_row_sse2, luma_stats_row_sse2};
+// vpgatherddڶCPUϱpinsrw, ˮƽSSE2汾
+static const image_kernels_t kernels_avx2 = {"avx2", blend_rows_avx2, accumulate_row_avx2, scale_row_sse2, i420_to_bgra_row_avx2, luma_stats_row_avx2};
+#endif
+
+const image_kernels_t *ImageKernels::active_ = &kernels_c;
+
+// Ŀiصӳ䵽Դ, 8λС; ּ֤һԴ
+pj_uint32_t PlaneScaler::MapCoord(pj_uint32_t i, pj_uint32_t src, pj_uint32_t dst)
+{
+	pj_int64_t pos = (pj_int64_t)(2 * i + 1) * src * 128 / dst - 128;
+	if(pos < 0)
+	{
+		pos = 0;
+	}
+
+	pj_uint32_t s = (pj_uint32_t)(pos >> 8);
+	pj_uint32_t f = (pj_uint32_t)(pos & 0xff);
+	if(s + 1 >= src)
+	{
+		s = src - 2;
+		f = 0xff;
+	}
+
+	return (s << 8) | f;
+}
+
+PlaneScaler::PlaneScaler()
+{
+	Reset();
+}
+
+void PlaneScaler::Reset()
+{
+	src_w_ = src_h_ = dst_w_ = dst_h_ = 0;
+	area_ = PJ_FALSE;
+}
+
+void PlaneScaler::Prepare(pj_uint32_t src_w, pj_uint32_t src_h, pj_uint32_t dst_w, pj_uint32_t dst_h)
+{
+	RETURN_IF_FAIL(src_w != src_w_ || src_h != src_h_ || dst_w != dst_w_ || dst_h != dst_h_);
+
+	src_w_ = src_w;
+	src_h_ = src_h;
+	dst_w_ = dst_w;
+	dst_h_ = dst_h;
+
+	// ۼΪ16λ, һĿา256Դ
+	area_ = src_w >= KERNEL_AREA_RATIO * dst_w && src_h >= KERNEL_AREA_RATIO * dst_h && src_h <= 256 * dst_h ? PJ_TRUE : PJ_FALSE;
+	if(area_)
+	{
+		xmap_.resize(dst_w + 1);
+		for(pj_uint32_t i = 0; i <= dst_w; ++ i)
+		{
+			xmap_[i] = (pj_uint32_t)((pj_uint64_t)i * src_w / dst_w);
+		}
+		acc_.resize(src_w);
+	}
+	else
+	{
+		xmap_.resize(dst_w);
+		for(pj_uint32_t i = 0; i < dst_w; ++ i)
+		{
+			xmap_[i] = MapCoord(i, src_w, dst_w);
+		}
+		rows_.resize(2 * dst_w);
+	}
+}
+
+void PlaneScaler::Scale(const pj_uint8_t *src, pj_int32_t src_pitch, pj_uint32_t src_w, pj_uint32_t src_h,
+						pj_uint8_t *dst, pj_int32_t dst_pitch, pj_uint32_t dst_w, pj_uint32_t dst_h)
+{
+	RETURN_IF_FAIL(dst_w > 0 && dst_h > 0);
+
+	if(src_w == dst_w && src_h == dst_h)
+	{
+		ImageKernels::CopyPlane(src, src_pitch, dst, dst_pitch, dst_w, dst_h);
+		return;
+	}
+
+	RETURN_IF_FAIL(src_w >= 2 && src_h >= 2);
+
+	Prepare(src_w, src_h, dst_w, dst_h);
+	if(area_)
+	{
+		Area(src, src_pitch, dst, dst_pitch);
+	}
+	else
+	{
+		Bilinear(src, src_pitch, dst, dst_pitch);
+	}
+}
+
+// ÿԴֻˮƽһ, ; ˮƽʹֱֵSIMDں
+void PlaneScaler::Bilinear(const pj_uint8_t *src, pj_int32_t src_pitch, pj_uint8_t *dst, pj_int32_t dst_pitch)
+{
+	const image_kernels_t &kernels = ImageKernels::Get();
+
+	pj_uint8_t *row[2] = {&rows_[0], &rows_[0] + dst_w_};
+	pj_int32_t cached[2] = {-1, -1};
+	for(pj_uint32_t y = 0; y < dst_h_; ++ y)
+	{
+		pj_uint32_t pos = MapCoord(y, src_h_, dst_h_);
+		pj_int32_t sy = (pj_int32_t)(pos >> 8);
+
+		if(cached[0] != sy && cached[1] == sy)
+		{
+			std::swap(row[0], row[1]);
+			std::swap(cached[0], cached[1]);
+		}
+		if(cached[0] != sy)
+		{
+			kernels.scale_row_(row[0], src + sy * src_pitch, &xmap_[0], dst_w_);
+			cached[0] = sy;
+		}
+		if(cached[1] != sy + 1)
+		{
+			kernels.scale_row_(row[1], src + (sy + 1) * src_pitch, &xmap_[0], dst_w_);
+			cached[1] = sy + 1;
+		}
+
+		kernels.blend_rows_(dst + y * dst_pitch, row[0], row[1], dst_w_, pos & 0xff);
+	}
+}
+
+// ÿĿȡǵԴεƽֵ. SIMDۼԴ, ˮƽ
+void PlaneScaler::Area(const pj_uint8_t *src, pj_int32_t src_pitch, pj_uint8_t *dst, pj_int32_t dst_pitch)
+{
+	const image_kernels_t &kernels = ImageKernels::Get();
+
+	for(pj_uint32_t y = 0; y < dst_h_; ++ y)
+	{
+		pj_uint32_t y0 = (pj_uint32_t)((pj_uint64_t)y * src_h_ / dst_h_);
+		pj_uint32_t y1 = (pj_uint32_t)((pj_uint64_t)(y + 1) * src_h_ / dst_h_);
+
+		pj_bzero(&acc_[0], src_w_ * sizeof(pj_uint16_t));
+		for(pj_uint32_t sy = y0; sy < y1; ++ sy)
+		{
+			kernels.accumulate_row_(&acc_[0], src + sy * src_pitch, src_w_);
+		}
+
+		pj_uint8_t *out = dst + y * dst_pitch;
+		for(pj_uint32_t x = 0; x < dst_w_; ++ x)
+		{
+			pj_uint32_t sum = 0;
+			for(pj_uint32_t sx = xmap_[x]; sx < xmap_[x + 1]; ++ sx)
+			{
+				sum += acc_[sx];
+			}
+
+			pj_uint32_t count = (y1 - y0) * (xmap_[x + 1] - xmap_[x]);
+			out[x] = (pj_uint8_t)((sum + count / 2) / count);
+		}
+	}
+}
+
+void ImageKernels::CopyPlane(const pj_uint8_t *src, pj_int32_t src_pitch, pj_uint8_t *dst, pj_int32_t dst_pitch,
+							 pj_uint32_t width, pj_uint32_t height)
+{
+	if(src_pitch == dst_pitch && (pj_uint32_t)src_pitch == width)
+	{
+		pj_memcpy(dst, src, width * height);
+		return;
+	}
+
+	for(pj_uint32_t y = 0; y < height; ++ y)
+	{
+		pj_memcpy(dst + y * dst_pitch, src + y * src_pitch, width);
+	}
+}
+
+void ImageKernels::FillPlane(pj_uint8_t *dst, pj_int32_t dst_pitch, pj_uint32_t width, pj_uint32_t height, pj_uint8_t value)
+{
+	if((pj_uint32_t)dst_pitch == width)
+	{
+		pj_memset(dst, value, width * height);
+		return;
+	}
+
+	for(pj_uint32_t y = 0; y < height; ++ y)
+	{
+		pj_memset(dst + y * dst_pitch, value, width);
+	}
+}
+
+// dstΪwidth * heightBGRA, ڽͼҪRGBĳ
+void ImageKernels::I420ToBgra(const pj_uint8_t *const planes[3], const pj_int32_t pitches[3], pj_uint32_t width, pj_uint32_t height,
+							  pj_uint8_t *dst, pj_int32_t dst_pitch)
+{
+	const image_kernels_t &kernels = Get();
+	for(pj_uint32_t y = 0; y < height; ++ y)
+	{
+		kernels.i420_to_bgra_row_(dst + y * dst_pitch, planes[0] + y * pitches[0],
+			planes[1] + y / 2 * pitches[1], planes[2] + y / 2 * pitches[2], width);
+	}
+}
+
+const image_kernels_t *ImageKernels::Table(kernel_isa_t isa)
+{
+	switch(isa)
+	{
+	case KERNEL_ISA_C:
+		return &kernels_c;
+#ifdef KERNELS_X86
+	case KERNEL_ISA_SSE2:
+		return cpu_has_sse2() ? &kernels_sse2 : nullptr;
+	case KERNEL_ISA_AVX2:
+		return cpu_has_sse2() && cpu_has_avx2() ? &kernels_avx2 : nullptr;
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+void ImageKernels::Init(const pj_str_t &isa)
+{
+	static const char *names[KERNEL_ISA_COUNT] = {"c", "sse2", "avx2"};
+
+	kernel_isa_t wanted = KERNEL_ISA_COUNT;
+	for(pj_uint32_t i = 0; i < KERNEL_ISA_COUNT; ++ i)
+	{
+		pj_str_t name = pj_str((char *)names[i]);
+		if(pj_stricmp(&isa, &name) == 0)
+		{
+			wanted = (kernel_isa_t)i;
+		}
+	}
+
+	const image_kernels_t *best = &kernels_c;
+	for(pj_uint32_t i = 0; i < KERNEL_ISA_COUNT; ++ i)
+	{
+		const image_kernels_t *kernels = Table((kernel_isa_t)i);
+		if(kernels != nullptr && i <= (pj_uint32_t)wanted)
+		{
+			best = kernels;
+		}
+	}
+
+	active_ = best;
+
+	PJ_LOG(4, (__ABS_FILE__, "Init() => image kernels[%s] requested[%.*s]", active_->name_, (int)isa.slen, isa.ptr));
+}
@@ -0,0 +1,92 @@
+#ifndef __AVS_PROXY_CLIENT_IMAGE_KERNELS__
+#define __AVS_PROXY_CLIENT_IMAGE_KERNELS__
+
+#include <vector>
+
+#include "Com.h"
+
+using std::vector;
+
+#define KERNEL_AREA_RATIO       2       // С1/2ʱƽ, ˫
+
+typedef enum
+{
+	KERNEL_ISA_C = 0,
+	KERNEL_ISA_SSE2,
+	KERNEL_ISA_AVX2,
+	KERNEL_ISA_COUNT,
+} kernel_isa_t;
+
+// Ҫָɵں, ָĽC汾ֽͬ
+typedef struct
+{
+	const char *name_;
+	// dst = (a * (256 - f) + b * f + 128) >> 8, fΪ0~255
+	void (*blend_rows_)(pj_uint8_t *dst, const pj_uint8_t *a, const pj_uint8_t *b, pj_uint32_t width, pj_uint32_t f);
+	// acc += src
+	void (*accumulate_row_)(pj_uint16_t *acc, const pj_uint8_t *src, pj_uint32_t width);
+	// ˫Եˮƽ: xmapΪÿĿе(Դ << 8) | Ȩ, Դмһ
+	void (*scale_row_)(pj_uint8_t *dst, const pj_uint8_t *src, const pj_uint32_t *xmap, pj_uint32_t width);
+	// BT.601޷Χ, 6λ; u/vΪˮƽɫ
+	void (*i420_to_bgra_row_)(pj_uint8_t *dst, const pj_uint8_t *y, const pj_uint8_t *u, const pj_uint8_t *v, pj_uint32_t width);
+	// sums[0]Ϊcur֮, sums[1]Ϊcurƽ, sums[2]Ϊ|cur - prev|֮; width65536, 
+	void (*luma_stats_row_)(const pj_uint8_t *cur, const pj_uint8_t *prev, pj_uint32_t width, pj_uint32_t sums[3]);
+} image_kernels_t;
+
+/**
+ * һƽ, 水ԴĿߴ罨õӳ, ߴ粻ʱظʹ.
+ * Сһƽ, ˫ֻȡɵ˸;; ˫; ߴͬʱֱӿ.
+ * ̰߳ȫ, ÿʹ߸һ.
+ */
+class PlaneScaler
+{
+public:
+	PlaneScaler();
+
+	void Reset();
+	void Scale(const pj_uint8_t *src, pj_int32_t src_pitch, pj_uint32_t src_w, pj_uint32_t src_h,
+		pj_uint8_t *dst, pj_int32_t dst_pitch, pj_uint32_t dst_w, pj_uint32_t dst_h);
+
+	// ˫ӳһ: (Դ << 8) | Ȩ
+	static pj_uint32_t MapCoord(pj_uint32_t i, pj_uint32_t src, pj_uint32_t dst);
+
+private:
+	void Prepare(pj_uint32_t src_w, pj_uint32_t src_h, pj_uint32_t dst_w, pj_uint32_t dst_h);
+	void Bilinear(const pj_uint8_t *src, pj_int32_t src_pitch, pj_uint8_t *dst, pj_int32_t dst_pitch);
+	void Area(const pj_uint8_t *src, pj_int32_t src_pitch, pj_uint8_t *dst, pj_int32_t dst_pitch);
+
+	pj_uint32_t         src_w_;
+	pj_uint32_t         src_h_;
+	pj_uint32_t         dst_w_;
+	pj_uint32_t         dst_h_;
+	pj_bool_t           area_;
+	vector<pj_uint32_t> xmap_;      // ˫: ÿĿе(Դ << 8) | Ȩ; : ÿĿеԴ, dst_w_ + 1
+	vector<pj_uint8_t>  rows_;      // ˫: ˮƽź
+	vector<pj_uint16_t> acc_;       // : һĿиǵԴаۼ
+};
+
+/**
+ * ͼں˿. Init()CPUѡָ, Init()֮ǰʹC汾.
+ * ָC汾ֽڱȶԺ²Monitor/Benchkernel_testkernel_bench.
+ * 䰴еCRTmemcpy/memset, ѰCPU, ٷ.
+ */
+class ImageKernels
+{
+public:
+	// isaΪclient.xmlеimage_kernels, ΪʱԶѡ
+	static void Init(const pj_str_t &isa);
+	static const image_kernels_t &Get() { return *active_; }
+	// CPUֵָ֧nullptr
+	static const image_kernels_t *Table(kernel_isa_t isa);
+
+	static void CopyPlane(const pj_uint8_t *src, pj_int32_t src_pitch, pj_uint8_t *dst, pj_int32_t dst_pitch,
+		pj_uint32_t width, pj_uint32_t height);
+	static void FillPlane(pj_uint8_t *dst, pj_int32_t dst_pitch, pj_uint32_t width, pj_uint32_t height, pj_uint8_t value);
+	static void I420ToBgra(const pj_uint8_t *const planes[3], const pj_int32_t pitches[3], pj_uint32_t width, pj_uint32_t height,
+		pj_uint8_t *dst, pj_int32_t dst_pitch);
+
+private:
+	static const image_kernels_t *active_;
+};
+
+#endif
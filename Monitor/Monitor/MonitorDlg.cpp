@@ -68,6 +68,39 @@ static pj_status_t init_param()
 	g_client_config.rrtvms_fcgi_host = pj_str(strdup((char *)client.attribute("rrtvms_fcgi_host").value()));
 	g_client_config.rrtvms_fcgi_port = atoi(client.attribute("rrtvms_fcgi_port").value());
 	g_client_config.rrtvms_fcgi_uri = pj_str(strdup((char *)client.attribute("rrtvms_fcgi_uri").value()));
+	g_client_config.resume_enable = atoi(client.attribute("resume_enable").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.resume_max_retries = atoi(client.attribute("resume_max_retries").value());
+	g_client_config.resume_retry_interval = atoi(client.attribute("resume_retry_interval").value());
+	g_client_config.snapshot_file_name = pj_str(strdup((char *)client.attribute("snapshot_file_name").value()));
+	g_client_config.prefetch_pages = atoi(client.attribute("prefetch_pages").value());
+	g_client_config.gop_cache_size = atoi(client.attribute("gop_cache_size").value());
+	g_client_config.max_decoders = atoi(client.attribute("max_decoders").value());
+	g_client_config.video_decoder = pj_str(strdup((char *)client.attribute("video_decoder").value()));
+	g_client_config.decoder_threads = atoi(client.attribute("decoder_threads").value());
+	g_client_config.decoder_thread_type = pj_str(strdup((char *)client.attribute("decoder_thread_type").value()));
+	g_client_config.decoder_skip_frame = pj_str(strdup((char *)client.attribute("decoder_skip_frame").value()));
+	g_client_config.decoder_fast = atoi(client.attribute("decoder_fast").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.rtcp_enable = atoi(client.attribute("rtcp_enable").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.rtcp_interval = atoi(client.attribute("rtcp_interval").value());
+	g_client_config.nack_interval = atoi(client.attribute("nack_interval").value());
+	g_client_config.health_enable = atoi(client.attribute("health_enable").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.health_timeout = atoi(client.attribute("health_timeout").value());
+	g_client_config.compositor = pj_str(strdup((char *)client.attribute("compositor").value()));
+	g_client_config.low_latency = atoi(client.attribute("low_latency").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.playout_max_delay = atoi(client.attribute("playout_max_delay").value());
+	g_client_config.image_kernels = pj_str(strdup((char *)client.attribute("image_kernels").value()));
+	g_client_config.letterbox = atoi(client.attribute("letterbox").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.analytics_enable = atoi(client.attribute("analytics_enable").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.freeze_timeout = atoi(client.attribute("freeze_timeout").value());
+	g_client_config.black_timeout = atoi(client.attribute("black_timeout").value());
+	g_client_config.low_motion_timeout = atoi(client.attribute("low_motion_timeout").value());
+	g_client_config.audio_enable = atoi(client.attribute("audio_enable").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.audio_mix = MAX(atoi(client.attribute("audio_mix").value()), 1);
+	g_client_config.speaker_enable = atoi(client.attribute("speaker_enable").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.audio_level_ext_id = atoi(client.attribute("audio_level_ext_id").value());
+	g_client_config.av_sync = atoi(client.attribute("av_sync").value()) != 0 ? PJ_TRUE : PJ_FALSE;
+	g_client_config.record_path = pj_str(strdup((char *)client.attribute("record_path").value()));
+	g_client_config.record_format = pj_str(strdup((char *)client.attribute("record_format").value()));
 
 	return PJ_SUCCESS;
 }
@@ -252,6 +285,14 @@ BOOL CMonitorDlg::PreTranslateMessage(MSG *pMsg)
 			{
 				g_watchs_list.NextPage();
 			}
+			else if(pMsg->wParam == VK_UP)
+			{
+				g_watchs_list.ActivePage();
+			}
+			else if(pMsg->wParam == VK_DOWN)
+			{
+				g_watchs_list.SpeakerPage();
+			}
 			else if(pMsg->wParam == VK_RETURN)
 			{
 				sinashow::SendMessage(WM_CHANGE_LAYOUT, (WPARAM)0, (LPARAM)0);
@@ -375,7 +416,7 @@ LRESULT CMonitorDlg::OnLinkScreenUser(WPARAM wParam, LPARAM lParam)
 	pj_uint32_t screen_idx = (pj_uint32_t)lParam;
 	RETURN_VAL_IF_FAIL((screen_idx != INVALID_SCREEN_INDEX && draging_user_ && is_draging_), true);
 
-	g_screen_mgr->LinkScreenUser(screen_idx, draging_user_);
+	g_screen_mgr->LinkScreenUser(screen_idx, draging_user_, (pj_bool_t)wParam);
 
 	is_draging_ = PJ_FALSE;
 	draging_user_ = nullptr;
@@ -389,7 +430,18 @@ LRESULT CMonitorDlg::OnWatchRoomUser(WPARAM wParam, LPARAM lParam)
 	pj_uint32_t screen_idx = (pj_uint32_t)lParam;
 	RETURN_VAL_IF_FAIL(user && screen_idx != INVALID_SCREEN_INDEX, true);
 
-	g_screen_mgr->LinkScreenUser(screen_idx, user);
+	g_screen_mgr->LinkScreenUser(screen_idx, user, PJ_FALSE);
+
+	return true;
+}
+
+LRESULT CMonitorDlg::OnShowPage(WPARAM wParam, LPARAM lParam)
+{
+	watch_page_t *page = reinterpret_cast<watch_page_t *>(wParam);
+	RETURN_VAL_IF_FAIL(page != nullptr, true);
+
+	g_screen_mgr->ShowPage(*page);
+	delete page;
 
 	return true;
 }
@@ -464,6 +516,9 @@ void CMonitorDlg::EventOnPipe(evutil_socket_t fd, short event, void *arg)
 		case WM_WATCH_ROOM_USER:
 			OnWatchRoomUser(param.wParam, param.lParam);
 			break;
+		case WM_SHOW_PAGE:
+			OnShowPage(param.wParam, param.lParam);
+			break;
 		case WM_LINK_ROOM_USER:
 			OnLinkScreenUser(param.wParam, param.lParam);
 			break;
@@ -476,6 +531,9 @@ void CMonitorDlg::EventOnPipe(evutil_socket_t fd, short event, void *arg)
 		case WM_SHRINKEDROOM:
 			OnUnlinkRoom(param.wParam, param.lParam);
 			break;
+		case WM_RELINK_ROOM:
+			g_screen_mgr->OnRelinkRoom(reinterpret_cast<TitleRoom *>(param.lParam), (pj_uint16_t)param.wParam);
+			break;
 		case WM_DISCONNECT_ALL_PROXYS:
 			OnDisconnectAllProxys(param.wParam, param.lParam);
 			break;
@@ -488,6 +546,14 @@ void CMonitorDlg::EventOnPipe(evutil_socket_t fd, short event, void *arg)
 		case WM_CHANGE_LAYOUT:
 			OnChangeLayout(param.wParam, param.lParam);
 			break;
+		case WM_DIRECTORY_REFRESHED:
+			{
+				// 64λĽڵŲWin32LPARAM, ɷͷnewָ봫
+				node_handle_t *phandle = reinterpret_cast<node_handle_t *>(param.lParam);
+				g_screen_mgr->OnDirectoryRefreshed((CTreeCtrl *)param.wParam, phandle != nullptr ? *phandle : INVALID_NODE_HANDLE);
+				delete phandle;
+			}
+			break;
 		default:
 			break;
 	}
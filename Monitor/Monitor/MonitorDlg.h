@@ -41,6 +41,7 @@ protected:
 	afx_msg LRESULT OnSelectUser(WPARAM wParam, LPARAM lParam);
 	afx_msg LRESULT OnLinkScreenUser(WPARAM wParam, LPARAM lParam);
 	afx_msg LRESULT OnWatchRoomUser(WPARAM wParam, LPARAM lParam);
+	afx_msg LRESULT OnShowPage(WPARAM wParam, LPARAM lParam);
 	afx_msg LRESULT OnUnlinkScreenUser(WPARAM wParam, LPARAM lParam);
 	afx_msg LRESULT OnLinkRoom(WPARAM wParam, LPARAM lParam);
 	afx_msg LRESULT OnUnlinkRoom(WPARAM wParam, LPARAM lParam);
@@ -1,45 +1,49 @@
 #include "stdafx.h"
+#include <algorithm>
+
 #include "Node.h"
 
-Node::Node(pj_int32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount, pj_uint8_t node_type)
-	: tree_item_(nullptr)
+Node::Node(NodeArena *arena, pj_int32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount, pj_uint8_t node_type)
+	: arena_(arena)
+	, handle_(INVALID_NODE_HANDLE)
+	, tree_item_(nullptr)
 	, id_(id)
-	, name_(pj_str(strdup(name.ptr)))
+	, name_(arena->Intern(name))
 	, order_(order)
 	, usercount_(usercount)
 	, nodes_()
-	, nodes_order_()
+	, nodes_index_()
 	, node_type_(node_type)
 {
+	handle_ = arena_->Attach(this);
 }
 
 Node::~Node()
 {
-	if(name_.ptr != nullptr)
-	{
-		free(name_.ptr);
-		name_.ptr = nullptr;
-	}
+	arena_->Detach(handle_);
+	handle_ = INVALID_NODE_HANDLE;
 }
 
-void Node::Update(const pj_str_t &name, order_t order, pj_uint32_t usercount)
+// PJ_TRUEʾorder_仯, Ҫڵ
+pj_bool_t Node::Update(const pj_str_t &name, order_t order, pj_uint32_t usercount)
 {
-	if(name_.ptr != nullptr)
+	pj_bool_t reorder = order_ != order ? PJ_TRUE : PJ_FALSE;
+
+	if(pj_strcmp(&name_, &name) != 0)
 	{
-		free(name_.ptr);
-		name_.ptr = nullptr;
+		name_ = arena_->Intern(name);
 	}
-
-	name_      = pj_str(strdup(name.ptr));
 	order_     = order;
 	usercount_ = usercount;
+
+	return reorder;
 }
 
 void Node::AddNull(CTreeCtrl &tree_ctrl)
 {
 	TVINSERTSTRUCT tvInsert;
 	tvInsert.hParent = tree_item_;
-	tvInsert.item.lParam = (LPARAM)0;
+	tvInsert.item.lParam = (LPARAM)INVALID_NODE_HANDLE;
 	tvInsert.item.pszText = _T("");
 	tvInsert.item.mask = LVIF_TEXT | TVIF_PARAM;
 
@@ -57,28 +61,28 @@ void Node::DelAll(CTreeCtrl &tree_ctrl)
 		tree_ctrl.DeleteItem(node);
 	}
 
-	for(node_map_t::iterator pnode = nodes_.begin();
+	for(node_vec_t::iterator pnode = nodes_.begin();
 		pnode != nodes_.end();
 		++ pnode)
 	{
-		node_map_t::mapped_type node = pnode->second;
+		node_vec_t::value_type node = *pnode;
 		if(node != nullptr)
 		{
-			delete node;
+			arena_->Destroy(node);
 			node = nullptr;
 		}
 	}
 
 	nodes_.clear();
-	nodes_order_.clear();
+	nodes_index_.clear();
 }
 
 pj_bool_t Node::GetNodeOrRoom(pj_int32_t id, Node *&node)
 {
-	node_map_t::iterator pnode = nodes_.find(id);
-	if(pnode != nodes_.end())
+	node_index_t::iterator pindex = nodes_index_.find(id);
+	if(pindex != nodes_index_.end())
 	{
-		node = pnode->second;
+		node = nodes_[pindex->second];
 		return PJ_TRUE;
 	}
 	else
@@ -95,39 +99,115 @@ void Node::AddNodeOrRoom(pj_int32_t id,
 	WCHAR gb_buf[128] = {0};
 	UTF8_to_GB2312(gb_buf, sizeof(gb_buf), node->name_);
 
-	nodes_.insert(node_map_t::value_type(id, node));
+	node_vec_t::iterator pnode = std::upper_bound(nodes_.begin(), nodes_.end(), node, order_cmp<Node>());
+	pj_uint32_t pos = pnode - nodes_.begin();
 
 	TVINSERTSTRUCT tvInsert;
 	tvInsert.hParent = tree_item_;
-	tvInsert.hInsertAfter = tree_ctrl.GetNextItem(node->tree_item_, TVGN_NEXT);
-	tvInsert.item.lParam = (LPARAM)node;
+	tvInsert.hInsertAfter = pos > 0 ? nodes_[pos - 1]->tree_item_ : TVI_FIRST;
+	tvInsert.item.lParam = (LPARAM)NODE_HANDLE_INDEX(node->handle_);
 	tvInsert.item.pszText = gb_buf;
 	tvInsert.item.mask = LVIF_TEXT | TVIF_PARAM;
 
 	node->tree_item_ = tree_ctrl.InsertItem(&tvInsert);
 
 	tvInsert.hParent = node->tree_item_;
+	tvInsert.hInsertAfter = TVI_LAST;
 	tvInsert.item.pszText = _T("");
-	tvInsert.item.lParam = (LPARAM)0;
+	tvInsert.item.lParam = (LPARAM)INVALID_NODE_HANDLE;
 	tvInsert.item.mask = LVIF_TEXT | TVIF_PARAM;
 
 	tree_ctrl.InsertItem(&tvInsert);
 
-	nodes_order_.insert(node);
+	nodes_.insert(pnode, node);
+	ReindexNodes(pos);
 }
 
 void Node::DelNodeOrRoom(pj_int32_t id, CTreeCtrl &tree_ctrl)
 {
-	node_map_t::iterator pnode = nodes_.find(id);
-	RETURN_IF_FAIL(pnode != nodes_.end());
+	node_index_t::iterator pindex = nodes_index_.find(id);
+	RETURN_IF_FAIL(pindex != nodes_index_.end());
 
-	node_map_t::mapped_type node = pnode->second;
+	pj_uint32_t pos = pindex->second;
+	node_vec_t::value_type node = nodes_[pos];
 	pj_assert(node);
-	nodes_.erase(pnode);
+	nodes_index_.erase(pindex);
+	nodes_.erase(nodes_.begin() + pos);
+	ReindexNodes(pos);
 
 	tree_ctrl.DeleteItem(node->tree_item_);
 
-	delete node;
+	arena_->Destroy(node);
 	node = nullptr;
 }
 
+// ٴε㿪"ĳ"/"ĳ", ܻߵķߴ.
+void Node::KickoutRedundantNodes(const set<pj_int32_t> &nodes_id, CTreeCtrl &tree_ctrl)
+{
+	pj_uint32_t kept = 0;
+	for(pj_uint32_t i = 0; i < nodes_.size(); ++ i)
+	{
+		node_vec_t::value_type node = nodes_[i];
+		if(nodes_id.find(node->id_) == nodes_id.end())
+		{
+			nodes_index_.erase(node->id_);
+			node->OnDestory(); // ߷ߴ
+			tree_ctrl.DeleteItem(node->tree_item_);
+			arena_->Destroy(node);
+			node = nullptr;
+		}
+		else
+		{
+			nodes_[kept ++] = node;
+		}
+	}
+
+	RETURN_IF_FAIL(kept < nodes_.size());
+
+	nodes_.resize(kept);
+	ReindexNodes(0);
+}
+
+// ӽڵorder_б仯, ؼеͬ˳
+void Node::SortNodes(CTreeCtrl &tree_ctrl)
+{
+	std::sort(nodes_.begin(), nodes_.end(), order_cmp<Node>());
+	ReindexNodes(0);
+
+	TVSORTCB sort;
+	sort.hParent = tree_item_;
+	sort.lpfnCompare = &Node::CompareItems;
+	sort.lParamSort = (LPARAM)this;
+	tree_ctrl.SortChildrenCB(&sort);
+}
+
+// ӽڵnodes_е±Ƚ, ռλĿ
+int CALLBACK Node::CompareItems(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+{
+	Node *parent = reinterpret_cast<Node *>(lParamSort);
+
+	pj_uint32_t pos[2] = {(pj_uint32_t)-1, (pj_uint32_t)-1};
+	LPARAM params[2] = {lParam1, lParam2};
+	for(pj_uint32_t i = 0; i < 2; ++ i)
+	{
+		Node *node = parent->arena_->Lookup((pj_uint32_t)params[i]);
+		if(node != nullptr)
+		{
+			node_index_t::const_iterator pindex = parent->nodes_index_.find(node->id_);
+			if(pindex != parent->nodes_index_.end())
+			{
+				pos[i] = pindex->second;
+			}
+		}
+	}
+
+	return pos[0] < pos[1] ? -1 : (pos[0] > pos[1] ? 1 : 0);
+}
+
+void Node::ReindexNodes(pj_uint32_t first)
+{
+	for(pj_uint32_t i = first; i < nodes_.size(); ++ i)
+	{
+		nodes_index_[nodes_[i]->id_] = i;
+	}
+}
@@ -2,8 +2,10 @@
 #define __AVS_PROXY_CLIENT_NODE__
 
 #include <stack>
+#include <unordered_map>
 
 #include "pugixml.hpp"
+#include "NodeArena.h"
 #include "Config.h"
 #include "Com.h"
 
@@ -18,15 +20,15 @@ enum __enum_node_tpye__
 using std::stack;
 
 class Node;
-typedef map<pj_int32_t, Node *> node_map_t;
-typedef set<Node *, order_cmp<Node>> node_set_t;
+typedef vector<Node *> node_vec_t;                             // order_cmp
+typedef std::unordered_map<pj_int32_t, pj_uint32_t> node_index_t; // id -> nodes_е±
 class Node
 {
 public:
-	Node(pj_int32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount, pj_uint8_t node_type);
+	Node(NodeArena *arena, pj_int32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount, pj_uint8_t node_type);
 	virtual ~Node();
 
-	void Update(const pj_str_t &name, order_t order, pj_uint32_t usercount);
+	virtual pj_bool_t Update(const pj_str_t &name, order_t order, pj_uint32_t usercount);
 	virtual void OnDestory() {}
 	virtual void OnWatched(void *ctrl) {}
 	virtual void OnItemExpanded(CTreeCtrl &tree_ctrl) {}
@@ -39,15 +41,21 @@ protected:
 	virtual void      AddNodeOrRoom(pj_int32_t id, Node *node, CTreeCtrl &tree_ctrl);
 	virtual void      DelNodeOrRoom(pj_int32_t id, CTreeCtrl &tree_ctrl);
 	virtual void      ParseXML(const vector<pj_uint8_t> &xml) {}
+	void              KickoutRedundantNodes(const set<pj_int32_t> &nodes_id, CTreeCtrl &tree_ctrl);
+	void              SortNodes(CTreeCtrl &tree_ctrl);
+	void              ReindexNodes(pj_uint32_t first);
+	static int CALLBACK CompareItems(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
 
 public:
-	HTREEITEM   tree_item_;
-	pj_int32_t  id_;
-	pj_str_t    name_;
-	order_t     order_;
-	pj_uint32_t usercount_;
-	node_map_t  nodes_;
-	node_set_t  nodes_order_;
+	NodeArena    *arena_;
+	node_handle_t handle_;
+	HTREEITEM     tree_item_;
+	pj_int32_t    id_;
+	pj_str_t      name_;
+	order_t       order_;
+	pj_uint32_t   usercount_;
+	node_vec_t    nodes_;
+	node_index_t  nodes_index_;
 	const pj_uint8_t node_type_;
 };
 
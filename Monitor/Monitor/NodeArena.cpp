@@ -0,0 +1,162 @@
+#include "stdafx.h"
+#include "NodeArena.h"
+#include "Node.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "NodeArena.cpp"
+
+#define ARENA_POOL_SIZE      (16 * 1024)
+#define ARENA_POOL_INCREMENT (16 * 1024)
+#define ARENA_ALIGN(size)    (((size) + 7) & ~((pj_size_t)7))
+#define ARENA_MAX_SLOTS      0x7FFFFFFF
+
+NodeArena::NodeArena(pj_pool_factory *factory, const char *name)
+	: arena_lock_()
+	, pool_(nullptr)
+	, strings_(nullptr)
+	, slots_(1, nullptr)          // 0ŲλINVALID_NODE_HANDLE
+	, generations_(1, 0)
+	, free_slots_()
+	, free_blocks_()
+{
+	pool_ = pj_pool_create(factory, name, ARENA_POOL_SIZE, ARENA_POOL_INCREMENT, NULL);
+	pj_assert(pool_ != nullptr);
+
+	strings_ = pj_hash_create(pool_, 1024);
+	pj_assert(strings_ != nullptr);
+}
+
+NodeArena::~NodeArena()
+{
+	if(pool_ != nullptr)
+	{
+		pj_pool_release(pool_);
+		pool_ = nullptr;
+	}
+}
+
+void *NodeArena::Alloc(pj_size_t size)
+{
+	lock_guard<mutex> lock(arena_lock_);
+
+	size = ARENA_ALIGN(MAX(size, sizeof(void *)));
+
+	free_blocks_t::iterator pblock = free_blocks_.find(size);
+	if(pblock != free_blocks_.end() && pblock->second != nullptr)
+	{
+		void *ptr = pblock->second;
+		pblock->second = *reinterpret_cast<void **>(ptr);
+		return ptr;
+	}
+
+	arena_block_t *block = reinterpret_cast<arena_block_t *>(pj_pool_alloc(pool_, sizeof(arena_block_t) + size));
+	RETURN_VAL_IF_FAIL(block != nullptr, nullptr);
+
+	block->size = size;
+	block->reserved = 0;
+
+	return block + 1;
+}
+
+void NodeArena::Free(void *ptr)
+{
+	RETURN_IF_FAIL(ptr != nullptr);
+
+	lock_guard<mutex> lock(arena_lock_);
+
+	arena_block_t *block = reinterpret_cast<arena_block_t *>(ptr) - 1;
+	void *&head = free_blocks_[block->size];
+	*reinterpret_cast<void **>(ptr) = head;
+	head = ptr;
+}
+
+void NodeArena::Destroy(Node *node)
+{
+	RETURN_IF_FAIL(node != nullptr);
+
+	void *ptr = dynamic_cast<void *>(node);   // ʼַ
+	node->~Node();
+	Free(ptr);
+}
+
+node_handle_t NodeArena::Attach(Node *node)
+{
+	RETURN_VAL_IF_FAIL(node != nullptr, INVALID_NODE_HANDLE);
+
+	lock_guard<mutex> lock(arena_lock_);
+
+	pj_uint32_t index;
+	if(!free_slots_.empty())
+	{
+		index = free_slots_.back();
+		free_slots_.pop_back();
+		slots_[index] = node;
+	}
+	else
+	{
+		RETURN_VAL_IF_FAIL(slots_.size() < ARENA_MAX_SLOTS, INVALID_NODE_HANDLE);
+		index = slots_.size();
+		slots_.push_back(node);
+		generations_.push_back(1);
+	}
+
+	return ((node_handle_t)generations_[index] << 32) | index;
+}
+
+void NodeArena::Detach(node_handle_t handle)
+{
+	lock_guard<mutex> lock(arena_lock_);
+
+	pj_uint32_t index = NODE_HANDLE_INDEX(handle);
+	RETURN_IF_FAIL(index > 0 && index < slots_.size());
+	RETURN_IF_FAIL(generations_[index] == NODE_HANDLE_GEN(handle));
+
+	slots_[index] = nullptr;
+	if(++ generations_[index] == 0)
+	{
+		generations_[index] = 1;      // 0ʹ, ֤Ϊ0
+	}
+	free_slots_.push_back(index);
+}
+
+Node *NodeArena::Resolve(node_handle_t handle)
+{
+	lock_guard<mutex> lock(arena_lock_);
+
+	pj_uint32_t index = NODE_HANDLE_INDEX(handle);
+	RETURN_VAL_IF_FAIL(index > 0 && index < slots_.size(), nullptr);
+	RETURN_VAL_IF_FAIL(generations_[index] == NODE_HANDLE_GEN(handle), nullptr);
+
+	return slots_[index];
+}
+
+Node *NodeArena::Lookup(pj_uint32_t index)
+{
+	lock_guard<mutex> lock(arena_lock_);
+	RETURN_VAL_IF_FAIL(index > 0 && index < slots_.size(), nullptr);
+
+	return slots_[index];
+}
+
+pj_str_t NodeArena::Intern(const pj_str_t &str)
+{
+	lock_guard<mutex> lock(arena_lock_);
+
+	pj_str_t interned;
+	interned.slen = str.slen;
+	interned.ptr = reinterpret_cast<char *>(pj_hash_get(strings_, str.ptr, (unsigned)str.slen, NULL));
+	if(interned.ptr == nullptr)
+	{
+		interned.ptr = reinterpret_cast<char *>(pj_pool_alloc(pool_, str.slen + 1));
+		pj_memcpy(interned.ptr, str.ptr, str.slen);
+		interned.ptr[str.slen] = '\0';
+
+		// keyvalueͬһڴ, pool_һ
+		pj_hash_set(pool_, strings_, interned.ptr, (unsigned)str.slen, 0, interned.ptr);
+	}
+
+	return interned;
+}
@@ -0,0 +1,70 @@
+#ifndef __AVS_PROXY_CLIENT_NODE_ARENA__
+#define __AVS_PROXY_CLIENT_NODE_ARENA__
+
+#include <mutex>
+
+#include "Com.h"
+
+using std::mutex;
+using std::lock_guard;
+
+/**
+ * ڵ: 32λΪλ±, 32λΪ.
+ * ڵͷźλһ, ɾʧЧ, ϲľֻΪnullptr.
+ * ͬһλҪ2^32δŻ, ľٽ½ڵ.
+ */
+typedef pj_uint64_t node_handle_t;
+#define INVALID_NODE_HANDLE  0
+#define NODE_HANDLE_INDEX(h) ((pj_uint32_t)(h))
+#define NODE_HANDLE_GEN(h)   ((pj_uint32_t)((h) >> 32))
+
+class Node;
+
+/**
+ * ÿҵ(service)һ, Ŀ¼нڵ㶼.
+ * ڵڴȡpj_pool, ͷŵĿ鰴Сһؿ; ڵͳһפַ.
+ */
+class NodeArena
+	: public Noncopyable
+{
+public:
+	NodeArena(pj_pool_factory *factory, const char *name);
+	~NodeArena();
+
+	void         *Alloc(pj_size_t size);
+	void          Destroy(Node *node);
+	node_handle_t Attach(Node *node);
+	void          Detach(node_handle_t handle);
+	Node         *Resolve(node_handle_t handle);
+	// ؼitem dataWin32ֻ32λ, ֻλ±, ɵ÷˶Խڵtree_item_
+	Node         *Lookup(pj_uint32_t index);
+	pj_str_t      Intern(const pj_str_t &str);
+
+private:
+	void          Free(void *ptr);
+
+	typedef struct __arena_block__
+	{
+		pj_size_t size;
+		pj_size_t reserved;       // 8ֽڶ
+	} arena_block_t;
+
+	typedef map<pj_size_t, void *> free_blocks_t;
+
+	mutex                arena_lock_;
+	pj_pool_t           *pool_;
+	pj_hash_table_t     *strings_;
+	vector<Node *>       slots_;
+	vector<pj_uint32_t>  generations_;
+	vector<pj_uint32_t>  free_slots_;
+	free_blocks_t        free_blocks_;
+};
+
+// ̻߳ûʱֻ, g_av_index_lock½(resolve_user), ûѱɾʱΪnullptr
+typedef struct
+{
+	NodeArena    *arena;
+	node_handle_t handle;
+} user_ref_t;
+
+#endif
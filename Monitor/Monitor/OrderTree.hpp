@@ -0,0 +1,294 @@
+#ifndef __AVS_PROXY_ORDER_TREE__
+#define __AVS_PROXY_ORDER_TREE__
+
+#include <functional>
+
+#include "Com.h"
+
+/**
+ * keyĴȨƽ(treap), άȨֵ.
+ * Insert/Erase/SetΪO(log n), мɾʱҪؽ;
+ * VisitFromӵkȨֵλʼ, ȨֵΪ0k֮ǰֱ.
+ */
+template<class K, class V, class Less = std::less<K> >
+class OrderTree
+	: public Noncopyable
+{
+public:
+	OrderTree()
+		: root_(nullptr)
+		, seed_(0x9E3779B9)
+		, less_()
+	{
+	}
+
+	~OrderTree()
+	{
+		Clear();
+	}
+
+	void Clear()
+	{
+		Free(root_);
+		root_ = nullptr;
+	}
+
+	inline pj_uint32_t Size() const
+	{
+		return root_ != nullptr ? root_->size : 0;
+	}
+
+	inline pj_uint64_t Total() const
+	{
+		return root_ != nullptr ? root_->sum : 0;
+	}
+
+	// keyѴʱPJ_FALSE
+	pj_bool_t Insert(const K &key, const V &value, pj_uint32_t weight)
+	{
+		RETURN_VAL_IF_FAIL(Lookup(key) == nullptr, PJ_FALSE);
+
+		node_t *node = new node_t;
+		node->key      = key;
+		node->value    = value;
+		node->weight   = weight;
+		node->priority = Random();
+		node->left     = nullptr;
+		node->right    = nullptr;
+		Pull(node);
+
+		node_t *left, *right;
+		Split(root_, key, left, right);
+		root_ = Merge(Merge(left, node), right);
+
+		return PJ_TRUE;
+	}
+
+	// weightرɾԪصȨֵ
+	pj_bool_t Erase(const K &key, pj_uint32_t *weight = nullptr)
+	{
+		node_t *left, *mid, *right;
+		Split(root_, key, left, mid);          // left < key <= mid
+		SplitAfter(mid, key, mid, right);      // mid == key < right
+
+		pj_bool_t found = mid != nullptr ? PJ_TRUE : PJ_FALSE;
+		if(found && weight != nullptr)
+		{
+			*weight = mid->weight;
+		}
+		Free(mid);
+		root_ = Merge(left, right);
+
+		return found;
+	}
+
+	pj_bool_t Set(const K &key, pj_uint32_t weight)
+	{
+		return Update(root_, key, weight);
+	}
+
+	// key˳Ȩֵ0Ԫ, visit(value, skip, weight)falseʱֹͣ. skipΪkڸԪڵƫ
+	template<class Visitor>
+	void VisitFrom(pj_uint64_t k, Visitor visit) const
+	{
+		Walk(root_, k, visit);
+	}
+
+	// key˳Ԫ
+	template<class Visitor>
+	void Visit(Visitor visit) const
+	{
+		InOrder(root_, visit);
+	}
+
+private:
+	typedef struct __order_tree_node__
+	{
+		K           key;
+		V           value;
+		pj_uint32_t weight;
+		pj_uint32_t priority;
+		pj_uint32_t size;
+		pj_uint64_t sum;
+		struct __order_tree_node__ *left;
+		struct __order_tree_node__ *right;
+	} node_t;
+
+	pj_uint32_t Random()
+	{
+		seed_ ^= seed_ << 13;
+		seed_ ^= seed_ >> 17;
+		seed_ ^= seed_ << 5;
+		return seed_;
+	}
+
+	static void Pull(node_t *node)
+	{
+		node->size = 1;
+		node->sum  = node->weight;
+		if(node->left != nullptr)
+		{
+			node->size += node->left->size;
+			node->sum  += node->left->sum;
+		}
+		if(node->right != nullptr)
+		{
+			node->size += node->right->size;
+			node->sum  += node->right->sum;
+		}
+	}
+
+	// leftеkeyСkey, rightеĶСkey
+	void Split(node_t *node, const K &key, node_t *&left, node_t *&right)
+	{
+		if(node == nullptr)
+		{
+			left = right = nullptr;
+			return;
+		}
+
+		if(less_(node->key, key))
+		{
+			Split(node->right, key, node->right, right);
+			left = node;
+		}
+		else
+		{
+			Split(node->left, key, left, node->left);
+			right = node;
+		}
+		Pull(node);
+	}
+
+	// leftеkeykey, rightеĶkey
+	void SplitAfter(node_t *node, const K &key, node_t *&left, node_t *&right)
+	{
+		if(node == nullptr)
+		{
+			left = right = nullptr;
+			return;
+		}
+
+		if(less_(key, node->key))
+		{
+			SplitAfter(node->left, key, left, node->left);
+			right = node;
+		}
+		else
+		{
+			SplitAfter(node->right, key, node->right, right);
+			left = node;
+		}
+		Pull(node);
+	}
+
+	static node_t *Merge(node_t *left, node_t *right)
+	{
+		if(left == nullptr || right == nullptr)
+		{
+			return left != nullptr ? left : right;
+		}
+
+		if(left->priority > right->priority)
+		{
+			left->right = Merge(left->right, right);
+			Pull(left);
+			return left;
+		}
+
+		right->left = Merge(left, right->left);
+		Pull(right);
+		return right;
+	}
+
+	node_t *Lookup(const K &key) const
+	{
+		node_t *node = root_;
+		while(node != nullptr)
+		{
+			if(less_(key, node->key))
+			{
+				node = node->left;
+			}
+			else if(less_(node->key, key))
+			{
+				node = node->right;
+			}
+			else
+			{
+				break;
+			}
+		}
+		return node;
+	}
+
+	pj_bool_t Update(node_t *node, const K &key, pj_uint32_t weight)
+	{
+		RETURN_VAL_IF_FAIL(node != nullptr, PJ_FALSE);
+
+		pj_bool_t found;
+		if(less_(key, node->key))
+		{
+			found = Update(node->left, key, weight);
+		}
+		else if(less_(node->key, key))
+		{
+			found = Update(node->right, key, weight);
+		}
+		else
+		{
+			node->weight = weight;
+			found = PJ_TRUE;
+		}
+		Pull(node);
+
+		return found;
+	}
+
+	template<class Visitor>
+	static pj_bool_t Walk(const node_t *node, pj_uint64_t &skip, Visitor &visit)
+	{
+		RETURN_VAL_IF_FAIL(node != nullptr && node->sum > 0, PJ_TRUE);
+		RETURN_VAL_WITH_STATEMENT_IF_FAIL(node->sum > skip, skip -= node->sum, PJ_TRUE);
+
+		RETURN_VAL_IF_FAIL(Walk(node->left, skip, visit), PJ_FALSE);
+
+		if(node->weight > skip)
+		{
+			pj_uint32_t offset = (pj_uint32_t)skip;
+			skip = 0;
+			RETURN_VAL_IF_FAIL(visit(node->value, offset, node->weight), PJ_FALSE);
+		}
+		else
+		{
+			skip -= node->weight;
+		}
+
+		return Walk(node->right, skip, visit);
+	}
+
+	template<class Visitor>
+	static void InOrder(const node_t *node, Visitor &visit)
+	{
+		RETURN_IF_FAIL(node != nullptr);
+
+		InOrder(node->left, visit);
+		visit(node->value, node->weight);
+		InOrder(node->right, visit);
+	}
+
+	static void Free(node_t *node)
+	{
+		RETURN_IF_FAIL(node != nullptr);
+
+		Free(node->left);
+		Free(node->right);
+		delete node;
+	}
+
+	node_t     *root_;
+	pj_uint32_t seed_;
+	Less        less_;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "stdafx.h"
+#include "PjmediaDecoder.h"
+#include "VideoStream.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "PjmediaDecoder.cpp"
+
+PjmediaDecoder::PjmediaDecoder()
+	: codec_(nullptr)
+	, param_()
+	, dec_buf_(nullptr)
+	, dec_max_size_(VIDEO_WIDTH * VIDEO_HEIGHT * 4)
+{
+}
+
+pj_status_t PjmediaDecoder::Open(pj_pool_t *pool)
+{
+	dec_buf_ = (pj_uint8_t *)pj_pool_alloc(pool, dec_max_size_);
+	RETURN_VAL_IF_FAIL(dec_buf_ != nullptr, PJ_ENOMEM);
+
+	pjmedia_vid_codec_mgr *codec_mgr = pjmedia_vid_codec_mgr_instance();
+
+	pj_str_t h264_id = pj_str("H264");
+	unsigned info_cnt;
+	const pjmedia_vid_codec_info *codec_info;
+	pj_status_t status;
+	status = pjmedia_vid_codec_mgr_find_codecs_by_id(codec_mgr,
+		&h264_id, 
+		&info_cnt, 
+		&codec_info,
+		NULL);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	status = pjmedia_vid_codec_mgr_alloc_codec(codec_mgr, 
+		codec_info,
+		&codec_);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	 /* Init and open the codec. */
+    status = pjmedia_vid_codec_init(codec_, pool);
+    RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	status = pjmedia_vid_codec_mgr_get_default_param(codec_mgr,
+		codec_info,
+		&param_);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+    status = pjmedia_vid_codec_open(codec_, &param_);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	return PJ_SUCCESS;
+}
+
+void PjmediaDecoder::Close()
+{
+	RETURN_IF_FAIL(codec_ != nullptr);
+
+	pjmedia_vid_codec_close(codec_);
+	pjmedia_vid_codec_mgr_dealloc_codec(pjmedia_vid_codec_mgr_instance(), codec_);
+	codec_ = nullptr;
+}
+
+// װûflushӿ, رպԭ´, һssrcĲο֡ƴ״̬
+void PjmediaDecoder::Flush()
+{
+	RETURN_IF_FAIL(codec_ != nullptr);
+
+	pjmedia_vid_codec_close(codec_);
+	pj_status_t status = pjmedia_vid_codec_open(codec_, &param_);
+	if(status != PJ_SUCCESS)
+	{
+		PJ_LOG(3, (__ABS_FILE__, "Flush() => reopen codec failed, status %d", status));
+	}
+}
+
+pj_status_t PjmediaDecoder::Decode(const pjmedia_frame *packets, pj_uint32_t count, pj_uint32_t ts, video_frame_ptr_t &frame)
+{
+	pjmedia_frame dec_frame;
+	pj_bzero(&dec_frame, sizeof(dec_frame));
+	dec_frame.buf = dec_buf_;
+	dec_frame.size = dec_max_size_;
+
+	pj_status_t status;
+	status = pjmedia_vid_codec_decode(codec_, count, const_cast<pjmedia_frame *>(packets), dec_max_size_, &dec_frame);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+	RETURN_VAL_IF_FAIL(dec_frame.type == PJMEDIA_FRAME_TYPE_VIDEO && dec_frame.size > 0, PJ_ENOTFOUND);
+
+	// װڷֱʱ仯ʱdec_fmt
+	pjmedia_vid_codec_param param;
+	status = pjmedia_vid_codec_get_param(codec_, &param);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	pj_uint32_t width = param.dec_fmt.det.vid.size.w;
+	pj_uint32_t height = param.dec_fmt.det.vid.size.h;
+	RETURN_VAL_IF_FAIL(width * height * 3 / 2 <= dec_frame.size, PJ_ETOOSMALL);
+
+	shared_ptr<vector<pj_uint8_t>> pixels(new vector<pj_uint8_t>(dec_buf_, dec_buf_ + width * height * 3 / 2));
+
+	video_frame_t *picture = new video_frame_t;
+	picture->width_ = width;
+	picture->height_ = height;
+	picture->planes_[0] = &(*pixels)[0];
+	picture->planes_[1] = picture->planes_[0] + width * height;
+	picture->planes_[2] = picture->planes_[1] + width * height / 4;
+	picture->pitches_[0] = width;
+	picture->pitches_[1] = width / 2;
+	picture->pitches_[2] = width / 2;
+	picture->buffer_ = pixels;
+	frame.reset(picture);
+
+	return PJ_SUCCESS;
+}
@@ -0,0 +1,34 @@
+#ifndef __AVS_PROXY_CLIENT_PJMEDIA_DECODER__
+#define __AVS_PROXY_CLIENT_PJMEDIA_DECODER__
+
+#include <vector>
+#include <pjmedia-codec.h>
+
+#include "VideoDecoder.h"
+
+using std::vector;
+
+/**
+ * pjmedia_vid_codec_decode. װƴ, ͼдڲ,
+ * ٿһݽĻ. AvcodecDecoderԱ.
+ */
+class PjmediaDecoder
+	: public VideoDecoder
+{
+public:
+	PjmediaDecoder();
+
+	virtual pj_status_t Open(pj_pool_t *pool);
+	virtual void        Close();
+	virtual void        Flush();
+	virtual pj_status_t Decode(const pjmedia_frame *packets, pj_uint32_t count, pj_uint32_t ts, video_frame_ptr_t &frame);
+	virtual const char *Name() const { return "pjmedia"; }
+
+private:
+	pjmedia_vid_codec *codec_;
+	pjmedia_vid_codec_param param_;   // Flushʱԭ´
+	pj_uint8_t        *dec_buf_;
+	pj_uint32_t        dec_max_size_;
+};
+
+#endif
@@ -0,0 +1,281 @@
+#include "stdafx.h"
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+#include "Playout.h"
+#include "VideoStream.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "Playout.cpp"
+
+PlayoutScheduler g_playout_scheduler;
+
+PlayoutClock::PlayoutClock()
+	: last_due_(0)
+{
+	Reset();
+}
+
+// ֻ, last_due_: ʱ𲽵֡ŵѽ֮֡ǰ
+
+void PlayoutClock::Reset()
+{
+	started_ = PJ_FALSE;
+	last_ts_ = 0;
+	ts_base_ = 0;
+	ts_unwrapped_ = 0;
+	local_base_ = 0;
+	w_ = sx_ = sy_ = sxx_ = sxy_ = 0.0;
+	samples_ = 0;
+	slope_ = 1.0;
+	intercept_ = 0.0;
+	residual_count_ = 0;
+	target_ = 0.0;
+	pj_bzero(&stats_, sizeof(stats_));
+}
+
+// pj_elapsed_usec, 32λһСʱͻ
+pj_uint64_t PlayoutClock::Usec(const pj_timestamp &ts)
+{
+	pj_timestamp freq;
+	pj_get_timestamp_freq(&freq);
+
+	return ts.u64 / freq.u64 * 1000000 + ts.u64 % freq.u64 * 1000000 / freq.u64;
+}
+
+pj_uint64_t PlayoutClock::Schedule(pj_uint32_t ts, const pj_timestamp &arrival, pj_uint32_t decode_usec)
+{
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	pj_uint64_t now_usec = Usec(now);
+	pj_uint64_t arrival_usec = Usec(arrival);
+
+	if(started_)
+	{
+		pj_int32_t delta = (pj_int32_t)(ts - last_ts_);
+		pj_int64_t elapsed = (pj_int64_t)(arrival_usec - local_base_) / 1000;
+		pj_int64_t expected = (pj_int64_t)(intercept_ + slope_ * ((ts_unwrapped_ - ts_base_ + delta) / (double)PLAYOUT_CLOCK_RATE));
+		if(delta > PLAYOUT_RESET_GAP * PLAYOUT_CLOCK_RATE || delta < -PLAYOUT_RESET_GAP * PLAYOUT_CLOCK_RATE
+			|| (samples_ >= PLAYOUT_MIN_SAMPLES && (elapsed - expected > PLAYOUT_RESET_GAP || expected - elapsed > PLAYOUT_RESET_GAP)))
+		{
+			PJ_LOG(5, (__ABS_FILE__, "Schedule() => timestamp jumped %d ticks, arrival off %lld ms, refit", delta, elapsed - expected));
+			Reset();
+		}
+		else if(delta < 0)
+		{
+			// ľ֡
+			last_due_ = MAX(last_due_, now_usec);
+			return last_due_;
+		}
+		else
+		{
+			ts_unwrapped_ += delta;
+			last_ts_ = ts;
+		}
+	}
+
+	if(!started_)
+	{
+		started_ = PJ_TRUE;
+		last_ts_ = ts;
+		ts_base_ = ts_unwrapped_ = ts;
+		local_base_ = arrival_usec;
+	}
+
+	if(ts_unwrapped_ - ts_base_ > (pj_uint64_t)PLAYOUT_REBASE * PLAYOUT_CLOCK_RATE)
+	{
+		Rebase();
+	}
+
+	double x = (ts_unwrapped_ - ts_base_) / (double)PLAYOUT_CLOCK_RATE;
+	double y = (pj_int64_t)(arrival_usec - local_base_) / 1000.0;
+	Fit(x, y);
+
+	double predicted = intercept_ + slope_ * x;
+	UpdateTarget(y + decode_usec / 1000.0 - predicted);
+
+	pj_uint64_t due = now_usec;
+	if(samples_ >= PLAYOUT_MIN_SAMPLES)
+	{
+		pj_int64_t offset = (pj_int64_t)((predicted + target_) * 1000);
+		due = offset > 0 || local_base_ > (pj_uint64_t)(-offset) ? local_base_ + offset : 0;
+		++ stats_.scheduled_;
+		if(due < now_usec)
+		{
+			++ stats_.late_;
+		}
+	}
+
+	last_due_ = MAX(last_due_, due);
+
+	return last_due_;
+}
+
+// ָļȨС, бʱƯƵĺΧ
+void PlayoutClock::Fit(double x, double y)
+{
+	w_ = w_ * PLAYOUT_FORGET + 1;
+	sx_ = sx_ * PLAYOUT_FORGET + x;
+	sy_ = sy_ * PLAYOUT_FORGET + y;
+	sxx_ = sxx_ * PLAYOUT_FORGET + x * x;
+	sxy_ = sxy_ * PLAYOUT_FORGET + x * y;
+	++ samples_;
+
+	double det = w_ * sxx_ - sx_ * sx_;
+	slope_ = samples_ >= PLAYOUT_MIN_SAMPLES && det > 1e-6 ? (w_ * sxy_ - sx_ * sy_) / det : 1.0;
+	slope_ = MIN(MAX(slope_, 1.0 - PLAYOUT_MAX_DRIFT), 1.0 + PLAYOUT_MAX_DRIFT);
+	intercept_ = (sy_ - slope_ * sx_) / w_;
+}
+
+// ԭƽƵϵĵǰ, Ȩ֮任, Ͻ
+void PlayoutClock::Rebase()
+{
+	pj_uint64_t dx_ticks = ts_unwrapped_ - ts_base_;
+	double dx = dx_ticks / (double)PLAYOUT_CLOCK_RATE;
+	pj_int64_t dy_usec = (pj_int64_t)((intercept_ + slope_ * dx) * 1000);
+	double dy = dy_usec / 1000.0;
+
+	sxx_ = sxx_ - 2 * dx * sx_ + w_ * dx * dx;
+	sxy_ = sxy_ - dx * sy_ - dy * sx_ + w_ * dx * dy;
+	sx_ = sx_ - w_ * dx;
+	sy_ = sy_ - w_ * dy;
+	intercept_ = intercept_ + slope_ * dx - dy;
+
+	ts_base_ += dx_ticks;
+	local_base_ += dy_usec;
+}
+
+/**
+ * residualΪһ֡ʱ̱ϵĵʱٺ. ĿӳȡPLAYOUT_WINDOW֡
+ * PLAYOUT_PERCENTILEλ, ʱ, Сʱ, .
+ */
+void PlayoutClock::UpdateTarget(double residual)
+{
+	residuals_[residual_count_ % PLAYOUT_WINDOW] = residual;
+	++ residual_count_;
+
+	pj_uint32_t count = MIN(residual_count_, (pj_uint32_t)PLAYOUT_WINDOW);
+	double sorted[PLAYOUT_WINDOW];
+	std::copy(residuals_, residuals_ + count, sorted);
+	pj_uint32_t nth = (count - 1) * PLAYOUT_PERCENTILE / 100;
+	std::nth_element(sorted, sorted + nth, sorted + count);
+
+	double wanted = MIN(MAX(sorted[nth], 0.0), (double)g_client_config.playout_max_delay);
+	target_ = wanted > target_ ? wanted : target_ - (target_ - wanted) / PLAYOUT_DECAY;
+}
+
+void PlayoutClock::GetStats(playout_stats_t &stats) const
+{
+	stats = stats_;
+	stats.target_msec_ = (pj_uint32_t)target_;
+	stats.drift_ppm_ = (pj_int32_t)((1.0 / slope_ - 1.0) * 1000000);
+}
+
+PlayoutScheduler::PlayoutScheduler()
+	: active_(PJ_FALSE)
+	, release_thread_()
+	, queue_lock_()
+	, queue_cv_()
+	, seq_(0)
+	, drops_(0)
+	, queue_()
+{
+}
+
+pj_status_t PlayoutScheduler::Launch()
+{
+	active_ = PJ_TRUE;
+	release_thread_ = thread(std::bind(&PlayoutScheduler::ReleaseThread, this));
+
+	PJ_LOG(5, (__ABS_FILE__, "Launch playout scheduler ok!"));
+
+	return PJ_SUCCESS;
+}
+
+void PlayoutScheduler::Destory()
+{
+	{
+		lock_guard<mutex> lock(queue_lock_);
+		active_ = PJ_FALSE;
+	}
+	queue_cv_.notify_one();
+
+	if(release_thread_.joinable())
+	{
+		release_thread_.join();
+	}
+}
+
+pj_bool_t PlayoutScheduler::Push(VideoStream *stream, pj_uint32_t epoch, const video_frame_ptr_t &frame, pj_uint64_t due)
+{
+	RETURN_VAL_IF_FAIL(stream != nullptr && frame, PJ_FALSE);
+
+	{
+		lock_guard<mutex> lock(queue_lock_);
+		RETURN_VAL_IF_FAIL(active_, PJ_FALSE);
+
+		// ̸֡߳ϻڹԶʱö, Ǳʾ֡
+		if(queue_.size() >= PLAYOUT_MAX_QUEUE)
+		{
+			queue_.pop();
+			if(drops_ ++ % 100 == 0)
+			{
+				PJ_LOG(4, (__ABS_FILE__, "Push() => playout queue full, %llu frames dropped", drops_));
+			}
+		}
+
+		playout_entry_t entry = {due, seq_ ++, stream, epoch, frame};
+		queue_.push(entry);
+	}
+	queue_cv_.notify_one();
+
+	return PJ_TRUE;
+}
+
+// ڵ֡ⷢ, ̷߳֡ᱻ
+void PlayoutScheduler::ReleaseThread()
+{
+	pj_thread_desc desc;
+	pj_thread_t *pj_thread = nullptr;
+	if(!pj_thread_is_registered())
+	{
+		pj_thread_register(NULL, desc, &pj_thread);
+	}
+
+	std::unique_lock<mutex> lock(queue_lock_);
+	while(active_)
+	{
+		if(queue_.empty())
+		{
+			queue_cv_.wait(lock);
+			continue;
+		}
+
+		pj_timestamp now;
+		pj_get_timestamp(&now);
+		pj_uint64_t now_usec = PlayoutClock::Usec(now);
+		if(queue_.top().due_ > now_usec)
+		{
+			queue_cv_.wait_for(lock, std::chrono::microseconds(queue_.top().due_ - now_usec));
+			continue;
+		}
+
+		playout_entry_t entry = queue_.top();
+		queue_.pop();
+
+		lock.unlock();
+		entry.stream_->Release(entry.frame_, entry.epoch_);
+		entry.frame_.reset();
+		lock.lock();
+	}
+
+	while(!queue_.empty())
+	{
+		queue_.pop();
+	}
+}
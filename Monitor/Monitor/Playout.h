@@ -0,0 +1,124 @@
+#ifndef __AVS_PROXY_CLIENT_PLAYOUT__
+#define __AVS_PROXY_CLIENT_PLAYOUT__
+
+#include <queue>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "VideoDecoder.h"
+#include "Com.h"
+
+using std::vector;
+using std::mutex;
+using std::lock_guard;
+using std::thread;
+
+#define PLAYOUT_CLOCK_RATE      90        // RTPʱÿĿ̶
+#define PLAYOUT_FORGET          0.98      // ϵ, Լֻ50֡
+#define PLAYOUT_MIN_SAMPLES     8         // ʱ, ˾ʾ
+#define PLAYOUT_MAX_DRIFT       0.01      // Ͷ뱾ʱӵʲ
+#define PLAYOUT_RESET_GAP       3000      // ms, ʱ򵽴ʱ䳬ֵΪ, 
+#define PLAYOUT_REBASE          600000    // ms, ϵԭÿôƽһ, ־
+#define PLAYOUT_WINDOW          64        // ͳƲвλ֡
+#define PLAYOUT_PERCENTILE      95
+#define PLAYOUT_DECAY           32        // Ŀӳ½ʱÿֵֻ֡1/32, ʱλ
+#define PLAYOUT_MAX_QUEUE       (MAXIMAL_SCREEN_NUM * 16)   // ֡е, ˶絽ڵ֡
+
+typedef struct
+{
+	pj_uint32_t target_msec_;        // ǰĿӳ
+	pj_int32_t  drift_ppm_;          // ϳķͶʱԱؿppm
+	pj_uint32_t scheduled_;
+	pj_uint32_t late_;               // ʱѹʱ֡
+} playout_stats_t;
+
+/**
+ * һ·ƵĲʱ, ֻVideoStream߳ʹ.
+ * ôӵС˰90kHzRTPʱϵصʱ(бʼʱƯ),
+ * ٰϲвķλӦһĿӳ: ֡Ĳʱ = ϵĵʱ + Ŀӳ + ʱ.
+ * 綶ӳ, ֡Ͷ˵ĽȵؽĻ.
+ */
+class PlayoutClock
+{
+public:
+	PlayoutClock();
+
+	void        Reset();
+	// һ֮֡, زʱ(΢). ʱʱΪǰʱ, ʾ
+	pj_uint64_t Schedule(pj_uint32_t ts, const pj_timestamp &arrival, pj_uint32_t decode_usec);
+	void        GetStats(playout_stats_t &stats) const;
+
+	static pj_uint64_t Usec(const pj_timestamp &ts);
+
+private:
+	void   Fit(double x, double y);
+	void   Rebase();
+	void   UpdateTarget(double residual);
+
+	pj_bool_t   started_;
+	pj_uint32_t last_ts_;
+	pj_uint64_t ts_base_;            // չRTPʱԭ
+	pj_uint64_t ts_unwrapped_;
+	pj_uint64_t local_base_;         // ΢ԭ
+	double      w_, sx_, sy_, sxx_, sxy_;   // Ȩ, xΪʱ, yΪ, ԭ
+	pj_uint32_t samples_;
+	double      slope_;
+	double      intercept_;
+	double      residuals_[PLAYOUT_WINDOW];
+	pj_uint32_t residual_count_;
+	double      target_;             // ms
+	pj_uint64_t last_due_;           // ͬһ·Ĳʱ䲻
+	playout_stats_t stats_;
+};
+
+class VideoStream;
+typedef struct
+{
+	pj_uint64_t        due_;
+	pj_uint64_t        seq_;         // ͬһʱ̵֡Ⱥ
+	VideoStream       *stream_;
+	pj_uint32_t        epoch_;       // Flush
+	video_frame_ptr_t  frame_;
+} playout_entry_t;
+
+struct playout_entry_later
+{
+	bool operator () (const playout_entry_t &e1, const playout_entry_t &e2) const
+	{
+		return e1.due_ != e2.due_ ? e1.due_ > e2.due_ : e1.seq_ > e2.seq_;
+	}
+};
+
+/**
+ * Ƶõķ֡߳: ̰߳Ѵʱ̵֡ŽС, ʱɱ߳̽VideoStreamĵĻ.
+ * ĻֻдCompositor, ߳.
+ * StreamMgrٽ֮ǰDestory.
+ */
+class PlayoutScheduler
+	: public Noncopyable
+{
+public:
+	PlayoutScheduler();
+
+	pj_status_t Launch();
+	void        Destory();
+	// PJ_FALSEʾû, ÷Ӧ
+	pj_bool_t   Push(VideoStream *stream, pj_uint32_t epoch, const video_frame_ptr_t &frame, pj_uint64_t due);
+
+private:
+	void ReleaseThread();
+
+	pj_bool_t               active_;
+	thread                  release_thread_;
+	mutex                   queue_lock_;
+	std::condition_variable queue_cv_;
+	pj_uint64_t             seq_;
+	pj_uint64_t             drops_;
+	std::priority_queue<playout_entry_t, vector<playout_entry_t>, playout_entry_later> queue_;
+};
+
+extern PlayoutScheduler g_playout_scheduler;
+
+#endif
@@ -0,0 +1,346 @@
+#include "stdafx.h"
+#include "RTCPFeedback.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "RTCPFeedback.cpp"
+
+RTCPFeedback g_rtcp_feedback;
+
+static char RTCP_SESSION_NAME[] = "rtcp";
+
+// дRTCPͷ, lengthΪֽ
+static void write_rtcp_header(pj_uint8_t *buf, pj_uint8_t count, pj_uint8_t pt, pj_uint32_t length)
+{
+	pj_uint16_t words = pj_htons((pj_uint16_t)(length / 4 - 1));
+	buf[0] = 0x80 | (count & 0x1F);
+	buf[1] = pt;
+	pj_memcpy(buf + 2, &words, sizeof(words));
+}
+
+RTCPFeedback::RTCPFeedback()
+	: rtcp_lock_()
+	, streams_()
+{
+}
+
+void RTCPFeedback::Track(pj_uint32_t ssrc)
+{
+	RETURN_IF_FAIL(g_client_config.rtcp_enable);
+
+	lock_guard<mutex> lock(rtcp_lock_);
+	RETURN_IF_FAIL(streams_.find(ssrc) == streams_.end());
+
+	rtcp_stream_t &stream = streams_[ssrc];
+	pjmedia_rtcp_init(&stream.rtcp_, RTCP_SESSION_NAME, RTCP_VIDEO_CLOCK_RATE, RTCP_VIDEO_CLOCK_RATE / 30, g_rtp_session.GetSSRC());
+	stream.rtcp_.peer_ssrc = pj_ntohl(ssrc);
+	stream.has_peer_ = PJ_FALSE;
+	pj_bzero(&stream.peer_, sizeof(stream.peer_));
+	stream.max_seq_ = 0;
+	stream.last_nack_.u64 = 0;
+	stream.last_report_.u64 = 0;
+	stream.keyframe_pending_ = PJ_FALSE;
+	stream.keyframe_fir_ = PJ_FALSE;
+	stream.last_keyframe_req_.u64 = 0;
+	stream.fir_seq_ = 0;
+}
+
+void RTCPFeedback::Untrack(pj_uint32_t ssrc)
+{
+	lock_guard<mutex> lock(rtcp_lock_);
+	streams_.erase(ssrc);
+}
+
+void RTCPFeedback::Clear()
+{
+	lock_guard<mutex> lock(rtcp_lock_);
+	streams_.clear();
+}
+
+// ֻ, OnTimer. firΪʱFIR, PLI
+void RTCPFeedback::RequestKeyframe(pj_uint32_t ssrc, pj_bool_t fir)
+{
+	lock_guard<mutex> lock(rtcp_lock_);
+	rtcp_stream_map_t::iterator pstream = streams_.find(ssrc);
+	RETURN_IF_FAIL(pstream != streams_.end());
+
+	pstream->second.keyframe_pending_ = PJ_TRUE;
+	pstream->second.keyframe_fir_ |= fir;
+}
+
+pj_bool_t RTCPFeedback::IsRtcp(const pj_uint8_t *packet, pj_uint32_t packetlen)
+{
+	RETURN_VAL_IF_FAIL(packet != nullptr && packetlen >= 8, PJ_FALSE);
+
+	// RFC 5761: RTPö˿ʱڶֽ, ϵͳýPTΧ
+	return (packet[0] >> 6) == 2 && packet[1] >= RTCP_PT_SR && packet[1] <= RTCP_PT_PSFB ? PJ_TRUE : PJ_FALSE;
+}
+
+// libevent߳е, ÿRTPһ
+void RTCPFeedback::OnRxRtp(const pjmedia_rtp_hdr *hdr, pj_uint32_t payloadlen, const pj_sockaddr_in &addr)
+{
+	RETURN_IF_FAIL(hdr != nullptr);
+
+	lock_guard<mutex> lock(rtcp_lock_);
+	rtcp_stream_map_t::iterator pstream = streams_.find(hdr->ssrc);
+	RETURN_IF_FAIL(pstream != streams_.end());
+
+	rtcp_stream_t &stream = pstream->second;
+	pj_uint16_t seq = pj_ntohs(hdr->seq);
+	pjmedia_rtcp_rx_rtp(&stream.rtcp_, seq, pj_ntohl(hdr->ts), payloadlen);
+	stream.peer_ = addr;
+
+	if(!stream.has_peer_)
+	{
+		stream.has_peer_ = PJ_TRUE;
+		stream.max_seq_ = seq;
+		return;
+	}
+
+	TrackLoss(stream, seq);
+}
+
+// Ǽȱ; ٵشİӴNACKбȥ
+void RTCPFeedback::TrackLoss(rtcp_stream_t &stream, pj_uint16_t seq)
+{
+	pj_int16_t delta = (pj_int16_t)(seq - stream.max_seq_);
+	if(delta <= 0)
+	{
+		for(list<nack_entry_t>::iterator pentry = stream.lost_.begin(); pentry != stream.lost_.end(); ++ pentry)
+		{
+			if(pentry->seq_ == seq)
+			{
+				stream.lost_.erase(pentry);
+				break;
+			}
+		}
+		return;
+	}
+
+	pj_uint16_t gap = (pj_uint16_t)(delta - 1);
+	if(gap > NACK_MAX_GAP)
+	{
+		PJ_LOG(5, (__ABS_FILE__, "TrackLoss() => seq jump %u -> %u, drop pending nacks", stream.max_seq_, seq));
+		stream.lost_.clear();
+	}
+	else if(gap > 0)
+	{
+		nack_entry_t entry;
+		pj_get_timestamp(&entry.lost_at_);
+		entry.sent_at_.u64 = 0;
+		entry.retries_ = 0;
+		for(pj_uint16_t i = 1; i <= gap; ++ i)
+		{
+			entry.seq_ = (pj_uint16_t)(stream.max_seq_ + i);
+			stream.lost_.push_back(entry);
+		}
+
+		while(stream.lost_.size() > NACK_MAX_PENDING)
+		{
+			stream.lost_.pop_front();
+		}
+	}
+
+	stream.max_seq_ = seq;
+}
+
+// ͷSRpjmediaLSR, ֮RRݴ˴LSR/DLSR
+void RTCPFeedback::OnRxRtcp(const pj_uint8_t *packet, pj_uint32_t packetlen)
+{
+	lock_guard<mutex> lock(rtcp_lock_);
+
+	pj_uint32_t offset = 0;
+	while(offset + 8 <= packetlen)
+	{
+		const pj_uint8_t *p = packet + offset;
+		pj_uint32_t size = ((((pj_uint32_t)p[2] << 8) | p[3]) + 1) * 4;
+		RETURN_IF_FAIL(offset + size <= packetlen);
+
+		pj_uint32_t ssrc;
+		pj_memcpy(&ssrc, p + 4, sizeof(ssrc));
+
+		rtcp_stream_map_t::iterator pstream = streams_.find(ssrc);
+		if(pstream != streams_.end())
+		{
+			if(p[1] == RTCP_PT_SR)
+			{
+				pjmedia_rtcp_rx_rtcp(&pstream->second.rtcp_, p, size);
+			}
+			else if(p[1] == RTCP_PT_BYE)
+			{
+				PJ_LOG(5, (__ABS_FILE__, "OnRxRtcp() => ssrc[%u] sent BYE", ssrc));
+			}
+		}
+
+		offset += size;
+	}
+}
+
+// RR + SDES, ΪÿϰĿͷ
+pj_uint32_t RTCPFeedback::BuildReport(rtcp_stream_t &stream, pj_uint8_t *buf)
+{
+	void *report;
+	int   report_len;
+	pjmedia_rtcp_build_rtcp(&stream.rtcp_, &report, &report_len);
+	RETURN_VAL_IF_FAIL(report_len > 0 && report_len < RTCP_MAX_PACKET_SIZE, 0);
+	pj_memcpy(buf, report, report_len);
+
+	pjmedia_rtcp_sdes sdes;
+	pj_bzero(&sdes, sizeof(sdes));
+	sdes.cname = g_client_config.local_ip;
+
+	pj_size_t sdes_len = RTCP_MAX_PACKET_SIZE - report_len;
+	pj_status_t status = pjmedia_rtcp_build_rtcp_sdes(&stream.rtcp_, buf + report_len, &sdes_len, &sdes);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, (pj_uint32_t)report_len);
+
+	return (pj_uint32_t)(report_len + sdes_len);
+}
+
+// RFC 4585 generic NACK: ÿFCIΪPID16λͼBLP. ֻ뵽ڵĿ
+pj_uint32_t RTCPFeedback::BuildNack(pj_uint32_t ssrc, rtcp_stream_t &stream, const pj_timestamp &now, pj_uint8_t *buf)
+{
+	pj_uint16_t pids[NACK_MAX_FCI];
+	pj_uint16_t blps[NACK_MAX_FCI];
+	pj_uint32_t fci_count = 0;
+
+	for(list<nack_entry_t>::iterator pentry = stream.lost_.begin(); pentry != stream.lost_.end(); ++ pentry)
+	{
+		if(pentry->sent_at_.u64 != 0 && pj_elapsed_msec(&pentry->sent_at_, &now) < g_client_config.nack_interval)
+		{
+			continue;
+		}
+
+		pj_uint16_t distance = fci_count > 0 ? (pj_uint16_t)(pentry->seq_ - pids[fci_count - 1]) : 0;
+		if(fci_count > 0 && distance >= 1 && distance <= 16)
+		{
+			blps[fci_count - 1] |= 1 << (distance - 1);
+		}
+		else if(fci_count < NACK_MAX_FCI)
+		{
+			pids[fci_count] = pentry->seq_;
+			blps[fci_count] = 0;
+			++ fci_count;
+		}
+		else
+		{
+			break;
+		}
+
+		pentry->sent_at_ = now;
+		++ pentry->retries_;
+	}
+	RETURN_VAL_IF_FAIL(fci_count > 0, 0);
+
+	pj_uint32_t length = 12 + fci_count * 4;
+	pj_uint32_t sender = pj_htonl(g_rtp_session.GetSSRC());
+	write_rtcp_header(buf, RTCP_FMT_NACK, RTCP_PT_RTPFB, length);
+	pj_memcpy(buf + 4, &sender, sizeof(sender));
+	pj_memcpy(buf + 8, &ssrc, sizeof(ssrc));
+	for(pj_uint32_t i = 0; i < fci_count; ++ i)
+	{
+		pj_uint16_t pid = pj_htons(pids[i]);
+		pj_uint16_t blp = pj_htons(blps[i]);
+		pj_memcpy(buf + 12 + i * 4, &pid, sizeof(pid));
+		pj_memcpy(buf + 14 + i * 4, &blp, sizeof(blp));
+	}
+
+	return length;
+}
+
+// PLIFCI; FIR(RFC 5104)media ssrcΪ0, ĿssrcŷFCI
+pj_uint32_t RTCPFeedback::BuildKeyframeRequest(pj_uint32_t ssrc, rtcp_stream_t &stream, pj_uint8_t *buf)
+{
+	pj_uint32_t sender = pj_htonl(g_rtp_session.GetSSRC());
+	pj_memcpy(buf + 4, &sender, sizeof(sender));
+
+	if(!stream.keyframe_fir_)
+	{
+		write_rtcp_header(buf, RTCP_FMT_PLI, RTCP_PT_PSFB, 12);
+		pj_memcpy(buf + 8, &ssrc, sizeof(ssrc));
+		return 12;
+	}
+
+	write_rtcp_header(buf, RTCP_FMT_FIR, RTCP_PT_PSFB, 20);
+	pj_bzero(buf + 8, 12);
+	pj_memcpy(buf + 12, &ssrc, sizeof(ssrc));
+	buf[16] = stream.fir_seq_ ++;
+
+	return 20;
+}
+
+void RTCPFeedback::Send(const rtcp_stream_t &stream, const pj_uint8_t *buf, pj_uint32_t len)
+{
+	pj_status_t status = g_rtp_session.SendRTCPPacket(stream.peer_, buf, len);
+	if(status != PJ_SUCCESS)
+	{
+		PJ_LOG(5, (__ABS_FILE__, "Send() => Send rtcp packet failed, status %d", status));
+	}
+}
+
+// libevent߳ÿRTCP_TIMER_INTERVALһ. зҪʱͬRRһ𷢳, rtcp_intervalֻRR
+void RTCPFeedback::OnTimer()
+{
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+
+	lock_guard<mutex> lock(rtcp_lock_);
+	for(rtcp_stream_map_t::iterator pstream = streams_.begin(); pstream != streams_.end(); ++ pstream)
+	{
+		rtcp_stream_t &stream = pstream->second;
+		if(!stream.has_peer_)
+		{
+			continue;   // ֪﷢, һ
+		}
+
+		// شĿһڶͷ, Ҫ
+		for(list<nack_entry_t>::iterator pentry = stream.lost_.begin(); pentry != stream.lost_.end(); )
+		{
+			if(pentry->retries_ >= NACK_MAX_RETRIES || pj_elapsed_msec(&pentry->lost_at_, &now) > NACK_MAX_AGE)
+			{
+				pentry = stream.lost_.erase(pentry);
+			}
+			else
+			{
+				++ pentry;
+			}
+		}
+
+		pj_bool_t nack_due = !stream.lost_.empty()
+			&& (stream.last_nack_.u64 == 0 || pj_elapsed_msec(&stream.last_nack_, &now) >= g_client_config.nack_interval);
+		pj_bool_t keyframe_due = stream.keyframe_pending_
+			&& (stream.last_keyframe_req_.u64 == 0 || pj_elapsed_msec(&stream.last_keyframe_req_, &now) >= RTCP_KEYFRAME_REQ_INTERVAL);
+		pj_bool_t report_due = stream.last_report_.u64 == 0
+			|| pj_elapsed_msec(&stream.last_report_, &now) >= g_client_config.rtcp_interval;
+		if(!nack_due && !keyframe_due && !report_due)
+		{
+			continue;
+		}
+
+		pj_uint8_t  buf[RTCP_MAX_PACKET_SIZE];
+		pj_uint32_t len = BuildReport(stream, buf);
+		if(len == 0)
+		{
+			continue;
+		}
+		stream.last_report_ = now;
+
+		if(nack_due && len + 12 + NACK_MAX_FCI * 4 <= RTCP_MAX_PACKET_SIZE)
+		{
+			len += BuildNack(pstream->first, stream, now, buf + len);
+			stream.last_nack_ = now;
+		}
+
+		if(keyframe_due && len + 20 <= RTCP_MAX_PACKET_SIZE)
+		{
+			PJ_LOG(5, (__ABS_FILE__, "OnTimer() => Request keyframe of ssrc[%u] by %s", pstream->first, stream.keyframe_fir_ ? "FIR" : "PLI"));
+			len += BuildKeyframeRequest(pstream->first, stream, buf + len);
+			stream.keyframe_pending_ = PJ_FALSE;
+			stream.keyframe_fir_ = PJ_FALSE;
+			stream.last_keyframe_req_ = now;
+		}
+
+		Send(stream, buf, len);
+	}
+}
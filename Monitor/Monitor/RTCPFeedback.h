@@ -0,0 +1,96 @@
+#ifndef __AVS_PROXY_CLIENT_RTCP_FEEDBACK__
+#define __AVS_PROXY_CLIENT_RTCP_FEEDBACK__
+
+#include <map>
+#include <list>
+#include <mutex>
+
+#include "RTPSession.h"
+#include "Config.h"
+#include "Com.h"
+
+using std::map;
+using std::list;
+using std::mutex;
+using std::lock_guard;
+
+#define RTCP_PT_SR                  200
+#define RTCP_PT_RR                  201
+#define RTCP_PT_BYE                 203
+#define RTCP_PT_RTPFB               205    // RFC 4585 㷴
+#define RTCP_PT_PSFB                206    // RFC 4585 ط
+#define RTCP_FMT_NACK               1      // RTPFB: generic NACK
+#define RTCP_FMT_PLI                1      // PSFB: picture loss indication
+#define RTCP_FMT_FIR                4      // PSFB: full intra request, RFC 5104
+#define RTCP_MAX_PACKET_SIZE        1200
+
+#define RTCP_TIMER_INTERVAL         10     // ms, ǷеڵNACK/ؼ֡/ձ
+#define RTCP_VIDEO_CLOCK_RATE       90000
+#define RTCP_KEYFRAME_REQ_INTERVAL  500    // ms, ͬһ·ιؼ֡С
+#define NACK_MAX_GAP                64     // һİֵΪ, NACK
+#define NACK_MAX_PENDING            128
+#define NACK_MAX_RETRIES            3
+#define NACK_MAX_AGE                300    // ms, شҲϲϽ, 
+#define NACK_MAX_FCI                32     // ÿNACKPID/BLPĿ
+
+typedef struct
+{
+	pj_uint16_t  seq_;
+	pj_timestamp lost_at_;
+	pj_timestamp sent_at_;
+	pj_uint32_t  retries_;
+} nack_entry_t;
+
+typedef struct
+{
+	pjmedia_rtcp_session rtcp_;         // հͳ(, jitter, LSR/DLSR), RR
+	pj_bool_t            has_peer_;     // յRTP, peer_Ϊͷַ
+	pj_sockaddr_in       peer_;
+	pj_uint16_t          max_seq_;
+	list<nack_entry_t>   lost_;         // Ⱥ
+	pj_timestamp         last_nack_;
+	pj_timestamp         last_report_;
+	pj_bool_t            keyframe_pending_;
+	pj_bool_t            keyframe_fir_;
+	pj_timestamp         last_keyframe_req_;
+	pj_uint8_t           fir_seq_;
+} rtcp_stream_t;
+
+typedef map<pj_uint32_t, rtcp_stream_t> rtcp_stream_map_t;  // video ssrc -> ״̬
+
+/**
+ * RTPSessionsocketշRTCP, յssrcRTPԴַ(proxy).
+ * ֻڽƵssrc: ʱRR, ȱڷgeneric NACK(, дʱЧ),
+ * ĻʱûпõGOPFIR, ο֡ʧʱPLI.
+ * ssrcRTPͷһ, ֽת.
+ */
+class RTCPFeedback
+	: public Noncopyable
+{
+public:
+	RTCPFeedback();
+
+	void Track(pj_uint32_t ssrc);
+	void Untrack(pj_uint32_t ssrc);
+	void Clear();
+	void RequestKeyframe(pj_uint32_t ssrc, pj_bool_t fir);
+	void OnRxRtp(const pjmedia_rtp_hdr *hdr, pj_uint32_t payloadlen, const pj_sockaddr_in &addr);
+	void OnRxRtcp(const pj_uint8_t *packet, pj_uint32_t packetlen);
+	void OnTimer();
+
+	static pj_bool_t IsRtcp(const pj_uint8_t *packet, pj_uint32_t packetlen);
+
+private:
+	void        TrackLoss(rtcp_stream_t &stream, pj_uint16_t seq);
+	pj_uint32_t BuildReport(rtcp_stream_t &stream, pj_uint8_t *buf);
+	pj_uint32_t BuildNack(pj_uint32_t ssrc, rtcp_stream_t &stream, const pj_timestamp &now, pj_uint8_t *buf);
+	pj_uint32_t BuildKeyframeRequest(pj_uint32_t ssrc, rtcp_stream_t &stream, pj_uint8_t *buf);
+	void        Send(const rtcp_stream_t &stream, const pj_uint8_t *buf, pj_uint32_t len);
+
+	mutex             rtcp_lock_;
+	rtcp_stream_map_t streams_;
+};
+
+extern RTCPFeedback g_rtcp_feedback;
+
+#endif
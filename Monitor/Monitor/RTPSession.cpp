@@ -9,7 +9,8 @@ pj_status_t RTPSession::Open()
 	status = pj_open_udp_transport(&g_client_config.local_ip, g_client_config.local_media_port, rtp_sock_);
 	RETURN_VAL_IF_FAIL( status == PJ_SUCCESS, status );
 
-	status = pjmedia_rtp_session_init(&rtp_out_session_, RTP_EXPAND_PAYLOAD_TYPE, pj_rand());
+	ssrc_ = pj_rand();
+	status = pjmedia_rtp_session_init(&rtp_out_session_, RTP_EXPAND_PAYLOAD_TYPE, ssrc_);
 	RETURN_VAL_IF_FAIL( status == PJ_SUCCESS, status );
 
 	return PJ_SUCCESS;
@@ -51,5 +52,14 @@ pj_status_t RTPSession::SendRTPPacket(pj_str_t &ip, pj_uint16_t port, const void
 	status = pj_sockaddr_in_init(&addr, &ip, port);
 	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
 
+	return pj_sock_sendto(rtp_sock_, packet, &size, 0, &addr, sizeof(addr));
+}
+
+// RTCPRTPһ˿, rtp_out_session_
+pj_status_t RTPSession::SendRTCPPacket(const pj_sockaddr_in &addr, const void *packet, pj_ssize_t packet_len)
+{
+	RETURN_VAL_IF_FAIL(packet != nullptr && packet_len > 0 && packet_len <= MAX_UDP_DATA_SIZE, PJ_EINVAL);
+
+	pj_ssize_t size = packet_len;
 	return pj_sock_sendto(rtp_sock_, packet, &size, 0, &addr, sizeof(addr));
 }
\ No newline at end of file
@@ -14,10 +14,13 @@ public:
 	pj_status_t Open();
 	void        Close();
 	pj_status_t SendRTPPacket(pj_str_t &ip, pj_uint16_t port, const void *payload, pj_ssize_t payload_len);
+	pj_status_t SendRTCPPacket(const pj_sockaddr_in &addr, const void *packet, pj_ssize_t packet_len);
 	inline pj_sock_t GetRTPSock() const { return rtp_sock_; }
+	inline pj_uint32_t GetSSRC() const { return ssrc_; }
 
 private:
 	pj_sock_t           rtp_sock_;
+	pj_uint32_t         ssrc_;
 	mutex               rtp_lock_;
 	pjmedia_rtp_session rtp_out_session_;
 };
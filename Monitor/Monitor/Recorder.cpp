@@ -0,0 +1,750 @@
+#include "stdafx.h"
+#include <algorithm>
+#include <chrono>
+
+#include "Recorder.h"
+#include "AvRoutes.h"
+#include "AudioStream.h"
+#include "VideoStream.h"
+#include "TitleRoom.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "Recorder.cpp"
+
+Recorder g_recorder;
+
+/**
+ * offsetһAnnex-Bʼ, NALλúͳ(ʼ), offsetƵNALĩβ.
+ * ֽʼһ0ǰһNALĽβ, Ӱж.
+ */
+static pj_bool_t next_nal(const pj_uint8_t *buf, pj_uint32_t len, pj_uint32_t &offset, pj_uint32_t &nal, pj_uint32_t &nal_len)
+{
+	pj_uint32_t i = offset;
+	while(i + 3 < len && !(buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1))
+	{
+		++ i;
+	}
+	RETURN_VAL_IF_FAIL(i + 3 < len, PJ_FALSE);
+
+	nal = i + 3;
+	pj_uint32_t j = nal;
+	while(j + 3 <= len && !(buf[j] == 0 && buf[j + 1] == 0 && (buf[j + 2] == 1 || (buf[j + 2] == 0 && j + 3 < len && buf[j + 3] == 1))))
+	{
+		++ j;
+	}
+	nal_len = (j + 3 <= len ? j : len) - nal;
+	offset = nal + nal_len;
+
+	return PJ_TRUE;
+}
+
+Recording::Recording(pj_int64_t user_id, pj_uint32_t audio_ssrc, pj_uint32_t video_ssrc, const std::string &path)
+	: user_id_(user_id)
+	, audio_ssrc_(audio_ssrc)
+	, video_ssrc_(video_ssrc)
+	, stopping_(PJ_FALSE)
+	, path_(path)
+	, queue_(RECORD_QUEUE_SIZE)
+	, written_kb_(0)
+	, dropped_(0)
+	, failed_(PJ_FALSE)
+	, written_(0)
+	, pool_(nullptr)
+	, packetizer_(nullptr)
+	, au_buf_(nullptr)
+	, au_len_(0)
+	, au_ts_(0)
+	, have_seq_(PJ_FALSE)
+	, next_seq_(0)
+	, fd_(nullptr)
+	, format_(nullptr)
+	, video_(nullptr)
+	, audio_(nullptr)
+	, muxing_(PJ_FALSE)
+{
+	pj_bzero(&au_arrival_, sizeof(au_arrival_));
+	pj_bzero(&start_, sizeof(start_));
+	pj_bzero(&video_track_, sizeof(video_track_));
+	pj_bzero(&audio_track_, sizeof(audio_track_));
+}
+
+Recording::~Recording()
+{
+}
+
+pj_status_t Recording::Open(pj_pool_factory *factory)
+{
+	pool_ = pj_pool_create(factory, "record", 4096, 4096, NULL);
+	RETURN_VAL_IF_FAIL(pool_ != nullptr, PJ_ENOMEM);
+
+	au_buf_ = (pj_uint8_t *)pj_pool_alloc(pool_, RECORD_AU_SIZE);
+	RETURN_VAL_IF_FAIL(au_buf_ != nullptr, PJ_ENOMEM);
+
+	pjmedia_h264_packetizer_cfg cfg;
+	pj_bzero(&cfg, sizeof(cfg));
+	cfg.mtu = PJMEDIA_MAX_MRU;
+	cfg.mode = PJMEDIA_H264_PACKETIZER_MODE_NON_INTERLEAVED;
+
+	return pjmedia_h264_packetizer_create(pool_, &cfg, &packetizer_);
+}
+
+// ֻһεԤȷĲ; ˾Ͷ, д߳ٶӰհ
+void Recording::Push(pj_uint8_t media, const pj_uint8_t *rtp_frame, pj_uint16_t framelen)
+{
+	RETURN_IF_FAIL(!failed_ && framelen <= MAX_UDP_DATA_SIZE);
+
+	record_packet_t *packet = queue_.BeginPush();
+	if(packet == nullptr)
+	{
+		++ dropped_;
+		return;
+	}
+
+	packet->media_ = media;
+	packet->len_ = framelen;
+	pj_get_timestamp(&packet->arrival_);
+	pj_memcpy(packet->data_, rtp_frame, framelen);
+	queue_.EndPush();
+}
+
+void Recording::GetStats(record_stats_t &stats) const
+{
+	stats.written_kb_ = written_kb_;
+	stats.dropped_ = dropped_;
+	stats.failed_ = failed_;
+}
+
+// һȡһȦ, ¼֮д. ʧֻܺӲ
+pj_uint32_t Recording::Drain()
+{
+	pj_uint32_t count = 0;
+	record_packet_t *packet;
+	while(count < queue_.Capacity() && (packet = queue_.Front()) != nullptr)
+	{
+		if(!failed_)
+		{
+			if(packet->media_ == VIDEO_INDEX)
+			{
+				OnVideo(*packet);
+			}
+			else
+			{
+				OnAudio(*packet);
+			}
+		}
+		queue_.Pop();
+		++ count;
+	}
+
+	return count;
+}
+
+/**
+ * AvcodecDecoderͬ, pjmedia_h264_unpacketizeƴAnnex-Baccess unit.
+ * ʱ仯markerʱһ֡; Ųʱ֪ƴȱNAL.
+ */
+void Recording::OnVideo(const record_packet_t &packet)
+{
+	const pjmedia_rtp_hdr *hdr;
+	const void *payload;
+	unsigned payloadlen;
+	pj_status_t status;
+	status = pjmedia_rtp_decode_rtp(NULL, packet.data_, packet.len_, &hdr, &payload, &payloadlen);
+	RETURN_IF_FAIL(status == PJ_SUCCESS && hdr->pt == RTP_MEDIA_VIDEO_TYPE);
+
+	pj_uint32_t ts = pj_ntohl(hdr->ts);
+	pj_uint16_t seq = pj_ntohs(hdr->seq);
+	if(au_len_ > 0 && ts != au_ts_)
+	{
+		FlushAu();
+	}
+
+	if(have_seq_ && seq != next_seq_)
+	{
+		pjmedia_h264_unpacketize(packetizer_, NULL, 0, au_buf_, RECORD_AU_SIZE, &au_len_);
+	}
+	have_seq_ = PJ_TRUE;
+	next_seq_ = seq + 1;
+
+	if(au_len_ == 0)
+	{
+		au_ts_ = ts;
+		au_arrival_ = packet.arrival_;
+	}
+	pjmedia_h264_unpacketize(packetizer_, (const pj_uint8_t *)payload, payloadlen, au_buf_, RECORD_AU_SIZE, &au_len_);
+
+	if(hdr->m)
+	{
+		FlushAu();
+	}
+}
+
+// һͬʱSPSPPS֡ļ, Ϊextradata, ֮ǰ֡û, 
+void Recording::FlushAu()
+{
+	pj_uint32_t len = au_len_;
+	au_len_ = 0;
+	RETURN_IF_FAIL(len > 0);
+
+	pj_uint32_t sps = 0, sps_len = 0, pps = 0, pps_len = 0;
+	pj_bool_t idr = PJ_FALSE;
+	pj_uint32_t offset = 0, nal, nal_len;
+	while(next_nal(au_buf_, len, offset, nal, nal_len))
+	{
+		pj_uint8_t type = au_buf_[nal] & 0x1f;
+		if(type == 7 && sps_len == 0)
+		{
+			sps = nal;
+			sps_len = nal_len;
+		}
+		else if(type == 8 && pps_len == 0)
+		{
+			pps = nal;
+			pps_len = nal_len;
+		}
+		else if(type == 5)
+		{
+			idr = PJ_TRUE;
+		}
+	}
+	pj_bool_t keyframe = idr || (sps_len > 0 && pps_len > 0) ? PJ_TRUE : PJ_FALSE;
+
+	if(format_ == nullptr)
+	{
+		RETURN_IF_FAIL(sps_len > 0 && pps_len > 0);
+
+		static const pj_uint8_t start_code[] = {0, 0, 0, 1};
+		vector<pj_uint8_t> extradata;
+		extradata.insert(extradata.end(), start_code, start_code + sizeof(start_code));
+		extradata.insert(extradata.end(), au_buf_ + sps, au_buf_ + sps + sps_len);
+		extradata.insert(extradata.end(), start_code, start_code + sizeof(start_code));
+		extradata.insert(extradata.end(), au_buf_ + pps, au_buf_ + pps + pps_len);
+		if(Start(au_arrival_, &extradata[0], extradata.size()) != PJ_SUCCESS)
+		{
+			failed_ = PJ_TRUE;
+			return;
+		}
+	}
+	RETURN_IF_FAIL(video_ != nullptr);
+
+	WriteFrame(video_, video_track_, au_ts_, au_arrival_, VIDEO_CLOCK_RATE, au_buf_, len, 0, keyframe);
+}
+
+// ƵûƵʼдƵ, Ƶûӵһʼ
+void Recording::OnAudio(const record_packet_t &packet)
+{
+	const pjmedia_rtp_hdr *hdr;
+	const void *payload;
+	unsigned payloadlen;
+	pj_status_t status;
+	status = pjmedia_rtp_decode_rtp(NULL, packet.data_, packet.len_, &hdr, &payload, &payloadlen);
+	RETURN_IF_FAIL(status == PJ_SUCCESS && hdr->pt == RTP_MEDIA_AUDIO_TYPE);
+	RETURN_IF_FAIL(payloadlen > 0 && payloadlen % 2 == 0);
+
+	if(format_ == nullptr)
+	{
+		RETURN_IF_FAIL(video_ssrc_ == 0);
+		if(Start(packet.arrival_, nullptr, 0) != PJ_SUCCESS)
+		{
+			failed_ = PJ_TRUE;
+			return;
+		}
+	}
+	RETURN_IF_FAIL(audio_ != nullptr);
+
+	WriteFrame(audio_, audio_track_, pj_ntohl(hdr->ts), packet.arrival_, AUDIO_CLOCK_RATE,
+		(const pj_uint8_t *)payload, payloadlen, payloadlen / 2, PJ_TRUE);
+}
+
+/**
+ * װдԶAVIOContext, RECORD_IO_BUFFERŻصһWritePacket,
+ * ˳дÿһСͬҰ, ֻзװͷдͷʱд.
+ * mp4/mov÷Ƭʽд, 쳣˳ʱдĲԿɲ.
+ */
+pj_status_t Recording::Start(const pj_timestamp &arrival, const pj_uint8_t *extradata, pj_uint32_t extradata_len)
+{
+	start_ = arrival;
+
+	AVOutputFormat *format = av_guess_format(NULL, path_.c_str(), NULL);
+	if(format == nullptr)
+	{
+		PJ_LOG(2, (__ABS_FILE__, "Start() => no muxer for %s", path_.c_str()));
+		return PJ_ENOTSUP;
+	}
+
+	// L1616λPCM, ԭд. mp4MPEG-TSûӳ, ֻ¼Ƶ; mov, mkvȿԴ
+	pj_bool_t with_audio = PJ_FALSE;
+	if(audio_ssrc_ > 0 && (g_client_config.audio_enable || g_client_config.speaker_enable))
+	{
+		with_audio = avformat_query_codec(format, AV_CODEC_ID_PCM_S16BE, FF_COMPLIANCE_NORMAL) == 1 ? PJ_TRUE : PJ_FALSE;
+		if(!with_audio)
+		{
+			PJ_LOG(3, (__ABS_FILE__, "Start() => user[%lld] muxer[%s] can not carry L16, audio not recorded",
+				user_id_, format->name));
+		}
+	}
+
+	// ûпдʱļ
+	if(extradata_len == 0 && !with_audio)
+	{
+		PJ_LOG(2, (__ABS_FILE__, "Start() => user[%lld] muxer[%s] has nothing to record", user_id_, format->name));
+		return PJ_ENOTSUP;
+	}
+
+	pj_status_t status;
+	status = pj_file_open(pool_, path_.c_str(), PJ_O_WRONLY, &fd_);
+	if(status != PJ_SUCCESS)
+	{
+		PJ_LOG(2, (__ABS_FILE__, "Start() => open %s failed[%d]", path_.c_str(), status));
+		fd_ = nullptr;
+		return status;
+	}
+
+	format_ = avformat_alloc_context();
+	RETURN_VAL_IF_FAIL(format_ != nullptr, PJ_ENOMEM);
+	format_->oformat = format;
+	format_->max_interleave_delta = (int64_t)RECORD_INTERLEAVE_DELTA * 1000;
+
+	unsigned char *io_buf = (unsigned char *)av_malloc(RECORD_IO_BUFFER);
+	RETURN_VAL_IF_FAIL(io_buf != nullptr, PJ_ENOMEM);
+	format_->pb = avio_alloc_context(io_buf, RECORD_IO_BUFFER, 1, this, NULL, &Recording::WritePacket, &Recording::Seek);
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(format_->pb != nullptr, av_free(io_buf), PJ_ENOMEM);
+	format_->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+	if(extradata_len > 0)
+	{
+		video_ = avformat_new_stream(format_, NULL);
+		RETURN_VAL_IF_FAIL(video_ != nullptr, PJ_ENOMEM);
+
+		AVRational time_base = {1, VIDEO_CLOCK_RATE};
+		AVCodecContext *codec = video_->codec;
+		video_->time_base = time_base;
+		codec->time_base = time_base;
+		codec->codec_type = AVMEDIA_TYPE_VIDEO;
+		codec->codec_id = AV_CODEC_ID_H264;
+		codec->extradata = (uint8_t *)av_mallocz(extradata_len + FF_INPUT_BUFFER_PADDING_SIZE);
+		RETURN_VAL_IF_FAIL(codec->extradata != nullptr, PJ_ENOMEM);
+		pj_memcpy(codec->extradata, extradata, extradata_len);
+		codec->extradata_size = extradata_len;
+		if(format->flags & AVFMT_GLOBALHEADER)
+		{
+			codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+		}
+	}
+
+	if(with_audio)
+	{
+		audio_ = avformat_new_stream(format_, NULL);
+		RETURN_VAL_IF_FAIL(audio_ != nullptr, PJ_ENOMEM);
+
+		AVRational time_base = {1, AUDIO_CLOCK_RATE};
+		AVCodecContext *codec = audio_->codec;
+		audio_->time_base = time_base;
+		codec->time_base = time_base;
+		codec->codec_type = AVMEDIA_TYPE_AUDIO;
+		codec->codec_id = AV_CODEC_ID_PCM_S16BE;
+		codec->sample_rate = AUDIO_CLOCK_RATE;
+		codec->channels = 1;
+		codec->channel_layout = AV_CH_LAYOUT_MONO;
+		codec->sample_fmt = AV_SAMPLE_FMT_S16;
+		codec->bits_per_coded_sample = 16;
+		codec->block_align = 2;
+	}
+
+	// ʶѡķװ
+	AVDictionary *options = nullptr;
+	av_dict_set(&options, "movflags", "frag_keyframe+empty_moov", 0);
+	int ret = avformat_write_header(format_, &options);
+	av_dict_free(&options);
+	if(ret < 0)
+	{
+		PJ_LOG(2, (__ABS_FILE__, "Start() => user[%lld] write %s header failed[%d]", user_id_, format->name, ret));
+		return PJ_EINVAL;
+	}
+	muxing_ = PJ_TRUE;
+
+	PJ_LOG(4, (__ABS_FILE__, "Start() => user[%lld] recording to %s muxer[%s] video[%s] audio[%s]",
+		user_id_, path_.c_str(), format->name, video_ != nullptr ? "h264" : "none", audio_ != nullptr ? "l16" : "none"));
+
+	return PJ_SUCCESS;
+}
+
+/**
+ * ·ԸԵһĵʱ뵽¼ƿʼʱ, ֮RTPʱƽ.
+ * 㵽ʱ󲻵İ(򵽴ľɰ)д, װҪdts.
+ */
+void Recording::WriteFrame(AVStream *stream, record_track_t &track, pj_uint32_t ts, const pj_timestamp &arrival,
+	pj_uint32_t rate, const pj_uint8_t *data, pj_uint32_t len, pj_uint32_t duration, pj_bool_t keyframe)
+{
+	if(!track.started_)
+	{
+		track.started_ = PJ_TRUE;
+		track.pts_ = arrival.u64 > start_.u64 ? (pj_int64_t)pj_elapsed_usec(&start_, &arrival) * rate / 1000000 : 0;
+		track.last_pts_ = -1;
+	}
+	else
+	{
+		track.pts_ += (pj_int32_t)(ts - track.last_ts_);
+	}
+	track.last_ts_ = ts;
+
+	AVRational time_base = {1, (int)rate};
+	pj_int64_t pts = av_rescale_q(track.pts_, time_base, stream->time_base);
+	RETURN_IF_FAIL(pts > track.last_pts_);
+	track.last_pts_ = pts;
+
+	AVPacket packet;
+	av_init_packet(&packet);
+	packet.data = (uint8_t *)data;
+	packet.size = len;
+	packet.stream_index = stream->index;
+	packet.pts = packet.dts = pts;
+	packet.duration = (int)av_rescale_q(duration, time_base, stream->time_base);
+	packet.flags = keyframe ? AV_PKT_FLAG_KEY : 0;
+
+	int ret = av_interleaved_write_frame(format_, &packet);
+	if(ret < 0 && !failed_)
+	{
+		failed_ = PJ_TRUE;
+		PJ_LOG(2, (__ABS_FILE__, "WriteFrame() => user[%lld] write failed[%d] after %u KB, recording stopped",
+			user_id_, ret, (pj_uint32_t)written_kb_));
+	}
+}
+
+// дʧ(ͨ)ֻʧ, ֮ճӶ, հ̲߳Ӱ
+int Recording::WritePacket(void *opaque, uint8_t *buf, int buf_size)
+{
+	Recording *recording = reinterpret_cast<Recording *>(opaque);
+
+	pj_ssize_t size = buf_size;
+	pj_status_t status = pj_file_write(recording->fd_, buf, &size);
+	if(status != PJ_SUCCESS || size != buf_size)
+	{
+		if(!recording->failed_)
+		{
+			recording->failed_ = PJ_TRUE;
+			PJ_LOG(2, (__ABS_FILE__, "WritePacket() => user[%lld] write %s failed[%d] after %u KB, recording stopped",
+				recording->user_id_, recording->path_.c_str(), status, (pj_uint32_t)recording->written_kb_));
+		}
+		return AVERROR(EIO);
+	}
+
+	recording->written_ += size;
+	recording->written_kb_ = (pj_uint32_t)(recording->written_ >> 10);
+
+	return buf_size;
+}
+
+// ṩļС, װֻҪصǰдͷ
+int64_t Recording::Seek(void *opaque, int64_t offset, int whence)
+{
+	Recording *recording = reinterpret_cast<Recording *>(opaque);
+	RETURN_VAL_IF_FAIL(!(whence & AVSEEK_SIZE), -1);
+
+	enum pj_file_seek_type type = PJ_SEEK_SET;
+	switch(whence & ~AVSEEK_FORCE)
+	{
+	case SEEK_CUR:
+		type = PJ_SEEK_CUR;
+		break;
+	case SEEK_END:
+		type = PJ_SEEK_END;
+		break;
+	}
+
+	pj_status_t status;
+	status = pj_file_setpos(recording->fd_, offset, type);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, -1);
+
+	pj_off_t pos;
+	status = pj_file_getpos(recording->fd_, &pos);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, -1);
+
+	return pos;
+}
+
+// д߳, Ѿд֮
+void Recording::Close()
+{
+	if(format_ != nullptr)
+	{
+		if(!failed_)
+		{
+			FlushAu();
+		}
+		if(muxing_ && !failed_)
+		{
+			av_write_trailer(format_);
+		}
+		if(format_->pb != nullptr)
+		{
+			av_freep(&format_->pb->buffer);
+			av_freep(&format_->pb);
+		}
+		avformat_free_context(format_);
+		format_ = nullptr;
+		video_ = audio_ = nullptr;
+	}
+
+	if(fd_ != nullptr)
+	{
+		pj_file_close(fd_);
+		fd_ = nullptr;
+	}
+
+	if(pool_ != nullptr)
+	{
+		pj_pool_release(pool_);
+		pool_ = nullptr;
+	}
+
+	PJ_LOG(4, (__ABS_FILE__, "Close() => user[%lld] recording %s closed, %u KB written, %u packets dropped%s",
+		user_id_, path_.c_str(), (pj_uint32_t)written_kb_, (pj_uint32_t)dropped_, failed_ ? ", failed" : ""));
+}
+
+Recorder::Recorder()
+	: active_(PJ_FALSE)
+	, factory_(nullptr)
+	, write_thread_()
+	, ssrcs_()
+	, recordings_lock_()
+	, recordings_()
+{
+}
+
+pj_status_t Recorder::Prepare(pj_pool_factory *factory)
+{
+	RETURN_VAL_IF_FAIL(factory != nullptr, PJ_EINVAL);
+	factory_ = factory;
+
+	av_register_all();
+
+	// Ŀ¼Ѵʱʧ, Ӱ¼
+	if(g_client_config.record_path.slen > 0)
+	{
+		::CreateDirectoryA(g_client_config.record_path.ptr, NULL);
+	}
+
+	return PJ_SUCCESS;
+}
+
+pj_status_t Recorder::Launch()
+{
+	active_ = PJ_TRUE;
+	write_thread_ = thread(std::bind(&Recorder::WriteThread, this));
+
+	PJ_LOG(5, (__ABS_FILE__, "Launch recorder ok!"));
+
+	return PJ_SUCCESS;
+}
+
+// ȴ·Ƴ¼, д̰߳յİд겢رļ˳
+void Recorder::Destory()
+{
+	{
+		AvRouteUpdate update;
+		while(!ssrcs_.empty())
+		{
+			Stop(ssrcs_.begin()->second);
+		}
+	}
+	g_av_routes.Synchronize();
+
+	active_ = PJ_FALSE;
+	if(write_thread_.joinable())
+	{
+		write_thread_.join();
+	}
+}
+
+/**
+ * ٴѡ¼Ƶûֹͣ. ļΪrecord_pathµ<ûID>_<ʱ>.<record_format>.
+ * ¼ư󶨿ʼʱssrc, ûssrc()Ҫ¿ʼ.
+ */
+pj_bool_t Recorder::Toggle(User *user)
+{
+	RETURN_VAL_IF_FAIL(active_ && user != nullptr, PJ_FALSE);
+
+	pj_uint32_t audio_ssrc, video_ssrc;
+	{
+		AvRouteUpdate update;
+		for(recording_map_t::iterator precording = ssrcs_.begin(); precording != ssrcs_.end(); ++ precording)
+		{
+			if(precording->second->user_id_ == user->user_id_)
+			{
+				Stop(precording->second);
+				return PJ_FALSE;
+			}
+		}
+		audio_ssrc = user->audio_ssrc_;
+		video_ssrc = user->video_ssrc_;
+	}
+	RETURN_VAL_IF_FAIL(audio_ssrc > 0 || video_ssrc > 0, PJ_FALSE);
+
+	{
+		lock_guard<mutex> lock(recordings_lock_);
+		if(recordings_.size() >= RECORD_MAX_RECORDINGS)
+		{
+			PJ_LOG(3, (__ABS_FILE__, "Toggle() => user[%lld] not recorded, already %u recordings", user->user_id_, recordings_.size()));
+			return PJ_FALSE;
+		}
+	}
+
+	pj_time_val now;
+	pj_parsed_time local;
+	pj_gettimeofday(&now);
+	pj_time_gmt_to_local(&now);
+	pj_time_decode(&now, &local);
+
+	const pj_str_t &dir = g_client_config.record_path;
+	pj_bool_t separator = dir.slen > 0 && dir.ptr[dir.slen - 1] != '\\' && dir.ptr[dir.slen - 1] != '/' ? PJ_TRUE : PJ_FALSE;
+	char path[MAX_PATH];
+	pj_ansi_snprintf(path, sizeof(path), "%.*s%s%lld_%04d%02d%02d_%02d%02d%02d.%.*s",
+		(int)dir.slen, dir.ptr, separator ? "\\" : "", user->user_id_,
+		local.year, local.mon + 1, local.day, local.hour, local.min, local.sec,
+		(int)g_client_config.record_format.slen, g_client_config.record_format.ptr);
+
+	Recording *recording = new Recording(user->user_id_, audio_ssrc, video_ssrc, path);
+	if(recording->Open(factory_) != PJ_SUCCESS)
+	{
+		recording->Close();
+		delete recording;
+		return PJ_FALSE;
+	}
+
+	{
+		lock_guard<mutex> lock(recordings_lock_);
+		recordings_.push_back(recording);
+	}
+
+	{
+		AvRouteUpdate update;
+		if(audio_ssrc > 0)
+		{
+			ssrcs_[audio_ssrc] = recording;
+		}
+		if(video_ssrc > 0)
+		{
+			ssrcs_[video_ssrc] = recording;
+		}
+		g_av_routes.Touch();
+	}
+
+	PJ_LOG(4, (__ABS_FILE__, "Toggle() => user[%lld] audio ssrc[%u] video ssrc[%u] start recording to %s",
+		user->user_id_, audio_ssrc, video_ssrc, path));
+
+	return PJ_TRUE;
+}
+
+// ÷g_av_index_lock. ·ɷհ̲߳¼, ֮д̹߳رղɾ
+void Recorder::Stop(Recording *recording)
+{
+	if(recording->audio_ssrc_ > 0)
+	{
+		ssrcs_.erase(recording->audio_ssrc_);
+	}
+	if(recording->video_ssrc_ > 0)
+	{
+		ssrcs_.erase(recording->video_ssrc_);
+	}
+	g_av_routes.Touch();
+	g_av_routes.Defer([recording]() { recording->stopping_ = PJ_TRUE; });
+
+	PJ_LOG(4, (__ABS_FILE__, "Stop() => user[%lld] stop recording", recording->user_id_));
+}
+
+/**
+ * ÷g_av_index_lock, AvRoutes::PublishиĶ, ؽǰ.
+ * ¼ƵssrcѲg_av_index_map(ûҳ, Ͽssrc)ʱղ, ֹͣ¼, תļ.
+ */
+void Recorder::StopUnrouted()
+{
+	vector<Recording *> unrouted;
+	for(recording_map_t::iterator precording = ssrcs_.begin(); precording != ssrcs_.end(); ++ precording)
+	{
+		Recording *recording = precording->second;
+		pj_bool_t routed = (recording->audio_ssrc_ > 0 && g_av_index_map[AUDIO_INDEX].count(recording->audio_ssrc_) > 0)
+			|| (recording->video_ssrc_ > 0 && g_av_index_map[VIDEO_INDEX].count(recording->video_ssrc_) > 0) ? PJ_TRUE : PJ_FALSE;
+		if(!routed && std::find(unrouted.begin(), unrouted.end(), recording) == unrouted.end())
+		{
+			unrouted.push_back(recording);
+		}
+	}
+
+	for(pj_uint32_t i = 0; i < unrouted.size(); ++ i)
+	{
+		PJ_LOG(3, (__ABS_FILE__, "StopUnrouted() => user[%lld] left the wall, recording stopped", unrouted[i]->user_id_));
+		Stop(unrouted[i]);
+	}
+}
+
+pj_bool_t Recorder::GetStats(User *user, record_stats_t &stats)
+{
+	RETURN_VAL_IF_FAIL(user != nullptr, PJ_FALSE);
+
+	lock_guard<std::mutex> lock(g_av_index_lock);
+	for(recording_map_t::iterator precording = ssrcs_.begin(); precording != ssrcs_.end(); ++ precording)
+	{
+		if(precording->second->user_id_ == user->user_id_)
+		{
+			precording->second->GetStats(stats);
+			return PJ_TRUE;
+		}
+	}
+
+	return PJ_FALSE;
+}
+
+/**
+ * Ѹ¼ƵĶд, ûаʱ˯RECORD_POLL_INTERVAL; հ̲߳κλ.
+ * ֹͣ¼ڶдرղɾ, Destory֮д¼˳.
+ */
+void Recorder::WriteThread()
+{
+	pj_thread_desc desc;
+	pj_thread_t *pj_thread = nullptr;
+	if(!pj_thread_is_registered())
+	{
+		pj_thread_register(NULL, desc, &pj_thread);
+	}
+
+	while(PJ_TRUE)
+	{
+		pj_bool_t active = active_;
+		vector<Recording *> recordings;
+		{
+			lock_guard<mutex> lock(recordings_lock_);
+			recordings = recordings_;
+		}
+		RETURN_IF_FAIL(active || !recordings.empty());
+
+		pj_uint32_t written = 0;
+		for(pj_uint32_t i = 0; i < recordings.size(); ++ i)
+		{
+			Recording *recording = recordings[i];
+			pj_bool_t stopping = recording->stopping_;
+			written += recording->Drain();
+			if(!stopping)
+			{
+				continue;
+			}
+
+			// stopping_Ƴ·֮λ, ֮ǰӵİѾȫд
+			recording->Close();
+			{
+				lock_guard<mutex> lock(recordings_lock_);
+				recordings_.erase(std::find(recordings_.begin(), recordings_.end(), recording));
+			}
+			delete recording;
+		}
+
+		if(written == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(RECORD_POLL_INTERVAL));
+		}
+	}
+}
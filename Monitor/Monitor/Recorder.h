@@ -0,0 +1,155 @@
+#ifndef __AVS_PROXY_CLIENT_RECORDER__
+#define __AVS_PROXY_CLIENT_RECORDER__
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <pjmedia-codec.h>
+
+#include "RingQueue.hpp"
+#include "Com.h"
+
+using std::vector;
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+
+#define RECORD_QUEUE_SIZE       4096            // , ÿ·Լ6MB; д̸ʱ°ֱӶ
+#define RECORD_MAX_RECORDINGS   4
+#define RECORD_POLL_INTERVAL    20              // ms, д߳ûаʱѯ, հ̲߳
+#define RECORD_IO_BUFFER        (1 << 20)       // 1MBдһ, ļͷ1MB
+#define RECORD_INTERLEAVE_DELTA 1000            // ms, һ·ͣʱһ·໺ô
+#define RECORD_AU_SIZE          PJMEDIA_MAX_VIDEO_ENC_FRAME_SIZE
+
+// հ߳ԭдһ
+typedef struct
+{
+	pj_uint8_t   media_;             // AUDIO_INDEXVIDEO_INDEX
+	pj_uint16_t  len_;
+	pj_timestamp arrival_;
+	pj_uint8_t   data_[MAX_UDP_DATA_SIZE];
+} record_packet_t;
+
+typedef struct
+{
+	pj_uint32_t written_kb_;
+	pj_uint32_t dropped_;            // İ
+	pj_bool_t   failed_;             // дʧ, ֮İ
+} record_stats_t;
+
+// һ·RTPʱչɴ¼ƿʼƵpts, λΪ·ʱƵ
+typedef struct
+{
+	pj_bool_t   started_;
+	pj_uint32_t last_ts_;
+	pj_int64_t  pts_;
+	pj_int64_t  last_pts_;           // дpts, 򵽴ľɰд
+} record_track_t;
+
+/**
+ * һû¼, 󶨿ʼʱƵssrc. հֻ߳Ű,
+ * ඼д߳: H.264ʱmarkerƴaccess unit, ȵSPS/PPSĹؼ֡ſʼд,
+ * L16ԭд, Ҳ±.
+ */
+class Recording
+	: public Noncopyable
+{
+public:
+	Recording(pj_int64_t user_id, pj_uint32_t audio_ssrc, pj_uint32_t video_ssrc, const std::string &path);
+	~Recording();
+
+	pj_status_t Open(pj_pool_factory *factory);
+	// д߳е
+	pj_uint32_t Drain();
+	void        Close();
+
+	// հ߳е, AvRoutesĿҵ
+	void        Push(pj_uint8_t media, const pj_uint8_t *rtp_frame, pj_uint16_t framelen);
+	void        GetStats(record_stats_t &stats) const;
+
+	const pj_int64_t  user_id_;
+	const pj_uint32_t audio_ssrc_;
+	const pj_uint32_t video_ssrc_;
+	std::atomic<pj_bool_t> stopping_;    // Ѵ·Ƴ, д߳дʣµİر
+
+private:
+	void        OnVideo(const record_packet_t &packet);
+	void        OnAudio(const record_packet_t &packet);
+	void        FlushAu();
+	pj_status_t Start(const pj_timestamp &arrival, const pj_uint8_t *extradata, pj_uint32_t extradata_len);
+	void        WriteFrame(AVStream *stream, record_track_t &track, pj_uint32_t ts, const pj_timestamp &arrival,
+		pj_uint32_t rate, const pj_uint8_t *data, pj_uint32_t len, pj_uint32_t duration, pj_bool_t keyframe);
+
+	static int     WritePacket(void *opaque, uint8_t *buf, int buf_size);
+	static int64_t Seek(void *opaque, int64_t offset, int whence);
+
+	const std::string        path_;
+	RingQueue<record_packet_t> queue_;
+	std::atomic<pj_uint32_t> written_kb_;
+	std::atomic<pj_uint32_t> dropped_;
+	std::atomic<pj_bool_t>   failed_;
+	pj_uint64_t              written_;
+	pj_pool_t               *pool_;
+	pjmedia_h264_packetizer *packetizer_;
+	pj_uint8_t              *au_buf_;
+	unsigned                 au_len_;
+	pj_uint32_t              au_ts_;
+	pj_timestamp             au_arrival_;
+	pj_bool_t                have_seq_;
+	pj_uint16_t              next_seq_;
+	pj_oshandle_t            fd_;
+	AVFormatContext         *format_;
+	AVStream                *video_;
+	AVStream                *audio_;
+	pj_bool_t                muxing_;        // ͷд, رʱҪдβ
+	pj_timestamp             start_;
+	record_track_t           video_track_;
+	record_track_t           audio_track_;
+};
+
+typedef std::unordered_map<pj_uint32_t, Recording *> recording_map_t;   // ƵƵssrc -> ¼
+
+class User;
+
+/**
+ * ѡûյH.264ƵlibavformatԭװMP4/MPEG-TSļ, ʽrecord_formatչ.
+ * ڷַVideoSceneͬһλõ, Žÿ·һоͷ; дڵ߳,
+ * ԶAVIOContextܳɴ鰴д. дֻö󶪰, հ߳.
+ * ʼֹͣڽ߳, ¼еssrcg_av_index_lock޸, հ߳̾AvRoutesĿնȡ.
+ * û뿪(ҳ, Ͽ)а, ֹ֮ͣ¼.
+ */
+class Recorder
+	: public Noncopyable
+{
+public:
+	Recorder();
+
+	pj_status_t Prepare(pj_pool_factory *factory);
+	pj_status_t Launch();
+	void        Destory();
+	// ߳е, PJ_TRUEʾʼ¼, PJ_FALSEʾֹͣ޷ʼ
+	pj_bool_t   Toggle(User *user);
+	pj_bool_t   GetStats(User *user, record_stats_t &stats);
+
+	// ÷g_av_index_lock
+	inline const recording_map_t &Recordings() const { return ssrcs_; }
+	void        StopUnrouted();
+
+private:
+	void WriteThread();
+	void Stop(Recording *recording);
+
+	std::atomic<pj_bool_t> active_;          // ߳д, д̶߳
+	pj_pool_factory       *factory_;
+	thread                 write_thread_;
+	recording_map_t        ssrcs_;           // g_av_index_lock¶д
+	mutex                  recordings_lock_;
+	vector<Recording *>    recordings_;      // ֻд߳ɾ
+};
+
+extern Recorder g_recorder;
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __AVS_PROXY_RING_QUEUE__
+#define __AVS_PROXY_RING_QUEUE__
+
+#include <atomic>
+#include <vector>
+
+#include "Com.h"
+
+/**
+ * ߵߵζ, ȡСcapacity2.
+ * λԤȷ, ڲԭд󷢲, ԭضͷ, .
+ * ʱõnullptr, Ӳȴ. ߳ʱɵ÷֤.
+ */
+template<class T>
+class RingQueue
+	: public Noncopyable
+{
+public:
+	explicit RingQueue(pj_uint32_t capacity)
+		: slots_()
+		, mask_(0)
+		, head_(0)
+		, tail_(0)
+	{
+		pj_uint32_t size = 1;
+		while(size < capacity)
+		{
+			size <<= 1;
+		}
+		slots_.resize(size);
+		mask_ = size - 1;
+	}
+
+	// : һղ, ʱnullptr
+	T *BeginPush()
+	{
+		pj_uint32_t tail = tail_.load(std::memory_order_relaxed);
+		RETURN_VAL_IF_FAIL(tail - head_.load(std::memory_order_acquire) <= mask_, nullptr);
+		return &slots_[tail & mask_];
+	}
+
+	void EndPush()
+	{
+		tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// : Ĳ, ʱnullptr
+	T *Front()
+	{
+		pj_uint32_t head = head_.load(std::memory_order_relaxed);
+		RETURN_VAL_IF_FAIL(head != tail_.load(std::memory_order_acquire), nullptr);
+		return &slots_[head & mask_];
+	}
+
+	void Pop()
+	{
+		head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	inline pj_uint32_t Capacity() const { return mask_ + 1; }
+
+private:
+	vector<T>                slots_;
+	pj_uint32_t              mask_;
+	std::atomic<pj_uint32_t> head_;          // ֻ޸
+	char                     pad_[64];       // Ųͬһ, ߺ߻ʧЧ
+	std::atomic<pj_uint32_t> tail_;          // ֻ޸
+};
+
+#endif
@@ -11,14 +11,6 @@
 using std::vector;
 
 #pragma pack(1)
-typedef struct
-{
-	pj_int64_t  user_id_;
-	pj_uint32_t mic_id_;
-	pj_uint32_t audio_ssrc_;
-	pj_uint32_t video_ssrc_;
-} user_info_t;
-
 typedef struct
 {
 	pj_int32_t room_id_;
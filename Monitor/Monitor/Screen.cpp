@@ -1,6 +1,14 @@
 #include "stdafx.h"
+#include <algorithm>
+
 #include "afxdialogex.h"
 #include "Screen.h"
+#include "StreamMgr.h"
+#include "HealthMonitor.h"
+#include "AudioMixer.h"
+#include "SpeakerIndex.h"
+#include "Recorder.h"
+#include "AvRoutes.h"
 
 #ifdef __ABS_FILE__
 #undef __ABS_FILE__
@@ -13,21 +21,19 @@ BEGIN_MESSAGE_MAP(Screen, CWnd)
 	ON_WM_MOUSELEAVE()
 	ON_WM_LBUTTONUP()
 	ON_WM_LBUTTONDBLCLK()
+	ON_WM_RBUTTONUP()
 END_MESSAGE_MAP()
 
 Screen::Screen(pj_uint32_t index)
 	: CWnd()
 	, user_(nullptr)
 	, index_(index)
-	, window_(nullptr)
-	, render_(nullptr)
-	, texture_(nullptr)
-	, render_mutex_()
-	, audio_thread_pool_(1)
-	, video_thread_pool_(1)
+	, wall_(nullptr)
+	, publish_lock_()
 	, media_active_(PJ_FALSE)
 	, call_status_(0)
 	, stream_(nullptr)
+	, audio_()
 {
 }
 
@@ -35,146 +41,76 @@ Screen::~Screen()
 {
 }
 
-#define WIDTH  320
-#define HEIGHT 240
-
 pj_status_t Screen::Prepare(pj_pool_t *pool,
 							const CRect &rect,
 							const CWnd *wrapper,
-							pj_uint32_t uid)
+							pj_uint32_t uid,
+							CWnd *wall)
 {
-	enum { M = 32 };
+	RETURN_VAL_IF_FAIL(wall != nullptr, PJ_EINVAL);
+	wall_ = wall;
 
+	// ͸Ҳ, ǽϵĻ͸; ߿Compositorڻ
 	BOOL result;
-	result = Create(nullptr, nullptr, WS_VISIBLE | WS_TABSTOP | WS_CHILD | WS_BORDER
-		| TVS_HASBUTTONS | TVS_LINESATROOT | TVS_HASLINES,
+	result = CreateEx(WS_EX_TRANSPARENT, nullptr, nullptr, WS_VISIBLE | WS_TABSTOP | WS_CHILD,
 		rect, (CWnd *)wrapper, uid);
 	RETURN_VAL_IF_FAIL(result, PJ_EINVAL);
 
-	window_ = SDL_CreateWindowFrom(GetSafeHwnd());
-	RETURN_VAL_IF_FAIL(window_ != nullptr, PJ_EINVAL);
-
-	render_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_SOFTWARE);
-	RETURN_VAL_IF_FAIL(render_ != nullptr, PJ_EINVAL);
-
-	texture_ = SDL_CreateTexture(render_, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, WIDTH, HEIGHT);
-	RETURN_VAL_IF_FAIL(texture_ != nullptr, PJ_EINVAL);
-
-	/* Allocate stream */
-    stream_ = PJ_POOL_ZALLOC_T(pool, vid_stream_t);
-    PJ_ASSERT_RETURN(stream_ != NULL, PJ_ENOMEM);
-
-	stream_->dec = PJ_POOL_ZALLOC_T(pool, vid_channel_t);
-    PJ_ASSERT_RETURN(stream_->dec != NULL, PJ_ENOMEM);
-
-	stream_->dec_max_size = WIDTH * HEIGHT * 4;
-	stream_->dec_frame.buf = pj_pool_alloc(pool, stream_->dec_max_size);
-
-	unsigned chunks_per_frm = PJMEDIA_MAX_VIDEO_ENC_FRAME_SIZE / PJMEDIA_MAX_MRU;
-	int frm_ptime = 1000 * 1 / 25;
-	unsigned jb_max = 500 * chunks_per_frm / frm_ptime;
-
-	stream_->rx_frame_cnt = chunks_per_frm * 2;
-    stream_->rx_frames = (pjmedia_frame *)pj_pool_calloc(pool, stream_->rx_frame_cnt,
-                                       sizeof(stream_->rx_frames[0]));
-	pj_str_t name;
-	name.ptr = (char*) pj_pool_alloc(pool, M);
-    name.slen = pj_ansi_snprintf(name.ptr, M, "%s%p", "vstenc", stream_);
-
 	pj_status_t status;
-	status = pjmedia_jbuf_create(pool, &name,
-		PJMEDIA_MAX_MRU,
-		1000 * 1 / 25,
-		jb_max, &stream_->jb);
-	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
-
-	status = pjmedia_rtp_session_init(&stream_->dec->rtp, RTP_MEDIA_VIDEO_TYPE, 0);
-	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
-
-	status = pj_mutex_create_simple(pool, NULL, &stream_->jb_mutex);
-	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
-
-	pjmedia_vid_codec_mgr *codec_mgr = pjmedia_vid_codec_mgr_instance();
-
-	pj_str_t h264_id = pj_str("H264");
-	unsigned info_cnt;
-	const pjmedia_vid_codec_info *codec_info;
-	status = pjmedia_vid_codec_mgr_find_codecs_by_id(codec_mgr,
-		&h264_id, 
-		&info_cnt, 
-		&codec_info,
-		NULL);
-	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
-
-	status = pjmedia_vid_codec_mgr_alloc_codec(codec_mgr, 
-		codec_info,
-		&stream_->codec);
+	status = audio_.Open(pool);
 	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+	g_audio_mixer.Attach(index_, &audio_);
 
-	 /* Init and open the codec. */
-    status = pjmedia_vid_codec_init(stream_->codec, pool);
-    RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
-
-	pjmedia_vid_codec_param info_param;
-	status = pjmedia_vid_codec_mgr_get_default_param(codec_mgr,
-		codec_info,
-		&info_param);
-	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
-
-    status = pjmedia_vid_codec_open(stream_->codec, &info_param);
-	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
-
-	PJ_LOG(5, (__ABS_FILE__, "Prepare screen index[%u] size[%dx%d] ok!", index_, WIDTH, HEIGHT));
+	PJ_LOG(5, (__ABS_FILE__, "Prepare screen index[%u] ok!", index_));
 
 	return PJ_SUCCESS;
 }
 
 pj_status_t Screen::Launch()
 {
-	audio_thread_pool_.Start();
-	video_thread_pool_.Start();
-
 	PJ_LOG(5, (__ABS_FILE__, "Launch screen index[%u] ok!", index_));
 
 	return PJ_SUCCESS;
 }
 
+// ÷ȹرg_audio_mixer, صٶaudio_
 void Screen::Destory()
 {
-	audio_thread_pool_.Stop();
-	video_thread_pool_.Stop();
+	audio_.Close();
 }
 
+// rectΪ, ǽϵĻ
 void Screen::MoveToRect(const CRect &rect)
 {
-	lock_guard<std::mutex> internal_lock(render_mutex_);
 	MoveWindow(rect);
 	ShowWindow(SW_SHOW);
+
+	CRect canvas_rect(rect);
+	GetParent()->MapWindowPoints(wall_, &canvas_rect);
+	tile_rect_t tile = {(pj_uint32_t)MAX(canvas_rect.left, 0), (pj_uint32_t)MAX(canvas_rect.top, 0),
+		(pj_uint32_t)canvas_rect.Width(), (pj_uint32_t)canvas_rect.Height()};
+	g_compositor.SetTile(index_, tile);
 }
 
 void Screen::HideWindow()
 {
-	lock_guard<std::mutex> internal_lock(render_mutex_);
 	ShowWindow(SW_HIDE);
+
+	tile_rect_t hidden = {0, 0, 0, 0};
+	g_compositor.SetTile(index_, hidden);
 }
 
+// еĻɺɫ
 void Screen::UpdateWindow()
 {
-	lock_guard<std::mutex> internal_lock(render_mutex_);
-	ShowWindow(SW_HIDE);
-	ShowWindow(SW_SHOW);
+	lock_guard<std::mutex> internal_lock(publish_lock_);
+	Painting(video_frame_ptr_t());
 }
 
-void Screen::Painting(const void *pixels)
+// ÷publish_lock_. Compositorĳ߳ŽϱĻĸ
+void Screen::Painting(const video_frame_ptr_t &frame)
 {
-	lock_guard<std::mutex> internal_lock(render_mutex_);
-	int pitch = WIDTH * SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_IYUV);
-	SDL_Rect sdl_rect = {0, 0, WIDTH, HEIGHT};
-
-	SDL_UpdateTexture(texture_, &sdl_rect, pixels, pixels != nullptr ? pitch : 0);
-	SDL_RenderClear(render_);
-	SDL_RenderCopy(render_, texture_, NULL, NULL);
-	SDL_RenderPresent(render_);
+	g_compositor.Publish(index_, frame);
 }
 
 void Screen::AudioScene(const pj_uint8_t *rtp_frame, pj_uint16_t framelen)
@@ -185,229 +121,160 @@ void Screen::AudioScene(const pj_uint8_t *rtp_frame, pj_uint16_t framelen)
 	}
 	RETURN_IF_FAIL(rtp_frame && framelen > 0);
 
-	audio_thread_pool_.Schedule(std::bind(&Screen::OnRxAudio, this, vector<pj_uint8_t>(rtp_frame, rtp_frame + framelen)));
+	audio_.Put(rtp_frame, framelen);
 }
 
-void Screen::OnRxAudio(const vector<pj_uint8_t> &audio_frame)
+/**
+ * VideoStream߳е, ֻ, ᱻֻ߳.
+ * ѻĽֱ֡Ӷ; ֱ仯ػCompositorĵǰ֡.
+ */
+void Screen::OnVideoFrame(VideoStream *stream, video_frame_ptr_t frame)
 {
-	RETURN_IF_FAIL(audio_frame.size() > 0);
-}
+	RETURN_IF_FAIL(frame);
 
-void Screen::VideoScene(const pj_uint8_t *rtp_frame, pj_uint16_t framelen)
-{
-	{
-		lock_guard<mutex> lock(media_active_lock_);
-		RETURN_IF_FAIL(media_active_);
-	}
-	RETURN_IF_FAIL(rtp_frame && framelen > 0);
+	lock_guard<std::mutex> internal_lock(publish_lock_);
+	RETURN_IF_FAIL(stream == stream_);
 
-	/*vector<pj_uint8_t>(rtp_frame, rtp_frame + framelen) */
-	pj_uint8_t *frame = new pj_uint8_t[framelen];
-	memcpy(frame, rtp_frame, framelen);
+	Painting(frame);
+}
 
-	video_thread_pool_.Schedule(std::bind(&Screen::OnRxVideo, this, shared_ptr<pj_uint8_t>(frame), framelen));
+pj_status_t Screen::GetUser(User *&user)
+{
+	return (user = const_cast<User *>(user_)) != nullptr ? PJ_SUCCESS : PJ_ENOTFOUND;
 }
 
-void Screen::OnRxVideo(shared_ptr<pj_uint8_t> video_frame, pj_uint16_t framelen)
+/**
+ * ûûĻ(δʾԤȡ)ʱĻΪĻ, ·ָ, ƵҲﲥ;
+ * ĻֻǾ, Ļͬһ.
+ */
+pj_status_t Screen::ConnectUser(User *user)
 {
-	RETURN_IF_FAIL(framelen > 0);
+	RETURN_VAL_IF_FAIL(user, PJ_EINVAL);
 
-	pj_status_t status;
-	const pjmedia_rtp_hdr *hdr;
-	const void *payload;
-	unsigned payloadlen;
-	pjmedia_rtp_status seq_st;
-
-	status = pjmedia_rtp_decode_rtp(&stream_->dec->rtp, video_frame.get(), framelen,
-				&hdr, &payload, &payloadlen);
-	if(status == PJ_SUCCESS)
 	{
-		pjmedia_rtp_session_update2(&stream_->dec->rtp, hdr, &seq_st, PJ_TRUE);
-		if (payloadlen == 0)
-			return;
-
-		pj_mutex_lock(stream_->jb_mutex);
-
-		if ((pj_ntohl(hdr->ts) != stream_->dec_frame.timestamp.u32.lo) || hdr->m) {
-			/* Only decode if we don't already have decoded one,
-				* unless the jb is full.
-				*/
-			pj_bool_t can_decode = PJ_FALSE;
+		AvRouteUpdate update;
 
-			if (pjmedia_jbuf_is_full(stream_->jb)) {
-				can_decode = PJ_TRUE;
-			}
-			else if (stream_->dec_frame.size == 0) {
-				can_decode = PJ_TRUE;
-			}
-
-			if (can_decode) {
-				stream_->dec_frame.size = stream_->dec_max_size;  // Width * Height * max_color_depth(4)
-				if (decode_vid_frame() != PJ_SUCCESS) {
-					stream_->dec_frame.size = 0;
-				}
-			}
+		SwapUser(user);
+		if(user->screen_ == nullptr)
+		{
+			user->ConnectScreen(this, index_);
 		}
-
-		if (seq_st.status.flag.restart) {
-			status = pjmedia_jbuf_reset(stream_->jb);
-			PJ_LOG(4,(__FILE__, "Jitter buffer reset"));
-		} else {
-			/* Just put the payload into jitter buffer */
-			pjmedia_jbuf_put_frame3(stream_->jb, payload, payloadlen, 0, 
-				hdr->seq, hdr->ts, NULL);
+		else
+		{
+			user->mirrors_.push_back(this);
 		}
-
-		pj_mutex_unlock(stream_->jb_mutex);
 	}
 
-	if (stream_->dec_frame.type == PJMEDIA_FRAME_TYPE_VIDEO
-		&& stream_->dec_frame.size > 0)
+	PJ_LOG(5, (__ABS_FILE__, "screen[%u] was connected to new user[%ld]", index_, user->user_id_));
+
+	return PJ_SUCCESS;
+}
+
+pj_status_t Screen::DisconnectUser()
+{
+	RETURN_VAL_IF_FAIL(user_, PJ_EINVAL);
+
 	{
-		Painting(stream_->dec_frame.buf);
-		stream_->dec_frame.size = 0;
+		AvRouteUpdate update;
+		DetachUser();
 	}
+	this->UpdateWindow();
+
+	return PJ_SUCCESS;
 }
 
-pj_status_t Screen::decode_vid_frame()
+// ÷g_av_index_lock. ĻϿʱɵһ, ûоɾ·
+void Screen::DetachUser()
 {
-    pj_uint32_t last_ts = 0;
-    int frm_first_seq = 0, frm_last_seq = 0;
-    pj_bool_t got_frame = PJ_FALSE;
-    unsigned cnt;
-    pj_status_t status;
-
-	/* Check if we got a decodable frame */
-    for (cnt=0; ; ++cnt)
-	{
-		char ptype;
-		pj_uint32_t ts;
-		int seq;
-
-		/* Peek frame from jitter buffer. */
-		pjmedia_jbuf_peek_frame(stream_->jb, cnt, NULL, NULL,
-					&ptype, NULL, &ts, &seq);
-		if (ptype == PJMEDIA_JB_NORMAL_FRAME)
-		{
-			if (last_ts == 0)
-			{
-				last_ts = ts;
-				frm_first_seq = seq;
-			}
-			if (ts != last_ts)
-			{
-				got_frame = PJ_TRUE;
-				break;
-			}
-			frm_last_seq = seq;
-		}
-		else if (ptype == PJMEDIA_JB_ZERO_EMPTY_FRAME)
-		{
-			/* No more packet in the jitter buffer */
-			break;
-		}
-    }
+	RETURN_IF_FAIL(user_);
 
-    if (got_frame)
-	{
-		unsigned i;
+	PJ_LOG(5, (__ABS_FILE__, "screen[%u] was disconnected. Old user[%ld]", index_, user_->user_id_));
 
-		/* Generate frame bitstream from the payload */
-		if (cnt > stream_->rx_frame_cnt)
+	User *old_user = user_;
+	SwapUser(nullptr);
+	if(old_user->screen_ == this)
+	{
+		if(!old_user->mirrors_.empty())
 		{
-			PJ_LOG(1,(__FILE__, "Discarding %u frames because array is full!",
-				cnt - stream_->rx_frame_cnt));
-			pjmedia_jbuf_remove_frame(stream_->jb, cnt - stream_->rx_frame_cnt);
-			cnt = stream_->rx_frame_cnt;
+			Screen *primary = old_user->mirrors_.front();
+			old_user->mirrors_.erase(old_user->mirrors_.begin());
+			old_user->ConnectScreen(primary, primary->GetIndex());
 		}
-
-		for (i = 0; i < cnt; ++i)
+		else
 		{
-			char ptype;
-
-			stream_->rx_frames[i].type = PJMEDIA_FRAME_TYPE_VIDEO;
-			stream_->rx_frames[i].timestamp.u64 = last_ts;
-			stream_->rx_frames[i].bit_info = 0;
-
-			/* We use jbuf_peek_frame() as it will returns the pointer of
-			 * the payload (no buffer and memcpy needed), just as we need.
-			 */
-			pjmedia_jbuf_peek_frame(stream_->jb, i,
-				(const void**)&stream_->rx_frames[i].buf,
-				&stream_->rx_frames[i].size, &ptype,
-				NULL, NULL, NULL);
-
-			if (ptype != PJMEDIA_JB_NORMAL_FRAME)
-			{
-				/* Packet lost, must set payload to NULL and keep going */
-				stream_->rx_frames[i].buf = NULL;
-				stream_->rx_frames[i].size = 0;
-				stream_->rx_frames[i].type = PJMEDIA_FRAME_TYPE_NONE;
-				continue;
-			}
+			old_user->DisconnectScreen();
 		}
-
-		/* Decode */
-		status = pjmedia_vid_codec_decode(stream_->codec, cnt,
-			stream_->rx_frames,
-			(unsigned)stream_->dec_frame.size, &stream_->dec_frame);
-		if (status != PJ_SUCCESS)
+	}
+	else
+	{
+		vector<Screen *>::iterator pmirror = std::find(old_user->mirrors_.begin(), old_user->mirrors_.end(), this);
+		if(pmirror != old_user->mirrors_.end())
 		{
-			stream_->dec_frame.type = PJMEDIA_FRAME_TYPE_NONE;
-			stream_->dec_frame.size = 0;
+			old_user->mirrors_.erase(pmirror);
 		}
-
-		pjmedia_jbuf_remove_frame(stream_->jb, cnt);
-    }
-
-	/* Learn remote frame rate after successful decoding */
-    if (stream_->dec_frame.type == PJMEDIA_FRAME_TYPE_VIDEO
-		&& stream_->dec_frame.size)
-    {
-		stream_->last_dec_seq = frm_last_seq;
-		stream_->last_dec_ts = last_ts;
 	}
-
-	return got_frame ? PJ_SUCCESS : PJ_ENOTFOUND;
 }
 
-pj_status_t Screen::GetUser(User *&user)
+/**
+ * ÷g_av_index_lock, ·ɱɵ÷޸.
+ * ˶ûĽ, ûĽ: нʱʾһ֡,
+ * StreamMgr½ӻGOP. ޷ֲʱǼǵȴ, н黹Resubscribe().
+ */
+void Screen::SwapUser(User *user)
 {
-	return (user = const_cast<User *>(user_)) != nullptr ? PJ_SUCCESS : PJ_ENOTFOUND;
-}
-
-pj_status_t Screen::ConnectUser(User *user)
-{
-	RETURN_VAL_IF_FAIL(user, PJ_EINVAL);
+	g_stream_mgr.Cancel(this);
 
 	{
 		lock_guard<mutex> lock(media_active_lock_);
-		media_active_ = PJ_TRUE;
+		media_active_ = user != nullptr ? PJ_TRUE : PJ_FALSE;
 	}
 	user_ = user;
-	user_->ConnectScreen(this, index_);
+	audio_.Reset();
 
-	PJ_LOG(5, (__ABS_FILE__, "screen[%u] was connected to new user[%ld]", index_, user->user_id_));
+	VideoStream *old_stream = stream_;
+	VideoStream *new_stream = nullptr;
+	if(user != nullptr && user->video_ssrc_ > 0)
+	{
+		new_stream = g_stream_mgr.Acquire(user->video_ssrc_);
+	}
 
-	return PJ_SUCCESS;
+	{
+		lock_guard<std::mutex> internal_lock(publish_lock_);
+		stream_ = new_stream;
+		Painting(video_frame_ptr_t());
+	}
+
+	if(old_stream != nullptr)
+	{
+		old_stream->Unsubscribe(this);
+		g_stream_mgr.Release(old_stream);
+	}
+
+	if(new_stream != nullptr)
+	{
+		new_stream->Subscribe(this);
+	}
+	else if(user != nullptr && user->video_ssrc_ > 0)
+	{
+		g_stream_mgr.Wait(this);
+	}
 }
 
-pj_status_t Screen::DisconnectUser()
+// ÷g_av_index_lock. ûʱûֵ, ʵ黹һ
+void Screen::Resubscribe()
 {
-	RETURN_VAL_IF_FAIL(user_, PJ_EINVAL);
+	RETURN_IF_FAIL(user_ != nullptr && user_->video_ssrc_ > 0 && stream_ == nullptr);
 
-	PJ_LOG(5, (__ABS_FILE__, "screen[%u] was disconnected. Old user[%ld]", index_, user_->user_id_));
+	VideoStream *stream = g_stream_mgr.Acquire(user_->video_ssrc_);
+	RETURN_WITH_STATEMENT_IF_FAIL(stream != nullptr, g_stream_mgr.Wait(this));
 
 	{
-		lock_guard<mutex> lock(media_active_lock_);
-		media_active_ = PJ_FALSE;
+		lock_guard<std::mutex> internal_lock(publish_lock_);
+		stream_ = stream;
 	}
+	stream->Subscribe(this);
 
-	user_->DisconnectScreen();
-	user_ = nullptr;
-	this->UpdateWindow();
-
-	return PJ_SUCCESS;
+	PJ_LOG(5, (__ABS_FILE__, "screen[%u] got decoder for ssrc[%u] after waiting", index_, user_->video_ssrc_));
 }
 
 static Screen *old_screen = nullptr;
@@ -436,8 +303,76 @@ void Screen::OnMouseMove(UINT nFlags, CPoint point)
 			TitleRoom *title_room = user_->title_room_;
 			if(title_room != nullptr)
 			{
-				WCHAR coords[128];
-				swprintf_s(coords, ARRAYSIZE(coords), _T("ID: %d ûID: %ld"), title_room->id_, user_->user_id_);
+				VideoStream *stream = stream_;
+
+				WCHAR coords[400];
+				int len = swprintf_s(coords, ARRAYSIZE(coords), _T("ID: %d ûID: %ld"), title_room->id_, user_->user_id_);
+				// ղհͽ. ѱ黹°󶨵ssrc, ǱûͳƲʾ
+				stream_stats_t stats;
+				if(stream != nullptr)
+				{
+					stream->GetStats(stats);
+				}
+				if(stream != nullptr && len > 0
+					&& stats.rx_.ssrc_ == user_->video_ssrc_ && stats.dec_.ssrc_ == user_->video_ssrc_)
+				{
+					swprintf_s(coords + len, ARRAYSIZE(coords) - len, _T("\n: %d/%u : %ums : %ukbps ֡: %u/%u ӳp95: %ums"),
+						stats.rx_.lost_, stats.rx_.expected_, stats.rx_.jitter_usec_ / 1000, stats.rx_.bitrate_ / 1000,
+						stats.dec_.fps_, stats.rx_.fps_, StreamStats::Percentile(stats.dec_.latency_, 95));
+
+					if(g_client_config.analytics_enable)
+					{
+						analytics_snapshot_t analytics;
+						stream->GetAnalytics(analytics);
+						pj_uint32_t alarms = stream->GetAlarms();
+						len = (int)wcslen(coords);
+						swprintf_s(coords + len, ARRAYSIZE(coords) - len, _T("\n: %u ˶: %u.%02u 澯: %s%s%s%s"),
+							analytics.mean_, analytics.motion_ / 100, analytics.motion_ % 100,
+							alarms == 0 ? _T("") : _T(""),
+							(alarms & VIDEO_ALARM_FREEZE) ? _T(" ") : _T(""),
+							(alarms & VIDEO_ALARM_BLACK) ? _T(" ") : _T(""),
+							(alarms & VIDEO_ALARM_LOW_MOTION) ? _T("˶") : _T(""));
+					}
+				}
+
+				tile_counters_t counters;
+				len = (int)wcslen(coords);
+				if(g_compositor.GetCounters(index_, counters) == PJ_SUCCESS)
+				{
+					swprintf_s(coords + len, ARRAYSIZE(coords) - len, _T("\n: %u : %u : %u"),
+						counters.decoded_, counters.presented_, counters.dropped_);
+				}
+
+				len = (int)wcslen(coords);
+				if(g_audio_mixer.Monitored(index_))
+				{
+					swprintf_s(coords + len, ARRAYSIZE(coords) - len, _T("\n : -%udBov ֵ: %u"),
+						audio_.Level(), audio_.Peak());
+				}
+
+				speaker_state_t speaker;
+				len = (int)wcslen(coords);
+				if(g_client_config.speaker_enable && g_speaker_index.GetSpeaker(user_->audio_ssrc_, speaker))
+				{
+					swprintf_s(coords + len, ARRAYSIZE(coords) - len, _T("\n˵: %u/1000 %s : -%udBov%s"),
+						speaker.score_ / 1000, speaker.speaking_ ? _T("(˵)") : _T(""), speaker.level_,
+						speaker.ext_level_ ? _T("(ͷչ)") : _T(""));
+				}
+
+				record_stats_t record;
+				len = (int)wcslen(coords);
+				if(g_recorder.GetStats(user_, record))
+				{
+					swprintf_s(coords + len, ARRAYSIZE(coords) - len, _T("\n¼ %uKB : %u%s"),
+						record.written_kb_, record.dropped_, record.failed_ ? _T(" дʧ") : _T(""));
+				}
+
+				health_snapshot_t health;
+				len = (int)wcslen(coords);
+				if(g_client_config.health_enable && g_health_monitor.GetHealth(user_->video_ssrc_, health))
+				{
+					swprintf_s(coords + len, ARRAYSIZE(coords) - len, _T("\nԾ: %u"), health.nal_.activity_);
+				}
 				g_toolItem.lpszText = coords;
 				::SendMessage(g_hwndTrackingTT, TTM_SETTOOLINFO, 0, (LPARAM)&g_toolItem);
 
@@ -471,12 +406,36 @@ void Screen::OnMouseLeave()
 	CWnd::OnMouseLeave();
 }
 
+// סCtrlʱΪ, ûԭڵĻֲ.
+// ѡеĸӳΪĸ; ӵûĻ
 void Screen::OnLButtonUp(UINT nFlags, CPoint point)
 {
-	sinashow::SendMessage(WM_LINK_ROOM_USER, (WPARAM)0, (LPARAM)index_);
+	sinashow::SendMessage(WM_LINK_ROOM_USER, (WPARAM)((nFlags & MK_CONTROL) ? PJ_TRUE : PJ_FALSE), (LPARAM)index_);
+
+	if(!(nFlags & MK_CONTROL))
+	{
+		pj_uint32_t listen_idx = index_;
+		{
+			lock_guard<mutex> lock(g_av_index_lock);
+			if(user_ != nullptr && user_->screen_idx_ < MAXIMAL_SCREEN_NUM)
+			{
+				listen_idx = user_->screen_idx_;
+			}
+		}
+		g_audio_mixer.Focus(listen_idx);
+	}
 }
 
 void Screen::OnLButtonDblClk(UINT nFlags, CPoint point)
 {
 	sinashow::SendMessage(WM_UNLINK_ROOM_USER, (WPARAM)user_, (LPARAM)this);
 }
+
+// Ҽʼֹͣ¼Ƹϵû, ʾ´ƶʱˢ
+void Screen::OnRButtonUp(UINT nFlags, CPoint point)
+{
+	RETURN_IF_FAIL(user_ != nullptr);
+
+	g_recorder.Toggle(user_);
+	old_screen = nullptr;
+}
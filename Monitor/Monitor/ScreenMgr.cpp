@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include "ScreenMgr.h"
+#include "AvRoutes.h"
+#include "AudioKernels.h"
 
 #ifdef __ABS_FILE__
 #undef __ABS_FILE__
@@ -19,6 +21,18 @@ void ScreenMgr::event_func_proxy(evutil_socket_t fd, short event, void *arg)
 	(*pfunction)(fd, event, arg);
 }
 
+// ¼߳˳, ͬʱͷevent_newʱĻص
+static void free_event(struct event *&ev)
+{
+	RETURN_IF_FAIL(ev != nullptr);
+
+	ev_function_t *pfunction = reinterpret_cast<ev_function_t *>(event_get_callback_arg(ev));
+	event_del(ev);
+	event_free(ev);
+	delete pfunction;
+	ev = nullptr;
+}
+
 ScreenMgr::ScreenMgr(CWnd *wrapper,
 					 pj_uint16_t client_id,
 					 const pj_str_t &local_ip,
@@ -37,14 +51,24 @@ ScreenMgr::ScreenMgr(CWnd *wrapper,
 	, tcp_ev_(nullptr)
 	, udp_ev_(nullptr)
 	, pipe_ev_(nullptr)
+	, rtcp_ev_(nullptr)
+	, health_ev_(nullptr)
+	, analytics_ev_(nullptr)
+	, speaker_ev_(nullptr)
+	, reclaim_ev_(nullptr)
 	, evbase_(nullptr)
 	, connector_thread_()
 	, event_thread_()
 	, active_(PJ_FALSE)
 	, titles_(nullptr)
+	, wall_(nullptr)
 	, screenmgr_func_array_()
 	, sync_thread_pool_(1)
+	, resume_thread_pool_(1)
+	, resume_lock_()
+	, resume_cv_()
 	, num_blocks_()
+	, prefetch_users_()
 {
 	round_t round;
 	screenmgr_func_array_.push_back(&ScreenMgr::ChangeLayout_1x1);
@@ -134,15 +158,103 @@ pj_status_t ScreenMgr::Prepare()
 	ret = event_add(pipe_ev_, NULL);
 	RETURN_VAL_IF_FAIL(ret == 0, PJ_EINVAL);
 
+	if(g_client_config.rtcp_enable)
+	{
+		function = std::bind(&ScreenMgr::EventOnRtcpTimer, this, std::placeholders::_1, std::placeholders::_2, nullptr);
+		pfunction = new ev_function_t(function);
+		rtcp_ev_ = event_new(evbase_, -1, EV_PERSIST, event_func_proxy, pfunction);
+		RETURN_VAL_IF_FAIL(rtcp_ev_ != nullptr, PJ_EINVAL);
+
+		struct timeval interval = {0, RTCP_TIMER_INTERVAL * 1000};
+		ret = event_add(rtcp_ev_, &interval);
+		RETURN_VAL_IF_FAIL(ret == 0, PJ_EINVAL);
+	}
+
+	if(g_client_config.health_enable)
+	{
+		function = std::bind(&ScreenMgr::EventOnHealthTimer, this, std::placeholders::_1, std::placeholders::_2, nullptr);
+		pfunction = new ev_function_t(function);
+		health_ev_ = event_new(evbase_, -1, EV_PERSIST, event_func_proxy, pfunction);
+		RETURN_VAL_IF_FAIL(health_ev_ != nullptr, PJ_EINVAL);
+
+		struct timeval interval = {HEALTH_CHECK_INTERVAL / 1000, (HEALTH_CHECK_INTERVAL % 1000) * 1000};
+		ret = event_add(health_ev_, &interval);
+		RETURN_VAL_IF_FAIL(ret == 0, PJ_EINVAL);
+	}
+
+	if(g_client_config.speaker_enable)
+	{
+		function = std::bind(&ScreenMgr::EventOnSpeakerTimer, this, std::placeholders::_1, std::placeholders::_2, nullptr);
+		pfunction = new ev_function_t(function);
+		speaker_ev_ = event_new(evbase_, -1, EV_PERSIST, event_func_proxy, pfunction);
+		RETURN_VAL_IF_FAIL(speaker_ev_ != nullptr, PJ_EINVAL);
+
+		struct timeval interval = {SPEAKER_CHECK_INTERVAL / 1000, (SPEAKER_CHECK_INTERVAL % 1000) * 1000};
+		ret = event_add(speaker_ev_, &interval);
+		RETURN_VAL_IF_FAIL(ret == 0, PJ_EINVAL);
+	}
+
+	if(g_client_config.analytics_enable)
+	{
+		function = std::bind(&ScreenMgr::EventOnAnalyticsTimer, this, std::placeholders::_1, std::placeholders::_2, nullptr);
+		pfunction = new ev_function_t(function);
+		analytics_ev_ = event_new(evbase_, -1, EV_PERSIST, event_func_proxy, pfunction);
+		RETURN_VAL_IF_FAIL(analytics_ev_ != nullptr, PJ_EINVAL);
+
+		struct timeval interval = {ANALYTICS_CHECK_INTERVAL / 1000, (ANALYTICS_CHECK_INTERVAL % 1000) * 1000};
+		ret = event_add(analytics_ev_, &interval);
+		RETURN_VAL_IF_FAIL(ret == 0, PJ_EINVAL);
+	}
+
+	// ·ʱɿջжߵ, Ż
+	function = std::bind(&ScreenMgr::EventOnReclaimTimer, this, std::placeholders::_1, std::placeholders::_2, nullptr);
+	pfunction = new ev_function_t(function);
+	reclaim_ev_ = event_new(evbase_, -1, EV_PERSIST, event_func_proxy, pfunction);
+	RETURN_VAL_IF_FAIL(reclaim_ev_ != nullptr, PJ_EINVAL);
+
+	struct timeval reclaim_interval = {0, AV_ROUTES_RECLAIM_INTERVAL * 1000};
+	ret = event_add(reclaim_ev_, &reclaim_interval);
+	RETURN_VAL_IF_FAIL(ret == 0, PJ_EINVAL);
+
+	status = g_gop_cache.Prepare(&caching_pool_.factory, g_client_config.gop_cache_size * 1024);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	status = g_stream_mgr.Prepare(&caching_pool_.factory, g_client_config.max_decoders);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	status = g_recorder.Prepare(&caching_pool_.factory);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	status = g_directory_snapshot.Prepare(g_client_config.snapshot_file_name);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
 	titles_ = new TitlesCtl();
 	pj_assert(titles_ != nullptr);
-	status = titles_->Prepare(wrapper_, IDC_ROOM_TREE_CTL_INDEX);
+	status = titles_->Prepare(wrapper_, IDC_ROOM_TREE_CTL_INDEX, &caching_pool_.factory);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	// ڸScreen, Zλ֮
+	wall_ = new CWnd();
+	pj_assert(wall_ != nullptr);
+	BOOL result = wall_->Create(nullptr, nullptr, WS_VISIBLE | WS_CHILD,
+		CRect(MININUM_TREE_CTL_WIDTH, 0, MININUM_TREE_CTL_WIDTH + width_, height_), (CWnd *)wrapper_, IDC_WALL_BASE_INDEX + MAXIMAL_SCREEN_NUM);
+	RETURN_VAL_IF_FAIL(result, PJ_EINVAL);
+
+	ImageKernels::Init(g_client_config.image_kernels);
+	AudioKernels::Init(g_client_config.image_kernels);
+	status = g_compositor.Prepare(wall_->GetSafeHwnd(), g_client_config.compositor);
 	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
 
 	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
 	{
 		screens_[idx] = new Screen(idx);
-		status = screens_[idx]->Prepare(pool_, CRect(0, 0, width_, height_), wrapper_, IDC_WALL_BASE_INDEX + idx);
+		status = screens_[idx]->Prepare(pool_, CRect(0, 0, width_, height_), wrapper_, IDC_WALL_BASE_INDEX + idx, wall_);
+	}
+
+	// ûʱֻǲ, ӰƵ
+	if(g_client_config.audio_enable && g_audio_mixer.Prepare(g_client_config.audio_mix) != PJ_SUCCESS)
+	{
+		PJ_LOG(3, (__ABS_FILE__, "Prepare() => audio disabled, no usable audio device"));
 	}
 
 	PJ_LOG(5, (__ABS_FILE__, "Prepare screenmgr ok!"));
@@ -158,11 +270,17 @@ pj_status_t ScreenMgr::Launch()
 
 	event_thread_ = thread(std::bind(&ScreenMgr::EventThread, this));
 	sync_thread_pool_.Start();
+	resume_thread_pool_.Start();
+	g_directory_snapshot.Launch();
+	g_compositor.Launch();
+	g_playout_scheduler.Launch();
+	g_recorder.Launch();
 
 	for (pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++idx)
 	{
 		screens_[idx]->Launch();
 	}
+	g_audio_mixer.Launch();
 
 	PJ_LOG(5, (__ABS_FILE__, "Launch screenmgr ok!"));
 
@@ -171,29 +289,87 @@ pj_status_t ScreenMgr::Launch()
 
 void ScreenMgr::Destory()
 {
-	active_ = PJ_FALSE;
+	{
+		lock_guard<mutex> lock(resume_lock_);
+		active_ = PJ_FALSE;
+	}
+	resume_cv_.notify_all();
 	event_base_loopexit(evbase_, NULL);
+	if(event_thread_.joinable())
+	{
+		event_thread_.join();
+	}
+	free_event(rtcp_ev_);
+	free_event(health_ev_);
+	free_event(speaker_ev_);
+	free_event(analytics_ev_);
+	free_event(reclaim_ev_);
 	sync_thread_pool_.Stop();
+	resume_thread_pool_.Stop();
+	g_directory_snapshot.Destory();
+	g_recorder.Destory();
+	g_playout_scheduler.Destory();
+	g_stream_mgr.Destory();
+	g_compositor.Destory();
+	g_audio_mixer.Destory();
+	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+	{
+		screens_[idx]->Destory();
+	}
+	g_rtcp_feedback.Clear();
+	g_health_monitor.Clear();
+	g_speaker_index.Clear();
+	g_av_sync.Clear();
+	g_gop_cache.Destory();
 
 	pj_sock_close(local_tcp_sock_);
 }
 
 pj_status_t ScreenMgr::OnLinkRoom(TitleRoom *title_room, Title *title)
 {
-	vector<pj_uint8_t> response;
-	http_proxy_get(g_client_config.rrtvms_fcgi_host, g_client_config.rrtvms_fcgi_port, g_client_config.rrtvms_fcgi_uri,
-		title_room->id_, response);
-
 	pj_status_t       status;
 	link_room_param_t param = {100, "192.168.6.40", 12000, 13000, title_room};
 
-	status = ParseHttpResponse(param.proxy_id, param.proxy_ip, param.proxy_tcp_port, param.proxy_udp_port, response);
+	// ʹÿеproxy, ʧrrtvmsѯ; Ҳں̨˶һ
+	snapshot_proxy_t cached;
+	if(g_directory_snapshot.GetProxy(title_room->id_, cached))
+	{
+		param.proxy_id       = cached.proxy_id_;
+		param.proxy_ip       = cached.proxy_ip_;
+		param.proxy_tcp_port = cached.tcp_port_;
+		param.proxy_udp_port = cached.udp_port_;
+
+		status = LinkRoom(param);
+		if(status == PJ_SUCCESS)
+		{
+			// ѾǨproxy, ̨rrtvms˶, ʱµproxy
+			pj_int32_t room_id = title_room->id_;
+			g_directory_snapshot.RevalidateProxy(room_id, cached,
+				[this, room_id](snapshot_proxy_t &latest) {
+				return QueryProxy(room_id, latest) == PJ_SUCCESS ? PJ_TRUE : PJ_FALSE;
+			},
+				[title_room, cached] {
+				sinashow::SendMessage(WM_RELINK_ROOM, (WPARAM)cached.proxy_id_, (LPARAM)title_room);
+			});
+			return PJ_SUCCESS;
+		}
+
+		PJ_LOG(5, (__ABS_FILE__, "OnLinkRoom() => Cached proxy[%u] of room[%d] failed, ask rrtvms",
+			param.proxy_id, title_room->id_));
+	}
+
+	snapshot_proxy_t latest;
+	status = QueryProxy(title_room->id_, latest);
 	if(status != PJ_SUCCESS && title != nullptr)
 	{
 		sinashow::SendMessage(WM_CONTINUE_TRAVERSE, (WPARAM)title, (LPARAM)0);
 	}
 	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
 
+	param.proxy_id       = latest.proxy_id_;
+	param.proxy_ip       = latest.proxy_ip_;
+	param.proxy_tcp_port = latest.tcp_port_;
+	param.proxy_udp_port = latest.udp_port_;
 	status = LinkRoom(param);
 	if(status != PJ_SUCCESS && title != nullptr)
 	{
@@ -201,9 +377,40 @@ pj_status_t ScreenMgr::OnLinkRoom(TitleRoom *title_room, Title *title)
 	}
 	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
 
+	g_directory_snapshot.SetProxy(title_room->id_, latest);
+
 	return PJ_SUCCESS;
 }
 
+// rrtvmsѯڵproxy
+pj_status_t ScreenMgr::QueryProxy(pj_int32_t room_id, snapshot_proxy_t &proxy)
+{
+	vector<pj_uint8_t> response;
+	http_proxy_get(g_client_config.rrtvms_fcgi_host, g_client_config.rrtvms_fcgi_port, g_client_config.rrtvms_fcgi_uri,
+		room_id, response);
+
+	return ParseHttpResponse(proxy.proxy_id_, proxy.proxy_ip_, proxy.tcp_port_, proxy.udp_port_, response);
+}
+
+// еproxyѹ: ʱϿ, ٰºĿµproxy
+pj_status_t ScreenMgr::OnRelinkRoom(TitleRoom *title_room, pj_uint16_t stale_proxy_id)
+{
+	RETURN_VAL_IF_FAIL(title_room != nullptr, PJ_EINVAL);
+	RETURN_VAL_IF_FAIL(title_room->proxy_ != nullptr && title_room->proxy_->id_ == stale_proxy_id, PJ_SUCCESS);  // ȡעѸ
+
+	PJ_LOG(5, (__ABS_FILE__, "OnRelinkRoom() => Room[%d] leaves stale proxy[%u]", title_room->id_, stale_proxy_id));
+
+	pj_status_t status = OnUnlinkRoom(title_room);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	return OnLinkRoom(title_room, nullptr);
+}
+
+void ScreenMgr::OnDirectoryRefreshed(CTreeCtrl *tree_ctrl, node_handle_t handle)
+{
+	titles_->OnDirectoryRefreshed(tree_ctrl, handle);
+}
+
 pj_status_t ScreenMgr::OnUnlinkRoom(TitleRoom *title_room)
 {
 	RETURN_VAL_IF_FAIL(title_room != nullptr, PJ_EINVAL);
@@ -225,7 +432,8 @@ pj_status_t ScreenMgr::OnUnlinkRoom(TitleRoom *title_room)
 
 // old_screen may be exist at new_user.
 // old_user may be exist at new_screen
-void ScreenMgr::LinkScreenUser(pj_uint32_t new_screen_idx, User *new_user)
+// mirrorΪʱnew_userͬʱԭĻ, Ļһ
+void ScreenMgr::LinkScreenUser(pj_uint32_t new_screen_idx, User *new_user, pj_bool_t mirror)
 {
 	RETURN_IF_FAIL(new_screen_idx != INVALID_SCREEN_INDEX);
 	RETURN_IF_FAIL(new_user != nullptr);
@@ -235,25 +443,27 @@ void ScreenMgr::LinkScreenUser(pj_uint32_t new_screen_idx, User *new_user)
 	RETURN_IF_FAIL(proxy != nullptr);
 
 	Screen *new_screen = screens_[new_screen_idx];
-
-	if(new_user->screen_ != nullptr)  // קûĻʾ
-	{
-		Screen *old_screen = new_user->screen_;
-		RETURN_IF_FAIL(new_screen != old_screen);
-
-		UnlinkScreenUser(old_screen, new_user);
-	}
+	Screen *old_screen = new_user->screen_;  // קûĻʾ
 
 	User *old_user = nullptr;
 	if (new_screen->GetUser(old_user) == PJ_SUCCESS)  // Ļû
 	{
-		RETURN_IF_FAIL(*new_user != *old_user);
+		RETURN_IF_FAIL(old_user != new_user && *new_user != *old_user);
 
 		UnlinkScreenUser(new_screen, old_user);
 	}
 
-	proxy->LinkRoomUser(new_user);
+	// Ļ, Ԥȡ򽡿еûproxyת, , ĻֱӶеĽ
+	if(!new_user->IsForwarded())
+	{
+		proxy->LinkRoomUser(new_user);
+	}
 	new_screen->ConnectUser(new_user);
+
+	if(!mirror && old_screen != nullptr)
+	{
+		old_screen->DisconnectUser();
+	}
 }
 
 void ScreenMgr::UnlinkScreenUser(Screen *screen, User *old_user)
@@ -264,6 +474,14 @@ void ScreenMgr::UnlinkScreenUser(Screen *screen, User *old_user)
 
 	screen->DisconnectUser();
 
+	// ûʾĻʱת
+	RETURN_IF_FAIL(old_user->screen_idx_ == INVALID_SCREEN_INDEX);
+
+	g_gop_cache.Drop(old_user->video_ssrc_);
+
+	// ҪûƵ
+	RETURN_IF_FAIL(!old_user->health_);
+
 	AvsProxy *proxy = old_user->title_room_->proxy_;
 	RETURN_IF_FAIL(proxy != nullptr);
 
@@ -285,6 +503,7 @@ void ScreenMgr::ChangeLayout(enum_screen_mgr_resolution_t resolution)
 	round_height = ROUND(height, divisor.v);
 
 	HideAll();
+	ResizeWall();
 
 	(this->* screenmgr_func_array_[GET_FUNC_INDEX(screen_mgr_res_)])(round_width, round_height);
 }
@@ -318,9 +537,19 @@ void ScreenMgr::Adjest(pj_int32_t &cx, pj_int32_t &cy)
 	round_width  = ROUND(tmp_width, divisor.h);
 	round_height = ROUND(cy, divisor.v);
 
+	ResizeWall();
 	(this->* screenmgr_func_array_[GET_FUNC_INDEX(screen_mgr_res_)])(round_width, round_height);
 }
 
+// ǽĿ¼Ҳȫ, ֮ؽ, ֮ɲ·øĻ
+void ScreenMgr::ResizeWall()
+{
+	RETURN_IF_FAIL(wall_ != nullptr && width_ > MININUM_TREE_CTL_WIDTH);
+
+	wall_->MoveWindow(CRect(MININUM_TREE_CTL_WIDTH, 0, width_, height_));
+	g_compositor.Resize(width_ - MININUM_TREE_CTL_WIDTH, height_);
+}
+
 void ScreenMgr::ChangeLayout_1x1(pj_uint32_t width, pj_uint32_t height)
 {
 	CRect rect(0, 0, MININUM_TREE_CTL_WIDTH, height * num_blocks_[0].v);
@@ -563,24 +792,53 @@ void ScreenMgr::UdpParamScene(const pjmedia_rtp_hdr *rtp_hdr,
 	{
 		const pj_uint8_t media_index = (rtp_hdr->pt == RTP_MEDIA_VIDEO_TYPE) ? VIDEO_INDEX : 
 			(rtp_hdr->pt == RTP_MEDIA_AUDIO_TYPE ? AUDIO_INDEX : -1);
-		RETURN_IF_FAIL(media_index != -1);
+		RETURN_IF_FAIL(media_index <= VIDEO_INDEX);
 
-		Screen *screen = nullptr;
-		index_map_t::iterator pscreen_idx = g_av_index_map[media_index].find(rtp_hdr->ssrc);
-		if (pscreen_idx != g_av_index_map[media_index].end())
+		// ˵ֻ, Ƿ޹, תƵҪͳ
+		if (media_index == AUDIO_INDEX && g_client_config.speaker_enable)
 		{
-			index_map_t::mapped_type screen_idx = pscreen_idx->second;
-			if (screen_idx >= 0 && screen_idx < MAXIMAL_SCREEN_NUM)
-			{
-				screen = screens_[screen_idx];
-			}
+			g_speaker_index.OnRtp(rtp_hdr->ssrc, storage, storage_len);
 		}
 
-		RETURN_IF_FAIL(screen != nullptr);
+		// , һβõssrcȫȥ. ҳ¿պ, ɿϵİŻFlush
+		av_routes_ptr_t routes = g_av_routes.Load();
+		av_route_map_t::const_iterator proute = routes->routes[media_index].find(rtp_hdr->ssrc);
+		RETURN_IF_FAIL(proute != routes->routes[media_index].end());
+		const av_route_t &route = proute->second;
 
-		media_index == AUDIO_INDEX ?
-			screen->AudioScene(storage, storage_len) :
-			screen->VideoScene(storage, storage_len);
+		// ֻRTPͷNAL, Ƿ޹
+		if (route.health)
+		{
+			pj_timestamp arrival;
+			pj_get_timestamp(&arrival);
+			route.health->OnRtp(storage, storage_len, arrival);
+		}
+
+		index_map_t::mapped_type screen_idx = route.screen_idx;
+		RETURN_IF_FAIL(screen_idx != (index_map_t::mapped_type)INVALID_SCREEN_INDEX);
+
+		// ¼ֻ, Ƿ޹
+		if (route.recording != nullptr)
+		{
+			route.recording->Push(media_index, storage, storage_len);
+		}
+
+		if (media_index == VIDEO_INDEX)
+		{
+			// ƵssrcΨһĽ, ֡ʾûĻ
+			g_gop_cache.Push(rtp_hdr->ssrc, storage, storage_len);
+
+			RETURN_IF_FAIL(route.stream != nullptr);
+			route.stream->VideoScene(storage, storage_len);
+		}
+		else
+		{
+			// ƵֻĻ, ûбĸӲ
+			RETURN_IF_FAIL(screen_idx < MAXIMAL_SCREEN_NUM);
+			RETURN_IF_FAIL(g_audio_mixer.Monitored(screen_idx));
+
+			screens_[screen_idx]->AudioScene(storage, storage_len);
+		}
 	}
 }
 
@@ -635,8 +893,12 @@ void ScreenMgr::EventOnTcpRead(evutil_socket_t fd, short event, void *arg)
 	}
 	else if (recvlen <= 0)
 	{
-		pj_sock_close(proxy->sock_);
-		proxy->sock_ = INVALID_SOCKET;
+		{
+			// ͬ߳̿SendTCPPacket
+			lock_guard<mutex> tcp_lock(proxy->tcp_lock_);
+			pj_sock_close(proxy->sock_);
+			proxy->sock_ = INVALID_SOCKET;
+		}
 
 		event_del(proxy->tcp_ev_);
 		event_free(proxy->tcp_ev_);
@@ -644,7 +906,14 @@ void ScreenMgr::EventOnTcpRead(evutil_socket_t fd, short event, void *arg)
 
 		PJ_LOG(5, (__ABS_FILE__, "EventOnTcpRead() => Proxy was disconnected, code %d", recvlen));
 
-		DelProxy(proxy);
+		if(g_client_config.resume_enable)
+		{
+			SuspendProxy(proxy);
+		}
+		else
+		{
+			DelProxy(proxy);
+		}
 	}
 }
 
@@ -667,6 +936,16 @@ void ScreenMgr::EventOnUdpRead(evutil_socket_t fd, short event, void *arg)
 	status = pj_sock_recvfrom(g_rtp_session.GetRTPSock(), datagram, &datalen, 0, &addr, &addrlen);
 	RETURN_IF_FAIL(status == PJ_SUCCESS);
 
+	if(RTCPFeedback::IsRtcp(datagram, (pj_uint32_t)datalen))
+	{
+		g_rtcp_feedback.OnRxRtcp(datagram, (pj_uint32_t)datalen);
+		if(g_client_config.av_sync)
+		{
+			g_av_sync.OnRxRtcp(datagram, (pj_uint32_t)datalen);
+		}
+		return;
+	}
+
 	if (datalen >= sizeof(*rtp_hdr)
 		&& datalen < (1 << 16))  // max data size is 2^16
 	{
@@ -681,11 +960,47 @@ void ScreenMgr::EventOnUdpRead(evutil_socket_t fd, short event, void *arg)
 		}
 		else
 		{
+			g_rtcp_feedback.OnRxRtp(rtp_hdr, payload_len, addr);
 			UdpParamScene(rtp_hdr, datagram, (pj_uint16_t)datalen);
 		}
 	}
 }
 
+void ScreenMgr::EventOnRtcpTimer(evutil_socket_t fd, short event, void *arg)
+{
+	g_rtcp_feedback.OnTimer();
+}
+
+void ScreenMgr::EventOnHealthTimer(evutil_socket_t fd, short event, void *arg)
+{
+	g_health_monitor.Check();
+}
+
+void ScreenMgr::EventOnReclaimTimer(evutil_socket_t fd, short event, void *arg)
+{
+	g_av_routes.Reclaim();
+}
+
+void ScreenMgr::EventOnSpeakerTimer(evutil_socket_t fd, short event, void *arg)
+{
+	g_speaker_index.Check();
+}
+
+// ͬһ·ƵʾڶĻʱᱻ, 澯ֻڱ仯ʱӡ, ظ
+void ScreenMgr::EventOnAnalyticsTimer(evutil_socket_t fd, short event, void *arg)
+{
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	pj_uint64_t now_usec = PlayoutClock::Usec(now);
+
+	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+	{
+		VideoStream *stream = screens_[idx]->GetStream();
+		pj_uint32_t alarms = stream != nullptr ? stream->CheckAlarms(now_usec) : 0;
+		g_compositor.SetAlarm(screens_[idx]->GetIndex(), alarms != 0 ? PJ_TRUE : PJ_FALSE);
+	}
+}
+
 void ScreenMgr::EventOnPipe(evutil_socket_t fd, short event, void *arg)
 {
 	std::function<pj_status_t ()> *pconnection = nullptr;
@@ -737,6 +1052,10 @@ pj_status_t ScreenMgr::ConnProxy(AvsProxy *proxy)
 
 	function = std::bind(&ScreenMgr::EventOnTcpRead, this, std::placeholders::_1, std::placeholders::_2, proxy);
 	pfunction = new ev_function_t(function);
+	if(proxy->pfunction_ != nullptr)  // ָỰʱ, ɵeventѾͷ
+	{
+		delete proxy->pfunction_;
+	}
 	proxy->pfunction_ = pfunction;
 
 	proxy->tcp_ev_ = event_new(evbase_, proxy->sock_, EV_READ | EV_PERSIST, event_func_proxy, pfunction);
@@ -806,6 +1125,85 @@ pj_status_t ScreenMgr::DelProxy(proxy_map_t::mapped_type proxy)
 	return PJ_SUCCESS;
 }
 
+// proxyеķû, Ļᱻ
+pj_status_t ScreenMgr::SuspendProxy(proxy_map_t::mapped_type proxy)
+{
+	RETURN_VAL_IF_FAIL( proxy != nullptr, PJ_SUCCESS );
+
+	proxy->Suspend();
+
+	resume_thread_pool_.Schedule(std::bind(&ScreenMgr::ResumeProxy, this, proxy));
+
+	return PJ_SUCCESS;
+}
+
+void ScreenMgr::ResumeProxy(AvsProxy *proxy)
+{
+	pj_uint16_t id = proxy->id_;
+	pj_uint32_t interval = g_client_config.resume_retry_interval;
+
+	for(pj_uint32_t retry = 0; retry < g_client_config.resume_max_retries; ++ retry)
+	{
+		{
+			// ˳ʱص˱ܼ
+			std::unique_lock<mutex> lock(resume_lock_);
+			resume_cv_.wait_for(lock, std::chrono::milliseconds(interval), [this] { return !active_; });
+			RETURN_IF_FAIL(active_);
+		}
+		interval = MIN(interval * 2, 30 * 1000);
+
+		proxy_map_t::mapped_type linked_proxy = nullptr;
+		if(GetProxy(id, linked_proxy) != PJ_SUCCESS || linked_proxy != proxy)
+		{
+			PJ_LOG(5, (__ABS_FILE__, "ResumeProxy() => Proxy id[%u] was released, stop resuming", id));
+			return;
+		}
+
+		pj_sock_t sock;
+		pj_status_t status;
+		status = pj_open_tcp_clientport(&proxy->ip_, proxy->tcp_port_, sock);
+		if(status != PJ_SUCCESS)
+		{
+			PJ_LOG(5, (__ABS_FILE__, "ResumeProxy() => Reconnect proxy id[%u] failed, retry %u", id, retry + 1));
+			continue;
+		}
+
+		// sock_status_ֻlibevent߳л, ¼Ҳ﷢
+		std::function<pj_status_t()> connection = std::bind(&ScreenMgr::ResumeConnProxy, this, id, proxy, sock);
+		std::function<pj_status_t()> *pconnection = new std::function<pj_status_t()>(connection);
+		pj_assert(pconnection != nullptr);
+
+		pj_ssize_t sndlen = sizeof(pconnection);
+		pj_sock_send(pipe_fds_[1], &pconnection, &sndlen, 0);
+		return;
+	}
+
+	PJ_LOG(5, (__ABS_FILE__, "ResumeProxy() => Give up resuming proxy id[%u]", id));
+
+	DelProxy(proxy);
+}
+
+pj_status_t ScreenMgr::ResumeConnProxy(pj_uint16_t id, AvsProxy *proxy, pj_sock_t sock)
+{
+	// ڼproxyѱDelProxyƳ, ʱٷ
+	proxy_map_t::mapped_type linked_proxy = nullptr;
+	if(GetProxy(id, linked_proxy) != PJ_SUCCESS || linked_proxy != proxy)
+	{
+		PJ_LOG(5, (__ABS_FILE__, "ResumeConnProxy() => Proxy id[%u] was released, drop the new connection", id));
+		pj_sock_close(sock);
+		return PJ_EINVALIDOP;
+	}
+
+	pj_status_t status;
+	status = proxy->Resume(sock);
+	RETURN_VAL_WITH_STATEMENT_IF_FAIL(status == PJ_SUCCESS, pj_sock_close(sock), status);
+
+	status = ConnProxy(proxy);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	return proxy->Login();
+}
+
 pj_status_t ScreenMgr::GetProxy(pj_uint16_t id, proxy_map_t::mapped_type &proxy)
 {
 	lock_guard<mutex> lock(linked_proxys_lock_);
@@ -842,10 +1240,163 @@ void ScreenMgr::DelAllProxys()
 
 void ScreenMgr::CleanScreens()
 {
+	watch_page_t page;
+	ShowPage(page);
+}
+
+/**
+ * proxyʼתҳҳδתû, ҳʱʾ;
+ * g_av_index_lockһؽ·, ûĻĶûĽ, ½Ľӻgop;
+ * ȡҪû. , ҳʱֺ.
+ * proxylink/unlinkֻid, ⷢ.
+ */
+void ScreenMgr::ShowPage(const watch_page_t &page)
+{
+	typedef std::pair<AvsProxy *, user_binding_t> proxy_binding_t;
+
+	vector<proxy_binding_t> link;
+	{
+		lock_guard<mutex> lock(g_av_index_lock);
+
+		set<User *> wanted;
+		for(pj_uint32_t i = 0; i < page.users.size() + page.prefetch.size(); ++ i)
+		{
+			User *user = resolve_user(i < page.users.size() ? page.users[i] : page.prefetch[i - page.users.size()]);
+			if(user != nullptr
+				&& wanted.insert(user).second
+				&& !user->IsForwarded()
+				&& user->title_room_ != nullptr
+				&& user->title_room_->proxy_ != nullptr)
+			{
+				user_binding_t binding = {user->title_room_->id_, user->user_id_};
+				link.push_back(std::make_pair(user->title_room_->proxy_, binding));
+			}
+		}
+	}
+
+	for(pj_uint32_t i = 0; i < link.size(); ++ i)
+	{
+		link[i].first->LinkRoomUser(link[i].second);
+	}
+
+	vector<proxy_binding_t> unlink;
+	pj_bool_t idle[MAXIMAL_SCREEN_NUM] = {PJ_FALSE};
+	pj_uint32_t shown = 0;
+	{
+		AvRouteUpdate update;
+
+		vector<User *> users(page.users.size(), nullptr);
+		set<User *> wanted;
+		for(pj_uint32_t i = 0; i < page.users.size(); ++ i)
+		{
+			users[i] = resolve_user(page.users[i]);
+			wanted.insert(users[i]);
+		}
+
+		vector<User *> prefetch;
+		for(pj_uint32_t i = 0; i < page.prefetch.size(); ++ i)
+		{
+			User *user = resolve_user(page.prefetch[i]);
+			prefetch.push_back(user);
+			wanted.insert(user);
+		}
+		wanted.erase(nullptr);
+
+		set<User *> linked;
+		for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+		{
+			User *user = nullptr;
+			if(screens_[idx]->GetUser(user) == PJ_SUCCESS)
+			{
+				linked.insert(user);
+			}
+		}
+		for(pj_uint32_t i = 0; i < prefetch_users_.size(); ++ i)
+		{
+			User *user = resolve_user(prefetch_users_[i]);
+			if(user != nullptr && user->prefetch_)
+			{
+				linked.insert(user);
+			}
+		}
+
+		for(set<User *>::iterator puser = linked.begin(); puser != linked.end(); ++ puser)
+		{
+			(*puser)->DisconnectScreen();
+		}
+
+		for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
+		{
+			User *old_user = nullptr;
+			screens_[idx]->GetUser(old_user);
+			User *new_user = idx < users.size() ? users[idx] : nullptr;
+
+			if(new_user != old_user)
+			{
+				screens_[idx]->SwapUser(new_user);
+				idle[idx] = new_user == nullptr ? PJ_TRUE : PJ_FALSE;
+			}
+
+			if(new_user == nullptr)
+			{
+				continue;
+			}
+
+			// ͬһûҳгֶʱ, һĻΪĻ, Ϊ
+			if(new_user->screen_ == nullptr)
+			{
+				new_user->ConnectScreen(screens_[idx], idx);
+			}
+			else
+			{
+				new_user->mirrors_.push_back(screens_[idx]);
+			}
+			++ shown;
+		}
+
+		prefetch_users_.clear();
+		for(pj_uint32_t i = 0; i < prefetch.size(); ++ i)
+		{
+			User *user = prefetch[i];
+			if(user != nullptr && user->screen_idx_ == INVALID_SCREEN_INDEX && !user->prefetch_)
+			{
+				user->Prefetch();
+
+				user_ref_t ref = {user->arena_, user->handle_};
+				prefetch_users_.push_back(ref);
+			}
+		}
+
+		for(set<User *>::iterator puser = linked.begin(); puser != linked.end(); ++ puser)
+		{
+			User *user = *puser;
+			if(wanted.find(user) == wanted.end())
+			{
+				g_gop_cache.Drop(user->video_ssrc_);
+				if(!user->health_ && user->title_room_ != nullptr && user->title_room_->proxy_ != nullptr)
+				{
+					user_binding_t binding = {user->title_room_->id_, user->user_id_};
+					unlink.push_back(std::make_pair(user->title_room_->proxy_, binding));
+				}
+			}
+		}
+	}
+
+	for(pj_uint32_t i = 0; i < unlink.size(); ++ i)
+	{
+		unlink[i].first->UnlinkRoomUser(unlink[i].second);
+	}
+
 	for(pj_uint32_t idx = 0; idx < MAXIMAL_SCREEN_NUM; ++ idx)
 	{
-		screens_[idx]->DisconnectUser();
+		if(idle[idx])
+		{
+			screens_[idx]->UpdateWindow();
+		}
 	}
+
+	PJ_LOG(5, (__ABS_FILE__, "ShowPage() => %u users on screens, %u users prefetched",
+		shown, prefetch_users_.size()));
 }
 
 void ScreenMgr::EventThread()
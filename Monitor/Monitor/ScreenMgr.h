@@ -5,6 +5,7 @@
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <map>
 
 #include "MessageQueue.hpp"
@@ -27,6 +28,16 @@
 #include "NATScene.h"
 #include "TitleRoom.h"
 #include "AvsProxy.h"
+#include "GopCache.h"
+#include "StreamMgr.h"
+#include "RTCPFeedback.h"
+#include "HealthMonitor.h"
+#include "Compositor.h"
+#include "AudioMixer.h"
+#include "SpeakerIndex.h"
+#include "AvSync.h"
+#include "Recorder.h"
+#include "WatchsList.h"
 
 #define TOP_SIDE_SIZE          30
 #define SIDE_SIZE              8
@@ -84,7 +95,9 @@ public:
 	void        Destory();
 	pj_status_t OnLinkRoom(TitleRoom *title_room, Title *title);
 	pj_status_t OnUnlinkRoom(TitleRoom *title_room);
-	void        LinkScreenUser(pj_uint32_t new_screen_idx, User *new_user);
+	pj_status_t OnRelinkRoom(TitleRoom *title_room, pj_uint16_t stale_proxy_id);
+	void        OnDirectoryRefreshed(CTreeCtrl *tree_ctrl, node_handle_t handle);
+	void        LinkScreenUser(pj_uint32_t new_screen_idx, User *new_user, pj_bool_t mirror);
 	void        UnlinkScreenUser(Screen *screen, User *old_user);
 	void        ChangeLayout(enum_screen_mgr_resolution_t resolution);
 	void        GetSuitedSize(LPRECT lpRect);
@@ -93,8 +106,10 @@ public:
 	pj_status_t LinkRoom(const link_room_param_t &param);
 	void        DelAllProxys();
 	void        CleanScreens();
+	void        ShowPage(const watch_page_t &page);
 	pj_status_t AddProxy(pj_uint16_t id, pj_str_t &ip, pj_uint16_t tcp_port, pj_uint16_t udp_port, pj_sock_t sock, proxy_map_t::mapped_type &proxy);
 	pj_status_t DelProxy(proxy_map_t::mapped_type proxy);
+	pj_status_t SuspendProxy(proxy_map_t::mapped_type proxy);
 	pj_status_t GetProxy(pj_uint16_t id, proxy_map_t::mapped_type &proxy);
 	static resolution_t GetDefaultResolution();
 
@@ -104,6 +119,11 @@ protected:
 	void EventOnTcpRead(evutil_socket_t fd, short event, void *arg);
 	void EventOnUdpRead(evutil_socket_t fd, short event, void *arg);
 	void EventOnPipe(evutil_socket_t fd, short event, void *arg);
+	void EventOnRtcpTimer(evutil_socket_t fd, short event, void *arg);
+	void EventOnHealthTimer(evutil_socket_t fd, short event, void *arg);
+	void EventOnSpeakerTimer(evutil_socket_t fd, short event, void *arg);
+	void EventOnAnalyticsTimer(evutil_socket_t fd, short event, void *arg);
+	void EventOnReclaimTimer(evutil_socket_t fd, short event, void *arg);
 	void EventThread();
 
 private:
@@ -112,14 +132,24 @@ private:
 	 * @desc Ϊ˼libeventϿ, ˺libeventִ߳
 	 */
 	pj_status_t DiscProxy(AvsProxy *proxy);
+	/*
+	 * @desc ̨proxy, resume_thread_pool_ִ
+	 */
+	void        ResumeProxy(AvsProxy *proxy);
+	/*
+	 * @desc socketµ¼, libeventִ߳, EventOnTcpReadᲢ
+	 */
+	pj_status_t ResumeConnProxy(pj_uint16_t id, AvsProxy *proxy, pj_sock_t sock);
 	pj_status_t SendTCPPacket(const void *buf, pj_ssize_t *len);
 
 public:
+	pj_status_t QueryProxy(pj_int32_t room_id, snapshot_proxy_t &proxy);
 	pj_status_t ParseHttpResponse(pj_uint16_t &proxy_id, string &proxy_ip, pj_uint16_t &proxy_tcp_port, pj_uint16_t &proxy_udp_port,
 		const vector<pj_uint8_t> &response);
 private:
 	void TcpParamScene(const pj_uint8_t *, pj_uint16_t);
 	void UdpParamScene(const pjmedia_rtp_hdr *rtp_hdr, const pj_uint8_t *storage, pj_uint16_t storage_len);
+	void ResizeWall();
 	void ChangeLayout_1x1(pj_uint32_t width, pj_uint32_t height);
 	void ChangeLayout_2x2(pj_uint32_t width, pj_uint32_t height);
 	void ChangeLayout_1x5(pj_uint32_t width, pj_uint32_t height);
@@ -138,19 +168,24 @@ private:
 	pj_caching_pool     caching_pool_;
 	evutil_socket_t     pipe_fds_[2];
 	pj_pool_t		   *pool_;
-	struct event       *tcp_ev_, *udp_ev_, *pipe_ev_;
+	struct event       *tcp_ev_, *udp_ev_, *pipe_ev_, *rtcp_ev_, *health_ev_, *analytics_ev_, *speaker_ev_, *reclaim_ev_;
 	struct event_base  *evbase_;
 	thread              connector_thread_;
 	thread              event_thread_;
 	pj_bool_t           active_;
 	TitlesCtl          *titles_;
+	CWnd               *wall_;               // Ļõĳִ, λڸScreen֮
 	mutex               linked_proxys_lock_;
 	proxy_map_t         linked_proxys_;
 	vector<screenmgr_func_t> screenmgr_func_array_;
 	vector<round_t>     num_blocks_;
 	Screen             *screens_[MAXIMAL_SCREEN_NUM];
+	vector<user_ref_t>  prefetch_users_;      // Ծ, ûɾΪnullptr
 	enum_screen_mgr_resolution_t screen_mgr_res_;
 	PoolThread<std::function<void ()>> sync_thread_pool_;
+	PoolThread<std::function<void ()>> resume_thread_pool_;
+	mutex               resume_lock_;
+	std::condition_variable resume_cv_;    // Destory()ʱڵȴ߳
 
 	static const resolution_t DEFAULT_RESOLUTION;
 };
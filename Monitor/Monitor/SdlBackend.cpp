@@ -0,0 +1,102 @@
+#include "stdafx.h"
+
+#include "SdlBackend.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "SdlBackend.cpp"
+
+SdlBackend::SdlBackend()
+	: window_(nullptr)
+	, render_(nullptr)
+	, texture_(nullptr)
+	, vsync_(PJ_FALSE)
+{
+}
+
+pj_status_t SdlBackend::Open(void *native_window)
+{
+	RETURN_VAL_IF_FAIL(native_window != nullptr, PJ_EINVAL);
+
+	window_ = SDL_CreateWindowFrom(native_window);
+	RETURN_VAL_IF_FAIL(window_ != nullptr, PJ_EINVAL);
+
+	// ֻһ, ӲʱȾ. ֱͬǷЧ, ʵʵı־Ϊ׼
+	render_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	if(render_ == nullptr)
+	{
+		PJ_LOG(3, (__ABS_FILE__, "SdlBackend::Open() => no accelerated renderer: %s, fall back to software", SDL_GetError()));
+		render_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_SOFTWARE);
+	}
+	RETURN_VAL_IF_FAIL(render_ != nullptr, PJ_EINVAL);
+
+	SDL_RendererInfo info;
+	vsync_ = SDL_GetRendererInfo(render_, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC) ? PJ_TRUE : PJ_FALSE;
+
+	return PJ_SUCCESS;
+}
+
+void SdlBackend::Close()
+{
+	if(texture_ != nullptr)
+	{
+		SDL_DestroyTexture(texture_);
+		texture_ = nullptr;
+	}
+
+	if(render_ != nullptr)
+	{
+		SDL_DestroyRenderer(render_);
+		render_ = nullptr;
+	}
+
+	// MFC, ֻSDLĹ
+	if(window_ != nullptr)
+	{
+		SDL_DestroyWindow(window_);
+		window_ = nullptr;
+	}
+}
+
+pj_status_t SdlBackend::Resize(pj_uint32_t width, pj_uint32_t height)
+{
+	SDL_Texture *texture = SDL_CreateTexture(render_, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, width, height);
+	RETURN_VAL_IF_FAIL(texture != nullptr, PJ_ENOMEM);
+
+	if(texture_ != nullptr)
+	{
+		SDL_DestroyTexture(texture_);
+	}
+	texture_ = texture;
+
+	return PJ_SUCCESS;
+}
+
+void SdlBackend::Upload(const canvas_t &canvas, const tile_rect_t &rect)
+{
+	SDL_Rect sdl_rect = {(int)rect.x_, (int)rect.y_, (int)rect.width_, (int)rect.height_};
+	SDL_UpdateYUVTexture(texture_, &sdl_rect,
+		canvas.planes_[0] + rect.y_ * canvas.pitches_[0] + rect.x_, canvas.pitches_[0],
+		canvas.planes_[1] + rect.y_ / 2 * canvas.pitches_[1] + rect.x_ / 2, canvas.pitches_[1],
+		canvas.planes_[2] + rect.y_ / 2 * canvas.pitches_[2] + rect.x_ / 2, canvas.pitches_[2]);
+}
+
+void SdlBackend::Present()
+{
+	SDL_RenderCopy(render_, texture_, NULL, NULL);
+	SDL_RenderPresent(render_);
+}
+
+pj_uint32_t SdlBackend::RefreshRate()
+{
+	SDL_DisplayMode mode;
+	int display = SDL_GetWindowDisplayIndex(window_);
+	if(display >= 0 && SDL_GetCurrentDisplayMode(display, &mode) == 0 && mode.refresh_rate > 0)
+	{
+		return mode.refresh_rate;
+	}
+
+	return COMPOSITOR_DEFAULT_REFRESH;
+}
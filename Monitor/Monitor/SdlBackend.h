@@ -0,0 +1,31 @@
+#ifndef __AVS_PROXY_CLIENT_SDL_BACKEND__
+#define __AVS_PROXY_CLIENT_SDL_BACKEND__
+
+#include "Compositor.h"
+
+/**
+ * һSDLһIYUV, MFC. Compositorֿ, ޴ڵѹԲSDL.
+ */
+class SdlBackend
+	: public CompositorBackend
+{
+public:
+	SdlBackend();
+
+	virtual pj_status_t Open(void *native_window);
+	virtual void        Close();
+	virtual pj_status_t Resize(pj_uint32_t width, pj_uint32_t height);
+	virtual void        Upload(const canvas_t &canvas, const tile_rect_t &rect);
+	virtual void        Present();
+	virtual pj_uint32_t RefreshRate();
+	virtual pj_bool_t   Vsync() const { return vsync_; }
+	virtual const char *Name() const { return "sdl"; }
+
+private:
+	SDL_Window   *window_;
+	SDL_Renderer *render_;
+	SDL_Texture  *texture_;
+	pj_bool_t     vsync_;
+};
+
+#endif
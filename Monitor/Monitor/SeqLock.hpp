@@ -0,0 +1,60 @@
+#ifndef __AVS_PROXY_SEQ_LOCK__
+#define __AVS_PROXY_SEQ_LOCK__
+
+#include <atomic>
+
+#include "Com.h"
+
+/**
+ * д߶ߵ˳. д߲ȴκ, ֻ޸ǰżһ;
+ * ߸һ, ڼΪ仯ض.
+ * Tǿ԰ֽڸƵĽṹ. ߳дͬһSeqLockʱɵ÷֤.
+ */
+template<class T>
+class SeqLock
+	: public Noncopyable
+{
+public:
+	SeqLock()
+		: sequence_(0)
+	{
+		pj_bzero(&value_, sizeof(value_));
+	}
+
+	// صֻBeginWrite/EndWrite֮޸
+	T &BeginWrite()
+	{
+		sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		return value_;
+	}
+
+	void EndWrite()
+	{
+		sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// д̶߳Լдֵ, Ҫ
+	inline const T &Peek() const
+	{
+		return value_;
+	}
+
+	void Read(T &value) const
+	{
+		pj_uint32_t begin, end;
+		do
+		{
+			begin = sequence_.load(std::memory_order_acquire);
+			pj_memcpy(&value, &value_, sizeof(value));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			end = sequence_.load(std::memory_order_relaxed);
+		} while((begin & 1) || begin != end);
+	}
+
+private:
+	std::atomic<pj_uint32_t> sequence_;
+	T                        value_;
+};
+
+#endif
@@ -0,0 +1,260 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "SpeakerIndex.h"
+#include "AudioStream.h"
+#include "AudioKernels.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "SpeakerIndex.cpp"
+
+SpeakerIndex g_speaker_index;
+
+SpeakerIndex::SpeakerIndex()
+	: speakers_lock_()
+	, speakers_()
+	, top_()
+{
+}
+
+/**
+ * հ߳жÿƵ, ȶͷչ, ;
+ * ûʱֻ븺мһСβ, ˵Ѿ㹻.
+ */
+void SpeakerIndex::OnRtp(pj_uint32_t ssrc, const pj_uint8_t *rtp_frame, pj_uint16_t framelen)
+{
+	pj_timestamp arrival;
+	pj_get_timestamp(&arrival);
+
+	pj_int32_t level = -1;
+	if(g_client_config.audio_level_ext_id > 0)
+	{
+		level = ExtLevel(rtp_frame, framelen, g_client_config.audio_level_ext_id);
+	}
+
+	pj_bool_t ext_level = level >= 0 ? PJ_TRUE : PJ_FALSE;
+	if(!ext_level)
+	{
+		const pjmedia_rtp_hdr *hdr;
+		const void *payload;
+		unsigned payloadlen;
+		pj_status_t status;
+		status = pjmedia_rtp_decode_rtp(NULL, rtp_frame, framelen, &hdr, &payload, &payloadlen);
+		RETURN_IF_FAIL(status == PJ_SUCCESS && payloadlen >= 2);
+
+		pj_uint32_t samples = MIN(payloadlen / 2, (pj_uint32_t)SPEAKER_PARTIAL_SAMPLES);
+		const pj_uint8_t *middle = (const pj_uint8_t *)payload + (payloadlen / 2 - samples) / 2 * 2;
+
+		const audio_kernels_t &kernels = AudioKernels::Get();
+		pj_int16_t pcm[SPEAKER_PARTIAL_SAMPLES];
+		pj_uint64_t energy;
+		pj_uint32_t peak;
+		kernels.l16_to_pcm_(pcm, middle, samples);
+		kernels.pcm_energy_(pcm, samples, &energy, &peak);
+		level = AudioStream::Dbov(energy, samples);
+	}
+
+	// µssrcʼΪȫ0
+	lock_guard<std::mutex> lock(speakers_lock_);
+	speaker_state_t &state = speakers_[ssrc];
+	state.ext_level_ = ext_level;
+	Update(state, (pj_uint32_t)level, arrival);
+}
+
+/**
+ * ȡȵ°: , 컺, ıٱ˵.
+ * ˵ָƽ, 뷢Ͷ˵Ĵʱ޹.
+ */
+void SpeakerIndex::Update(speaker_state_t &state, pj_uint32_t level, const pj_timestamp &arrival)
+{
+	pj_uint32_t elapsed = state.packets_ > 0 ? MIN(pj_elapsed_msec(&state.last_rx_, &arrival), (pj_uint32_t)SPEAKER_WINDOW) : 0;
+	++ state.packets_;
+	state.last_rx_ = arrival;
+	state.level_ = MIN(level, (pj_uint32_t)AUDIO_LEVEL_SILENT);
+
+	// һܾ˵, ˵޿ʼ
+	pj_uint32_t loudness = (AUDIO_LEVEL_SILENT - state.level_) << 8;
+	if(state.packets_ == 1)
+	{
+		state.noise_ = MIN(loudness, (pj_uint32_t)(AUDIO_LEVEL_SILENT - SPEAKER_VAD_FLOOR) << 8);
+	}
+	else if(loudness < state.noise_)
+	{
+		state.noise_ = loudness;
+	}
+	else
+	{
+		state.noise_ += (loudness - state.noise_) >> SPEAKER_NOISE_RISE;
+	}
+
+	state.speaking_ = state.level_ <= SPEAKER_VAD_FLOOR && loudness >= state.noise_ + (SPEAKER_VAD_MARGIN << 8) ? PJ_TRUE : PJ_FALSE;
+
+	pj_uint32_t target = state.speaking_ ? 1000000 : 0;
+	if(target > state.score_)
+	{
+		state.score_ += (pj_uint32_t)((pj_uint64_t)(target - state.score_) * elapsed / SPEAKER_WINDOW);
+	}
+	else
+	{
+		state.score_ -= (pj_uint32_t)((pj_uint64_t)(state.score_ - target) * elapsed / SPEAKER_WINDOW);
+	}
+}
+
+void SpeakerIndex::Clear()
+{
+	lock_guard<std::mutex> lock(speakers_lock_);
+	speakers_.clear();
+}
+
+/**
+ * libevent߳ÿSPEAKER_CHECK_INTERVALһ. ֹͣssrcƳ,
+ * ǰ仯ʱӡһ, ־ؿ˭ʲôʱ˵.
+ */
+void SpeakerIndex::Check()
+{
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+
+	vector<std::pair<pj_uint32_t, pj_uint32_t> > ranked;   // score, ssrc
+	pj_uint32_t total;
+	{
+		lock_guard<std::mutex> lock(speakers_lock_);
+		for(speaker_map_t::iterator pspeaker = speakers_.begin(); pspeaker != speakers_.end(); )
+		{
+			speaker_state_t &state = pspeaker->second;
+			pj_uint32_t idle = pj_elapsed_msec(&state.last_rx_, &now);
+			if(idle > SPEAKER_EXPIRE)
+			{
+				pspeaker = speakers_.erase(pspeaker);
+				continue;
+			}
+
+			if(idle > SPEAKER_WINDOW)
+			{
+				state.score_ = 0;
+				state.speaking_ = PJ_FALSE;
+				state.level_ = AUDIO_LEVEL_SILENT;
+			}
+
+			if(state.score_ > 0)
+			{
+				ranked.push_back(std::make_pair(state.score_, pspeaker->first));
+			}
+			++ pspeaker;
+		}
+		total = speakers_.size();
+	}
+
+	pj_uint32_t count = MIN((pj_uint32_t)ranked.size(), (pj_uint32_t)SPEAKER_LOG_TOP);
+	std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+		std::greater<std::pair<pj_uint32_t, pj_uint32_t> >());
+
+	vector<pj_uint32_t> top(count);
+	char line[32 * SPEAKER_LOG_TOP] = {0};
+	int len = 0;
+	for(pj_uint32_t i = 0; i < count; ++ i)
+	{
+		top[i] = ranked[i].second;
+		len += pj_ansi_snprintf(line + len, sizeof(line) - len, " %u(%u)", ranked[i].second, ranked[i].first / 1000);
+	}
+
+	RETURN_IF_FAIL(top != top_);
+	top_ = top;
+
+	PJ_LOG(4, (__ABS_FILE__, "Check() => %u audio streams, %u speaking recently, top ssrc(score):%s",
+		total, ranked.size(), count > 0 ? line : " none"));
+}
+
+pj_bool_t SpeakerIndex::GetSpeaker(pj_uint32_t ssrc, speaker_state_t &state)
+{
+	lock_guard<std::mutex> lock(speakers_lock_);
+	speaker_map_t::iterator pspeaker = speakers_.find(ssrc);
+	RETURN_VAL_IF_FAIL(pspeaker != speakers_.end(), PJ_FALSE);
+
+	state = pspeaker->second;
+
+	return PJ_TRUE;
+}
+
+// Ϊǧ֮. ͬһûƵƵssrcͬ, ÷audio_ssrc_
+void SpeakerIndex::GetScores(const vector<pj_uint32_t> &ssrcs, vector<pj_uint32_t> &scores)
+{
+	scores.assign(ssrcs.size(), 0);
+
+	lock_guard<std::mutex> lock(speakers_lock_);
+	for(pj_uint32_t i = 0; i < ssrcs.size(); ++ i)
+	{
+		speaker_map_t::iterator pspeaker = speakers_.find(ssrcs[i]);
+		if(pspeaker != speakers_.end())
+		{
+			scores[i] = pspeaker->second.score_ / 1000;
+		}
+	}
+}
+
+/**
+ * RFC 8285: ̶ͷCSRC֮, profileΪ0xBEDEone-byteʽ(4λid, 4λȼһ),
+ * 0x100Xtwo-byteʽ(8λid, 8λ). RFC 6464ԪصһֽΪVλ7λ-dBov.
+ */
+pj_int32_t SpeakerIndex::ExtLevel(const pj_uint8_t *rtp_frame, pj_uint32_t framelen, pj_uint32_t id)
+{
+	RETURN_VAL_IF_FAIL(framelen >= 12 && (rtp_frame[0] & 0x10), -1);
+
+	pj_uint32_t offset = 12 + 4 * (rtp_frame[0] & 0x0f);
+	RETURN_VAL_IF_FAIL(offset + 4 <= framelen, -1);
+
+	pj_uint32_t profile = (rtp_frame[offset] << 8) | rtp_frame[offset + 1];
+	pj_uint32_t ext_len = 4 * ((rtp_frame[offset + 2] << 8) | rtp_frame[offset + 3]);
+	const pj_uint8_t *ext = rtp_frame + offset + 4;
+	RETURN_VAL_IF_FAIL(offset + 4 + ext_len <= framelen, -1);
+
+	pj_uint32_t i = 0;
+	if(profile == 0xBEDE)
+	{
+		while(i < ext_len)
+		{
+			pj_uint32_t ext_id = ext[i] >> 4;
+			pj_uint32_t len = (ext[i] & 0x0f) + 1;
+			if(ext[i] == 0)
+			{
+				++ i;          // 
+				continue;
+			}
+			RETURN_VAL_IF_FAIL(ext_id != 15 && i + 1 + len <= ext_len, -1);
+
+			if(ext_id == id)
+			{
+				return ext[i + 1] & 0x7f;
+			}
+			i += 1 + len;
+		}
+	}
+	else if((profile & 0xfff0) == 0x1000)
+	{
+		while(i < ext_len)
+		{
+			if(ext[i] == 0)
+			{
+				++ i;
+				continue;
+			}
+			RETURN_VAL_IF_FAIL(i + 2 <= ext_len, -1);
+
+			pj_uint32_t ext_id = ext[i];
+			pj_uint32_t len = ext[i + 1];
+			RETURN_VAL_IF_FAIL(i + 2 + len <= ext_len, -1);
+
+			if(ext_id == id && len >= 1)
+			{
+				return ext[i + 2] & 0x7f;
+			}
+			i += 2 + len;
+		}
+	}
+
+	return -1;
+}
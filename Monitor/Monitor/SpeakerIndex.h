@@ -0,0 +1,70 @@
+#ifndef __AVS_PROXY_CLIENT_SPEAKER_INDEX__
+#define __AVS_PROXY_CLIENT_SPEAKER_INDEX__
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+#include "Com.h"
+
+using std::vector;
+
+#define SPEAKER_CHECK_INTERVAL  1000    // ms
+#define SPEAKER_EXPIRE          10000   // ms, ʱûаssrcƳ
+#define SPEAKER_PARTIAL_SAMPLES 64      // ûչʱÿֻмô
+#define SPEAKER_VAD_FLOOR       60      // dBov, һɲ˵
+#define SPEAKER_VAD_MARGIN      9       // dB, ȵô˵
+#define SPEAKER_NOISE_RISE      9       // ʱÿֻ1/512, Լ5; ʱ
+#define SPEAKER_WINDOW          3000    // ms, ˵ʱ䳣ƽ, ûаʱ
+#define SPEAKER_LOG_TOP         3       // ǰ仯ʱӡ
+
+// һƵssrc˵ͳ, ֻspeakers_lock_¶д
+typedef struct
+{
+	pj_uint32_t  level_;             // һdBov, 0Ϊ, 127Ϊ
+	pj_uint32_t  noise_;             // (127 - dBov) << 8
+	pj_uint32_t  score_;             // ˵ʱı, ֮
+	pj_bool_t    speaking_;
+	pj_bool_t    ext_level_;         // RTPͷչ(RFC 6464)
+	pj_uint32_t  packets_;
+	pj_timestamp last_rx_;
+} speaker_state_t;
+
+typedef std::unordered_map<pj_uint32_t, speaker_state_t> speaker_map_t;   // audio ssrc -> ͳ
+
+/**
+ * תеƵssrc˵, , ڼٸûҳ˭˵.
+ * RFC 6464ͷչ(RFC 8285one-bytetwo-byteʽ, idaudio_level_ext_id)ʱֱʹ,
+ * ֻL16мSPEAKER_PARTIAL_SAMPLES, SIMDں˹.
+ * ȸ߳ٵĵһΪ˵, ʱƽ˵, ݴ˸WatchsList.
+ * ssrcյһʱ, ʱûаʱƳ, Ҫûɾά.
+ */
+class SpeakerIndex
+	: public Noncopyable
+{
+public:
+	SpeakerIndex();
+
+	// հ߳е
+	void OnRtp(pj_uint32_t ssrc, const pj_uint8_t *rtp_frame, pj_uint16_t framelen);
+
+	void      Clear();
+	void      Check();
+	pj_bool_t GetSpeaker(pj_uint32_t ssrc, speaker_state_t &state);
+	// scoresƵssrcsһһӦ, ûͳƵΪ0
+	void      GetScores(const vector<pj_uint32_t> &ssrcs, vector<pj_uint32_t> &scores);
+
+	// ͷչе(dBov), ûʱ-1
+	static pj_int32_t ExtLevel(const pj_uint8_t *rtp_frame, pj_uint32_t framelen, pj_uint32_t id);
+
+private:
+	void Update(speaker_state_t &state, pj_uint32_t level, const pj_timestamp &arrival);
+
+	std::mutex    speakers_lock_;
+	speaker_map_t speakers_;
+	vector<pj_uint32_t> top_;        // һCheck()ʱǰ
+};
+
+extern SpeakerIndex g_speaker_index;
+
+#endif
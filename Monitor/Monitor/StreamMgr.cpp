@@ -0,0 +1,199 @@
+#include "stdafx.h"
+#include <algorithm>
+#include "StreamMgr.h"
+#include "AvRoutes.h"
+#include "Screen.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "StreamMgr.cpp"
+
+StreamMgr g_stream_mgr;
+
+StreamMgr::StreamMgr()
+	: factory_(nullptr)
+	, max_streams_(MAXIMAL_SCREEN_NUM)
+	, streams_()
+	, pool_lock_()
+	, all_streams_()
+	, free_streams_()
+	, waiting_()
+	, has_waiting_(PJ_FALSE)
+{
+}
+
+// max_streamsΪ0ʱĻ
+pj_status_t StreamMgr::Prepare(pj_pool_factory *factory, pj_uint32_t max_streams)
+{
+	RETURN_VAL_IF_FAIL(factory != nullptr, PJ_EINVAL);
+
+	factory_ = factory;
+	max_streams_ = max_streams > 0 ? max_streams : MAXIMAL_SCREEN_NUM;
+
+	PJ_LOG(5, (__ABS_FILE__, "Prepare stream mgr with at most %u decoders", max_streams_));
+
+	return PJ_SUCCESS;
+}
+
+void StreamMgr::Destory()
+{
+	{
+		AvRouteUpdate update;
+		streams_.clear();
+		waiting_.clear();
+		has_waiting_ = PJ_FALSE;
+		g_av_routes.Touch();
+	}
+
+	// ֮ǰͷŵĽFlushڻն, ִ
+	g_av_routes.Synchronize();
+
+	vector<VideoStream *> streams;
+	{
+		lock_guard<mutex> lock(pool_lock_);
+		streams.swap(all_streams_);
+	}
+
+	// Close()ͣ߳, δɵFlushڴ֮ǰ黹, ͳһտ
+	for(pj_uint32_t i = 0; i < streams.size(); ++ i)
+	{
+		streams[i]->Close();
+		delete streams[i];
+	}
+
+	lock_guard<mutex> lock(pool_lock_);
+	free_streams_.clear();
+}
+
+// нʱֻ; ·ĽûGOP, ûлʱͷҪؼ֡
+VideoStream *StreamMgr::Acquire(pj_uint32_t ssrc)
+{
+	RETURN_VAL_IF_FAIL(ssrc > 0 && factory_ != nullptr, nullptr);
+
+	stream_map_t::iterator pstream = streams_.find(ssrc);
+	if(pstream != streams_.end())
+	{
+		++ pstream->second->refs_;
+		return pstream->second;
+	}
+
+	VideoStream *stream = AllocStream(ssrc);
+	RETURN_VAL_IF_FAIL(stream != nullptr, nullptr);
+
+	g_rtcp_feedback.Track(ssrc);
+
+	gop_packets_t gop;
+	if(g_gop_cache.Snapshot(ssrc, gop))
+	{
+		stream->Prime(gop);
+	}
+	else
+	{
+		g_rtcp_feedback.RequestKeyframe(ssrc, PJ_TRUE);
+	}
+
+	stream->refs_ = 1;
+	streams_[ssrc] = stream;
+	g_av_routes.Touch();
+
+	return stream;
+}
+
+// ùȴ·ɿɼıƳ; FlushƳٵ·ɷ֮, հ߳һ֮
+void StreamMgr::Release(VideoStream *stream)
+{
+	RETURN_IF_FAIL(stream != nullptr && stream->refs_ > 0);
+	RETURN_IF_FAIL(-- stream->refs_ == 0);
+
+	stream_map_t::iterator pstream = streams_.find(stream->ssrc_);
+	if(pstream != streams_.end() && pstream->second == stream)
+	{
+		streams_.erase(pstream);
+		g_av_routes.Touch();
+	}
+	g_rtcp_feedback.Untrack(stream->ssrc_);
+
+	g_av_routes.Defer([this, stream]() { stream->Flush(std::bind(&StreamMgr::OnFlushed, this, stream)); });
+}
+
+// ȸÿʵ, ûпδʱ½
+VideoStream *StreamMgr::AllocStream(pj_uint32_t ssrc)
+{
+	VideoStream *stream = nullptr;
+	{
+		lock_guard<mutex> lock(pool_lock_);
+		if(!free_streams_.empty())
+		{
+			stream = free_streams_.back();
+			free_streams_.pop_back();
+		}
+		else if(all_streams_.size() >= max_streams_)
+		{
+			PJ_LOG(5, (__ABS_FILE__, "AllocStream() => ssrc[%u] no decoder available, limit %u", ssrc, max_streams_));
+			return nullptr;
+		}
+	}
+
+	if(stream != nullptr)
+	{
+		stream->Rebind(ssrc);
+		return stream;
+	}
+
+	stream = new VideoStream(ssrc);
+	pj_status_t status = stream->Open(factory_);
+	if(status != PJ_SUCCESS)
+	{
+		stream->Close();
+		delete stream;
+		return nullptr;
+	}
+
+	lock_guard<mutex> lock(pool_lock_);
+	all_streams_.push_back(stream);
+
+	PJ_LOG(5, (__ABS_FILE__, "AllocStream() => New decoder for ssrc[%u], %u decoders in pool", ssrc, all_streams_.size()));
+
+	return stream;
+}
+
+// ÷g_av_index_lock
+void StreamMgr::Wait(Screen *screen)
+{
+	RETURN_IF_FAIL(std::find(waiting_.begin(), waiting_.end(), screen) == waiting_.end());
+
+	waiting_.push_back(screen);
+	has_waiting_ = PJ_TRUE;
+}
+
+// ÷g_av_index_lock
+void StreamMgr::Cancel(Screen *screen)
+{
+	vector<Screen *>::iterator pscreen = std::find(waiting_.begin(), waiting_.end(), screen);
+	RETURN_IF_FAIL(pscreen != waiting_.end());
+
+	waiting_.erase(pscreen);
+	has_waiting_ = waiting_.empty() ? PJ_FALSE : PJ_TRUE;
+}
+
+// streamԼ߳е. Ļڵʱ¶, ֲĻٴεǼ
+void StreamMgr::OnFlushed(VideoStream *stream)
+{
+	{
+		lock_guard<mutex> lock(pool_lock_);
+		free_streams_.push_back(stream);
+	}
+
+	RETURN_IF_FAIL(has_waiting_);
+
+	AvRouteUpdate update;
+	vector<Screen *> waiting;
+	waiting.swap(waiting_);
+	has_waiting_ = PJ_FALSE;
+	for(pj_uint32_t i = 0; i < waiting.size(); ++ i)
+	{
+		waiting[i]->Resubscribe();
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef __AVS_PROXY_CLIENT_STREAM_MGR__
+#define __AVS_PROXY_CLIENT_STREAM_MGR__
+
+#include <map>
+#include <mutex>
+#include <atomic>
+
+#include "VideoStream.h"
+#include "GopCache.h"
+#include "Com.h"
+
+using std::map;
+using std::mutex;
+using std::lock_guard;
+
+typedef map<pj_uint32_t, VideoStream *> stream_map_t;  // video ssrc -> stream
+
+/**
+ * video ssrcVideoStream, ͬһssrcʾڼĻ϶ֻһ.
+ * ڵһĻʱŴ; ״̬,
+ * ´ֱ°, ´codec. ʵ()max_streams_.
+ * Acquire/Release/Streamsɵ÷g_av_index_lock, ·ɱ޸ıһ; հ߳̾AvRoutesĿҵ.
+ * ʱûֵĻWait()Ǽ, ʵFlush黹¶, ص´λҳ.
+ */
+class StreamMgr
+	: public Noncopyable
+{
+public:
+	StreamMgr();
+
+	pj_status_t  Prepare(pj_pool_factory *factory, pj_uint32_t max_streams);
+	void         Destory();
+	VideoStream *Acquire(pj_uint32_t ssrc);
+	void         Release(VideoStream *stream);
+	void         Wait(Screen *screen);
+	void         Cancel(Screen *screen);
+	inline const stream_map_t &Streams() const { return streams_; }
+
+private:
+	VideoStream *AllocStream(pj_uint32_t ssrc);
+	void         OnFlushed(VideoStream *stream);
+
+	pj_pool_factory     *factory_;
+	pj_uint32_t          max_streams_;
+	stream_map_t         streams_;          // ڽ
+	mutex                pool_lock_;        // , ʵڸԵ߳й黹
+	vector<VideoStream *> all_streams_;
+	vector<VideoStream *> free_streams_;
+	vector<Screen *>     waiting_;          // ȴĻ, g_av_index_lock޸
+	std::atomic<pj_bool_t> has_waiting_;    // 黹ʱȿһ, û˵ȾͲȥg_av_index_lock
+};
+
+extern StreamMgr g_stream_mgr;
+
+#endif
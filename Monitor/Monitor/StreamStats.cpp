@@ -0,0 +1,252 @@
+#include "stdafx.h"
+#include "StreamStats.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "StreamStats.cpp"
+
+#define INVALID_SLOT ((pj_uint32_t)-1)
+
+RateWindow::RateWindow()
+{
+	Reset();
+}
+
+void RateWindow::Reset()
+{
+	for(pj_uint32_t i = 0; i < STATS_WINDOW_SLOTS; ++ i)
+	{
+		slots_[i] = INVALID_SLOT;
+		amounts_[i] = 0;
+	}
+}
+
+void RateWindow::Add(pj_uint32_t now_msec, pj_uint32_t amount)
+{
+	pj_uint32_t slot = now_msec / STATS_WINDOW_SLOT_MS;
+	pj_uint32_t idx = slot % STATS_WINDOW_SLOTS;
+	if(slots_[idx] != slot)
+	{
+		slots_[idx] = slot;
+		amounts_[idx] = 0;
+	}
+	amounts_[idx] += amount;
+}
+
+pj_uint32_t RateWindow::Sum(pj_uint32_t now_msec) const
+{
+	pj_uint32_t slot = now_msec / STATS_WINDOW_SLOT_MS;
+	pj_uint32_t sum = 0;
+	for(pj_uint32_t i = 0; i < STATS_WINDOW_SLOTS; ++ i)
+	{
+		if(slots_[i] != INVALID_SLOT && slot - slots_[i] < STATS_WINDOW_SLOTS)
+		{
+			sum += amounts_[i];
+		}
+	}
+	return sum;
+}
+
+static void add_latency(latency_histogram_t &histogram, pj_uint32_t usec)
+{
+	pj_uint32_t idx = 0;
+	for(pj_uint32_t msec = usec / 1000; msec > 0 && idx + 1 < LATENCY_BUCKETS; msec >>= 1)
+	{
+		++ idx;
+	}
+	++ histogram.buckets_[idx];
+	++ histogram.count_;
+}
+
+StreamStats::StreamStats(pj_uint32_t clock_rate, pj_uint32_t ssrc)
+	: clock_rate_(clock_rate)
+	, rx_()
+	, dec_()
+	, started_(PJ_FALSE)
+	, base_seq_(0)
+	, max_seq_(0)
+	, cycles_(0)
+	, expected_prior_(0)
+	, received_mask_(0)
+	, last_ts_(0)
+	, jitter_q4_(0)
+	, bytes_window_()
+	, frames_window_()
+	, dec_window_()
+{
+	pj_get_timestamp(&epoch_);
+	Reset(ssrc);
+}
+
+void StreamStats::Reset(pj_uint32_t ssrc)
+{
+	rx_stats_t &rx = rx_.BeginWrite();
+	pj_bzero(&rx, sizeof(rx_stats_t));
+	rx.ssrc_ = ssrc;
+	rx_.EndWrite();
+	dec_stats_t &dec = dec_.BeginWrite();
+	pj_bzero(&dec, sizeof(dec_stats_t));
+	dec.ssrc_ = ssrc;
+	dec_.EndWrite();
+
+	started_ = PJ_FALSE;
+	pj_get_timestamp(&epoch_);
+	base_seq_ = 0;
+	max_seq_ = 0;
+	cycles_ = 0;
+	expected_prior_ = 0;
+	received_mask_ = 0;
+	last_ts_ = 0;
+	jitter_q4_ = 0;
+	bytes_window_.Reset();
+	frames_window_.Reset();
+	dec_window_.Reset();
+}
+
+pj_uint32_t StreamStats::Elapsed(const pj_timestamp &now) const
+{
+	return pj_elapsed_msec(&epoch_, &now);
+}
+
+// հ̵߳, ÿһ
+void StreamStats::OnRtp(const pjmedia_rtp_hdr *hdr, pj_uint32_t payloadlen, const pj_timestamp &arrival)
+{
+	RETURN_IF_FAIL(hdr != nullptr);
+
+	pj_uint16_t seq = pj_ntohs(hdr->seq);
+	pj_uint32_t ts = pj_ntohl(hdr->ts);
+	pj_uint32_t now_msec = Elapsed(arrival);
+
+	rx_stats_t &rx = rx_.BeginWrite();
+
+	++ rx.packets_;
+	rx.bytes_ += payloadlen;
+	bytes_window_.Add(now_msec, payloadlen);
+
+	if(!started_)
+	{
+		started_ = PJ_TRUE;
+		base_seq_ = max_seq_ = seq;
+		received_mask_ = 1;
+		++ rx.frames_;
+		frames_window_.Add(now_msec, 1);
+	}
+	else
+	{
+		pj_int16_t seq_delta = (pj_int16_t)(seq - max_seq_);
+		if(seq_delta > 0 && ts != last_ts_)
+		{
+			++ rx.frames_;
+			frames_window_.Add(now_msec, 1);
+		}
+
+		// RFC 3550 A.8: ͬһssrcĵʱ֮
+		pj_int64_t arrival_delta = (pj_int64_t)pj_elapsed_usec(&rx.last_arrival_, &arrival) * clock_rate_ / 1000000;
+		pj_int64_t transit_delta = arrival_delta - (pj_int32_t)(ts - last_ts_);
+		pj_uint32_t d = (pj_uint32_t)(transit_delta < 0 ? -transit_delta : transit_delta);
+		jitter_q4_ += d - ((jitter_q4_ + 8) >> 4);
+		rx.jitter_usec_ = (pj_uint32_t)((pj_uint64_t)(jitter_q4_ >> 4) * 1000000 / clock_rate_);
+
+		UpdateSequence(rx, seq);
+	}
+
+	last_ts_ = ts;
+	rx.last_arrival_ = arrival;
+	rx.bitrate_ = bytes_window_.Sum(now_msec) * 8 * 1000 / (STATS_WINDOW_SLOTS * STATS_WINDOW_SLOT_MS);
+	rx.fps_ = frames_window_.Sum(now_msec) * 1000 / (STATS_WINDOW_SLOTS * STATS_WINDOW_SLOT_MS);
+	rx.expected_ = expected_prior_ + cycles_ + max_seq_ - base_seq_ + 1;
+	rx.lost_ = (pj_int32_t)(rx.expected_ - (rx.packets_ - rx.duplicates_));
+
+	rx_.EndWrite();
+}
+
+// ÷BeginWrite/EndWrite֮
+void StreamStats::UpdateSequence(rx_stats_t &rx, pj_uint16_t seq)
+{
+	pj_int32_t delta = (pj_int16_t)(seq - max_seq_);
+	if(delta >= STATS_MAX_DROPOUT || -delta >= STATS_MAX_DROPOUT)
+	{
+		PJ_LOG(5, (__ABS_FILE__, "UpdateSequence() => seq restart %u -> %u", max_seq_, seq));
+		++ rx.restarts_;
+		expected_prior_ += cycles_ + max_seq_ - base_seq_ + 1;
+		base_seq_ = max_seq_ = seq;
+		cycles_ = 0;
+		received_mask_ = 1;
+	}
+	else if(delta > 0)
+	{
+		if(seq < max_seq_)
+		{
+			cycles_ += 0x10000;
+		}
+		max_seq_ = seq;
+		received_mask_ = (delta >= STATS_REORDER_WINDOW ? 0 : received_mask_ << delta) | 1;
+	}
+	else if(-delta < STATS_REORDER_WINDOW)
+	{
+		pj_uint64_t bit = (pj_uint64_t)1 << -delta;
+		if(received_mask_ & bit)
+		{
+			++ rx.duplicates_;
+		}
+		else
+		{
+			++ rx.reordered_;
+			received_mask_ |= bit;
+		}
+	}
+	else
+	{
+		++ rx.reordered_;   // ̫, Ƿظ
+	}
+}
+
+// ̵߳, ÿһ֡һ
+void StreamStats::OnFrame(pj_uint32_t decode_usec, pj_uint32_t render_usec, pj_uint32_t latency_usec)
+{
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	pj_uint32_t now_msec = Elapsed(now);
+	dec_window_.Add(now_msec, 1);
+
+	dec_stats_t &dec = dec_.BeginWrite();
+	++ dec.frames_;
+	dec.fps_ = dec_window_.Sum(now_msec) * 1000 / (STATS_WINDOW_SLOTS * STATS_WINDOW_SLOT_MS);
+	add_latency(dec.decode_, decode_usec);
+	add_latency(dec.render_, render_usec);
+	add_latency(dec.latency_, latency_usec);
+	dec_.EndWrite();
+}
+
+void StreamStats::OnSkipped()
+{
+	dec_stats_t &dec = dec_.BeginWrite();
+	++ dec.skipped_;
+	dec_.EndWrite();
+}
+
+void StreamStats::Snapshot(stream_stats_t &stats) const
+{
+	rx_.Read(stats.rx_);
+	dec_.Read(stats.dec_);
+}
+
+pj_uint32_t StreamStats::Percentile(const latency_histogram_t &histogram, pj_uint32_t percent)
+{
+	RETURN_VAL_IF_FAIL(histogram.count_ > 0, 0);
+
+	pj_uint64_t target = ((pj_uint64_t)histogram.count_ * percent + 99) / 100;
+	pj_uint64_t sum = 0;
+	for(pj_uint32_t idx = 0; idx + 1 < LATENCY_BUCKETS; ++ idx)
+	{
+		sum += histogram.buckets_[idx];
+		if(sum >= target)
+		{
+			return 1 << idx;
+		}
+	}
+
+	return 1 << (LATENCY_BUCKETS - 2);
+}
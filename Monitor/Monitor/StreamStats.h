@@ -0,0 +1,118 @@
+#ifndef __AVS_PROXY_CLIENT_STREAM_STATS__
+#define __AVS_PROXY_CLIENT_STREAM_STATS__
+
+#include "SeqLock.hpp"
+#include "Com.h"
+
+#define STATS_WINDOW_SLOTS    10
+#define STATS_WINDOW_SLOT_MS  100     // ڹ1
+#define STATS_MAX_DROPOUT     3000    // 䳬ֵΪͶ
+#define STATS_REORDER_WINDOW  64      // ڴ˷Χظ
+#define LATENCY_BUCKETS       12      // <1ms, <2ms, <4ms, ... <1024ms, 
+
+typedef struct
+{
+	pj_uint32_t count_;
+	pj_uint32_t buckets_[LATENCY_BUCKETS];
+} latency_histogram_t;
+
+// հͳ, ֻհ߳д
+typedef struct
+{
+	pj_uint32_t ssrc_;
+	pj_uint32_t packets_;
+	pj_uint64_t bytes_;
+	pj_uint32_t expected_;
+	pj_int32_t  lost_;               // RFC 3550ۼƶ, ظʱΪ
+	pj_uint32_t reordered_;
+	pj_uint32_t duplicates_;
+	pj_uint32_t restarts_;
+	pj_uint32_t jitter_usec_;        // RFC 3550
+	pj_uint32_t frames_;             // յ֡(ͬRTPʱ)
+	pj_uint32_t bitrate_;            // bps, 1
+	pj_uint32_t fps_;                // 1
+	pj_timestamp last_arrival_;
+} rx_stats_t;
+
+// ʾͳ, ֻɽ߳д
+typedef struct
+{
+	pj_uint32_t ssrc_;
+	pj_uint32_t frames_;
+	pj_uint32_t skipped_;
+	pj_uint32_t fps_;                // 1
+	latency_histogram_t decode_;     // Decode()ʱ
+	latency_histogram_t render_;     // жĻĺʱ
+	latency_histogram_t latency_;    // һ֡һﵽ
+} dec_stats_t;
+
+// rx_dec_ssrc, ڼʵRebindʱ߻᲻һ, ߾ݴ˶
+typedef struct
+{
+	rx_stats_t  rx_;
+	dec_stats_t dec_;
+} stream_stats_t;
+
+/**
+ * ̶ʱƬɵĻڼ, ֻһ߳ʹ.
+ */
+class RateWindow
+{
+public:
+	RateWindow();
+
+	void        Reset();
+	void        Add(pj_uint32_t now_msec, pj_uint32_t amount);
+	pj_uint32_t Sum(pj_uint32_t now_msec) const;
+
+private:
+	pj_uint32_t slots_[STATS_WINDOW_SLOTS];
+	pj_uint32_t amounts_[STATS_WINDOW_SLOTS];
+};
+
+/**
+ * һ·ssrcͳ. հ̵߳OnRtp, ̵߳OnFrame/OnSkipped, ָһSeqLock,
+ * ·ϲ; κ̶߳ʱSnapshotӰհͽ.
+ * Resetֻд߶ͣʱ.
+ */
+class StreamStats
+	: public Noncopyable
+{
+public:
+	StreamStats(pj_uint32_t clock_rate, pj_uint32_t ssrc);
+
+	void Reset(pj_uint32_t ssrc);
+	void OnRtp(const pjmedia_rtp_hdr *hdr, pj_uint32_t payloadlen, const pj_timestamp &arrival);
+	void OnFrame(pj_uint32_t decode_usec, pj_uint32_t render_usec, pj_uint32_t latency_usec);
+	void OnSkipped();
+	void Snapshot(stream_stats_t &stats) const;
+
+	// ֱͼpercent%ĺ(ͰϽ), һͰʱ½
+	static pj_uint32_t Percentile(const latency_histogram_t &histogram, pj_uint32_t percent);
+
+private:
+	void UpdateSequence(rx_stats_t &rx, pj_uint16_t seq);
+	pj_uint32_t Elapsed(const pj_timestamp &now) const;
+
+	pj_uint32_t          clock_rate_;
+	SeqLock<rx_stats_t>  rx_;
+	SeqLock<dec_stats_t> dec_;
+
+	// ֻհ̷߳
+	pj_bool_t            started_;
+	pj_timestamp         epoch_;
+	pj_uint16_t          base_seq_;
+	pj_uint16_t          max_seq_;
+	pj_uint32_t          cycles_;
+	pj_uint32_t          expected_prior_;   // ֮ǰۼƵexpected
+	pj_uint64_t          received_mask_;    // kλʾmax_seq_ - kյ
+	pj_uint32_t          last_ts_;
+	pj_uint32_t          jitter_q4_;        // RFC 3550 A.8, Ŵ16
+	RateWindow           bytes_window_;
+	RateWindow           frames_window_;
+
+	// ֻɽ̷߳
+	RateWindow           dec_window_;
+};
+
+#endif
@@ -12,9 +12,9 @@ BEGIN_MESSAGE_MAP(Title, CTreeCtrl)
 	ON_COMMAND_RANGE(IDC_MENU_UNLOOKUP, IDC_MENU_UNLOOKUP, &Title::OnUnlookUpNode)
 END_MESSAGE_MAP()
 
-Title::Title(pj_uint32_t id, const pj_str_t &name, order_t order)
+Title::Title(NodeArena *arena, pj_uint32_t id, const pj_str_t &name, order_t order)
 	: CTreeCtrl()
-	, Node(id, name, order, 0, TITLE)
+	, Node(arena, id, name, order, 0, TITLE)
 {
 	tree_item_ = TVI_ROOT;
 }
@@ -39,13 +39,50 @@ void Title::OnDestory()
 {
 }
 
-void Title::AddNode(pj_uint32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount)
+// Ѵ, PJ_TRUEʾorder_仯Ҫ
+pj_bool_t Title::AddNode(pj_uint32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount)
 {
-	DelNodeOrRoom(id, *this);  // Make sure it wasn't exist!
+	Node *exist = nullptr;
+	if(GetNodeOrRoom(id, exist))
+	{
+		return exist->Update(name, order, usercount);
+	}
 
-	node_map_t::mapped_type node = new TitleNode(id, name, order, usercount);
+	TitleNode *node = new (arena_->Alloc(sizeof(TitleNode))) TitleNode(arena_, id, name, order, usercount);
 	pj_assert(node);
 	AddNodeOrRoom(id, node, *this);
+
+	return PJ_FALSE;
+}
+
+void Title::OnDirectoryRefreshed()
+{
+	set<pj_int32_t> nodes_id;
+	pj_bool_t reorder = PJ_FALSE;
+
+	pj_bool_t found = g_directory_snapshot.VisitChildren(DIR_RECORD_SERVICE, id_, [&](const dir_record_t &record) {
+		nodes_id.insert(record.id_);
+		reorder |= AddNode(record.id_, record.name_, record.order_, record.usercount_);
+	});
+	RETURN_IF_FAIL(found);
+
+	KickoutRedundantNodes(nodes_id, *this);
+
+	if(reorder)
+	{
+		SortNodes(*this);
+	}
+}
+
+// ؼitem dataбǽڵĲλ±, λѱĽڵ㸴ʱtree_item_Բ, nullptr
+Node *Title::GetItemNode(HTREEITEM item)
+{
+	RETURN_VAL_IF_FAIL(item != nullptr, nullptr);
+
+	Node *node = arena_->Lookup((pj_uint32_t)GetItemData(item));
+	RETURN_VAL_IF_FAIL(node != nullptr && node->tree_item_ == item, nullptr);
+
+	return node;
 }
 
 void Title::MoveToRect(const CRect &rect)
@@ -73,6 +110,14 @@ BOOL Title::PreTranslateMessage(MSG *pMsg)
 			{
 				g_watchs_list.NextPage();
 			}
+			else if(pMsg->wParam == VK_UP)
+			{
+				g_watchs_list.ActivePage();
+			}
+			else if(pMsg->wParam == VK_DOWN)
+			{
+				g_watchs_list.SpeakerPage();
+			}
 			else if(pMsg->wParam == VK_RETURN)
 			{
 				sinashow::SendMessage(WM_CHANGE_LAYOUT, (WPARAM)0, (LPARAM)0);
@@ -89,7 +134,7 @@ void Title::OnItemExpanded(NMHDR *pNMHDR, LRESULT *pResult)
 
 	HTREEITEM pTreeItem = reinterpret_cast<HTREEITEM>(pNMTreeView->itemNew.hItem);
 
-	Node *node = reinterpret_cast<Node *>(GetItemData(pTreeItem));
+	Node *node = GetItemNode(pTreeItem);
 	RETURN_IF_FAIL(node);
 
 	enum { EXPAND = 2, SHRINK = 1 };
@@ -113,8 +158,8 @@ void Title::OnTvnBeginDrag(NMHDR *pNMHDR, LRESULT *pResult)
 
 	if(!ItemHasChildren(pTreeItem))
 	{
-		User *user = reinterpret_cast<User *>(GetItemData(pTreeItem));
-		RETURN_IF_FAIL(user != nullptr);
+		User *user = reinterpret_cast<User *>(GetItemNode(pTreeItem));
+		RETURN_IF_FAIL(user != nullptr && user->node_type_ == TITLE_USER);
 
 		sinashow::SendMessage(WM_SELECT_USER, (WPARAM)0, (LPARAM)user);
 	}
@@ -134,7 +179,7 @@ void Title::OnRightButtonClick(NMHDR *pNMHDR, LRESULT *pResult)
     if(item != nullptr)
     {
         SelectItem(item);
-		Node *node = reinterpret_cast<Node *>(GetItemData(item));
+		Node *node = GetItemNode(item);
 		if(node != nullptr)
 		{
 			CString menu_str;
@@ -183,13 +228,13 @@ void Title::OnMouseMove(UINT nFlags, CPoint point)
 			g_TrackingMouse = TRUE; 
 		}
 
-		Node *new_node = reinterpret_cast<Node *>(GetItemData(hitem));
+		Node *new_node = GetItemNode(hitem);
 		if(new_node != nullptr)
 		{
 			if(new_node != old_node)
 			{
 				old_node = new_node;
-				WCHAR coords[128];
+				WCHAR coords[256];
 				switch(new_node->node_type_)
 				{
 					case TITLE_NODE:
@@ -199,11 +244,22 @@ void Title::OnMouseMove(UINT nFlags, CPoint point)
 						swprintf_s(coords, ARRAYSIZE(coords), _T("ID: %d : %u"), new_node->id_, new_node->usercount_);
 						break;
 					case TITLE_USER:
-						swprintf_s(coords, ARRAYSIZE(coords), _T("Ƶͨ: %u Ƶͨ: %u : %u"),
-							reinterpret_cast<User *>(new_node)->audio_ssrc_,
-							reinterpret_cast<User *>(new_node)->video_ssrc_,
-							reinterpret_cast<User *>(new_node)->mic_id_);
+					{
+						User *user = reinterpret_cast<User *>(new_node);
+						int len = swprintf_s(coords, ARRAYSIZE(coords), _T("Ƶͨ: %u Ƶͨ: %u : %u"),
+							user->audio_ssrc_, user->video_ssrc_, user->mic_id_);
+
+						health_snapshot_t health;
+						if(len > 0 && g_health_monitor.GetHealth(user->video_ssrc_, health))
+						{
+							swprintf_s(coords + len, ARRAYSIZE(coords) - len, _T("\n״̬: %S : %ukbps ֡: %u IDR: %ums"),
+								HealthMonitor::StateName(health.state_),
+								health.stats_.rx_.bitrate_ / 1000,
+								health.stats_.rx_.fps_,
+								health.nal_.idr_interval_msec_);
+						}
 						break;
+					}
 					default:
 						break;
 				}
@@ -245,7 +301,8 @@ pj_bool_t Title::BelowWatchedNode(TitleRoom *room, Node *node)
 	HTREEITEM hParent = GetParentItem(room->tree_item_);
 	while(hParent != nullptr)
 	{
-		Node *hNode = reinterpret_cast<Node *>(GetItemData(hParent));
+		Node *hNode = GetItemNode(hParent);
+		RETURN_VAL_IF_FAIL(hNode != nullptr, PJ_FALSE);
 		if(hNode == node)
 		{
 			return PJ_TRUE;
@@ -14,15 +14,17 @@ class Title
 	, public Node
 {
 public:
-	Title(pj_uint32_t id, const pj_str_t &name, pj_uint32_t order);
+	Title(NodeArena *arena, pj_uint32_t id, const pj_str_t &name, pj_uint32_t order);
 	pj_status_t  Prepare(const CWnd *wrapper, pj_uint32_t uid);
 	pj_status_t  Launch();
 	virtual void OnDestory();
-	void         AddNode(pj_uint32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount);
+	pj_bool_t    AddNode(pj_uint32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount);
+	void         OnDirectoryRefreshed();
 	void         Perform();
 	void         MoveToRect(const CRect &rect);
 	void         HideWindow();
 	pj_bool_t    BelowWatchedNode(TitleRoom *room, Node *node);
+	Node        *GetItemNode(HTREEITEM item);
 	LRESULT      OnContinueTraverse();
 
 protected:
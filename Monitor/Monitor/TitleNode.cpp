@@ -7,8 +7,8 @@
 
 #define __ABS_FILE__ "TitleNode.cpp"
 
-TitleNode::TitleNode(pj_int32_t id, const pj_str_t &name, order_t order, pj_uint32_t usercount)
-	: Node(id, name, order, usercount, TITLE_NODE)
+TitleNode::TitleNode(NodeArena *arena, pj_int32_t id, const pj_str_t &name, order_t order, pj_uint32_t usercount)
+	: Node(arena, id, name, order, usercount, TITLE_NODE)
 {
 }
 
@@ -18,30 +18,40 @@ TitleNode::~TitleNode()
 
 void TitleNode::OnDestory()
 {
-	node_map_t::iterator pnode = nodes_.begin();
+	node_vec_t::iterator pnode = nodes_.begin();
 	for(; pnode != nodes_.end(); ++ pnode)
 	{
-		node_map_t::mapped_type node = pnode->second;
+		node_vec_t::value_type node = *pnode;
 		if(node != nullptr)
 		{
 			node->OnDestory();
-			delete node;
+			arena_->Destroy(node);
 			node = nullptr;
 		}
 	}
 
 	nodes_.clear();
-	nodes_order_.clear();
+	nodes_index_.clear();
 }
 
 void TitleNode::OnWatched(void *ctrl)
 {
-	OnItemExpanded(*reinterpret_cast<CTreeCtrl *>(ctrl));
+	// ӽڵ㻹ں̨ȡʱȹ, OnDirectoryRefreshed()
+	if(!Expand(*reinterpret_cast<CTreeCtrl *>(ctrl)))
+	{
+		g_watchs_list.Wait(handle_);
+		return;
+	}
+
+	WatchChildren();
+}
 
-	node_set_t::reverse_iterator pnode = nodes_order_.rbegin();
-	for(; pnode != nodes_order_.rend(); ++ pnode)
+void TitleNode::WatchChildren()
+{
+	node_vec_t::reverse_iterator pnode = nodes_.rbegin();
+	for(; pnode != nodes_.rend(); ++ pnode)
 	{
-		node_set_t::value_type node = *pnode;
+		node_vec_t::value_type node = *pnode;
 		if(node != nullptr)
 		{
 			g_watchs_list.Push(node);
@@ -52,117 +62,114 @@ void TitleNode::OnWatched(void *ctrl)
 }
 
 void TitleNode::OnItemExpanded(CTreeCtrl &tree_ctrl)
+{
+	Expand(tree_ctrl);
+}
+
+/**
+ * Ȱʾ, ɺ̨Ŀ¼У; ûʱں̨ȡ.
+ * ͨWM_DIRECTORY_REFRESHEDص߳Ӧ, ̲߳ȴҲXML.
+ * PJ_FALSEʾӽڵ㻹ȡ.
+ */
+pj_bool_t TitleNode::Expand(CTreeCtrl &tree_ctrl)
 {
 	if(nodes_.empty())
 	{
 		DelAll(tree_ctrl);
 	}
 
-	vector<pj_uint8_t> response;
-	http_tls_get(g_client_config.tls_host, g_client_config.tls_port, g_client_config.tls_uri, id_, response);
-	ParseXML(response, tree_ctrl);
+	CTreeCtrl *tree = &tree_ctrl;
+	node_handle_t handle = handle_;
+	snapshot_cb_t on_refreshed = [tree, handle] {
+		sinashow::SendMessage(WM_DIRECTORY_REFRESHED, (WPARAM)tree, (LPARAM)new node_handle_t(handle));
+	};
+
+	pj_bool_t found = ApplySnapshot(tree_ctrl);
+	if(found)
+	{
+		g_directory_snapshot.Revalidate(id_, on_refreshed);
+	}
+	else
+	{
+		g_directory_snapshot.Load(id_, on_refreshed);
+	}
 
 	if(nodes_.empty())
 	{
 		AddNull(tree_ctrl);
 	}
+
+	return found;
 }
 
-void TitleNode::ParseXML(const vector<pj_uint8_t> &xml, CTreeCtrl &tree_ctrl)
+void TitleNode::OnDirectoryRefreshed(CTreeCtrl &tree_ctrl)
 {
-#define XML_STATIC_NODE  "static_node"
-#define XML_DYNAMIC_NODE "dynamic_node"
-#define XML_NODE         "node"
-#define XML_ROOM_NODE    "room_node"
-	pugi::xml_document doc;
-	node_map_t::mapped_type node = nullptr;
-	set<node_map_t::key_type> nodes_id;
-
-	pugi::xml_parse_result result = doc.load_buffer(&xml[0], xml.size());
-	RETURN_IF_FAIL(result);
-
-	pugi::xml_node first_child = doc.root().first_child();
-	if(strncmp((char *)first_child.name(), XML_STATIC_NODE, strlen(XML_STATIC_NODE)) == 0)
+	if(nodes_.empty())
 	{
-		for(pugi::xml_node xnode = first_child.child(XML_NODE);
-			xnode;
-			xnode = xnode.next_sibling(XML_NODE))
-		{
-			node_map_t::key_type id        = atoi(xnode.attribute("id").value());
-			pj_str_t             name      = pj_str((char*)xnode.attribute("name").value());
-			order_t              order     = atoi(xnode.attribute("order").value());
-			pj_uint32_t          usercount = atoi(xnode.attribute("usercount").value());
-
-			nodes_id.insert(id);
-
-			if(GetNodeOrRoom(id, node))
-			{
-				if(node != nullptr)
-				{
-					node->Update(name, order, usercount);
-				}
-			}
-			else
-			{
-				TitleNode *title_node = new TitleNode(id, name, order, usercount);
-				pj_assert(title_node);
-				AddNodeOrRoom(id, title_node, tree_ctrl);
-			}
-		}
+		DelAll(tree_ctrl);
 	}
-	else if(strncmp((char *)first_child.name(), XML_DYNAMIC_NODE, strlen(XML_DYNAMIC_NODE)) == 0)
+
+	tree_ctrl.SetRedraw(FALSE);
+	ApplySnapshot(tree_ctrl);
+	tree_ctrl.SetRedraw(TRUE);
+
+	if(nodes_.empty())
 	{
-		for(pugi::xml_node room = first_child.child(XML_ROOM_NODE);
-			room;
-			room = room.next_sibling(XML_ROOM_NODE))
-		{
-			node_map_t::key_type id = atoi(room.attribute("id").value());
-			pj_str_t name = pj_str((char*)room.attribute("name").value());
-			order_t order = atoi(room.attribute("order").value());
-			pj_uint32_t usercount = atoi(room.attribute("usercount").value());
-
-			nodes_id.insert(id);
-
-			if(GetNodeOrRoom(id, node))
-			{
-				if(node != nullptr)
-				{
-					node->Update(name, order, usercount);
-				}
-			}
-			else
-			{
-				TitleRoom *title_room = new TitleRoom(&tree_ctrl, id, name, order, usercount);
-				pj_assert(title_room);
-				AddNodeOrRoom(id, title_room, tree_ctrl);
-			}
-		}
+		AddNull(tree_ctrl);
 	}
 
-	KickoutRedundantNodes(nodes_id);
+	// ȡʧʱûӽڵ, ҲҪ
+	if(g_watchs_list.OnLoaded(handle_))
+	{
+		WatchChildren();
+	}
 }
 
-// ٴε㿪"ĳ"/"ĳ", ܻߵķߴ.
-void TitleNode::KickoutRedundantNodes(const set<node_map_t::key_type> &nodes_id)
+// еӽڵбɾ, ûд˽ڵʱPJ_FALSE
+pj_bool_t TitleNode::ApplySnapshot(CTreeCtrl &tree_ctrl)
 {
-	node_map_t::iterator pnode = nodes_.begin();
-	for(; pnode != nodes_.end();)
+	set<pj_int32_t> nodes_id;
+	pj_bool_t reorder = PJ_FALSE;
+
+	pj_bool_t found = g_directory_snapshot.VisitChildren(DIR_RECORD_NODE, id_, [&](const dir_record_t &record) {
+		OnDirectoryRecord(record, tree_ctrl, nodes_id, reorder);
+	});
+	RETURN_VAL_IF_FAIL(found, PJ_FALSE);
+
+	KickoutRedundantNodes(nodes_id, tree_ctrl);
+
+	if(reorder)
 	{
-		node_map_t::key_type id = pnode->first;
-		node_map_t::mapped_type node = pnode->second;
-		if(nodes_id.find(id) == nodes_id.end())
-		{
-			pnode = nodes_.erase(pnode);
-			if(node != nullptr)
-			{
-				node->OnDestory(); // ߷ߴ
-				delete node;
-				node = nullptr;
-			}
-		}
-		else
+		SortNodes(tree_ctrl);
+	}
+
+	return PJ_TRUE;
+}
+
+void TitleNode::OnDirectoryRecord(const dir_record_t &record, CTreeCtrl &tree_ctrl, set<pj_int32_t> &nodes_id, pj_bool_t &reorder)
+{
+	RETURN_IF_FAIL(record.type_ == DIR_RECORD_NODE || record.type_ == DIR_RECORD_ROOM);
+
+	nodes_id.insert(record.id_);
+
+	Node *node = nullptr;
+	if(GetNodeOrRoom(record.id_, node))
+	{
+		if(node != nullptr)
 		{
-			++ pnode;
+			reorder |= node->Update(record.name_, record.order_, record.usercount_);
 		}
 	}
+	else if(record.type_ == DIR_RECORD_NODE)
+	{
+		TitleNode *title_node = new (arena_->Alloc(sizeof(TitleNode))) TitleNode(arena_, record.id_, record.name_, record.order_, record.usercount_);
+		pj_assert(title_node);
+		AddNodeOrRoom(record.id_, title_node, tree_ctrl);
+	}
+	else
+	{
+		TitleRoom *title_room = new (arena_->Alloc(sizeof(TitleRoom))) TitleRoom(arena_, &tree_ctrl, record.id_, record.name_, record.order_, record.usercount_);
+		pj_assert(title_room);
+		AddNodeOrRoom(record.id_, title_room, tree_ctrl);
+	}
 }
@@ -1,7 +1,8 @@
 #ifndef __AVS_PROXY_CLIENT_TITLE_NODE__
 #define __AVS_PROXY_CLIENT_TITLE_NODE__
 
-#include "pugixml.hpp"
+#include "DirectorySnapshot.h"
+#include "DirectoryParser.h"
 #include "Config.h"
 #include "TitleRoom.h"
 #include "Node.h"
@@ -11,16 +12,19 @@ class TitleNode
 	: public Node
 {
 public:
-	TitleNode(pj_int32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount);
+	TitleNode(NodeArena *arena, pj_int32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount);
 	virtual ~TitleNode();
 
-	void KickoutRedundantNodes(const set<node_map_t::key_type> &nodes_id);
 	virtual void OnDestory();
 	virtual void OnWatched(void *ctrl);
 	virtual void OnItemExpanded(CTreeCtrl &tree_ctrl);
+	void OnDirectoryRefreshed(CTreeCtrl &tree_ctrl);
 
 protected:
-	virtual void ParseXML(const vector<pj_uint8_t> &xml, CTreeCtrl &tree_ctrl);
+	pj_bool_t Expand(CTreeCtrl &tree_ctrl);
+	void WatchChildren();
+	pj_bool_t ApplySnapshot(CTreeCtrl &tree_ctrl);
+	void OnDirectoryRecord(const dir_record_t &record, CTreeCtrl &tree_ctrl, set<pj_int32_t> &nodes_id, pj_bool_t &reorder);
 };
 
 #endif
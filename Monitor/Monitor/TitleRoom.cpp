@@ -1,5 +1,8 @@
 #include "stdafx.h"
+#include <algorithm>
+
 #include "TitleRoom.h"
+#include "AvRoutes.h"
 
 #ifdef __ABS_FILE__
 #undef __ABS_FILE__
@@ -7,53 +10,124 @@
 
 #define __ABS_FILE__ "TitleRoom.cpp"
 
-void User::ConnectScreen(Screen *screen, pj_uint32_t screen_idx)
+// ÷g_av_index_lock. ֵı˲AvRouteUpdate¿
+static void route_ssrc(pj_uint8_t media, pj_uint32_t ssrc, index_map_t::mapped_type screen_idx)
+{
+	std::pair<index_map_t::iterator, bool> result = g_av_index_map[media].insert(index_map_t::value_type(ssrc, screen_idx));
+	if (result.second || result.first->second != screen_idx)
+	{
+		result.first->second = screen_idx;
+		g_av_routes.Touch();
+	}
+}
+
+static void unroute_ssrc(pj_uint8_t media, pj_uint32_t ssrc)
 {
+	if (g_av_index_map[media].erase(ssrc) > 0)
+	{
+		g_av_routes.Touch();
+	}
+}
+
+// ÷g_av_index_lock, ǰssrcд·
+void User::Route()
+{
+	index_map_t::mapped_type screen_idx = (index_map_t::mapped_type)(prefetch_ ? PREFETCH_SCREEN_INDEX : screen_idx_);
+
 	if (audio_ssrc_ > 0)
 	{
-		g_av_index_map[AUDIO_INDEX].insert(index_map_t::value_type(audio_ssrc_, screen_idx));
+		route_ssrc(AUDIO_INDEX, audio_ssrc_, screen_idx);
 	}
 
 	if (video_ssrc_ > 0)
 	{
-		g_av_index_map[VIDEO_INDEX].insert(index_map_t::value_type(video_ssrc_, screen_idx));
+		route_ssrc(VIDEO_INDEX, video_ssrc_, screen_idx);
 	}
+}
 
+// ÷g_av_index_lock
+void User::ConnectScreen(Screen *screen, pj_uint32_t screen_idx)
+{
 	screen_ = screen;
 	screen_idx_ = screen_idx;
+	prefetch_ = PJ_FALSE;
+	Route();
+}
+
+// ÷g_av_index_lock. ֻתgop, screen_idx_ΪINVALID_SCREEN_INDEX
+void User::Prefetch()
+{
+	screen_ = nullptr;
+	screen_idx_ = INVALID_SCREEN_INDEX;
+	prefetch_ = PJ_TRUE;
+	Route();
 }
 
+// ÷g_av_index_lock
 void User::DisconnectScreen()
 {
-	g_av_index_map[AUDIO_INDEX].erase(audio_ssrc_);
-	g_av_index_map[VIDEO_INDEX].erase(video_ssrc_);
+	unroute_ssrc(AUDIO_INDEX, audio_ssrc_);
+	unroute_ssrc(VIDEO_INDEX, video_ssrc_);
 
 	screen_ = nullptr;
 	screen_idx_ = INVALID_SCREEN_INDEX;
+	prefetch_ = PJ_FALSE;
+	mirrors_.clear();
 }
 
+// ÷room_lock_. δʾҲδԤȡûֻssrc, ·, AvRouteUpdate˷
 void User::ModMedia(pj_uint32_t audio_ssrc, pj_uint32_t video_ssrc)
 {
-	audio_ssrc_ = audio_ssrc;
-	video_ssrc_ = video_ssrc;
+	RETURN_IF_FAIL(audio_ssrc_ != audio_ssrc || video_ssrc_ != video_ssrc);
+
+	AvRouteUpdate update;
 
-	if (screen_ != nullptr)
+	pj_bool_t routed = (screen_idx_ != INVALID_SCREEN_INDEX || prefetch_) ? PJ_TRUE : PJ_FALSE;
+	pj_bool_t video_changed = video_ssrc_ != video_ssrc ? PJ_TRUE : PJ_FALSE;
+	pj_uint32_t old_video_ssrc = video_ssrc_;
+	if (routed)
 	{
-		if (audio_ssrc_ > 0)
+		if (audio_ssrc_ != audio_ssrc)
 		{
-			g_av_index_map[AUDIO_INDEX].insert(index_map_t::value_type(audio_ssrc_, screen_idx_));
+			unroute_ssrc(AUDIO_INDEX, audio_ssrc_);
 		}
 
-		if (video_ssrc_ > 0)
+		if (video_changed)
+		{
+			unroute_ssrc(VIDEO_INDEX, video_ssrc_);
+			g_gop_cache.Drop(video_ssrc_);
+		}
+	}
+
+	audio_ssrc_ = audio_ssrc;
+	video_ssrc_ = video_ssrc;
+
+	if (routed)
+	{
+		Route();
+	}
+
+	if (video_changed && health_)
+	{
+		g_health_monitor.Detach(old_video_ssrc);
+		g_health_monitor.Attach(this);
+	}
+
+	// ʾеĻĶssrcĽ
+	if (video_changed && screen_ != nullptr)
+	{
+		screen_->SwapUser(this);
+		for (pj_uint32_t i = 0; i < mirrors_.size(); ++ i)
 		{
-			g_av_index_map[VIDEO_INDEX].insert(index_map_t::value_type(video_ssrc_, screen_idx_));
+			mirrors_[i]->SwapUser(this);
 		}
 	}
 }
 
-TitleRoom::TitleRoom(CTreeCtrl *tree_ctrl, pj_int32_t id, const pj_str_t &name, order_t order, pj_uint32_t usercount)
-	: Node(id, name, order, usercount, TITLE_ROOM)
+TitleRoom::TitleRoom(NodeArena *arena, CTreeCtrl *tree_ctrl, pj_int32_t id, const pj_str_t &name, order_t order, pj_uint32_t usercount)
+	: Node(arena, id, name, order, usercount, TITLE_ROOM)
 	, tree_ctrl_(tree_ctrl)
+	, health_(PJ_FALSE)
 {
 }
 
@@ -80,9 +154,23 @@ void TitleRoom::OnDestory()
 
 	proxy_ = nullptr;
 
+	g_watchs_list.DelRoom(this);
+
 	PJ_LOG(5, (__ABS_FILE__, "Room[%d] was destoryed!", id_));
 }
 
+// order_仯ʱ鿴беλøű, ҳ˳Ŀ¼һ
+pj_bool_t TitleRoom::Update(const pj_str_t &name, order_t order, pj_uint32_t usercount)
+{
+	pj_bool_t reorder = Node::Update(name, order, usercount);
+	if(reorder)
+	{
+		g_watchs_list.OnRoomReordered(this);
+	}
+
+	return reorder;
+}
+
 void TitleRoom::OnWatched(void *ctrl)
 {
 	if(proxy_ != nullptr)
@@ -146,25 +234,47 @@ User *TitleRoom::AddUser(pj_int64_t user_id, pj_uint32_t mic_id)
 	}
 	else
 	{
-		user = new User(user_id, mic_id, this);
+		user = NewUser(user_id, mic_id);
 		users_[user_id] = user;
 
-		wchar_t str_user_id[32];
-		swprintf(str_user_id, sizeof(str_user_id) - 1, L"%u", user_id);
-
-		TVINSERTSTRUCT tvInsert;
-		tvInsert.hParent = tree_item_;
-		tvInsert.hInsertAfter = TVI_LAST;
-		tvInsert.item.lParam = (LPARAM)user;
-		tvInsert.item.pszText = str_user_id;
-		tvInsert.item.mask = LVIF_TEXT | TVIF_PARAM;
-
-		user->tree_item_ = tree_ctrl_->InsertItem(&tvInsert);
+		InsertUserItem(user);
+		if(health_)
+		{
+			g_health_monitor.AddUser(user);
+		}
 	}
 
 	return user;
 }
 
+static bool user_id_cmp(const User *u1, const User *u2)
+{
+	return u1->user_id_ < u2->user_id_;
+}
+
+User *TitleRoom::NewUser(pj_int64_t user_id, pj_uint32_t mic_id)
+{
+	return new (arena_->Alloc(sizeof(User))) User(arena_, user_id, mic_id, this);
+}
+
+void TitleRoom::InsertUserItem(User *user)
+{
+	wchar_t str_user_id[32];
+	swprintf(str_user_id, sizeof(str_user_id) - 1, L"%u", user->user_id_);
+
+	TVINSERTSTRUCT tvInsert;
+	tvInsert.hParent = tree_item_;
+	tvInsert.hInsertAfter = TVI_LAST;
+	tvInsert.item.lParam = (LPARAM)NODE_HANDLE_INDEX(user->handle_);
+	tvInsert.item.pszText = str_user_id;
+	tvInsert.item.mask = LVIF_TEXT | TVIF_PARAM;
+
+	user->tree_item_ = tree_ctrl_->InsertItem(&tvInsert);
+
+	users_order_.insert(std::lower_bound(users_order_.begin(), users_order_.end(), user, user_id_cmp), user);
+	g_watchs_list.OnRoomResized(this, users_order_.size());
+}
+
 void TitleRoom::DelUser(pj_int64_t user_id, users_map_t::iterator &puser)
 {
 	lock_guard<mutex> lock(room_lock_);
@@ -180,15 +290,7 @@ void TitleRoom::DelUser(pj_int64_t user_id, users_map_t::iterator &puser)
 
 	if(user != nullptr)
 	{
-		tree_ctrl_->DeleteItem(user->tree_item_);
-
-		Screen *screen = user->screen_;
-		if (screen != nullptr)
-		{
-			screen->DisconnectUser();
-		}
-
-		delete user;
+		DeleteUser(user);
 		user = nullptr;
 	}
 
@@ -198,6 +300,60 @@ void TitleRoom::DelUser(pj_int64_t user_id, users_map_t::iterator &puser)
 	}
 }
 
+void TitleRoom::DeleteUser(User *user)
+{
+	UnlistUser(user);
+
+	vector<Screen *> idle;
+	{
+		AvRouteUpdate update;
+		DestroyUser(user, idle);
+	}
+
+	for (pj_uint32_t i = 0; i < idle.size(); ++ i)
+	{
+		idle[i]->UpdateWindow();
+	}
+}
+
+// Ŀ¼ͷҳ˳Ƴ. Ŀ¼Ҫ̷߳Ϣ, g_av_index_lockµ
+void TitleRoom::UnlistUser(User *user)
+{
+	tree_ctrl_->DeleteItem(user->tree_item_);
+
+	vector<User *>::iterator porder = std::lower_bound(users_order_.begin(), users_order_.end(), user, user_id_cmp);
+	if(porder != users_order_.end() && *porder == user)
+	{
+		users_order_.erase(porder);
+	}
+	g_watchs_list.OnRoomResized(this, users_order_.size());
+
+	g_gop_cache.Drop(user->video_ssrc_);
+}
+
+/**
+ * ÷AvRouteUpdateg_av_index_lock. Ͽͬһμ,
+ * ߳½, õɾû. ϿĻ׷ӵidle, ɵ÷.
+ */
+void TitleRoom::DestroyUser(User *user, vector<Screen *> &idle)
+{
+	g_health_monitor.DelUser(user);
+
+	// ĻϿɾ, ֱĻϿ
+	while (user->screen_ != nullptr)
+	{
+		idle.push_back(user->screen_);
+		user->screen_->DetachUser();
+	}
+
+	if (user->prefetch_)
+	{
+		user->DisconnectScreen();
+	}
+
+	arena_->Destroy(user);
+}
+
 User *TitleRoom::GetUser(pj_int64_t user_id)
 {
 	lock_guard<mutex> lock(room_lock_);
@@ -226,32 +382,151 @@ void TitleRoom::ModUser(User *user, pj_uint32_t audio_ssrc, pj_uint32_t video_ss
 		id_, user->user_id_, user->audio_ssrc_, user->video_ssrc_));
 }
 
-void TitleRoom::IncreaseCount(pj_uint32_t &user_count)
+static bool user_info_cmp(const user_info_t &u1, const user_info_t &u2)
 {
-	lock_guard<mutex> lock(room_lock_);
-	user_count += users_.size();
+	return u1.user_id_ < u2.user_id_;
 }
 
-pj_status_t TitleRoom::OnShowPage(pj_uint32_t &offset, pj_uint32_t &first)
+/**
+ * Apply a RoomsInfo list as a diff against users_ in a single pass.
+ * Only users which were added, removed or whose ssrc changed touch the
+ * tree control and the routing table, the tree is redrawn once and the
+ * routes are published at most once. Tree items are changed outside
+ * g_av_index_lock since they message the UI thread.
+ *
+ * @return count of users added, removed or rerouted.
+ */
+pj_uint32_t TitleRoom::Reconcile(vector<user_info_t> &users_info)
 {
+	std::sort(users_info.begin(), users_info.end(), user_info_cmp);
+
+	vector<const user_info_t *> added;
+	vector<const user_info_t *> changed;
+	vector<User *>              removed;
+
 	lock_guard<mutex> lock(room_lock_);
+
+	// users_ is ordered by user id as well, so both lists are merged.
 	users_map_t::iterator puser = users_.begin();
-	for (; puser != users_.end(); ++puser)
+	pj_uint32_t i = 0;
+	while(puser != users_.end() || i < users_info.size())
 	{
-		users_map_t::mapped_type user = puser->second;
-		if (offset >= first)
+		if(i > 0 && i < users_info.size() && users_info[i].user_id_ == users_info[i - 1].user_id_)
+		{
+			++ i;  // ظû
+		}
+		else if(puser == users_.end() || (i < users_info.size() && users_info[i].user_id_ < puser->first))
+		{
+			added.push_back(&users_info[i ++]);
+		}
+		else if(i == users_info.size() || puser->first < users_info[i].user_id_)
+		{
+			removed.push_back(puser->second);
+			++ puser;
+		}
+		else
 		{
-			pj_uint32_t idx = offset - first;
-			sinashow::SendMessage(WM_WATCH_ROOM_USER, (WPARAM)user, (LPARAM)idx);
+			User *user = puser->second;
+			user->mic_id_ = users_info[i].mic_id_;
+			if(user->audio_ssrc_ != users_info[i].audio_ssrc_ || user->video_ssrc_ != users_info[i].video_ssrc_)
+			{
+				changed.push_back(&users_info[i]);
+			}
+			++ puser;
+			++ i;
 		}
+	}
+
+	pj_uint32_t diff_count = added.size() + changed.size() + removed.size();
+	RETURN_VAL_IF_FAIL(diff_count > 0, 0);
+
+	tree_ctrl_->SetRedraw(FALSE);
 
-		if (++ offset >= (first + MAXIMAL_SCREEN_NUM))
+	if(users_.empty())
+	{
+		DelAll(*tree_ctrl_);
+	}
+
+	for(pj_uint32_t j = 0; j < removed.size(); ++ j)
+	{
+		users_.erase(removed[j]->user_id_);
+		UnlistUser(removed[j]);
+	}
+
+	vector<User *> fresh;
+	vector<Screen *> idle;
+	{
+		AvRouteUpdate update;
+
+		for(pj_uint32_t j = 0; j < removed.size(); ++ j)
+		{
+			DestroyUser(removed[j], idle);
+		}
+
+		for(pj_uint32_t j = 0; j < changed.size(); ++ j)
 		{
-			return PJ_EINVAL;
+			User *user = users_[changed[j]->user_id_];
+			user->ModMedia(changed[j]->audio_ssrc_, changed[j]->video_ssrc_);
 		}
+
+		// ûû·, ModMediaֻssrc; еķAddUserϼ
+		for(pj_uint32_t j = 0; j < added.size(); ++ j)
+		{
+			User *user = NewUser(added[j]->user_id_, added[j]->mic_id_);
+			user->ModMedia(added[j]->audio_ssrc_, added[j]->video_ssrc_);
+			users_[user->user_id_] = user;
+			fresh.push_back(user);
+
+			if(health_)
+			{
+				g_health_monitor.AddUser(user);
+			}
+		}
+	}
+
+	for(pj_uint32_t j = 0; j < fresh.size(); ++ j)
+	{
+		InsertUserItem(fresh[j]);
+	}
+
+	for(pj_uint32_t j = 0; j < idle.size(); ++ j)
+	{
+		idle[j]->UpdateWindow();
 	}
 
-	return PJ_SUCCESS;
+	if(users_.empty())
+	{
+		AddNull(*tree_ctrl_);
+	}
+
+	tree_ctrl_->SetRedraw(TRUE);
+
+	PJ_LOG(5, (__ABS_FILE__, "Room[%d] reconciled, added[%u] removed[%u] changed[%u]",
+		id_, added.size(), removed.size(), changed.size()));
+
+	return diff_count;
+}
+
+// users_order_[skip, skip + count)ûԾ׷ӵusers, ʵȡĿ.
+// room_lock_ûʱܱɾ, ָܰȥ
+pj_uint32_t TitleRoom::GetPageUsers(pj_uint32_t skip, pj_uint32_t count, vector<user_ref_t> &users)
+{
+	lock_guard<mutex> lock(room_lock_);
+	RETURN_VAL_IF_FAIL(skip < users_order_.size(), 0);
+
+	count = MIN(count, users_order_.size() - skip);
+	for(pj_uint32_t i = skip; i < skip + count; ++ i)
+	{
+		user_ref_t ref = {users_order_[i]->arena_, users_order_[i]->handle_};
+		users.push_back(ref);
+	}
+
+	return count;
+}
+
+User *resolve_user(const user_ref_t &ref)
+{
+	return ref.arena != nullptr ? dynamic_cast<User *>(ref.arena->Resolve(ref.handle)) : nullptr;
 }
 
 pj_status_t TitleRoom::SendTCPPacket(const void *buf, pj_ssize_t *len)
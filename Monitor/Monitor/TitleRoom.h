@@ -7,7 +7,9 @@
 #include "Node.h"
 #include "Screen.h"
 #include "AvsProxy.h"
+#include "GopCache.h"
 #include "WatchsList.h"
+#include "HealthMonitor.h"
 #include "Com.h"
 
 class Screen;
@@ -16,21 +18,31 @@ class User
 	: public Node
 {
 public:
-	User(pj_int64_t user_id, pj_uint32_t mic_id, TitleRoom *title_room)
-		: Node(0, pj_str(""), 0, 0, TITLE_USER)
+	User(NodeArena *arena, pj_int64_t user_id, pj_uint32_t mic_id, TitleRoom *title_room)
+		: Node(arena, 0, pj_str(""), 0, 0, TITLE_USER)
 		, user_id_(user_id)
 		, mic_id_(mic_id)
 		, screen_(nullptr)
 		, screen_idx_(INVALID_SCREEN_INDEX)
+		, mirrors_()
 		, title_room_(title_room)
 		, audio_ssrc_(0)
 		, video_ssrc_(0)
+		, health_(PJ_FALSE)
+		, prefetch_(PJ_FALSE)
 	{}
 
 	void ConnectScreen(Screen *screen, pj_uint32_t screen_idx);
+	void Prefetch();
 	void DisconnectScreen();
 	void ModMedia(pj_uint32_t audio_ssrc, pj_uint32_t video_ssrc);
 
+	// , Ԥȡ򽡿еûproxyת
+	inline pj_bool_t IsForwarded() const
+	{
+		return (screen_idx_ != INVALID_SCREEN_INDEX || prefetch_ || health_) ? PJ_TRUE : PJ_FALSE;
+	}
+
 	inline bool operator!=(const User &user) const
 	{
 		return !operator==(user);
@@ -46,20 +58,37 @@ public:
 
 	pj_int64_t  user_id_;
 	pj_uint32_t mic_id_;
-	Screen     *screen_;
-	pj_uint32_t screen_idx_;
+	Screen     *screen_;            // Ļ, ·ָ
+	pj_uint32_t screen_idx_;        // ĻʱΪINVALID_SCREEN_INDEX, ԤȡûҲ
+	vector<Screen *> mirrors_;      // ͬʱʾûĻ, һ
 	TitleRoom  *title_room_;
 	pj_uint32_t audio_ssrc_;
 	pj_uint32_t video_ssrc_;
+	pj_bool_t   health_;            // ڽ, g_av_index_lock
+	pj_bool_t   prefetch_;          // ҳԤȡ, ·ָPREFETCH_SCREEN_INDEX, g_av_index_lock
+
+private:
+	void Route();
 };
 
+// ÷g_av_index_lock. ɾûҲ¶Ͽ, ûڽǰһֱЧ
+User *resolve_user(const user_ref_t &ref);
+
+typedef struct
+{
+	pj_int64_t  user_id_;
+	pj_uint32_t mic_id_;
+	pj_uint32_t audio_ssrc_;
+	pj_uint32_t video_ssrc_;
+} user_info_t;
+
 class AvsProxy;
 typedef map<pj_int64_t, User *> users_map_t;
 class TitleRoom
 	: public Node
 {
 public:
-	TitleRoom(CTreeCtrl *tree_ctrl, pj_int32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount);
+	TitleRoom(NodeArena *arena, CTreeCtrl *tree_ctrl, pj_int32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount);
 	virtual ~TitleRoom();
 
 	void OnCreate(AvsProxy *proxy);
@@ -68,9 +97,10 @@ public:
 	void  DelUser(pj_int64_t user_id, users_map_t::iterator &puser);
 	User *GetUser(pj_int64_t user_id);
 	void  ModUser(User *user, pj_uint32_t audio_ssrc, pj_uint32_t video_ssrc);
+	pj_uint32_t Reconcile(vector<user_info_t> &users_info);
 	pj_status_t SendTCPPacket(const void *buf, pj_ssize_t *len);
-	pj_status_t OnShowPage(pj_uint32_t &offset, pj_uint32_t &first);
-	void IncreaseCount(pj_uint32_t &user_count);
+	pj_uint32_t GetPageUsers(pj_uint32_t skip, pj_uint32_t count, vector<user_ref_t> &users);
+	virtual pj_bool_t Update(const pj_str_t &name, order_t order, pj_uint32_t usercount);
 	virtual void OnWatched(void *ctrl);
 
 protected:
@@ -80,12 +110,19 @@ protected:
 private:
 	void AddNode(pj_int32_t id, const pj_str_t &name, pj_uint32_t order, pj_uint32_t usercount);
 	void DelNode(pj_int32_t id);
+	User *NewUser(pj_int64_t user_id, pj_uint32_t mic_id);
+	void InsertUserItem(User *user);
+	void DeleteUser(User *user);
+	void UnlistUser(User *user);
+	void DestroyUser(User *user, vector<Screen *> &idle);
 
 public:
 	CTreeCtrl  *tree_ctrl_;
 	AvsProxy   *proxy_;
 	mutex       room_lock_;
 	users_map_t users_;
+	vector<User *> users_order_;   // users_ͬ, ҳʱ±ȡû
+	pj_bool_t   health_;           // ڵûڽ, room_lock_
 };
 
 #endif
@@ -6,22 +6,38 @@ BEGIN_MESSAGE_MAP(TitlesCtl, CTabCtrl)
 END_MESSAGE_MAP()
 
 TitlesCtl::TitlesCtl()
-	: selected_index_(0)
+	: factory_(nullptr)
+	, uid_(0)
+	, rect_(0, 0, 0, 0)
+	, selected_index_(0)
 	, titles_()
 	, titles_order_()
 {
 }
 
-pj_status_t TitlesCtl::Prepare(const CWnd *wrapper, pj_uint32_t uid)
+pj_status_t TitlesCtl::Prepare(const CWnd *wrapper, pj_uint32_t uid, pj_pool_factory *factory)
 {
+	RETURN_VAL_IF_FAIL(factory != nullptr, PJ_EINVAL);
+	factory_ = factory;
+	uid_     = uid;
+
 	BOOL result;
 	result = Create(TCS_TABS | TCS_FIXEDWIDTH | TCS_VERTICAL | 
 		WS_BORDER | WS_CHILD | WS_VISIBLE,
 		CRect(0, 0, 0, 0), (CWnd *)wrapper, uid);
 
-	vector<pj_uint8_t> response;
-	http_tls_get(g_client_config.tls_host, g_client_config.tls_port, g_client_config.tls_uri, 0, response);
-	ParseXML(response, uid);
+	// Ȱʾ, ̨УɺӦò; ûпʱҲں̨ȡ, ̲߳XML
+	snapshot_cb_t on_refreshed = [] {
+		sinashow::SendMessage(WM_DIRECTORY_REFRESHED, (WPARAM)nullptr, (LPARAM)nullptr);
+	};
+	if(ApplySnapshot())
+	{
+		g_directory_snapshot.Revalidate(0, on_refreshed);
+	}
+	else
+	{
+		g_directory_snapshot.Load(0, on_refreshed);
+	}
 
 	Perform();
 	
@@ -37,47 +53,97 @@ void TitlesCtl::OnDestory()
 {
 }
 
-void TitlesCtl::ParseXML(const vector<pj_uint8_t> &xml, pj_uint32_t uid)
+Title *TitlesCtl::AddTitle(const dir_record_t &record)
+{
+	title_map_t::iterator pservice = titles_.find(record.id_);
+	pj_assert(pservice == titles_.end());
+
+	char arena_name[32];
+	pj_ansi_snprintf(arena_name, sizeof(arena_name), "NodeArena%u", record.id_);
+	NodeArena *arena = new NodeArena(factory_, arena_name);
+	pj_assert(arena);
+
+	Title *title = new Title(arena, record.id_, record.name_, record.order_);
+	pj_assert(title);
+	title->Prepare(this, ++ uid_);
+	title->ShowWindow(SW_HIDE);
+
+	titles_.insert(title_map_t::value_type(record.id_, title));
+	titles_order_.insert(title);
+
+	return title;
+}
+
+// еserviceбɾtitle, ûĿ¼ʱPJ_FALSE
+pj_bool_t TitlesCtl::ApplySnapshot()
+{
+	set<pj_int32_t> services_id;
+	pj_bool_t found = g_directory_snapshot.VisitChildren(DIR_PARENT_ROOT, 0, [&](const dir_record_t &record) {
+		services_id.insert(record.id_);
+
+		title_map_t::iterator pservice = titles_.find(record.id_);
+		if(pservice == titles_.end())
+		{
+			AddTitle(record);
+		}
+		else
+		{
+			Title *title = pservice->second;
+			titles_order_.erase(title);    // order_set, Ƴٸ
+			title->Update(record.name_, record.order_, record.usercount_);
+			titles_order_.insert(title);
+		}
+	});
+	RETURN_VAL_IF_FAIL(found, PJ_FALSE);
+
+	// ߵserviceֻtabƳ, еķڹۿ, titleͷ
+	for(title_map_t::iterator pservice = titles_.begin(); pservice != titles_.end();)
+	{
+		if(services_id.find(pservice->first) == services_id.end())
+		{
+			titles_order_.erase(pservice->second);
+			pservice->second->ShowWindow(SW_HIDE);
+			pservice = titles_.erase(pservice);
+		}
+		else
+		{
+			++ pservice;
+		}
+	}
+
+	for(title_set_t::iterator ptitle = titles_order_.begin();
+		ptitle != titles_order_.end();
+		++ ptitle)
+	{
+		(*ptitle)->OnDirectoryRefreshed();
+	}
+
+	return PJ_TRUE;
+}
+
+// tree_ctrlΪձʾserviceбѸ, Ϊtree_ctrlhandleӦĽڵ
+void TitlesCtl::OnDirectoryRefreshed(CTreeCtrl *tree_ctrl, node_handle_t handle)
 {
-#define XML_ROOT_NAME    "table_list_index"
-#define XML_SERVICE_NAME "service"
-#define XML_NODE_NAME    "node"
-	pugi::xml_document doc;
-
-	pugi::xml_parse_result result = doc.load_buffer(&xml[0], xml.size());
-	RETURN_IF_FAIL(result);
-
-	pugi::xml_node first_child = doc.root().first_child();
-	pj_assert(strncmp((char *)first_child.name(), XML_ROOT_NAME, strlen(XML_ROOT_NAME)) == 0);
-	for(pugi::xml_node service = first_child.child(XML_SERVICE_NAME);
-		service;
-		service = service.next_sibling(XML_SERVICE_NAME))
+	if(tree_ctrl == nullptr)
 	{
-		title_map_t::key_type id = atoi(service.attribute("id").value());
-		pj_str_t name = pj_str((char*)service.attribute("name").value());
-		order_t order = atoi(service.attribute("order").value());
-		pj_uint32_t usercount;
-		title_map_t::iterator pservice = titles_.find(id);
-		pj_assert(pservice == titles_.end());
-
-		Title *title = new Title(id, name, order);
-		pj_assert(title);
-		title->Prepare(this, ++ uid);
-		title->ShowWindow(SW_HIDE);
-
-		titles_.insert(title_map_t::value_type(id, title));
-		titles_order_.insert(title);
-		for(pugi::xml_node node = service.child(XML_NODE_NAME);
-			node;
-			node = node.next_sibling(XML_NODE_NAME))
+		RETURN_IF_FAIL(ApplySnapshot());
+
+		DeleteAllItems();
+		Perform();
+		if(!rect_.IsRectEmpty())
 		{
-			id = atoi(node.attribute("id").value());
-			name = pj_str((char*)node.attribute("name").value());
-			order = atoi(node.attribute("order").value());
-			usercount = atoi(node.attribute("usercount").value());
-			title->AddNode(id, name, order, usercount);
+			MoveToRect(rect_);
 		}
+		return;
 	}
+
+	Title *title = dynamic_cast<Title *>(tree_ctrl);
+	RETURN_IF_FAIL(title != nullptr);
+
+	Node *node = title->arena_->Resolve(handle);
+	RETURN_IF_FAIL(node != nullptr && node->node_type_ == TITLE_NODE);  // ڵѱ߳
+
+	static_cast<TitleNode *>(node)->OnDirectoryRefreshed(*title);
 }
 
 void TitlesCtl::Perform()
@@ -85,6 +151,11 @@ void TitlesCtl::Perform()
 	TCITEM tcItem;
 	tcItem.mask = TCIF_TEXT;
 
+	if(selected_index_ >= titles_order_.size())
+	{
+		selected_index_ = 0;
+	}
+
 	int i = 0;
 	for(title_set_t::iterator ptitle = titles_order_.begin();
 		ptitle != titles_order_.end();
@@ -98,11 +169,10 @@ void TitlesCtl::Perform()
 		tcItem.pszText = gb_buf;
 		InsertItem(i, &tcItem);
 
-		if(i == selected_index_)
-		{
-			title->ShowWindow(SW_SHOW);
-		}
+		title->ShowWindow(i == selected_index_ ? SW_SHOW : SW_HIDE);
 	}
+
+	SetCurSel(selected_index_);
 }
 
 void TitlesCtl::GetTreeCtrlRect(LPRECT lpRect)
@@ -123,6 +193,8 @@ void TitlesCtl::GetTreeCtrlRect(LPRECT lpRect)
 
 void TitlesCtl::MoveToRect(const CRect &rect)
 {
+	rect_ = rect;
+
 	RECT irect;
 	GetItemRect(0, &irect);
 
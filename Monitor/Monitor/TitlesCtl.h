@@ -4,7 +4,8 @@
 #include <vector>
 #include <set>
 
-#include "pugixml.hpp"
+#include "DirectorySnapshot.h"
+#include "DirectoryParser.h"
 #include "Config.h"
 #include "Title.h"
 #include "Com.h"
@@ -24,20 +25,25 @@ class TitlesCtl
 public:
 	TitlesCtl();
 
-	pj_status_t  Prepare(const CWnd *wrapper, pj_uint32_t uid);
+	pj_status_t  Prepare(const CWnd *wrapper, pj_uint32_t uid, pj_pool_factory *factory);
 	pj_status_t  Launch();
 	virtual void OnDestory();
-	void         ParseXML(const vector<pj_uint8_t> &xml, pj_uint32_t uid);
+	void         OnDirectoryRefreshed(CTreeCtrl *tree_ctrl, node_handle_t handle);
 	void         Perform();
 	void         GetTreeCtrlRect(LPRECT lpRect);
 	void         MoveToRect(const CRect &rect);
 	void         HideWindow();
 
 protected:
+	Title       *AddTitle(const dir_record_t &record);
+	pj_bool_t    ApplySnapshot();
 	afx_msg void OnSelChange(NMHDR* pNMHDR, LRESULT* pResult);
 	DECLARE_MESSAGE_MAP()
 
 public:
+	pj_pool_factory *factory_;        // ÿtitleNodeArenaﴴpool
+	pj_uint32_t uid_;
+	CRect       rect_;
 	pj_uint8_t  selected_index_;
 	title_map_t titles_;              // node_idtitle
 	title_set_t titles_order_;        // ˳ʾtitle
@@ -37,6 +37,7 @@ HWND CreateTrackingToolTip(int toolID, HWND hDlg, WCHAR *pText)
     GetClientRect(hDlg, &g_toolItem.rect); 
  
     SendMessage(hwndTT, TTM_ADDTOOL, 0, (LPARAM)(LPTOOLINFO)&g_toolItem); 
+    SendMessage(hwndTT, TTM_SETMAXTIPWIDTH, 0, 600);    // , \n
  
     return hwndTT; 
 }
\ No newline at end of file
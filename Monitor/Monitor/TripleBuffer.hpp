@@ -0,0 +1,54 @@
+#ifndef __AVS_PROXY_TRIPLE_BUFFER__
+#define __AVS_PROXY_TRIPLE_BUFFER__
+
+#include <atomic>
+
+#include "Com.h"
+
+/**
+ * дߵߵ. дߺͶ߸ռһ, мһԭӽ,
+ * ˫ȴԷ: дд, ֻȡµһ, ı.
+ * ߳дʱɵ÷֤.
+ */
+template<class T>
+class TripleBuffer
+	: public Noncopyable
+{
+public:
+	TripleBuffer()
+		: back_(0)
+		, middle_(1)
+		, front_(2)
+	{
+	}
+
+	// PJ_TRUEʾһݶ߻ûȡߵֵ
+	pj_bool_t Write(const T &value)
+	{
+		slots_[back_] = value;
+		pj_uint32_t prev = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+		back_ = prev & INDEX_MASK;
+		return (prev & FRESH) ? PJ_TRUE : PJ_FALSE;
+	}
+
+	// ֵʱȡPJ_TRUE
+	pj_bool_t Read(T &value)
+	{
+		RETURN_VAL_IF_FAIL(middle_.load(std::memory_order_relaxed) & FRESH, PJ_FALSE);
+
+		pj_uint32_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+		front_ = prev & INDEX_MASK;
+		value = slots_[front_];
+		return PJ_TRUE;
+	}
+
+private:
+	enum { INDEX_MASK = 0x3, FRESH = 0x4 };
+
+	T                        slots_[3];
+	pj_uint32_t              back_;     // ֻд߷
+	std::atomic<pj_uint32_t> middle_;
+	pj_uint32_t              front_;    // ֻɶ߷
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "stdafx.h"
+
+#include "VideoAnalytics.h"
+#include "ImageKernels.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "VideoAnalytics.cpp"
+
+VideoAnalytics::VideoAnalytics()
+	: samples_()
+	, checked_resets_(0)
+	, reported_(0)
+{
+	Reset();
+}
+
+void VideoAnalytics::Reset()
+{
+	width_ = height_ = 0;
+	last_ts_ = 0;
+	pj_bzero(&freeze_, sizeof(freeze_));
+	pj_bzero(&black_, sizeof(black_));
+	pj_bzero(&low_motion_, sizeof(low_motion_));
+
+	analytics_snapshot_t &snapshot = snapshot_.BeginWrite();
+	pj_uint32_t resets = snapshot.resets_ + 1;
+	pj_bzero(&snapshot, sizeof(snapshot));
+	snapshot.resets_ = resets;
+	snapshot_.EndWrite();
+}
+
+/**
+ * ֡Ͼȷֲ, ÿȡ, SIMDںһ, ƽԲ.
+ * ߴ仯ĵһ֡ûпɱȽϵһ֡, ֻºж.
+ */
+void VideoAnalytics::OnFrame(const video_frame_t &frame, pj_uint32_t ts, pj_uint64_t now_usec)
+{
+	RETURN_IF_FAIL(frame.width_ > 0 && frame.height_ > 0);
+
+	pj_uint32_t rows = MIN(frame.height_, (pj_uint32_t)ANALYTICS_SAMPLE_ROWS);
+	pj_bool_t comparable = frame.width_ == width_ && frame.height_ == height_ ? PJ_TRUE : PJ_FALSE;
+	if(!comparable)
+	{
+		width_ = frame.width_;
+		height_ = frame.height_;
+		samples_.resize(rows * width_);
+	}
+
+	const image_kernels_t &kernels = ImageKernels::Get();
+	pj_uint64_t sum = 0, sum_sq = 0, sad = 0;
+	for(pj_uint32_t i = 0; i < rows; ++ i)
+	{
+		const pj_uint8_t *row = frame.planes_[0] + (pj_int32_t)((2 * i + 1) * height_ / (2 * rows)) * frame.pitches_[0];
+		pj_uint8_t *prev = &samples_[i * width_];
+
+		pj_uint32_t sums[3];
+		kernels.luma_stats_row_(row, comparable ? prev : row, width_, sums);
+		sum += sums[0];
+		sum_sq += sums[1];
+		sad += sums[2];
+
+		pj_memcpy(prev, row, width_);
+	}
+
+	pj_uint64_t count = (pj_uint64_t)rows * width_;
+	const analytics_snapshot_t &last = snapshot_.Peek();
+	pj_uint32_t mean = (pj_uint32_t)(sum / count);
+	pj_uint32_t variance = (pj_uint32_t)((sum_sq * count - sum * sum) / (count * count));
+	pj_uint32_t motion = comparable ? (pj_uint32_t)(sad * 100 / count) : last.motion_;
+	pj_bool_t advanced = last.frames_ == 0 || ts != last_ts_ ? PJ_TRUE : PJ_FALSE;
+	last_ts_ = ts;
+
+	Update(black_, mean < ANALYTICS_BLACK_MEAN && variance < ANALYTICS_BLACK_VARIANCE,
+		mean > ANALYTICS_BLACK_CLEAR_MEAN || variance > ANALYTICS_BLACK_CLEAR_VARIANCE,
+		g_client_config.black_timeout, now_usec);
+
+	// ʱȻ, ظ͵˶; ʱҲ˶
+	if(comparable && advanced)
+	{
+		pj_bool_t dark = black_.raised_;
+		Update(freeze_, !dark && motion < ANALYTICS_FREEZE_MOTION, dark || motion > ANALYTICS_FREEZE_CLEAR,
+			g_client_config.freeze_timeout, now_usec);
+		Update(low_motion_, !dark && !freeze_.raised_ && motion < ANALYTICS_LOW_MOTION,
+			dark || freeze_.raised_ || motion > ANALYTICS_LOW_MOTION_CLEAR,
+			g_client_config.low_motion_timeout, now_usec);
+	}
+
+	analytics_snapshot_t &snapshot = snapshot_.BeginWrite();
+	++ snapshot.frames_;
+	snapshot.mean_ = mean;
+	snapshot.variance_ = variance;
+	snapshot.motion_ = motion;
+	snapshot.alarms_ = (freeze_.raised_ ? VIDEO_ALARM_FREEZE : 0)
+		| (black_.raised_ ? VIDEO_ALARM_BLACK : 0)
+		| (low_motion_.raised_ ? VIDEO_ALARM_LOW_MOTION : 0);
+	if(advanced)
+	{
+		snapshot.last_advance_ = now_usec;
+	}
+	snapshot_.EndWrite();
+}
+
+// raise_msecΪ0ʾָ澯
+void VideoAnalytics::Update(alarm_state_t &state, pj_bool_t enter, pj_bool_t leave, pj_uint32_t raise_msec, pj_uint64_t now_usec)
+{
+	if(raise_msec == 0)
+	{
+		pj_bzero(&state, sizeof(state));
+		return;
+	}
+
+	if(!(state.raised_ ? leave : enter))
+	{
+		state.pending_ = PJ_FALSE;
+		return;
+	}
+
+	if(!state.pending_)
+	{
+		state.pending_ = PJ_TRUE;
+		state.since_ = now_usec;
+	}
+
+	pj_uint32_t hold = state.raised_ ? ANALYTICS_CLEAR_MSEC : raise_msec;
+	RETURN_IF_FAIL(now_usec - state.since_ >= (pj_uint64_t)hold * 1000);
+
+	state.raised_ = state.raised_ ? PJ_FALSE : PJ_TRUE;
+	state.pending_ = PJ_FALSE;
+}
+
+/**
+ * ݵĸ澯Խ߳; ʱfreeze_timeoutǰ(ֹͣ֡)ﲹ϶澯,
+ * ֡һ. Flush°󶨵ssrcʱ, Ϊɵĸ澯ӡ.
+ */
+pj_uint32_t VideoAnalytics::Check(pj_uint32_t ssrc, pj_uint64_t now_usec)
+{
+	analytics_snapshot_t snapshot;
+	snapshot_.Read(snapshot);
+
+	pj_uint32_t reported = reported_;
+	if(snapshot.resets_ != checked_resets_)
+	{
+		checked_resets_ = snapshot.resets_;
+		reported = 0;
+	}
+
+	pj_uint32_t alarms = snapshot.alarms_;
+	pj_uint32_t idle_msec = snapshot.frames_ > 0 && now_usec > snapshot.last_advance_
+		? (pj_uint32_t)((now_usec - snapshot.last_advance_) / 1000) : 0;
+	if(g_client_config.freeze_timeout > 0 && idle_msec > g_client_config.freeze_timeout)
+	{
+		alarms |= VIDEO_ALARM_FREEZE;
+	}
+
+	pj_uint32_t changed = alarms ^ reported;
+	for(pj_uint32_t alarm = VIDEO_ALARM_FREEZE; alarm <= VIDEO_ALARM_LOW_MOTION; alarm <<= 1)
+	{
+		if(!(changed & alarm))
+		{
+			continue;
+		}
+
+		if(alarms & alarm)
+		{
+			PJ_LOG(3, (__ABS_FILE__, "Check() => ssrc[%u] %s alarm raised, mean[%u] variance[%u] motion[%u] timestamp idle[%u]ms",
+				ssrc, AlarmName(alarm), snapshot.mean_, snapshot.variance_, snapshot.motion_, idle_msec));
+		}
+		else
+		{
+			PJ_LOG(4, (__ABS_FILE__, "Check() => ssrc[%u] %s alarm cleared, mean[%u] variance[%u] motion[%u]",
+				ssrc, AlarmName(alarm), snapshot.mean_, snapshot.variance_, snapshot.motion_));
+		}
+	}
+
+	reported_ = alarms;
+
+	return alarms;
+}
+
+const char *VideoAnalytics::AlarmName(pj_uint32_t alarm)
+{
+	switch(alarm)
+	{
+	case VIDEO_ALARM_FREEZE:
+		return "freeze";
+	case VIDEO_ALARM_BLACK:
+		return "black";
+	case VIDEO_ALARM_LOW_MOTION:
+		return "low motion";
+	default:
+		return "unknown";
+	}
+}
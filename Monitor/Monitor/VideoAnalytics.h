@@ -0,0 +1,88 @@
+#ifndef __AVS_PROXY_CLIENT_VIDEO_ANALYTICS__
+#define __AVS_PROXY_CLIENT_VIDEO_ANALYTICS__
+
+#include <vector>
+#include <atomic>
+
+#include "VideoDecoder.h"
+#include "SeqLock.hpp"
+#include "Com.h"
+
+using std::vector;
+
+#define ANALYTICS_CHECK_INTERVAL    1000    // ms, 澯Ķʱ
+#define ANALYTICS_SAMPLE_ROWS       24      // ÿ֡ȡôͳ
+#define ANALYTICS_BLACK_MEAN        28      // ƽȵڴҷANALYTICS_BLACK_VARIANCEΪ(޷ΧĺΪ16)
+#define ANALYTICS_BLACK_VARIANCE    30
+#define ANALYTICS_BLACK_CLEAR_MEAN  40      // ƽȻ򷽲ֵſʼ澯
+#define ANALYTICS_BLACK_CLEAR_VARIANCE 60
+#define ANALYTICS_FREEZE_MOTION     20      // ֡ƽԲ * 100ڴΪ治
+#define ANALYTICS_FREEZE_CLEAR      60
+#define ANALYTICS_LOW_MOTION        100     // ֡ƽԲ * 100ڴΪ˶
+#define ANALYTICS_LOW_MOTION_CLEAR  200
+#define ANALYTICS_CLEAR_MSEC        1000    // 澯ʧôòŽ
+
+typedef enum
+{
+	VIDEO_ALARM_FREEZE     = 0x1,
+	VIDEO_ALARM_BLACK      = 0x2,
+	VIDEO_ALARM_LOW_MOTION = 0x4,
+} video_alarm_t;
+
+typedef struct
+{
+	pj_uint32_t resets_;             // ÿResetһ, 澯ʱݴ˶һ·״̬
+	pj_uint32_t frames_;             // Reset֡
+	pj_uint32_t mean_;               // һ֡ƽ
+	pj_uint32_t variance_;
+	pj_uint32_t motion_;             // һ֡ƽԲ * 100
+	pj_uint32_t alarms_;             // жĸ澯, video_alarm_tλ
+	pj_uint64_t last_advance_;       // һRTPʱǰı΢
+} analytics_snapshot_t;
+
+// һָ澯ĳ״̬: 趨ʱŸ澯, ANALYTICS_CLEAR_MSECŽ
+typedef struct
+{
+	pj_bool_t   raised_;
+	pj_bool_t   pending_;
+	pj_uint64_t since_;
+} alarm_state_t;
+
+/**
+ * һ·Ƶ, ж϶, ͵˶.
+ * OnFrame()VideoStream߳жÿ֡, ֻȡȷֲANALYTICS_SAMPLE_ROWS,
+ * SIMDںֵ, һ֡ͬһλõľԲ, Զڽ뱾Ŀ.
+ * 治ʱǰ˵Դ˻涳; ʱʱ䲻ǰ(û֡)ɶʱCheck()ж.
+ * SeqLock, Check()GetSnapshot()̵߳.
+ */
+class VideoAnalytics
+	: public Noncopyable
+{
+public:
+	VideoAnalytics();
+
+	void        Reset();
+	void        OnFrame(const video_frame_t &frame, pj_uint32_t ts, pj_uint64_t now_usec);
+	// ɼ澯Ķʱ(ֻһ߳), 澯仯ʱӡ־, video_alarm_tλ
+	pj_uint32_t Check(pj_uint32_t ssrc, pj_uint64_t now_usec);
+	inline pj_uint32_t GetAlarms() const { return reported_; }
+	inline void GetSnapshot(analytics_snapshot_t &snapshot) const { snapshot_.Read(snapshot); }
+
+	static const char *AlarmName(pj_uint32_t alarm);
+
+private:
+	void Update(alarm_state_t &state, pj_bool_t enter, pj_bool_t leave, pj_uint32_t raise_msec, pj_uint64_t now_usec);
+
+	vector<pj_uint8_t>   samples_;        // һ֡е, ֻڽ߳з
+	pj_uint32_t          width_;
+	pj_uint32_t          height_;
+	pj_uint32_t          last_ts_;
+	alarm_state_t        freeze_;
+	alarm_state_t        black_;
+	alarm_state_t        low_motion_;
+	SeqLock<analytics_snapshot_t> snapshot_;
+	pj_uint32_t          checked_resets_; // ֻCheck()
+	std::atomic<pj_uint32_t> reported_;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "stdafx.h"
+#include "VideoDecoder.h"
+#include "PjmediaDecoder.h"
+#include "AvcodecDecoder.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "VideoDecoder.cpp"
+
+VideoDecoder *VideoDecoder::Create(const pj_str_t &name)
+{
+	pj_str_t pjmedia = pj_str("pjmedia");
+	if(pj_stricmp(&name, &pjmedia) == 0)
+	{
+		return new PjmediaDecoder();
+	}
+
+	return new AvcodecDecoder();
+}
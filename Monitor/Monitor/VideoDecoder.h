@@ -0,0 +1,43 @@
+#ifndef __AVS_PROXY_CLIENT_VIDEO_DECODER__
+#define __AVS_PROXY_CLIENT_VIDEO_DECODER__
+
+#include <memory>
+
+#include "Com.h"
+
+using std::shared_ptr;
+
+typedef struct
+{
+	pj_uint32_t        width_;
+	pj_uint32_t        height_;
+	const pj_uint8_t  *planes_[3];      // I420: Y, U, V
+	pj_int32_t         pitches_[3];
+	shared_ptr<void>   buffer_;         // planes_ָڴĳ: AVFrameû򿽱Ļ
+} video_frame_t;
+
+typedef shared_ptr<const video_frame_t> video_frame_ptr_t;  // ֡жĵĻ
+
+/**
+ * H264. Ϊjitter bufferһ֡ȫRTP(ʧİbufΪNULL),
+ * ͼʱͨframe. еöVideoStream߳н.
+ */
+class VideoDecoder
+	: public Noncopyable
+{
+public:
+	virtual ~VideoDecoder() {}
+
+	virtual pj_status_t Open(pj_pool_t *pool) = 0;
+	virtual void        Close() = 0;
+	virtual void        Flush() = 0;
+	virtual pj_status_t Decode(const pjmedia_frame *packets, pj_uint32_t count, pj_uint32_t ts, video_frame_ptr_t &frame) = 0;
+	virtual const char *Name() const = 0;
+
+	/**
+	 * client.xmlеvideo_decoder: "pjmedia"pjmediaffmpegװ, Ϊֱӵlibavcodec.
+	 */
+	static VideoDecoder *Create(const pj_str_t &name);
+};
+
+#endif
@@ -0,0 +1,644 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "VideoStream.h"
+#include "Screen.h"
+#include "Config.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "VideoStream.cpp"
+
+VideoStream::VideoStream(pj_uint32_t ssrc)
+	: ssrc_(ssrc)
+	, refs_(0)
+	, pool_(nullptr)
+	, stream_(nullptr)
+	, decoder_(nullptr)
+	, decoded_()
+	, decode_usec_(0)
+	, rtp_stats_(VIDEO_CLOCK_RATE, ssrc)
+	, ref_broken_(PJ_TRUE)
+	, stalled_(PJ_FALSE)
+	, subscribers_lock_()
+	, subscribers_()
+	, last_frame_()
+	, epoch_(0)
+	, video_thread_pool_(1)
+{
+	pj_bzero(&stats_, sizeof(stats_));
+	pj_bzero(&stall_start_, sizeof(stall_start_));
+	pj_bzero(&av_sync_, sizeof(av_sync_));
+	pj_bzero(&tail_arrival_, sizeof(tail_arrival_));
+	pj_bzero(&frame_arrival_, sizeof(frame_arrival_));
+}
+
+VideoStream::~VideoStream()
+{
+}
+
+pj_status_t VideoStream::Open(pj_pool_factory *factory)
+{
+	enum { M = 32 };
+
+	video_thread_pool_.Start();  // ߳, ʧʱClose()ճ
+
+	pool_ = pj_pool_create(factory, "VideoStream", 4000, 4000, NULL);
+	RETURN_VAL_IF_FAIL(pool_ != nullptr, PJ_ENOMEM);
+
+	/* Allocate stream */
+    stream_ = PJ_POOL_ZALLOC_T(pool_, vid_stream_t);
+    PJ_ASSERT_RETURN(stream_ != NULL, PJ_ENOMEM);
+
+	stream_->dec = PJ_POOL_ZALLOC_T(pool_, vid_channel_t);
+    PJ_ASSERT_RETURN(stream_->dec != NULL, PJ_ENOMEM);
+
+	unsigned chunks_per_frm = PJMEDIA_MAX_VIDEO_ENC_FRAME_SIZE / PJMEDIA_MAX_MRU;
+	int frm_ptime = 1000 * 1 / 25;
+	unsigned jb_max = 500 * chunks_per_frm / frm_ptime;
+
+	stream_->rx_frame_cnt = chunks_per_frm * 2;
+    stream_->rx_frames = (pjmedia_frame *)pj_pool_calloc(pool_, stream_->rx_frame_cnt,
+                                       sizeof(stream_->rx_frames[0]));
+	pj_str_t name;
+	name.ptr = (char*) pj_pool_alloc(pool_, M);
+    name.slen = pj_ansi_snprintf(name.ptr, M, "%s%p", "vstenc", stream_);
+
+	pj_status_t status;
+	status = pjmedia_jbuf_create(pool_, &name,
+		PJMEDIA_MAX_MRU,
+		1000 * 1 / 25,
+		jb_max, &stream_->jb);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	status = pjmedia_rtp_session_init(&stream_->dec->rtp, RTP_MEDIA_VIDEO_TYPE, 0);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	status = pj_mutex_create_simple(pool_, NULL, &stream_->jb_mutex);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	decoder_ = VideoDecoder::Create(g_client_config.video_decoder);
+	status = decoder_->Open(pool_);
+	RETURN_VAL_IF_FAIL(status == PJ_SUCCESS, status);
+
+	PJ_LOG(5, (__ABS_FILE__, "Open video stream ssrc[%u] decoder[%s] ok!", ssrc_, decoder_->Name()));
+
+	return PJ_SUCCESS;
+}
+
+void VideoStream::Close()
+{
+	video_thread_pool_.Stop();
+
+	if(decoder_ != nullptr)
+	{
+		decoder_->Close();
+		delete decoder_;
+		decoder_ = nullptr;
+	}
+	decoded_.reset();
+
+	if(stream_ != nullptr)
+	{
+		if(stream_->jb != nullptr)
+		{
+			pjmedia_jbuf_destroy(stream_->jb);
+		}
+		if(stream_->jb_mutex != nullptr)
+		{
+			pj_mutex_destroy(stream_->jb_mutex);
+		}
+		stream_ = nullptr;
+	}
+
+	if(pool_ != nullptr)
+	{
+		pj_pool_release(pool_);
+		pool_ = nullptr;
+	}
+
+	PJ_LOG(5, (__ABS_FILE__, "Close video stream ssrc[%u]", ssrc_));
+}
+
+/**
+ * jitter buffer, RTPỰ, Ĳο֡һ֡, ر, Ա㸴.
+ * ̶ִ߳, doneʱоssrcİ֡.
+ */
+void VideoStream::Flush(const std::function<void ()> &done)
+{
+	video_thread_pool_.Schedule(std::bind(&VideoStream::OnFlush, this, done));
+}
+
+// ֻFlushɵĿʵ, ʱ̶߳дͳ
+void VideoStream::Rebind(pj_uint32_t ssrc)
+{
+	PJ_LOG(5, (__ABS_FILE__, "Rebind video stream ssrc[%u] to ssrc[%u]", ssrc_, ssrc));
+
+	ssrc_ = ssrc;
+	rtp_stats_.Reset(ssrc);
+}
+
+void VideoStream::OnFlush(std::function<void ()> done)
+{
+	pj_mutex_lock(stream_->jb_mutex);
+	pjmedia_jbuf_reset(stream_->jb);
+	pjmedia_rtp_session_init(&stream_->dec->rtp, RTP_MEDIA_VIDEO_TYPE, 0);
+	stream_->dec_frame.size = 0;
+	stream_->dec_frame.timestamp.u64 = 0;
+	pj_mutex_unlock(stream_->jb_mutex);
+
+	decoder_->Flush();
+	decoded_.reset();
+	playout_.Reset();
+	analytics_.Reset();
+	pj_bzero(&av_sync_, sizeof(av_sync_));
+	pj_bzero(&stats_, sizeof(stats_));
+	ref_broken_ = PJ_TRUE;
+	stalled_ = PJ_FALSE;
+
+	{
+		lock_guard<mutex> lock(subscribers_lock_);
+		subscribers_.clear();
+		last_frame_.reset();
+		++ epoch_;
+	}
+
+	done();
+}
+
+// ·ĽûGOPٽ, ʵʱ֮ǰ
+void VideoStream::Prime(const gop_packets_t &gop)
+{
+	RETURN_IF_FAIL(!gop.empty());
+
+	video_thread_pool_.Schedule(std::bind(&VideoStream::OnPrimeVideo, this, shared_ptr<gop_packets_t>(new gop_packets_t(gop))));
+}
+
+void VideoStream::Subscribe(Screen *screen)
+{
+	RETURN_IF_FAIL(screen != nullptr);
+
+	video_frame_ptr_t frame;
+	{
+		lock_guard<mutex> lock(subscribers_lock_);
+		subscribers_.push_back(screen);
+		frame = last_frame_;
+	}
+
+	if(frame)
+	{
+		video_thread_pool_.Schedule(std::bind(&Screen::OnVideoFrame, screen, this, frame));
+	}
+}
+
+void VideoStream::Unsubscribe(Screen *screen)
+{
+	lock_guard<mutex> lock(subscribers_lock_);
+	vector<Screen *>::iterator pscreen = std::find(subscribers_.begin(), subscribers_.end(), screen);
+	if(pscreen != subscribers_.end())
+	{
+		subscribers_.erase(pscreen);
+	}
+}
+
+pj_uint32_t VideoStream::GetSubscribers()
+{
+	lock_guard<mutex> lock(subscribers_lock_);
+	return subscribers_.size();
+}
+
+void VideoStream::VideoScene(const pj_uint8_t *rtp_frame, pj_uint16_t framelen)
+{
+	RETURN_IF_FAIL(rtp_frame && framelen > 0);
+
+	/*vector<pj_uint8_t>(rtp_frame, rtp_frame + framelen) */
+	pj_uint8_t *frame = new pj_uint8_t[framelen];
+	memcpy(frame, rtp_frame, framelen);
+
+	pj_timestamp arrival;
+	pj_get_timestamp(&arrival);
+
+	const pjmedia_rtp_hdr *hdr;
+	const void *payload;
+	unsigned payloadlen;
+	if(pjmedia_rtp_decode_rtp(NULL, rtp_frame, framelen, &hdr, &payload, &payloadlen) == PJ_SUCCESS)
+	{
+		rtp_stats_.OnRtp(hdr, payloadlen, arrival);
+	}
+
+	video_thread_pool_.Schedule(std::bind(&VideoStream::OnRxVideo, this, shared_ptr<pj_uint8_t>(frame), framelen, arrival));
+}
+
+void VideoStream::OnRxVideo(shared_ptr<pj_uint8_t> video_frame, pj_uint16_t framelen, pj_timestamp arrival)
+{
+	RETURN_IF_FAIL(framelen > 0);
+
+	if(decode_rtp_packet(video_frame.get(), framelen, arrival))
+	{
+		pj_timestamp publish_start;
+		pj_get_timestamp(&publish_start);
+
+		if(g_client_config.analytics_enable && decoded_)
+		{
+			analytics_.OnFrame(*decoded_, stream_->dec_frame.timestamp.u32.lo, PlayoutClock::Usec(publish_start));
+
+			pj_timestamp analyzed;
+			pj_get_timestamp(&analyzed);
+			stats_.analytics_usec_ += pj_elapsed_usec(&publish_start, &analyzed);
+			publish_start = analyzed;
+		}
+
+		Schedule(stream_->dec_frame.timestamp.u32.lo, frame_arrival_);
+		UpdateStats(frame_arrival_, publish_start);
+	}
+}
+
+/**
+ * ͳÿ֡Ľʱʹհӳ, ڴӡ.
+ * client.xmlлvideo_decoderɱȽpjmedialibavcodec·.
+ */
+void VideoStream::UpdateStats(const pj_timestamp &arrival, const pj_timestamp &publish_start)
+{
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+	pj_uint32_t latency_usec = pj_elapsed_usec(&arrival, &now);
+
+	rtp_stats_.OnFrame(decode_usec_, pj_elapsed_usec(&publish_start, &now), latency_usec);
+
+	++ stats_.frames_;
+	stats_.decode_usec_ += decode_usec_;
+	stats_.decode_max_usec_ = MAX(stats_.decode_max_usec_, decode_usec_);
+	stats_.latency_usec_ += latency_usec;
+
+	RETURN_IF_FAIL(stats_.frames_ >= DECODE_STATS_INTERVAL);
+
+	pj_uint32_t decode_avg = (pj_uint32_t)(stats_.decode_usec_ / stats_.frames_);
+	PJ_LOG(4, (__ABS_FILE__, "ssrc[%u] decoder[%s] frames[%u] decode avg[%u]us max[%u]us latency avg[%u]us "
+		"skipped[%u] saved about[%u]us stalls[%u] stalled[%u]ms",
+		ssrc_, decoder_->Name(), stats_.frames_,
+		decode_avg, stats_.decode_max_usec_,
+		(pj_uint32_t)(stats_.latency_usec_ / stats_.frames_),
+		stats_.skipped_, stats_.skipped_ * decode_avg,
+		stats_.stalls_, (pj_uint32_t)(stats_.stall_usec_ / 1000)));
+
+	playout_stats_t playout;
+	playout_.GetStats(playout);
+	PJ_LOG(4, (__ABS_FILE__, "ssrc[%u] playout %s target delay[%u]ms drift[%d]ppm scheduled[%u] late[%u]",
+		ssrc_, g_client_config.low_latency ? "bypassed" : "scheduled",
+		playout.target_msec_, playout.drift_ppm_, playout.scheduled_, playout.late_));
+
+	if(g_client_config.av_sync)
+	{
+		PJ_LOG(4, (__ABS_FILE__, "ssrc[%u] av sync %s offset[%lld]ms aligned frames[%u]",
+			ssrc_, av_sync_.synced_ ? (av_sync_.by_report_ ? "by sender reports" : "by arrival") : "off",
+			av_sync_.offset_usec_ / 1000, av_sync_.frames_));
+		av_sync_.frames_ = 0;
+	}
+
+	stream_stats_t snapshot;
+	rtp_stats_.Snapshot(snapshot);
+	PJ_LOG(4, (__ABS_FILE__, "ssrc[%u] packets[%u] lost[%d] reordered[%u] duplicates[%u] jitter[%u]us "
+		"bitrate[%u]kbps fps rx[%u] decoded[%u] p95 decode[%u]ms render[%u]ms latency[%u]ms",
+		ssrc_, snapshot.rx_.packets_, snapshot.rx_.lost_, snapshot.rx_.reordered_, snapshot.rx_.duplicates_,
+		snapshot.rx_.jitter_usec_, snapshot.rx_.bitrate_ / 1000, snapshot.rx_.fps_, snapshot.dec_.fps_,
+		StreamStats::Percentile(snapshot.dec_.decode_, 95),
+		StreamStats::Percentile(snapshot.dec_.render_, 95),
+		StreamStats::Percentile(snapshot.dec_.latency_, 95)));
+
+	if(g_client_config.analytics_enable)
+	{
+		// Ŀռʱֱȱʾ, ӦԶ1%
+		analytics_snapshot_t analytics;
+		analytics_.GetSnapshot(analytics);
+		pj_uint32_t ratio = (pj_uint32_t)(stats_.analytics_usec_ * 10000 / MAX(stats_.decode_usec_, 1));
+		PJ_LOG(4, (__ABS_FILE__, "ssrc[%u] analytics avg[%u]us %u.%02u%% of decode mean[%u] variance[%u] motion[%u] alarms[0x%x]",
+			ssrc_, (pj_uint32_t)(stats_.analytics_usec_ / stats_.frames_), ratio / 100, ratio % 100,
+			analytics.mean_, analytics.variance_, analytics.motion_, analytics.alarms_));
+	}
+
+	pj_bzero(&stats_, sizeof(stats_));
+}
+
+// м֡, ֻһ֡. ĵʱ, ʱ
+void VideoStream::OnPrimeVideo(shared_ptr<gop_packets_t> gop)
+{
+	pj_timestamp now;
+	pj_get_timestamp(&now);
+
+	pj_bool_t decoded = PJ_FALSE;
+	for(pj_uint32_t i = 0; i < gop->size(); ++ i)
+	{
+		const rtp_packet_t &packet = (*gop)[i];
+		if(decode_rtp_packet(&packet[0], (pj_uint16_t)packet.size(), now))
+		{
+			decoded = PJ_TRUE;
+		}
+	}
+
+	if(decoded)
+	{
+		Publish();
+	}
+	playout_.Reset();
+
+	PJ_LOG(5, (__ABS_FILE__, "Video stream ssrc[%u] primed with %u cached packets", ssrc_, gop->size()));
+}
+
+// ڱ߳һ֡
+void VideoStream::Publish()
+{
+	RETURN_IF_FAIL(decoded_);
+
+	Release(decoded_, epoch_);
+}
+
+/**
+ * RTPʱں󽻸g_playout_scheduler, ٷ. low_latencyʱ, ֡߳
+ * ûʱ. ͬһ·֡ʱ˳, ᱻ֮֡.
+ * av_syncʱڷͬһûƵ.
+ */
+void VideoStream::Schedule(pj_uint32_t ts, const pj_timestamp &arrival)
+{
+	RETURN_IF_FAIL(decoded_);
+
+	if(!g_client_config.low_latency)
+	{
+		pj_uint64_t due = playout_.Schedule(ts, arrival, decode_usec_);
+		if(g_client_config.av_sync)
+		{
+			due = g_av_sync.Align(ssrc_, ts, arrival, due, av_sync_);
+		}
+		RETURN_IF_FAIL(!g_playout_scheduler.Push(this, epoch_, decoded_, due));
+	}
+
+	Publish();
+}
+
+// ̵̻߳֡߳. ڼ䱻Flushľ֡ٷ
+void VideoStream::Release(const video_frame_ptr_t &frame, pj_uint32_t epoch)
+{
+	vector<Screen *> subscribers;
+	{
+		lock_guard<mutex> lock(subscribers_lock_);
+		RETURN_IF_FAIL(epoch == epoch_);
+
+		last_frame_ = frame;
+		subscribers = subscribers_;
+	}
+
+	for(pj_uint32_t i = 0; i < subscribers.size(); ++ i)
+	{
+		subscribers[i]->OnVideoFrame(this, frame);
+	}
+}
+
+/**
+ * ο: ο֡ȱ, ֡Ҳǻ, һɲͽ,
+ * Ļһ֡ȷĻ, ֱIDRrecovery point.
+ * ȱķǲοֻ֡Լ. ǷӦһ֡.
+ */
+pj_bool_t VideoStream::GateFrame(pj_bool_t complete, pj_bool_t reference, pj_bool_t keyframe)
+{
+	if(keyframe && complete)
+	{
+		if(stalled_)
+		{
+			pj_timestamp now;
+			pj_get_timestamp(&now);
+			pj_uint32_t stall_usec = pj_elapsed_usec(&stall_start_, &now);
+			stats_.stall_usec_ += stall_usec;
+			stalled_ = PJ_FALSE;
+
+			PJ_LOG(5, (__ABS_FILE__, "ssrc[%u] resumed at keyframe after %u ms stall", ssrc_, stall_usec / 1000));
+		}
+		ref_broken_ = PJ_FALSE;
+		return PJ_TRUE;
+	}
+
+	if(ref_broken_)
+	{
+		++ stats_.skipped_;
+		rtp_stats_.OnSkipped();
+		g_rtcp_feedback.RequestKeyframe(ssrc_, PJ_FALSE);
+		return PJ_FALSE;
+	}
+
+	if(!complete)
+	{
+		++ stats_.skipped_;
+		rtp_stats_.OnSkipped();
+		if(reference)
+		{
+			ref_broken_ = PJ_TRUE;
+			stalled_ = PJ_TRUE;
+			pj_get_timestamp(&stall_start_);
+			++ stats_.stalls_;
+			g_rtcp_feedback.RequestKeyframe(ssrc_, PJ_FALSE);
+
+			PJ_LOG(5, (__ABS_FILE__, "ssrc[%u] reference frame incomplete, hold until next keyframe", ssrc_));
+		}
+		return PJ_FALSE;
+	}
+
+	return PJ_TRUE;
+}
+
+// һRTPjitter buffer, һ֡ʱ. Ƿõµһ֡
+pj_bool_t VideoStream::decode_rtp_packet(const pj_uint8_t *rtp_frame, pj_uint16_t framelen, const pj_timestamp &arrival)
+{
+	pj_status_t status;
+	const pjmedia_rtp_hdr *hdr;
+	const void *payload;
+	unsigned payloadlen;
+	pjmedia_rtp_status seq_st;
+
+	status = pjmedia_rtp_decode_rtp(&stream_->dec->rtp, rtp_frame, framelen,
+				&hdr, &payload, &payloadlen);
+	if(status == PJ_SUCCESS)
+	{
+		pjmedia_rtp_session_update2(&stream_->dec->rtp, hdr, &seq_st, PJ_TRUE);
+		if (payloadlen == 0)
+			return PJ_FALSE;
+
+		pj_mutex_lock(stream_->jb_mutex);
+
+		if ((pj_ntohl(hdr->ts) != stream_->dec_frame.timestamp.u32.lo) || hdr->m) {
+			/* Only decode if we don't already have decoded one,
+				* unless the jb is full.
+				*/
+			pj_bool_t can_decode = PJ_FALSE;
+
+			if (pjmedia_jbuf_is_full(stream_->jb)) {
+				can_decode = PJ_TRUE;
+			}
+			else if (stream_->dec_frame.size == 0) {
+				can_decode = PJ_TRUE;
+			}
+
+			if (can_decode) {
+				if (decode_vid_frame() != PJ_SUCCESS) {
+					stream_->dec_frame.size = 0;
+				}
+				else if (stream_->dec_frame.size > 0) {
+					/* û, ֮ǰİճɵ֡ */
+					frame_arrival_ = tail_arrival_;
+				}
+			}
+		}
+
+		if (seq_st.status.flag.restart) {
+			status = pjmedia_jbuf_reset(stream_->jb);
+			ref_broken_ = PJ_TRUE;
+			PJ_LOG(4,(__FILE__, "Jitter buffer reset"));
+		} else {
+			/* Just put the payload into jitter buffer */
+			pjmedia_jbuf_put_frame3(stream_->jb, payload, payloadlen, 0, 
+				pj_ntohs(hdr->seq), pj_ntohl(hdr->ts), NULL);
+			tail_arrival_ = arrival;
+		}
+
+		pj_mutex_unlock(stream_->jb_mutex);
+	}
+
+	if (stream_->dec_frame.type == PJMEDIA_FRAME_TYPE_VIDEO
+		&& stream_->dec_frame.size > 0)
+	{
+		stream_->dec_frame.size = 0;  // decoded_
+		return PJ_TRUE;
+	}
+
+	return PJ_FALSE;
+}
+
+pj_status_t VideoStream::decode_vid_frame()
+{
+    pj_uint32_t last_ts = 0;
+    int frm_first_seq = 0, frm_last_seq = 0;
+    pj_bool_t got_frame = PJ_FALSE;
+    unsigned cnt;
+    pj_status_t status;
+
+	/* Check if we got a decodable frame */
+    for (cnt=0; ; ++cnt)
+	{
+		char ptype;
+		pj_uint32_t ts;
+		int seq;
+
+		/* Peek frame from jitter buffer. */
+		pjmedia_jbuf_peek_frame(stream_->jb, cnt, NULL, NULL,
+					&ptype, NULL, &ts, &seq);
+		if (ptype == PJMEDIA_JB_NORMAL_FRAME)
+		{
+			if (last_ts == 0)
+			{
+				last_ts = ts;
+				frm_first_seq = seq;
+			}
+			if (ts != last_ts)
+			{
+				got_frame = PJ_TRUE;
+				break;
+			}
+			frm_last_seq = seq;
+		}
+		else if (ptype == PJMEDIA_JB_ZERO_EMPTY_FRAME)
+		{
+			/* No more packet in the jitter buffer */
+			break;
+		}
+    }
+
+    if (got_frame)
+	{
+		unsigned i;
+		pj_bool_t complete = PJ_TRUE, reference = PJ_FALSE, keyframe = PJ_FALSE;
+
+		/* Generate frame bitstream from the payload */
+		if (cnt > stream_->rx_frame_cnt)
+		{
+			PJ_LOG(1,(__FILE__, "Discarding %u frames because array is full!",
+				cnt - stream_->rx_frame_cnt));
+			pjmedia_jbuf_remove_frame(stream_->jb, cnt - stream_->rx_frame_cnt);
+			cnt = stream_->rx_frame_cnt;
+			complete = PJ_FALSE;    // ֡ͷİѱ
+		}
+
+		for (i = 0; i < cnt; ++i)
+		{
+			char ptype;
+
+			stream_->rx_frames[i].type = PJMEDIA_FRAME_TYPE_VIDEO;
+			stream_->rx_frames[i].timestamp.u64 = last_ts;
+			stream_->rx_frames[i].bit_info = 0;
+
+			/* We use jbuf_peek_frame() as it will returns the pointer of
+			 * the payload (no buffer and memcpy needed), just as we need.
+			 */
+			pjmedia_jbuf_peek_frame(stream_->jb, i,
+				(const void**)&stream_->rx_frames[i].buf,
+				&stream_->rx_frames[i].size, &ptype,
+				NULL, NULL, NULL);
+
+			if (ptype != PJMEDIA_JB_NORMAL_FRAME)
+			{
+				/* Packet lost, must set payload to NULL and keep going */
+				stream_->rx_frames[i].buf = NULL;
+				stream_->rx_frames[i].size = 0;
+				stream_->rx_frames[i].type = PJMEDIA_FRAME_TYPE_NONE;
+				complete = PJ_FALSE;
+				continue;
+			}
+
+			const pj_uint8_t *payload = (const pj_uint8_t *)stream_->rx_frames[i].buf;
+			pj_uint32_t payloadlen = stream_->rx_frames[i].size;
+			reference |= GopCache::IsReference(payload, payloadlen);
+			keyframe |= GopCache::IsKeyframe(payload, payloadlen) || GopCache::IsRecoveryPoint(payload, payloadlen);
+		}
+
+		if (!GateFrame(complete, reference, keyframe))
+		{
+			stream_->dec_frame.type = PJMEDIA_FRAME_TYPE_NONE;
+			stream_->dec_frame.size = 0;
+			pjmedia_jbuf_remove_frame(stream_->jb, cnt);
+			return PJ_SUCCESS;
+		}
+
+		/* Decode */
+		pj_timestamp start, end;
+		pj_get_timestamp(&start);
+
+		video_frame_ptr_t frame;
+		status = decoder_->Decode(stream_->rx_frames, cnt, last_ts, frame);
+
+		pj_get_timestamp(&end);
+		decode_usec_ = pj_elapsed_usec(&start, &end);
+
+		if (status != PJ_SUCCESS || !frame)
+		{
+			stream_->dec_frame.type = PJMEDIA_FRAME_TYPE_NONE;
+			stream_->dec_frame.size = 0;
+		}
+		else
+		{
+			decoded_ = frame;
+			stream_->dec_frame.type = PJMEDIA_FRAME_TYPE_VIDEO;
+			stream_->dec_frame.size = frame->width_ * frame->height_ * 3 / 2;
+			stream_->dec_frame.timestamp.u64 = last_ts;
+		}
+
+		pjmedia_jbuf_remove_frame(stream_->jb, cnt);
+    }
+
+	/* Learn remote frame rate after successful decoding */
+    if (stream_->dec_frame.type == PJMEDIA_FRAME_TYPE_VIDEO
+		&& stream_->dec_frame.size)
+    {
+		stream_->last_dec_seq = frm_last_seq;
+		stream_->last_dec_ts = last_ts;
+	}
+
+	return got_frame ? PJ_SUCCESS : PJ_ENOTFOUND;
+}
@@ -0,0 +1,128 @@
+#ifndef __AVS_PROXY_CLIENT_VIDEO_STREAM__
+#define __AVS_PROXY_CLIENT_VIDEO_STREAM__
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <pjmedia-codec.h>
+
+#include "PoolThread.hpp"
+#include "GopCache.h"
+#include "VideoDecoder.h"
+#include "RTCPFeedback.h"
+#include "StreamStats.h"
+#include "Playout.h"
+#include "VideoAnalytics.h"
+#include "AvSync.h"
+#include "Com.h"
+
+using std::shared_ptr;
+using std::vector;
+using std::mutex;
+using std::lock_guard;
+
+#define VIDEO_WIDTH  320
+#define VIDEO_HEIGHT 240
+#define VIDEO_CLOCK_RATE 90000
+
+typedef struct vid_channel
+{
+    unsigned		    pt;		    /**< Payload type.		    */
+    pj_bool_t		    paused;	    /**< Paused?.		    */
+    void		       *buf;	    /**< Output buffer.		    */
+    unsigned		    buf_size;	/**< Size of output buffer.	    */
+    pjmedia_rtp_session rtp;	/**< RTP session.		    */
+} vid_channel_t;
+
+typedef struct vid_stream
+{
+	vid_channel_t     *dec;	            /**< Decoding channel.	    */
+	pj_mutex_t        *jb_mutex;
+    pjmedia_jbuf      *jb;	            /**< Jitter buffer.		    */
+	pjmedia_frame      dec_frame;	    /**< Current decoded frame, ֻtype/size/timestamp¼״̬ */
+	unsigned           rx_frame_cnt;    /**< # of array in rx_frames    */
+    pjmedia_frame     *rx_frames;	    /**< Temp. buffer for incoming frame assembly.	    */
+	pj_uint32_t		   last_dec_ts;     /**< Last decoded timestamp.    */
+    int			       last_dec_seq;    /**< Last decoded sequence.     */
+} vid_stream_t;
+
+#define DECODE_STATS_INTERVAL 500      // ÿô֡ӡһͳ
+
+typedef struct
+{
+	pj_uint32_t frames_;
+	pj_uint64_t decode_usec_;            // Decode()ʱ֮
+	pj_uint32_t decode_max_usec_;
+	pj_uint64_t latency_usec_;           // һ֡İӵ֮
+	pj_uint32_t skipped_;                // οѶδ֡
+	pj_uint32_t stalls_;
+	pj_uint64_t stall_usec_;             // ѽͣʱ֮
+	pj_uint64_t analytics_usec_;         // VideoAnalytics::OnFrame()ʱ֮
+} decode_stats_t;
+
+class Screen;
+/**
+ * һ·ƵssrcĽ. ÿssrcֻһ, ֡üķʽ
+ * жĵĻ, ĻԼĴڴСʾ.
+ * StreamMgrssrc, ʹʱ״̬Żؿ, ֮°󶨵ssrc.
+ * Լ߳; ֡PlayoutClock, ʱg_playout_scheduler̷߳.
+ */
+class VideoStream
+	: public Noncopyable
+{
+public:
+	VideoStream(pj_uint32_t ssrc);
+	~VideoStream();
+
+	pj_status_t Open(pj_pool_factory *factory);
+	void        Close();
+	void        Flush(const std::function<void ()> &done);
+	void        Rebind(pj_uint32_t ssrc);
+	void        Prime(const gop_packets_t &gop);
+	void        Subscribe(Screen *screen);
+	void        Unsubscribe(Screen *screen);
+	pj_uint32_t GetSubscribers();
+	void        VideoScene(const pj_uint8_t *rtp_frame, pj_uint16_t framelen);
+	void        Release(const video_frame_ptr_t &frame, pj_uint32_t epoch);
+	inline void GetStats(stream_stats_t &stats) const { rtp_stats_.Snapshot(stats); }
+	inline void GetAnalytics(analytics_snapshot_t &snapshot) const { analytics_.GetSnapshot(snapshot); }
+	inline pj_uint32_t GetAlarms() const { return analytics_.GetAlarms(); }
+	inline pj_uint32_t CheckAlarms(pj_uint64_t now_usec) { return analytics_.Check(ssrc_, now_usec); }
+
+	pj_uint32_t ssrc_;
+	pj_uint32_t refs_;                  // StreamMgrе, g_av_index_lock޸
+
+private:
+	void        OnRxVideo(shared_ptr<pj_uint8_t> video_frame, pj_uint16_t framelen, pj_timestamp arrival);
+	void        OnPrimeVideo(shared_ptr<gop_packets_t> gop);
+	void        OnFlush(std::function<void ()> done);
+	void        Publish();
+	void        Schedule(pj_uint32_t ts, const pj_timestamp &arrival);
+	void        UpdateStats(const pj_timestamp &arrival, const pj_timestamp &publish_start);
+	pj_bool_t   GateFrame(pj_bool_t complete, pj_bool_t reference, pj_bool_t keyframe);
+	pj_bool_t   decode_rtp_packet(const pj_uint8_t *rtp_frame, pj_uint16_t framelen, const pj_timestamp &arrival);
+	pj_status_t decode_vid_frame();
+
+	pj_pool_t         *pool_;
+	vid_stream_t      *stream_;
+	VideoDecoder      *decoder_;
+	video_frame_ptr_t  decoded_;        // һ֡, ֻڱ߳з
+	pj_uint32_t        decode_usec_;    // һDecode()ĺʱ
+	pj_timestamp       tail_arrival_;   // jitter bufferİĵʱ
+	pj_timestamp       frame_arrival_;  // decoded_һ֡һĵʱ. һ֡װ, ô
+	decode_stats_t     stats_;
+	StreamStats        rtp_stats_;      // հlibevent߳и, ʾڱ߳и
+	PlayoutClock       playout_;        // ֻڱ߳з
+	VideoAnalytics     analytics_;
+	av_sync_state_t    av_sync_;        // ֻڱ߳з
+	pj_bool_t          ref_broken_;     // οѶ, ȴIDRrecovery point
+	pj_bool_t          stalled_;        // 򶪰ͣ(ڸʱȴؼ֡)
+	pj_timestamp       stall_start_;
+	mutex              subscribers_lock_;
+	vector<Screen *>   subscribers_;
+	video_frame_ptr_t  last_frame_;     // ¶ĵĻʾһ֡
+	pj_uint32_t        epoch_;          // ÿFlushһ, еľ֡ݴ˶; ڱ߳гsubscribers_lock_޸
+	PoolThread<std::function<void ()>> video_thread_pool_;
+};
+
+#endif
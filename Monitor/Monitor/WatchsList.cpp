@@ -1,5 +1,14 @@
 #include "stdafx.h"
+#include <algorithm>
+
 #include "WatchsList.h"
+#include "SpeakerIndex.h"
+
+#ifdef __ABS_FILE__
+#undef __ABS_FILE__
+#endif
+
+#define __ABS_FILE__ "WatchsList.cpp"
 
 WatchsList g_watchs_list;
 
@@ -8,6 +17,7 @@ WatchsList::WatchsList()
 	, title_(nullptr)
 	, watching_(PJ_FALSE)
 	, page_(0)
+	, waiting_(INVALID_NODE_HANDLE)
 {
 }
 
@@ -29,12 +39,26 @@ void WatchsList::End()
 	watching_ = PJ_FALSE;
 	node_ = nullptr;
 	title_ = nullptr;
-	rooms_.clear();
 	page_ = 0;
+	waiting_ = INVALID_NODE_HANDLE;
 
-	while(!traverse_stack_.empty())
+	room_vec_t rooms;
 	{
-		Pop();
+		lock_guard<mutex> lock(watchs_lock_);
+		Rooms(rooms);
+		rooms_.Clear();
+		rooms_index_.clear();
+
+		while(!traverse_stack_.empty())
+		{
+			Pop();
+		}
+	}
+
+	// ܳwatchs_lock_ȡroom_lock_
+	for(pj_uint32_t i = 0; i < rooms.size(); ++ i)
+	{
+		g_health_monitor.DelRoom(rooms[i]);
 	}
 }
 
@@ -82,33 +106,97 @@ void WatchsList::OnTraverse()
 	}
 }
 
+void WatchsList::Wait(node_handle_t handle)
+{
+	RETURN_IF_FAIL(watching_);
+
+	waiting_ = handle;
+}
+
+// PJ_TRUEʾڵڵ, ÷űӽڵ
+pj_bool_t WatchsList::OnLoaded(node_handle_t handle)
+{
+	RETURN_VAL_IF_FAIL(watching_ && handle != INVALID_NODE_HANDLE && handle == waiting_, PJ_FALSE);
+
+	waiting_ = INVALID_NODE_HANDLE;
+
+	return PJ_TRUE;
+}
+
 void WatchsList::AddRoom(TitleRoom *room)
 {
 	RETURN_IF_FAIL(watching_ == PJ_TRUE);
 	RETURN_IF_FAIL(room != nullptr);
 	RETURN_IF_FAIL(title_ != nullptr && title_->BelowWatchedNode(room, node_));
 
+	{
+		// TitleRoom֪ͨû仯ʱļ˳һ
+		lock_guard<mutex> room_lock(room->room_lock_);
+		lock_guard<mutex> lock(watchs_lock_);
+
+		// RoomsInfo may be resent for a room which was already traversed.
+		RETURN_IF_FAIL(rooms_index_.find(room) == rooms_index_.end());
+
+		room_key_t key = {room->order_, room->id_, room};
+		rooms_.Insert(key, room, room->users_order_.size());
+		rooms_index_[room] = key;
+	}
+
+	g_health_monitor.AddRoom(room);
+
 	sinashow::SendMessage(WM_CONTINUE_TRAVERSE, (WPARAM)title_, (LPARAM)0);
+}
+
+void WatchsList::DelRoom(TitleRoom *room)
+{
+	lock_guard<mutex> lock(watchs_lock_);
 
-	rooms_.insert(room);
+	room_index_t::iterator pindex = rooms_index_.find(room);
+	RETURN_IF_FAIL(pindex != rooms_index_.end());
+
+	rooms_.Erase(pindex->second);
+	rooms_index_.erase(pindex);
 }
 
-pj_uint32_t WatchsList::Page()
+// TitleRoomڳroom_lock_ʱ
+void WatchsList::OnRoomResized(TitleRoom *room, pj_uint32_t user_count)
+{
+	lock_guard<mutex> lock(watchs_lock_);
+
+	room_index_t::iterator pindex = rooms_index_.find(room);
+	RETURN_IF_FAIL(pindex != rooms_index_.end());
+
+	rooms_.Set(pindex->second, user_count);
+}
+
+// TitleRoomorder_仯, µorder_·rooms_
+void WatchsList::OnRoomReordered(TitleRoom *room)
 {
+	lock_guard<mutex> lock(watchs_lock_);
+
+	room_index_t::iterator pindex = rooms_index_.find(room);
+	RETURN_IF_FAIL(pindex != rooms_index_.end());
+	RETURN_IF_FAIL(pindex->second.order != room->order_);
+
 	pj_uint32_t user_count = 0;
-	room_set_t::iterator proom = rooms_.begin();
-	for (; proom != rooms_.end(); ++proom)
-	{
-		room_set_t::value_type room = *proom;
-		if (room != nullptr)
-		{
-			room->IncreaseCount(user_count);
-		}
-	}
+	rooms_.Erase(pindex->second, &user_count);
+	pindex->second.order = room->order_;
+	rooms_.Insert(pindex->second, room, user_count);
+}
 
-	return (user_count % MAXIMAL_SCREEN_NUM == 0) ?
-		(user_count / MAXIMAL_SCREEN_NUM) :
-		(user_count / MAXIMAL_SCREEN_NUM) + 1;
+// watchs_lock_ʱ
+void WatchsList::Rooms(room_vec_t &rooms)
+{
+	rooms.reserve(rooms_.Size());
+	rooms_.Visit([&rooms](TitleRoom *room, pj_uint32_t) { rooms.push_back(room); });
+}
+
+pj_uint32_t WatchsList::Page()
+{
+	lock_guard<mutex> lock(watchs_lock_);
+	pj_uint64_t user_count = rooms_.Total();
+
+	return (pj_uint32_t)((user_count + MAXIMAL_SCREEN_NUM - 1) / MAXIMAL_SCREEN_NUM);
 }
 
 void WatchsList::NextPage()
@@ -127,23 +215,157 @@ void WatchsList::PrevPage()
 	OnShowPage();
 }
 
-void WatchsList::OnShowPage()
+/**
+ * ѹԾȰв鿴еû, Ծһҳ, CPUҵڶû.
+ * Ծhealth-only, Ҫhealth_enable. ıpage_, ҷҳصԭ˳.
+ */
+void WatchsList::ActivePage()
 {
-	sinashow::SendMessage(WM_CLEAN_SCREENS, (WPARAM)0, (LPARAM)0);
+	RETURN_IF_FAIL(watching_ == PJ_TRUE);
+	RETURN_IF_FAIL(g_client_config.health_enable);
+
+	vector<user_ref_t> users;
+	CollectAll(users);
+	RETURN_IF_FAIL(!users.empty());
 
-	pj_uint32_t first = (page_ - 1) * MAXIMAL_SCREEN_NUM;
+	vector<pj_uint32_t> ssrcs, scores;
+	Ssrcs(users, VIDEO_INDEX, ssrcs);
+	g_health_monitor.GetActivity(ssrcs, scores);
 
-	pj_uint32_t offset = 0;
-	room_set_t::iterator proom = rooms_.begin();
-	for (; proom != rooms_.end(); ++proom)
+	ShowRanked("activity", users, scores);
+}
+
+/**
+ * ˵ı, ˵û. ֻproxyתƵûз,
+ * ͬʱhealth_enableʱǲ鿴еû, ֻԤȡû֮.
+ */
+void WatchsList::SpeakerPage()
+{
+	RETURN_IF_FAIL(watching_ == PJ_TRUE);
+	RETURN_IF_FAIL(g_client_config.speaker_enable);
+
+	vector<user_ref_t> users;
+	CollectAll(users);
+	RETURN_IF_FAIL(!users.empty());
+
+	vector<pj_uint32_t> ssrcs, scores;
+	Ssrcs(users, AUDIO_INDEX, ssrcs);
+	g_speaker_index.GetScores(ssrcs, scores);
+
+	ShowRanked("speaking", users, scores);
+}
+
+void WatchsList::CollectAll(vector<user_ref_t> &users)
+{
+	room_vec_t rooms;
 	{
-		room_set_t::value_type room = *proom;
-		if (room != nullptr)
+		lock_guard<mutex> lock(watchs_lock_);
+		Rooms(rooms);
+	}
+
+	for(pj_uint32_t i = 0; i < rooms.size(); ++ i)
+	{
+		rooms[i]->GetPageUsers(0, (pj_uint32_t)-1, users);
+	}
+}
+
+// g_av_index_lock°ѾΪƵƵssrc, ûѱɾʱΪ0
+void WatchsList::Ssrcs(const vector<user_ref_t> &users, pj_uint8_t media, vector<pj_uint32_t> &ssrcs)
+{
+	ssrcs.assign(users.size(), 0);
+
+	lock_guard<mutex> lock(g_av_index_lock);
+	for(pj_uint32_t i = 0; i < users.size(); ++ i)
+	{
+		User *user = resolve_user(users[i]);
+		if(user != nullptr)
 		{
-			if (room->OnShowPage(offset, first) != PJ_SUCCESS)
-			{
-				return;
-			}
+			ssrcs[i] = media == AUDIO_INDEX ? user->audio_ssrc_ : user->video_ssrc_;
 		}
 	}
-}
\ No newline at end of file
+}
+
+// ߵһҳ, scoresusersһһӦ
+void WatchsList::ShowRanked(const char *what, const vector<user_ref_t> &users, const vector<pj_uint32_t> &scores)
+{
+	// ֵͬİԭ˳
+	vector<pj_uint32_t> order(users.size());
+	for(pj_uint32_t i = 0; i < order.size(); ++ i)
+	{
+		order[i] = i;
+	}
+	pj_uint32_t count = MIN((pj_uint32_t)order.size(), (pj_uint32_t)MAXIMAL_SCREEN_NUM);
+	std::partial_sort(order.begin(), order.begin() + count, order.end(),
+		[&scores](pj_uint32_t i1, pj_uint32_t i2) { return scores[i1] != scores[i2] ? scores[i1] > scores[i2] : i1 < i2; });
+
+	watch_page_t *page = new watch_page_t();
+	for(pj_uint32_t i = 0; i < count; ++ i)
+	{
+		page->users.push_back(users[order[i]]);
+	}
+
+	PJ_LOG(4, (__ABS_FILE__, "ShowRanked() => %u users ranked by %s, top[%u] last shown[%u]",
+		users.size(), what, scores[order[0]], scores[order[count - 1]]));
+
+	sinashow::SendMessage(WM_SHOW_PAGE, (WPARAM)page, (LPARAM)0);
+}
+
+// ҳ彻ScreenMgrһл, ҳԤȡ
+void WatchsList::OnShowPage()
+{
+	if(page_ == 0)
+	{
+		sinashow::SendMessage(WM_CLEAN_SCREENS, (WPARAM)0, (LPARAM)0);
+		return;
+	}
+
+	watch_page_t *page = new watch_page_t();
+	CollectPage(page_, page->users);
+
+	if(g_client_config.prefetch_pages > 0 && page_ < Page())
+	{
+		CollectPage(page_ + 1, page->prefetch);
+	}
+	if(g_client_config.prefetch_pages > 1 && page_ > 1)
+	{
+		CollectPage(page_ - 1, page->prefetch);
+	}
+
+	sinashow::SendMessage(WM_SHOW_PAGE, (WPARAM)page, (LPARAM)0);
+}
+
+void WatchsList::CollectPage(pj_uint32_t page, vector<user_ref_t> &users)
+{
+	RETURN_IF_FAIL(page > 0);
+
+	typedef struct
+	{
+		TitleRoom  *room;
+		pj_uint32_t skip;
+		pj_uint32_t count;
+	} page_slice_t;
+
+	page_slice_t slices[MAXIMAL_SCREEN_NUM];
+	pj_uint32_t  slice_count = 0;
+
+	{
+		lock_guard<mutex> lock(watchs_lock_);
+
+		// ҵҳһûڵķ, ֮ȡMAXIMAL_SCREEN_NUMû
+		pj_uint64_t first = (pj_uint64_t)(page - 1) * MAXIMAL_SCREEN_NUM;
+		pj_uint32_t left  = MAXIMAL_SCREEN_NUM;
+		rooms_.VisitFrom(first, [&](TitleRoom *room, pj_uint32_t skip, pj_uint32_t count) -> bool
+		{
+			page_slice_t slice = {room, skip, MIN(count - skip, left)};
+			slices[slice_count ++] = slice;
+			left -= slice.count;
+			return left > 0;
+		});
+	}
+
+	// watchs_lock_, room_lock_
+	for(pj_uint32_t i = 0; i < slice_count; ++ i)
+	{
+		slices[i].room->GetPageUsers(slices[i].skip, slices[i].count, users);
+	}
+}
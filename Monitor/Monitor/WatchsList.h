@@ -5,7 +5,10 @@
 #include <vector>
 #include <list>
 #include <set>
+#include <mutex>
+#include <unordered_map>
 
+#include "OrderTree.hpp"
 #include "TitleRoom.h"
 #include "Title.h"
 #include "Screen.h"
@@ -15,11 +18,43 @@ using std::stack;
 using std::vector;
 using std::list;
 using std::set;
+using std::mutex;
+using std::lock_guard;
 
 class Title;
 class TitleRoom;
+class User;
 typedef list<User *> users_list_t;
-typedef set<TitleRoom *, order_cmp<TitleRoom>> room_set_t;
+typedef vector<TitleRoom *> room_vec_t;
+
+// rooms_еλ, order_仯ʱþkeyɾٲ
+typedef struct
+{
+	order_t     order;
+	pj_int32_t  id;
+	TitleRoom  *room;
+} room_key_t;
+
+struct room_key_cmp
+{
+	bool operator() (const room_key_t &k1, const room_key_t &k2) const
+	{
+		if(k1.order != k2.order) return k1.order < k2.order;
+		if(k1.id != k2.id) return k1.id < k2.id;
+		return k1.room < k2.room;
+	}
+};
+
+typedef OrderTree<room_key_t, TitleRoom *, room_key_cmp> room_tree_t;    // order_cmp, ȨֵΪû
+typedef std::unordered_map<TitleRoom *, room_key_t> room_index_t;        // room -> rooms_еkey
+
+// ̴߳ʱֻ, ߳g_av_index_lock½, ûѱɾʱΪnullptr
+typedef struct
+{
+	vector<user_ref_t> users;         // ±꼴Ļ
+	vector<user_ref_t> prefetch;      // ҳû, ֻתgop, 
+} watch_page_t;
+
 class WatchsList
 {
 public:
@@ -29,25 +64,40 @@ public:
 	void  Begin(Node *node, Title *title);
 	void  End();
 	void  AddRoom(TitleRoom *room);
+	void  DelRoom(TitleRoom *room);
+	void  OnRoomResized(TitleRoom *room, pj_uint32_t user_count);
+	void  OnRoomReordered(TitleRoom *room);
 	void  NextPage();
 	void  PrevPage();
+	void  ActivePage();
+	void  SpeakerPage();
 	Node *Top();
 	void  Push(Node *node);
 	void  Pop();
 	void  OnTraverse();
+	void  Wait(node_handle_t handle);
+	pj_bool_t OnLoaded(node_handle_t handle);
 	inline pj_bool_t Watching() const { return watching_; }
 
 private:
 	pj_uint32_t Page();
 	void OnShowPage();
+	void CollectPage(pj_uint32_t page, vector<user_ref_t> &users);
+	void CollectAll(vector<user_ref_t> &users);
+	void Ssrcs(const vector<user_ref_t> &users, pj_uint8_t media, vector<pj_uint32_t> &ssrcs);
+	void ShowRanked(const char *what, const vector<user_ref_t> &users, const vector<pj_uint32_t> &scores);
+	void Rooms(room_vec_t &rooms);
 
 private:
 	Node       *node_;
 	Title      *title_;
 	pj_bool_t   watching_;
 	pj_uint32_t page_;
-	room_set_t  rooms_;
+	mutex        watchs_lock_;        // room_lock_֮ȡ
+	room_tree_t  rooms_;
+	room_index_t rooms_index_;
 	stack<Node *> traverse_stack_;
+	node_handle_t waiting_;           // ͣڵ, ӽڵӺ̨ȡ
 };
 
 extern WatchsList g_watchs_list;